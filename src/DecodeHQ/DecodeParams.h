@@ -14,7 +14,7 @@
 #include "Picture.h"
 #include "WaveletTransform.h"
 
-enum Output {TRANSFORM, QUANTISED, INDICES, DECODED};
+enum Output {TRANSFORM, QUANTISED, INDICES, DECODED, NONE};
 
 std::ostream& operator<<(std::ostream&, Output value);
 
@@ -34,9 +34,13 @@ struct ProgramParams {
   bool topFieldFirst;
   enum WaveletKernel kernel;
   int waveletDepth;
+  int waveletDepthHo;
   int ySize;
   int xSize;
   enum Output output;
+  bool y4mOutput; // Decoded output is Y4M
+  bool lumaOnly; // Skip decoding chroma
+  std::string expectedMD5; // Empty unless verifying output None
   int slice_scalar;
   std::string error;
 };
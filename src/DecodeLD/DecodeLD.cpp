@@ -20,6 +20,11 @@ Its primary output is the decoded image sequence. However it may produce alterna
   2 the quantised wavelet coefficients\n\
   3 the quantisation indices used for each slice\n\
   4 the decoded sequence\n\
+  5 none, to measure decode throughput (optionally verifying the MD5 of the decoded sequence)\n\
+With output None frames are decoded but not clipped, formatted or written, and the frame\n\
+rate and the time taken by each decoding stage are reported on exit. With --expectMD5 the\n\
+frames are formatted in memory to verify the MD5 of the output Decoded would have written.\n\
+With --lumaOnly chroma is skipped, without being decoded, and only luma is output.\n\
 Input is just a sequence of compressed bytes.\n\
 Output (where appropriate) are in planar format (4:4:4, 4:2:2, 4:2:0 or RGB).\n\
 There can be 1 to 4 bytes per sample and the data is left (MSB) justified.\n\
@@ -33,7 +38,9 @@ const char* details[] = {version, summary, description};
 #include <iostream> //For cin, cout, cerr
 #include <string>
 #include <fstream>
+#include <sstream>
 #include <cstdio> // for perror
+#include <cctype> // for tolower
 
 #include "DecodeParams.h"
 #include "Arrays.h"
@@ -43,6 +50,8 @@ const char* details[] = {version, summary, description};
 #include "Quantisation.h"
 #include "WaveletTransform.h"
 #include "Utils.h"
+#include "Timing.h"
+#include "Checksum.h"
 
 using std::cout;
 using std::cin;
@@ -56,6 +65,13 @@ using std::ios_base;
 using std::istream;
 using std::ostream;
 
+// The format of decoded pictures (and their transforms), without chroma if
+// only luma is decoded, so chroma is skipped from slice parsing onwards
+const PictureFormat decodedFormat(int height, int width, ColourFormat chromaFormat, bool lumaOnly) {
+  const PictureFormat format(height, width, chromaFormat);
+  return (lumaOnly ? luma_only_format(format) : format);
+}
+
 int main(int argc, char * argv[]) {
   
 try { //Giant try block around all code to get error messages
@@ -80,10 +96,16 @@ try { //Giant try block around all code to get error messages
   const bool topFieldFirst = params.topFieldFirst;
   const WaveletKernel kernel = params.kernel;
   const int waveletDepth = params.waveletDepth;
+  const int waveletDepthHo = params.waveletDepthHo;
   const int ySize = params.ySize;
   const int xSize = params.xSize;
   const int compressedBytes = params.compressedBytes;
   const Output output = params.output;
+  string expectedMD5 = params.expectedMD5;
+  for (unsigned int i=0; i<expectedMD5.size(); ++i) expectedMD5[i] = std::tolower(expectedMD5[i]);
+  const bool verifyMD5 = !expectedMD5.empty();
+  const bool y4mOutput = params.y4mOutput;
+  const bool lumaOnly = params.lumaOnly;
 
   if (verbose) {
     clog << endl;
@@ -124,7 +146,7 @@ try { //Giant try block around all code to get error messages
   // No point in continuing if can't open output file.
   filebuf outFileBuffer; // For file output. Needs to be defined here to remain in scope
   streambuf *pOutBuffer; // Either standard output buffer or a file buffer
-  if (outFileName=="-") { // Use standard out
+  if ((outFileName=="-") || (output==NONE)) { // Use standard out (nothing is written for output None)
     //Set standard input to binary mode.
     //Only relevant for Windows (*nix is always binary)
     if ( utils::setstdoutmode(std::ios_base::binary) == -1 ) {
@@ -142,6 +164,12 @@ try { //Giant try block around all code to get error messages
   }
   ostream outStream(pOutBuffer);
 
+  // Decoded Y4M output starts with a header (the frame rate is unknown)
+  if (y4mOutput && (output!=NONE)) {
+    outStream << Y4MHeader(PictureFormat(height, width, chromaFormat), lumaDepth, interlaced, topFieldFirst);
+    outStream << pictureio::y4m;
+  }
+
   if (verbose) {
     clog << "bytes per sample= " << bytes << endl;
     clog << "luma depth (bits) = " << lumaDepth << endl;
@@ -149,21 +177,24 @@ try { //Giant try block around all code to get error messages
     clog << "height = " << height << endl;
     clog << "width = " << width << endl;
     clog << "chroma format = " << chromaFormat << endl;
+    if (lumaOnly) clog << "luma only = true" << endl;
     clog << "interlaced = " << std::boolalpha << interlaced << endl;
     if (interlaced) clog << "top field first = " << std::boolalpha << topFieldFirst << endl;
     clog << "wavelet kernel = " << kernel << endl;
     clog << "wavelet depth = " << waveletDepth << endl;
+    clog << "horizontal only wavelet depth = " << waveletDepthHo << endl;
     clog << "vertical slice size (in units of 2**(wavelet depth)) = " << ySize << endl;
-    clog << "horizontal slice size (in units of 2**(wavelet depth)) = " << xSize << endl;
+    clog << "horizontal slice size (in units of 2**(wavelet depth+horizontal only depth)) = " << xSize << endl;
     clog << "output = " << output << endl;
+    if (verifyMD5) clog << "expected MD5 = " << expectedMD5 << endl;
   }
 
   // Calculate number of slices per picture
   const int yTransformSize = ySize*utils::pow(2,waveletDepth);
-  const int xTransformSize = xSize*utils::pow(2,waveletDepth);
+  const int xTransformSize = xSize*utils::pow(2,waveletDepth+waveletDepthHo);
   const int pictureHeight = ( (interlaced) ? height/2 : height);
   const int paddedPictureHeight = paddedSize(pictureHeight, waveletDepth);
-  const int paddedWidth = paddedSize(width, waveletDepth);
+  const int paddedWidth = paddedSize(width, waveletDepth+waveletDepthHo);
   const int ySlices = paddedPictureHeight/yTransformSize;
   const int xSlices = paddedWidth/xTransformSize;
   if (paddedPictureHeight != (ySlices*yTransformSize) ) {
@@ -189,7 +220,7 @@ try { //Giant try block around all code to get error messages
   }
 
   // Calculate the quantisation matrix
-  const Array1D qMatrix = quantMatrix(kernel, waveletDepth);
+  const Array1D qMatrix = quantMatrix(kernel, waveletDepth, waveletDepthHo);
   if (verbose) {
     clog << "Quantisation matrix = " << qMatrix[0];
     for (unsigned int i=1; i<qMatrix.size(); ++i) {
@@ -202,22 +233,33 @@ try { //Giant try block around all code to get error messages
   // First calculate number of bytes for each slice
   const int pictureBytes = (interlaced ? compressedBytes/2 : compressedBytes);
   const Array2D sliceBytes = slice_bytes(ySlices, xSlices, pictureBytes, 1);
-  const PictureFormat transformFormat(paddedPictureHeight, paddedWidth, chromaFormat);
-  Slices inSlices(transformFormat, waveletDepth, ySlices, xSlices);
+  const PictureFormat transformFormat = decodedFormat(paddedPictureHeight, paddedWidth, chromaFormat, lumaOnly);
+  Slices inSlices(transformFormat, waveletDepth, ySlices, xSlices, waveletDepthHo);
 
   // Define picture format (field or frame)
-  const PictureFormat picFormat(pictureHeight, width, chromaFormat);
+  const PictureFormat picFormat = decodedFormat(pictureHeight, width, chromaFormat, lumaOnly);
 
   // Create Frame to hold output data
-  const PictureFormat frameFormat(height, width, chromaFormat);
+  const PictureFormat frameFormat = decodedFormat(height, width, chromaFormat, lumaOnly);
   Frame outFrame(frameFormat, interlaced, topFieldFirst);
   
+  // Decoding stage times, and checksum of the decoded output, for output None
+  timing::Samples readTimes;
+  timing::Samples mergeTimes;
+  timing::Samples quantiseTimes;
+  timing::Samples transformTimes;
+  timing::Samples verifyTimes;
+  double stageStart = 0.0;
+  const double decodeStart = timing::now();
+  checksum::MD5 outputMD5;
+
   int frame = 0;
   const int framePics = (interlaced ? 2 : 1);
   while (true) {
 
     for (int pic=0; pic<framePics; ++pic) {
 
+      stageStart = timing::now();
       // Read input from planar file
       if (verbose) {
         if (interlaced)
@@ -236,16 +278,36 @@ try { //Giant try block around all code to get error messages
         }
         else {
           if (verbose) clog << "\rEnd of input reached after " << frame << " frames     " << endl;
+          if (output==NONE) {
+            const double seconds = timing::now()-decodeStart;
+            clog << endl << "Decoded " << frame << " frames in " << seconds << " s = "
+                 << frame/seconds << " frames per second (including file input)" << endl;
+            timing::summarise(clog, "Read slices", readTimes, 1e3, "ms");
+            timing::summarise(clog, "Merge slices", mergeTimes, 1e3, "ms");
+            timing::summarise(clog, "Inverse quantise", quantiseTimes, 1e3, "ms");
+            timing::summarise(clog, "Inverse transform", transformTimes, 1e3, "ms");
+            if (verifyMD5) {
+              timing::summarise(clog, "Clip, format and checksum", verifyTimes, 1e3, "ms");
+              const string md5 = outputMD5.digest();
+              if (md5!=expectedMD5) {
+                cerr << "MD5 mismatch: expected " << expectedMD5 << ", decoded " << md5 << endl;
+                return EXIT_FAILURE;
+              }
+              clog << "MD5 verified: " << md5 << endl;
+            }
+          }
           if (inFileName!="-") inFileBuffer.close();
           if (outFileName!="-") outFileBuffer.close();
           return EXIT_SUCCESS;
         }
       }
       else clog << endl;
+      timing::lap(readTimes, stageStart);
     
       // Reorder quantised coefficients from slice order to transform order
       if (verbose) clog << "Merge slices into full picture" << endl;
       const Picture yuvQCoeffs = merge_blocks(inSlices.yuvSlices);
+      timing::lap(mergeTimes, stageStart);
 
       if (output==INDICES) {
         //Write quantisation indices as 1 byte unsigned values
@@ -273,7 +335,8 @@ try { //Giant try block around all code to get error messages
     
       // Inverse quantise in transform order
       if (verbose) clog << "Inverse quantise" << endl;
-      const Picture yuvTransform = inverse_quantise_transform(yuvQCoeffs, inSlices.qIndices, qMatrix);
+      const Picture yuvTransform = inverse_quantise_transform(yuvQCoeffs, inSlices.qIndices, qMatrix, waveletDepthHo);
+      timing::lap(quantiseTimes, stageStart);
 
       if (output==TRANSFORM) {
         //Write transform output as 4 byte 2's comp values
@@ -289,7 +352,11 @@ try { //Giant try block around all code to get error messages
 
       // Inverse wavelet transform
       if (verbose) clog << "Inverse transform" << endl;
-      const Picture outPicture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picFormat);
+      const Picture outPicture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picFormat, waveletDepthHo);
+      timing::lap(transformTimes, stageStart);
+
+      // Nothing to output, so skip assembling, clipping and formatting frames
+      if ((output==NONE) && !verifyMD5) continue;
   
       // Copy picture to output frame
       if (verbose) clog << "Copy picture to output frame" << endl;
@@ -302,6 +369,11 @@ try { //Giant try block around all code to get error messages
 
     }
 
+    if ((output==NONE) && !verifyMD5) {
+      ++frame;
+      continue;
+    }
+
     if (verbose) clog << "Clipping output" << endl;
     {
       const int yMin = -utils::pow(2, lumaDepth-1);
@@ -311,6 +383,26 @@ try { //Giant try block around all code to get error messages
       outFrame.frame(clip(outFrame, yMin, yMax, uvMin, uvMax));
     }
 
+    if (output==NONE) {
+      // Format the frame in memory to verify the MD5 of the decoded output
+      if (verbose) clog << "Checksumming decoded frame" << endl;
+      std::ostringstream pixels;
+      if (y4mOutput) {
+        if (frame==0) pixels << Y4MHeader(PictureFormat(height, width, chromaFormat), lumaDepth, interlaced, topFieldFirst);
+        pixels << pictureio::y4m;
+      }
+      pixels << pictureio::wordWidth(bytes); // Set number of bytes per value in file
+      pixels << pictureio::left_justified;
+      pixels << pictureio::offset_binary;
+      pixels << pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
+      pixels << outFrame;
+      const string data = pixels.str();
+      outputMD5.update(data.data(), data.size());
+      timing::lap(verifyTimes, stageStart);
+      ++frame;
+      continue;
+    }
+
     if (verbose) clog << "Writing decoded output file" << endl;
     outStream << pictureio::wordWidth(bytes); // Set number of bytes per value in file
     outStream << pictureio::left_justified;
@@ -67,14 +67,18 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[
 
     // Define tclap command line parameters (and add them to tclap command line)
     UnlabeledValueArg<string> inFile("inFile", "Input file name", true, "-", "string", cmd);
-    UnlabeledValueArg<string> outFile("outFile", "Output file name", true, "-", "string", cmd);
+    UnlabeledValueArg<string> outFile("outFile", "Output file name (not used for output None)", false, "-", "string", cmd);
     SwitchArg verbosity("v", "verbose", "Output extra information to standard log", cmd);
     // "cla" prefix == command line argument
-    ValueArg<Output> cla_output("o", "output", "Program output (Transform, Quantised, Indices, Decoded)", false, DECODED, "string", cmd);
+    ValueArg<Output> cla_output("o", "output", "Program output (Transform, Quantised, Indices, Decoded, None)", false, DECODED, "string", cmd);
+    SwitchArg cla_y4m("Y", "y4m", "Decoded output is Y4M (the default for .y4m file names)", cmd, false);
+    SwitchArg cla_lumaOnly("", "lumaOnly", "Decode luma only, skipping the chroma data in each slice (outputs have no chroma)", cmd, false);
+    ValueArg<string> cla_expectMD5("", "expectMD5", "With output None, verify the MD5 of the output Decoded would have written", false, "", "string", cmd);
     ValueArg<int> cla_compressedBytes("s", "compressedBytes", "compressed bytes (size in bytes)", true, 0, "integer", cmd);
-    ValueArg<int> cla_hSliceSize("a", "hSlice", "Horizontical slice size (in units of 2**(wavelet depth))", true, 0, "integer", cmd);
+    ValueArg<int> cla_hSliceSize("a", "hSlice", "Horizontical slice size (in units of 2**(wavelet depth + horizontal only depth))", true, 0, "integer", cmd);
     ValueArg<int> cla_vSliceSize("u", "vSlice", "Vertical slice size (in units of 2**(wavelet depth))", true, 0, "integer", cmd);
     ValueArg<int> cla_waveletDepth("d", "waveletDepth", "Wavelet transform depth", true, 0, "integer", cmd);
+    ValueArg<int> cla_waveletDepthHo("D", "waveletDepthHo", "Additional horizontal only wavelet transform depth (default 0)", false, 0, "integer", cmd);
     ValueArg<WaveletKernel> cla_kernel("k", "kernel", "Wavelet kernel (DD97, LeGall, DD137, Haar0, Haar1, Fidelity, Daub97)", true, NullKernel, "string", cmd);
     SwitchArg cla_bottomFieldFirst("b", "bottomFieldFirst", "Bottom field is earliest (defaults to top field first))", cmd, false);
     SwitchArg cla_topFieldFirst("t", "topFieldFirst", "Top field is earliest (defaults to top field first))", cmd, true);
@@ -106,10 +110,15 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[
     bool topFieldFirst = !cla_bottomFieldFirst.isSet();
     const WaveletKernel kernel = cla_kernel.getValue();
     const int waveletDepth = cla_waveletDepth.getValue();
+    const int waveletDepthHo = cla_waveletDepthHo.getValue();
     const int ySize = cla_vSliceSize.getValue();
     const int xSize = cla_hSliceSize.getValue();
     const int compressedBytes = cla_compressedBytes.getValue();
     const Output output = cla_output.getValue();
+    const bool y4mOutput = ((output==DECODED) || (output==NONE)) &&
+                           (cla_y4m.isSet() || pictureio::isY4MFileName(outFileName));
+    const bool lumaOnly = cla_lumaOnly.getValue();
+    const string expectedMD5 = cla_expectMD5.getValue();
 
     // Check for valid combinations of parameters and options
     if ((chromaFormat==RGB) && (cla_lumaDepth.isSet() || cla_chromaDepth.isSet()))
@@ -122,6 +131,20 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[
       throw invalid_argument("field parity is incompatible with progressive image");
     if (cla_topFieldFirst.isSet() && cla_bottomFieldFirst.isSet())
       throw invalid_argument("image can't be both top field first and bottom field first: specify one or the other");
+    if (y4mOutput && (chromaFormat==RGB))
+      throw invalid_argument("Y4M output can't represent RGB");
+    if (lumaOnly && y4mOutput)
+      throw invalid_argument("Y4M output needs chroma, so can't be luma only");
+    if (y4mOutput && (cla_lumaDepth.isSet() || cla_chromaDepth.isSet()) &&
+        (cla_lumaDepth.getValue()!=cla_chromaDepth.getValue()))
+      throw invalid_argument("Y4M output needs the same luma and chroma bit depth");
+    if (!outFile.isSet() && (output!=NONE))
+      throw invalid_argument("an output file name is required unless output is None");
+    if (cla_expectMD5.isSet() && (output!=NONE))
+      throw invalid_argument("verifying an expected MD5 requires None output");
+    if (cla_expectMD5.isSet() &&
+        ((expectedMD5.size()!=32) || (expectedMD5.find_first_not_of("0123456789abcdefABCDEF")!=string::npos)))
+      throw invalid_argument("expected MD5 must be 32 hexadecimal digits");
 
     // Set default values
     if (!cla_bitDepth.isSet()) bitDepth = 8*bytes;
@@ -151,6 +174,8 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[
       throw std::invalid_argument("invalid wavelet kernel");
     if (waveletDepth<1)
       throw std::invalid_argument("wavelet depth must be 1 or more");
+    if (waveletDepthHo<0)
+      throw std::invalid_argument("horizontal only wavelet depth must be 0 or more");
     if (compressedBytes<1)
       throw std::invalid_argument("number of compressed bytes must be >0");
 
@@ -167,10 +192,14 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[
     params.topFieldFirst = topFieldFirst;
     params.kernel = kernel;
     params.waveletDepth = waveletDepth;
+    params.waveletDepthHo = waveletDepthHo;
     params.ySize = ySize;
     params.xSize = xSize;
     params.compressedBytes = compressedBytes;
     params.output = output;
+    params.y4mOutput = y4mOutput;
+    params.lumaOnly = lumaOnly;
+    params.expectedMD5 = expectedMD5;
 
   }
 
@@ -202,6 +231,9 @@ std::ostream& operator<<(std::ostream& os, Output output) {
     case DECODED:
       s = "Decoded";
       break;
+    case NONE:
+      s = "None";
+      break;
     default:
       s = "Unknown output!";
       break;
@@ -216,6 +248,7 @@ std::istream& operator>>(std::istream& is, Output& output) {
         else if (text == "Quantised") output = QUANTISED;
         else if (text == "Indices") output = INDICES;
         else if (text == "Decoded") output = DECODED;
+        else if (text == "None") output = NONE;
         else is.setstate(std::ios_base::badbit|std::ios_base::failbit);
         // Alternatively
         // else throw std::invalid_argument("invalid input");
@@ -0,0 +1,398 @@
+/*********************************************************************/
+/* DecodeMulti.cpp                                                   */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Decodes several VC-2 streams at once in one process, sharing a    */
+/* pool of decoding threads between them (e.g. for a multiviewer).   */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+const char version[] = __DATE__ " @ " __TIME__ ;
+const char summary[] = "Decodes several VC-2 LD or HQ streams concurrently using a shared pool of threads";
+const char description[] = "\
+This program decodes several VC-2 streams (LD or HQ profile) at once, in one process.\n\
+Decoding is shared between a fixed pool of threads. Each task decodes the next picture\n\
+of one stream, and tasks from all the streams are run earliest deadline first. The\n\
+deadline of each picture follows from the frame rate of its stream, counting from the\n\
+start of decoding, so streams are decoded fairly in proportion to their picture rates.\n\
+Each stream decodes one picture at a time, so its pictures are decoded in order, and\n\
+reuses its decoding state (buffers, quantisation matrix) until its format changes.\n\
+Pictures are decoded in a single thread each, so use DecodeStream for a single stream.\n\
+Decoded frames are written as planar, offset binary, left justified samples (as\n\
+DecodeStream), to files named by replacing %d in the output pattern with the stream\n\
+number (from 0). Without an output pattern the streams are decoded but not written.\n\
+The proxy option outputs pictures reduced by 2**level in each dimension, by not\n\
+inverting the finest levels of the wavelet transform (e.g. tiles for a multiviewer).\n\
+A picture is late if it is decoded after its deadline. For each stream the number of\n\
+frames and late pictures, and the time spent decoding, are reported at the end.\n\
+The exit status is non zero if any stream fails to decode.\n\
+\n\
+Example: DecodeMulti -j 16 --proxy 2 -o tile%d.yuv in0.vc2 in1.vc2 in2.vc2 in3.vc2";
+const char* details[] = {version, summary, description};
+
+#include <cstdlib> //for EXIT_SUCCESS, EXIT_FAILURE
+#include <stdexcept> //For standard logic errors
+#include <iostream> //For cin, cout, cerr
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/bind/bind.hpp>
+
+#include "MultiParams.h"
+#include "Picture.h"
+#include "Frame.h"
+#include "WaveletTransform.h"
+#include "Quantisation.h"
+#include "Slices.h"
+#include "Utils.h"
+#include "DataUnit.h"
+#include "ThreadPool.h"
+#include "Timing.h"
+
+using std::clog;
+using std::endl;
+using std::string;
+using std::vector;
+using std::filebuf;
+using std::ios_base;
+using std::istream;
+using std::ostream;
+
+namespace {
+
+  // The output file name of a stream, replacing each "%d" in the pattern
+  const string outputName(const string& pattern, int stream) {
+    std::ostringstream number;
+    number << stream;
+    string name = pattern;
+    for (string::size_type at=name.find("%d"); at!=string::npos; at=name.find("%d", at+number.str().size())) {
+      name.replace(at, 2, number.str());
+    }
+    return name;
+  }
+
+  // Only the format of a stream affects its decoding state, not the picture
+  // number or slice size scalar (as for vc2d)
+  const string contextKey(const SequenceHeader& sequence, const PicturePreamble& preamble, bool lowDelay) {
+    std::ostringstream text;
+    text << sequence.height << ' ' << sequence.width << ' ' << sequence.chromaFormat << ' '
+         << sequence.interlace << ' ' << sequence.topFieldFirst << ' ' << sequence.bitdepth << ' '
+         << preamble.wavelet_kernel << ' ' << preamble.depth << ' ' << preamble.depth_ho << ' '
+         << preamble.slices_x << ' ' << preamble.slices_y << ' ' << lowDelay;
+    for (unsigned int band=0; band<preamble.quant_matrix.size(); ++band) {
+      text << (band==0 ? " q" : ",") << preamble.quant_matrix[band];
+    }
+    if (lowDelay) {
+      text << ' ' << preamble.slice_bytes.numerator << '/' << preamble.slice_bytes.denominator;
+    }
+    return text.str();
+  }
+
+  // Format dependent state for decoding a stream
+  struct Context {
+    Context(const SequenceHeader& sequence, const PicturePreamble& preamble, bool lowDelay, int proxy);
+    const PictureFormat picFormat; // Field or frame format, at full resolution
+    const Array1D qMatrix;
+    const Array2D sliceBytes; // Bytes per slice for low delay coding
+    Slices inSlices;
+    Frame outFrame; // At proxy resolution, if any
+  };
+
+  const PictureFormat pictureFormat(const SequenceHeader& sequence) {
+    return PictureFormat((sequence.interlace ? sequence.height/2 : sequence.height),
+                         sequence.width,
+                         sequence.chromaFormat);
+  }
+
+  const PictureFormat transformFormat(const SequenceHeader& sequence, const PicturePreamble& preamble) {
+    const int pictureHeight = (sequence.interlace ? sequence.height/2 : sequence.height);
+    return PictureFormat(paddedSize(pictureHeight, preamble.depth),
+                         paddedSize(sequence.width, preamble.depth+preamble.depth_ho),
+                         sequence.chromaFormat);
+  }
+
+  // The format of output frames (made of two proxy fields, if interlaced)
+  const PictureFormat frameFormat(const SequenceHeader& sequence, int proxy) {
+    const PictureFormat format = pictureFormat(sequence);
+    if (proxy==0) return PictureFormat(sequence.height, sequence.width, sequence.chromaFormat);
+    const PictureFormat reduced = proxyFormat(format, proxy);
+    const int fields = (sequence.interlace ? 2 : 1);
+    return PictureFormat(fields*reduced.lumaHeight(), reduced.lumaWidth(),
+                         fields*reduced.chromaHeight(), reduced.chromaWidth(),
+                         reduced.chromaFormat());
+  }
+
+  // Bytes for each slice of a picture, for low delay coding only
+  const Array2D ldSliceBytes(const PicturePreamble& preamble, bool lowDelay) {
+    if (!lowDelay) return Array2D(extents[preamble.slices_y][preamble.slices_x]);
+    const int pictureBytes = (preamble.slice_bytes.numerator*preamble.slices_y*preamble.slices_x)/
+                             preamble.slice_bytes.denominator;
+    return slice_bytes(preamble.slices_y, preamble.slices_x, pictureBytes, 1);
+  }
+
+  Context::Context(const SequenceHeader& sequence, const PicturePreamble& preamble, bool lowDelay, int proxy):
+    picFormat(pictureFormat(sequence)),
+    qMatrix(preamble.quant_matrix.size()>0 ?
+            preamble.quant_matrix :
+            quantMatrix(preamble.wavelet_kernel, preamble.depth, preamble.depth_ho)),
+    sliceBytes(ldSliceBytes(preamble, lowDelay)),
+    inSlices(transformFormat(sequence, preamble),
+             preamble.depth,
+             preamble.slices_y,
+             preamble.slices_x,
+             preamble.depth_ho),
+    outFrame(frameFormat(sequence, proxy), sequence.interlace, sequence.topFieldFirst) {
+  }
+
+  // Decodes one stream, a picture per task. Only one task of a stream is
+  // queued or running at a time, so a stream's state needs no locking.
+  class StreamDecoder {
+    public:
+      StreamDecoder(int number, const string& inFileName, const string& outFileName,
+                    int proxy, bool verbose, ThreadPool& pool);
+      // Queue the first picture, with deadlines counted from "start"
+      void start(double start);
+      const string inFileName;
+      int frames;
+      int pictures;
+      int latePictures;
+      double busy; // Seconds spent decoding
+      string error; // Empty unless decoding failed
+    private:
+      StreamDecoder(const StreamDecoder&); // Not copyable
+      StreamDecoder& operator=(const StreamDecoder&); // Not assignable
+      // Decode the next picture, then queue the one after (a pool task)
+      void decodeNext();
+      // Returns false at the end of the stream
+      const bool decodePicture();
+      void writeFrame();
+      const int number;
+      const int proxy;
+      const bool verbose;
+      ThreadPool& pool;
+      filebuf inBuffer;
+      filebuf outBuffer;
+      istream inStream;
+      ostream outStream;
+      const bool output;
+      SequenceHeader sequence;
+      bool haveSequence;
+      double period; // Picture (field or frame) period, or 0 if unknown
+      double startTime;
+      double deadline; // Of the picture being decoded
+      string key; // Of the current context
+      boost::scoped_ptr<Context> context;
+      int field; // Of an interlaced frame
+  };
+
+  StreamDecoder::StreamDecoder(int number, const string& inFileName, const string& outFileName,
+                               int proxy, bool verbose, ThreadPool& pool):
+    inFileName(inFileName),
+    frames(0),
+    pictures(0),
+    latePictures(0),
+    busy(0.0),
+    number(number),
+    proxy(proxy),
+    verbose(verbose),
+    pool(pool),
+    inStream(&inBuffer),
+    outStream(&outBuffer),
+    output(!outFileName.empty()),
+    haveSequence(false),
+    period(0.0),
+    startTime(0.0),
+    deadline(0.0),
+    field(0) {
+    if (!inBuffer.open(inFileName.c_str(), ios_base::in|ios_base::binary))
+      throw std::runtime_error("Failed to open input file \""+inFileName+"\"");
+    if (output && !outBuffer.open(outFileName.c_str(), ios_base::out|ios_base::binary))
+      throw std::runtime_error("Failed to open output file \""+outFileName+"\"");
+    inStream >> dataunitio::synchronise;
+  }
+
+  void StreamDecoder::start(double start) {
+    startTime = deadline = start;
+    pool.submit(boost::bind(&StreamDecoder::decodeNext, this), deadline);
+  }
+
+  void StreamDecoder::decodeNext() {
+    // The pool's threads are shared between the streams, so decode each
+    // picture in this thread only
+    const SerialComponents serial;
+    const double started = timing::now();
+    bool decoded = false;
+    try {
+      decoded = decodePicture();
+    }
+    catch (const std::exception& ex) {
+      error = ex.what();
+    }
+    const double finished = timing::now();
+    busy += finished-started;
+    if (!decoded) {
+      if (output) outBuffer.close();
+      return;
+    }
+    if ((period>0.0) && (finished>startTime+pictures*period)) ++latePictures;
+    deadline = startTime+(pictures+1)*period;
+    pool.submit(boost::bind(&StreamDecoder::decodeNext, this), deadline);
+  }
+
+  const bool StreamDecoder::decodePicture() {
+    while (inStream) {
+      DataUnit du;
+      inStream >> du;
+      if (du.type==SEQUENCE_HEADER) {
+        du.stream() >> sequence;
+        haveSequence = true;
+        const utils::Rational fps = frames_per_second(sequence.frameRate);
+        period = (fps.numerator>0 ? fps.denominator/(fps.numerator*(sequence.interlace ? 2.0 : 1.0)) : 0.0);
+        continue;
+      }
+      if (du.type==END_OF_SEQUENCE) return false;
+      if ((du.type!=LD_PICTURE) && (du.type!=HQ_PICTURE)) continue;
+      if (!haveSequence) throw std::runtime_error("picture before sequence header");
+
+      const bool lowDelay = (du.type==LD_PICTURE);
+      PicturePreamble preamble;
+      du.stream() >> dataunitio::majorVersion(sequence.major_version);
+      if (lowDelay) du.stream() >> dataunitio::lowDelay >> preamble;
+      else du.stream() >> dataunitio::highQualityVBR(1) >> preamble;
+      const string pictureKey = contextKey(sequence, preamble, lowDelay);
+      if (!context || (pictureKey!=key)) {
+        context.reset(new Context(sequence, preamble, lowDelay, proxy));
+        key = pictureKey;
+        field = 0;
+        if (verbose) {
+          std::ostringstream text; // So concurrent logs don't interleave
+          text << "Stream " << number << " format: " << key << "\n";
+          clog << text.str() << std::flush;
+        }
+      }
+
+      if (lowDelay) du.stream() >> sliceio::lowDelay(context->sliceBytes);
+      else du.stream() >> sliceio::highQualityVBR(preamble.slice_size_scalar);
+      du.stream() >> context->inSlices;
+      if (!du.stream()) throw std::runtime_error("failed to read compressed picture");
+
+      const Picture yuvQCoeffs = merge_blocks(context->inSlices.yuvSlices);
+      const Picture yuvTransform = (lowDelay ?
+        inverse_quantise_transform(yuvQCoeffs, context->inSlices.qIndices, context->qMatrix, preamble.depth_ho) :
+        inverse_quantise_transform_np(yuvQCoeffs, context->inSlices.qIndices, context->qMatrix, preamble.depth_ho));
+      const Picture outPicture = (proxy>0 ?
+        inverseWaveletProxy(yuvTransform, preamble.wavelet_kernel, preamble.depth,
+                            context->picFormat, proxy, preamble.depth_ho) :
+        inverseWaveletTransform(yuvTransform, preamble.wavelet_kernel, preamble.depth,
+                                context->picFormat, preamble.depth_ho));
+      ++pictures;
+
+      Frame& outFrame = context->outFrame;
+      if (sequence.interlace) {
+        if (field==0) {
+          outFrame.firstField(outPicture);
+          field = 1;
+          return true;
+        }
+        outFrame.secondField(outPicture);
+        field = 0;
+      }
+      else {
+        outFrame.frame(outPicture);
+      }
+      writeFrame();
+      ++frames;
+      return true;
+    }
+    return false;
+  }
+
+  void StreamDecoder::writeFrame() {
+    if (!output) return;
+    Frame& outFrame = context->outFrame;
+    const int depth = sequence.bitdepth;
+    const int min = -utils::pow(2, depth-1);
+    const int max = utils::pow(2, depth-1)-1;
+    outFrame.frame(clip(outFrame, min, max, min, max));
+    outStream << pictureio::wordWidth((depth==8) ? 1 : 2);
+    outStream << pictureio::left_justified;
+    outStream << pictureio::offset_binary;
+    outStream << pictureio::bitDepth(depth, depth);
+    outStream << outFrame;
+    if (!outStream) throw std::runtime_error("failed to write output");
+  }
+
+} // end unnamed namespace
+
+int main(int argc, char * argv[]) {
+
+try { //Giant try block around all code to get error messages
+
+  ProgramParams params = getCommandLineParams(argc, argv, details);
+  if (!params.error.empty()) {
+    std::cerr << "Command line error: " << params.error << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Create convenient aliases for program parameters
+  const vector<string> inFileNames = params.inFileNames;
+  const string outputs = params.outputs;
+  const int threads = params.threads;
+  const int proxy = params.proxy;
+  const bool verbose = params.verbose;
+
+  // The pool is declared first so it outlives the streams its tasks use
+  ThreadPool pool(threads);
+  if (verbose) {
+    clog << "Decoding " << inFileNames.size() << " streams with " << pool.size() << " threads";
+    if (proxy>0) clog << ", as proxies at level " << proxy;
+    clog << endl;
+  }
+
+  vector<boost::shared_ptr<StreamDecoder> > streams;
+  for (unsigned int s=0; s<inFileNames.size(); ++s) {
+    const string outFileName = (outputs.empty() ? "" : outputName(outputs, s));
+    streams.push_back(boost::shared_ptr<StreamDecoder>(
+      new StreamDecoder(s, inFileNames[s], outFileName, proxy, verbose, pool)));
+    if (verbose && !outFileName.empty())
+      clog << "Stream " << s << ": " << inFileNames[s] << " to " << outFileName << endl;
+  }
+
+  const double start = timing::now();
+  for (unsigned int s=0; s<streams.size(); ++s) streams[s]->start(start);
+  pool.wait();
+  const double seconds = timing::now()-start;
+
+  int totalFrames = 0;
+  int failed = 0;
+  for (unsigned int s=0; s<streams.size(); ++s) {
+    const StreamDecoder& stream = *streams[s];
+    clog << "Stream " << s << " (" << stream.inFileName << "): "
+         << stream.frames << " frames, "
+         << stream.latePictures << " of " << stream.pictures << " pictures late, "
+         << stream.busy << " s decoding" << endl;
+    if (!stream.error.empty()) {
+      clog << "Stream " << s << " failed: " << stream.error << endl;
+      ++failed;
+    }
+    totalFrames += stream.frames;
+  }
+  clog << "Decoded " << totalFrames << " frames in " << seconds << " s ("
+       << (seconds>0.0 ? totalFrames/seconds : 0.0) << " fps)" << endl;
+
+  return (failed==0 ? EXIT_SUCCESS : EXIT_FAILURE);
+
+} // end of try block
+
+// Report error messages from try block
+catch (const std::exception& ex) {
+    std::cerr << "Error: " << ex.what() << endl;
+    return EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,99 @@
+/*********************************************************************/
+/* MultiParams.cpp                                                   */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines getting program parameters from command line.             */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include "MultiParams.h"
+
+#include <cstdlib> // For exit
+#include <iostream> //For cin, cout, cerr
+#include <stdexcept> // For invalid_argument
+#include <string>
+#include <vector>
+
+using std::clog;
+using std::endl;
+using std::string;
+using std::vector;
+using std::invalid_argument;
+
+#include <tclap/CmdLine.h>
+
+using TCLAP::CmdLine;
+using TCLAP::ValueArg;
+using TCLAP::SwitchArg;
+using TCLAP::UnlabeledMultiArg;
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]) {
+
+  const char * const version = details[0];
+  const char * const summary = details[1];
+  const char * const description = details[2];
+
+  if (argc<2) {
+    clog << "Version: " << version << endl;
+    clog << description << endl;
+    clog << "\nFor more details and useage use -h or --help" << endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  ProgramParams params;
+
+  try {
+
+    // Define tclap command line object
+    CmdLine cmd(summary, ' ', version);
+
+    // Define tclap command line parameters (and add them to tclap command line)
+    // "cla" prefix == command line argument
+    ValueArg<string> cla_outputs("o", "outputs", "Output file names, with %d replaced by the stream number from 0 (default no output)", false, "", "string", cmd);
+    ValueArg<int> cla_threads("j", "threads", "Number of decoding threads shared by all streams (default one per hardware thread)", false, 0, "integer", cmd);
+    ValueArg<int> cla_proxy("", "proxy", "Output proxy pictures, reduced by 2**level in each dimension, by not inverting the finest wavelet levels", false, 0, "integer", cmd);
+    SwitchArg verbosity("v", "verbose", "Output extra information to standard log", cmd);
+    UnlabeledMultiArg<string> inFiles("inFiles", "Input stream file names", true, "string", cmd);
+
+    // Parse the argv array
+    cmd.parse(argc, argv);
+
+    // Initialise program parameters
+    const vector<string> inFileNames = inFiles.getValue();
+    const string outputs = cla_outputs.getValue();
+    const int threads = cla_threads.getValue();
+    const int proxy = cla_proxy.getValue();
+    const bool verbose = verbosity.getValue();
+
+    // Check for valid combinations of parameters and options
+    for (vector<string>::const_iterator name=inFileNames.begin(); name!=inFileNames.end(); ++name) {
+      if (*name=="-")
+        throw invalid_argument("standard input can't be one of several streams: specify input files");
+    }
+    if ((inFileNames.size()>1) && !outputs.empty() && (outputs.find("%d")==string::npos))
+      throw invalid_argument("output file names must include %d to number the streams");
+    if (threads<0)
+      throw invalid_argument("number of threads must be >=0");
+    if (proxy<0)
+      throw invalid_argument("proxy level must be >=0");
+
+    params.inFileNames = inFileNames;
+    params.outputs = outputs;
+    params.threads = threads;
+    params.proxy = proxy;
+    params.verbose = verbose;
+  }
+
+  // catch any TCLAP exceptions
+  catch (TCLAP::ArgException &e) {
+    params.error = string("Command line error: ") + e.error() + " for arg " + e.argId();
+  }
+
+  // catch other exceptions
+  catch(const std::exception& ex) {
+    params.error = string(ex.what());
+  }
+
+  return params;
+}
@@ -0,0 +1,27 @@
+/*********************************************************************/
+/* MultiParams.h                                                     */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares getting program parameters from command line.            */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef MULTIPARAMS_18OCT26
+#define MULTIPARAMS_18OCT26
+
+#include <string>
+#include <vector>
+
+struct ProgramParams {
+  std::vector<std::string> inFileNames;
+  std::string outputs; // Output file name pattern, empty for no output
+  int threads; // Zero for one per hardware thread
+  int proxy; // Wavelet levels not inverted, zero for full resolution
+  bool verbose;
+  std::string error;
+};
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]);
+
+#endif // MULTIPARAMS_18OCT26
@@ -34,6 +34,16 @@ namespace TCLAP {
   struct ArgTraits<Output> { // Let TCLAP parse Output objects
     typedef ValueLike ValueCategory;
   };
+
+  template <>
+  struct ArgTraits<ColourFormat> { // Let TCLAP parse ColourFormat objects
+    typedef ValueLike ValueCategory;
+  };
+
+  template <>
+  struct ArgTraits<ColourMatrix> { // Let TCLAP parse ColourMatrix objects
+    typedef ValueLike ValueCategory;
+  };
 }
 
 ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]) {
@@ -57,10 +67,21 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[
 
     // Define tclap command line parameters (and add them to tclap command line)
     UnlabeledValueArg<string> inFile("inFile", "Input file name", true, "-", "string", cmd);
-    UnlabeledValueArg<string> outFile("outFile", "Output file name", true, "-", "string", cmd);
+    UnlabeledValueArg<string> outFile("outFile", "Output file name (not used for output None)", false, "-", "string", cmd);
     SwitchArg verbosity("v", "verbose", "Output extra information to standard log", cmd);
     // "cla" prefix == command line argument
-    ValueArg<Output> cla_output("o", "output", "Program output (Transform, Quantised, Indices, Decoded)", false, DECODED, "string", cmd);
+    ValueArg<Output> cla_output("o", "output", "Program output (Transform, Quantised, Indices, Decoded, None)", false, DECODED, "string", cmd);
+    SwitchArg cla_y4m("Y", "y4m", "Decoded output is Y4M (the default for .y4m file names)", cmd, false);
+    SwitchArg cla_lumaOnly("", "lumaOnly", "Decode luma only, skipping the chroma data in each slice (outputs have no chroma)", cmd, false);
+    ValueArg<ColourFormat> cla_outputAs("", "outputAs", "Colour format of decoded output (4:4:4, 4:2:2 or RGB), upsampled or converted from YCbCr (defaults to the coded format)", false, UNKNOWN, "string", cmd);
+    ValueArg<ColourMatrix> cla_matrix("", "matrix", "Colour matrix for RGB output (709 or 2020, default 709)", false, BT709, "string", cmd);
+    SwitchArg cla_benchmark("b", "benchmark", "Report worst case and percentile decode times per picture and per slice", cmd, false);
+    ValueArg<string> cla_md5("", "md5", "Write MD5 checksums of each decoded frame and plane to this file", false, "", "string", cmd);
+    ValueArg<string> cla_crc32c("", "crc32c", "Write CRC32C checksums of each decoded frame and plane to this file", false, "", "string", cmd);
+    SwitchArg cla_noPixels("", "noPixels", "Checksum decoded frames without writing them to the output file", cmd, false);
+    ValueArg<string> cla_expectMD5("", "expectMD5", "With output None, verify the MD5 of the output Decoded would have written", false, "", "string", cmd);
+    ValueArg<string> cla_metrics("", "metrics", "Write live metrics (frames, frame rate, stage times, late pictures, output bytes) to a file in Prometheus text format, rewritten every metrics interval", false, "", "string", cmd);
+    ValueArg<double> cla_metricsInterval("", "metricsInterval", "Seconds between updates of the metrics file (default 5)", false, 5.0, "number", cmd);
 
     // Parse the argv array
     cmd.parse(argc, argv);
@@ -70,11 +91,65 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[
     const string outFileName = outFile.getValue();
     const bool verbose = verbosity.getValue();
     const Output output = cla_output.getValue();
+    const bool y4mOutput = ((output==DECODED) || (output==NONE)) &&
+                           (cla_y4m.isSet() || pictureio::isY4MFileName(outFileName));
+    const bool lumaOnly = cla_lumaOnly.getValue();
+    const ColourFormat outputAs = cla_outputAs.getValue();
+    const ColourMatrix matrix = cla_matrix.getValue();
+    const bool benchmark = cla_benchmark.getValue();
+    const string md5FileName = cla_md5.getValue();
+    const string crc32cFileName = cla_crc32c.getValue();
+    const bool noPixels = cla_noPixels.getValue();
+    const string expectedMD5 = cla_expectMD5.getValue();
+    const string metricsFile = cla_metrics.getValue();
+    const double metricsInterval = cla_metricsInterval.getValue();
+
+    // Check for valid combinations of parameters and options
+    if (cla_outputAs.isSet() && (output!=DECODED) && (output!=NONE))
+      throw invalid_argument("converting the colour format requires Decoded or None output");
+    if (cla_matrix.isSet() && (outputAs!=RGB))
+      throw invalid_argument("a colour matrix is only used for RGB output");
+    if (y4mOutput && (outputAs==RGB))
+      throw invalid_argument("Y4M output can't represent RGB");
+    if (lumaOnly && y4mOutput)
+      throw invalid_argument("Y4M output needs chroma, so can't be luma only");
+    if (lumaOnly && cla_outputAs.isSet())
+      throw invalid_argument("converting the colour format needs chroma, so can't be luma only");
+    if (benchmark && (output!=DECODED))
+      throw invalid_argument("benchmark times the whole decode so requires Decoded output");
+    if ((cla_md5.isSet() || cla_crc32c.isSet()) && (output!=DECODED) && (output!=NONE))
+      throw invalid_argument("checksums are of decoded frames so require Decoded or None output");
+    if (!outFile.isSet() && (output!=NONE))
+      throw invalid_argument("an output file name is required unless output is None");
+    if (cla_expectMD5.isSet() && (output!=NONE))
+      throw invalid_argument("verifying an expected MD5 requires None output");
+    if (cla_expectMD5.isSet() &&
+        ((expectedMD5.size()!=32) || (expectedMD5.find_first_not_of("0123456789abcdefABCDEF")!=string::npos)))
+      throw invalid_argument("expected MD5 must be 32 hexadecimal digits");
+    if (noPixels && !(cla_md5.isSet() || cla_crc32c.isSet()))
+      throw invalid_argument("omitting decoded pixels requires MD5 or CRC32C checksums");
+    if (cla_md5.isSet() && cla_crc32c.isSet() && (md5FileName==crc32cFileName))
+      throw invalid_argument("MD5 and CRC32C checksums must be written to different files");
+    if (cla_metricsInterval.isSet() && metricsFile.empty())
+      throw invalid_argument("a metrics interval needs a metrics file");
+    if (metricsInterval<=0.0)
+      throw invalid_argument("metrics interval must be >0");
 
     params.inFileName = inFileName;
     params.outFileName = outFileName;
     params.verbose = verbose;
     params.output = output;
+    params.y4mOutput = y4mOutput;
+    params.lumaOnly = lumaOnly;
+    params.outputAs = outputAs;
+    params.matrix = matrix;
+    params.benchmark = benchmark;
+    params.md5FileName = md5FileName;
+    params.crc32cFileName = crc32cFileName;
+    params.noPixels = noPixels;
+    params.expectedMD5 = expectedMD5;
+    params.metricsFile = metricsFile;
+    params.metricsInterval = metricsInterval;
 
   }
 
@@ -106,6 +181,9 @@ std::ostream& operator<<(std::ostream& os, Output output) {
     case DECODED:
       s = "Decoded";
       break;
+    case NONE:
+      s = "None";
+      break;
     default:
       s = "Unknown output!";
       break;
@@ -120,6 +198,7 @@ std::istream& operator>>(std::istream& is, Output& output) {
         else if (text == "Quantised") output = QUANTISED;
         else if (text == "Indices") output = INDICES;
         else if (text == "Decoded") output = DECODED;
+        else if (text == "None") output = NONE;
         else is.setstate(std::ios_base::badbit|std::ios_base::failbit);
         // Alternatively
         // else throw std::invalid_argument("invalid input");
@@ -13,8 +13,9 @@
 #include <string>
 #include "Picture.h"
 #include "WaveletTransform.h"
+#include "Colour.h"
 
-enum Output {TRANSFORM, QUANTISED, INDICES, DECODED};
+enum Output {TRANSFORM, QUANTISED, INDICES, DECODED, NONE};
 
 std::ostream& operator<<(std::ostream&, Output value);
 
@@ -25,6 +26,17 @@ struct ProgramParams {
   std::string outFileName;
   bool verbose;
   enum Output output;
+  bool y4mOutput; // Decoded output is Y4M
+  bool lumaOnly; // Skip decoding chroma
+  enum ColourFormat outputAs; // UNKNOWN to output the decoded colour format
+  ColourMatrix matrix; // For RGB output
+  bool benchmark;
+  std::string md5FileName; // Empty for no MD5 checksums
+  std::string crc32cFileName; // Empty for no CRC32C checksums
+  bool noPixels; // Checksum decoded frames without writing them
+  std::string expectedMD5; // Empty unless verifying output None
+  std::string metricsFile; // Empty for no live metrics
+  double metricsInterval; // Seconds between updates of the metrics file
   std::string error;
 };
 
@@ -19,6 +19,20 @@ Its primary output is the decoded image sequence. However it may produce alterna
   2 the quantised wavelet coefficients\n\
   3 the quantisation indices used for each slice\n\
   4 the decoded sequence\n\
+  5 none, to measure decode throughput (optionally verifying the MD5 of the decoded sequence)\n\
+With --benchmark it reports the worst case and percentile times to decode each picture\n\
+and each slice, and how many pictures missed the deadline set by the frame rate.\n\
+With --md5 or --crc32c it writes checksums of each decoded frame, and of each of its planes,\n\
+calculated from the bytes written to the output file, one line per frame. The last line is\n\
+the checksum of the whole output file. With --noPixels the decoded frames are checksummed\n\
+but not written, so conformance checks need no temporary storage.\n\
+With --y4m, or an output file name ending .y4m, decoded output is a Y4M file.\n\
+With --outputAs decoded output is converted to RGB, or chroma upsampled, before it is written.\n\
+With output None frames are decoded but not clipped, formatted or written, and the frame\n\
+rate and the time taken by each decoding stage are reported on exit. With --expectMD5 the\n\
+frames are formatted in memory to verify the MD5 of the output Decoded would have written.\n\
+With --lumaOnly chroma is skipped, without being decoded, and only luma is output.\n\
+With --metrics live metrics are written to a file in Prometheus text format.\n\
 Input is a VC-2 stream.\n\
 Output (where appropriate) are in planar format (4:4:4, 4:2:2, 4:2:0 or RGB).\n\
 There can be 1 to 4 bytes per sample and the data is left (MSB) justified.\n\
@@ -32,7 +46,9 @@ const char* details[] = {version, summary, description};
 #include <iostream> //For cin, cout, cerr
 #include <string>
 #include <fstream>
+#include <sstream>
 #include <cstdio> // for perror
+#include <cctype> // for tolower
 #include <boost/scoped_ptr.hpp>
 
 #include "DecodeParams.h"
@@ -44,6 +60,10 @@ const char* details[] = {version, summary, description};
 #include "WaveletTransform.h"
 #include "Utils.h"
 #include "DataUnit.h"
+#include "Timing.h"
+#include "Checksum.h"
+#include "Colour.h"
+#include "Metrics.h"
 
 using std::cout;
 using std::cin;
@@ -57,6 +77,61 @@ using std::ios_base;
 using std::istream;
 using std::ostream;
 
+// Write checksums of a formatted decoded frame, and of each of its planes,
+// as one line of text, and add the frame to the checksum of the whole output.
+// The frame checksum excludes any Y4M FRAME line before the first plane.
+template <class Checksum>
+void writeChecksums(ostream& stream, int frame, const string& pixels,
+                    const std::size_t planeBytes[3], Checksum& output) {
+  std::size_t offset = pixels.size()-(planeBytes[0]+planeBytes[1]+planeBytes[2]);
+  Checksum whole;
+  whole.update(pixels.data()+offset, pixels.size()-offset);
+  output.update(pixels.data(), pixels.size());
+  stream << frame << " " << whole.digest();
+  for (int plane=0; plane<3; ++plane) {
+    Checksum component;
+    component.update(pixels.data()+offset, planeBytes[plane]);
+    offset += planeBytes[plane];
+    stream << " " << component.digest();
+  }
+  stream << endl;
+}
+
+// The format of decoded pictures (and their transforms), without chroma if
+// only luma is decoded, so chroma is skipped from slice parsing onwards
+const PictureFormat decodedFormat(int height, int width, ColourFormat chromaFormat, bool lumaOnly) {
+  const PictureFormat format(height, width, chromaFormat);
+  return (lumaOnly ? luma_only_format(format) : format);
+}
+
+// Live metrics, updated as the stream is decoded
+struct DecoderMetrics {
+  metrics::Counter frames;
+  metrics::Counter bytes; // Written to the output
+  metrics::Counter latePictures; // Taking longer than a picture period to decode
+  metrics::Timer read;
+  metrics::Timer merge;
+  metrics::Timer quantise;
+  metrics::Timer transform;
+  metrics::Timer verify; // For output None with checksums
+};
+
+// Lap a decoding stage, adding its time to the stage's live metric too
+void lap(timing::Samples& samples, metrics::Timer& timer, double& start) {
+  const double stageStart = start;
+  timing::lap(samples, start);
+  timer.add(start-stageStart);
+}
+
+// Record the time to decode a picture (excluding file input and output),
+// for benchmarking (if times is non-null) and to count late pictures
+void pictureDecoded(timing::Samples* times, DecoderMetrics& decoderMetrics,
+                    double pictureStart, double deadline) {
+  const double seconds = timing::now()-pictureStart;
+  if (times) times->add(seconds);
+  if ((deadline>0.0) && (seconds>deadline)) decoderMetrics.latePictures.add();
+}
+
 int main(int argc, char * argv[]) {
   
 try { //Giant try block around all code to get error messages
@@ -72,6 +147,19 @@ try { //Giant try block around all code to get error messages
   const string outFileName = params.outFileName;
   const bool verbose = params.verbose;
   const Output output = params.output;
+  const bool benchmark = params.benchmark;
+  const string md5FileName = params.md5FileName;
+  const string crc32cFileName = params.crc32cFileName;
+  const bool noPixels = params.noPixels;
+  string expectedMD5 = params.expectedMD5;
+  for (unsigned int i=0; i<expectedMD5.size(); ++i) expectedMD5[i] = std::tolower(expectedMD5[i]);
+  const bool verifyMD5 = !expectedMD5.empty();
+  const bool y4mOutput = params.y4mOutput;
+  const ColourFormat outputAs = params.outputAs;
+  const ColourMatrix matrix = params.matrix;
+  const bool lumaOnly = params.lumaOnly;
+  const string metricsFile = params.metricsFile;
+  const double metricsInterval = params.metricsInterval;
 
   if (verbose) {
     clog << endl;
@@ -82,6 +170,15 @@ try { //Giant try block around all code to get error messages
     clog << endl;
     clog << "input file = " << inFileName << endl;
     clog << "output file = " << outFileName << endl;
+    if (!md5FileName.empty()) clog << "MD5 checksum file = " << md5FileName << endl;
+    if (!crc32cFileName.empty()) clog << "CRC32C checksum file = " << crc32cFileName
+                                      << (checksum::hardwareCRC32C() ? " (hardware CRC)" : "") << endl;
+    if (noPixels) clog << "Decoded pixels are not written" << endl;
+    if (verifyMD5) clog << "expected MD5 = " << expectedMD5 << endl;
+    if (outputAs!=UNKNOWN) clog << "output colour format = " << outputAs << endl;
+    if (outputAs==RGB) clog << "colour matrix = " << matrix << endl;
+    if (lumaOnly) clog << "luma only = true" << endl;
+    if (!metricsFile.empty()) clog << "metrics file = " << metricsFile << " (every " << metricsInterval << " s)" << endl;
   }
 
   // Open input file or use standard input
@@ -112,7 +209,7 @@ try { //Giant try block around all code to get error messages
   // No point in continuing if can't open output file.
   filebuf outFileBuffer; // For file output. Needs to be defined here to remain in scope
   streambuf *pOutBuffer; // Either standard output buffer or a file buffer
-  if (outFileName=="-") { // Use standard out
+  if ((outFileName=="-") || (output==NONE)) { // Use standard out (nothing is written for output None)
     //Set standard input to binary mode.
     //Only relevant for Windows (*nix is always binary)
     if ( utils::setstdoutmode(std::ios_base::binary) == -1 ) {
@@ -128,7 +225,33 @@ try { //Giant try block around all code to get error messages
       return EXIT_FAILURE;
     }
   }
-  ostream outStream(pOutBuffer);
+  // With live metrics the bytes written are counted on their way to the output
+  DecoderMetrics decoderMetrics;
+  metrics::CountingBuffer countingBuffer(pOutBuffer, decoderMetrics.bytes);
+  ostream outStream(metricsFile.empty() ? pOutBuffer : &countingBuffer);
+
+  // Open checksum files, if any
+  std::ofstream md5File;
+  if (!md5FileName.empty()) {
+    md5File.open(md5FileName.c_str());
+    if (!md5File) {
+      perror((string("Failed to open MD5 checksum file \"")+md5FileName+"\"").c_str());
+      return EXIT_FAILURE;
+    }
+    md5File << "# frame, frame MD5, plane MD5s (Y, C1, C2)" << endl;
+  }
+  std::ofstream crc32cFile;
+  if (!crc32cFileName.empty()) {
+    crc32cFile.open(crc32cFileName.c_str());
+    if (!crc32cFile) {
+      perror((string("Failed to open CRC32C checksum file \"")+crc32cFileName+"\"").c_str());
+      return EXIT_FAILURE;
+    }
+    crc32cFile << "# frame, frame CRC32C, plane CRC32Cs (Y, C1, C2)" << endl;
+  }
+  const bool checksums = (md5File.is_open() || crc32cFile.is_open() || verifyMD5);
+  checksum::MD5 outputMD5;
+  checksum::CRC32C outputCRC32C;
 
 
   int frame = 0;
@@ -142,6 +265,7 @@ try { //Giant try block around all code to get error messages
   int height                = 0;
   int width                 = 0;
   ColourFormat chromaFormat = UNKNOWN;
+  ColourFormat outputFormat = UNKNOWN; // Of decoded output (after any --outputAs conversion)
   int bytes                 = 0;
   int lumaDepth             = 0;
   int chromaDepth           = 0;
@@ -149,13 +273,50 @@ try { //Giant try block around all code to get error messages
   bool topFieldFirst        = false;
   WaveletKernel kernel;
   int waveletDepth;
+  int waveletDepthHo;
+  Array1D customQMatrix; // Empty unless signalled in the picture header
+  int majorVersion          = 0;
   int ySlices;
   int xSlices;
   int compressedBytes;
   int sliceScalar;
+  FrameRate frameRate       = FR0;
+  double pictureDeadline    = 0.0; // Picture period, from the frame rate (0 if unknown)
   boost::scoped_ptr<Frame> outFrame;
+
+  // Decode times, excluding file input and output, for benchmarking
+  timing::Samples pictureTimes;
+  timing::Samples sliceTimes;
+  double pictureStart = 0.0;
+  bool endOfSequence = false;
+
+  // Decoding stage times, excluding file input, for output None
+  timing::Samples readTimes;
+  timing::Samples mergeTimes;
+  timing::Samples quantiseTimes;
+  timing::Samples transformTimes;
+  timing::Samples verifyTimes;
+  double stageStart = 0.0;
+  const double decodeStart = timing::now();
+
+  boost::scoped_ptr<metrics::Exporter> exporter;
+  if (!metricsFile.empty()) {
+    exporter.reset(new metrics::Exporter(metricsFile, metricsInterval));
+    exporter->add("vc2_decoder_frames_total", "Frames decoded", decoderMetrics.frames);
+    exporter->addRate("vc2_decoder_frames_per_second", "Frames decoded per second", decoderMetrics.frames);
+    exporter->add("vc2_decoder_late_pictures_total", "Pictures taking longer than a picture period to decode", decoderMetrics.latePictures);
+    exporter->add("vc2_decoder_output_bytes_total", "Bytes written to the output", decoderMetrics.bytes);
+    const string help = "Time spent in each decoding stage";
+    exporter->add("vc2_decoder_stage_seconds_total", help, decoderMetrics.read, "stage=\"read\"");
+    exporter->add("vc2_decoder_stage_seconds_total", help, decoderMetrics.merge, "stage=\"merge\"");
+    exporter->add("vc2_decoder_stage_seconds_total", help, decoderMetrics.quantise, "stage=\"quantise\"");
+    exporter->add("vc2_decoder_stage_seconds_total", help, decoderMetrics.transform, "stage=\"transform\"");
+    exporter->add("vc2_decoder_stage_seconds_total", help, decoderMetrics.verify, "stage=\"verify\"");
+    exporter->start();
+  }
   
-  while (true) {
+  while (!endOfSequence) {
+    decoderMetrics.frames.add(frame-decoderMetrics.frames.value()); // Before waiting for input
     // Read data unit from stream
     if (!inStream) {
       // TODO: Add proper handling
@@ -164,6 +325,7 @@ try { //Giant try block around all code to get error messages
 
     DataUnit du;
     inStream >> du;
+    pictureStart = timing::now();
 
     if (verbose) {
       clog << endl;
@@ -191,8 +353,20 @@ try { //Giant try block around all code to get error messages
         chromaFormat  = seq_hdr.chromaFormat;
         interlaced    = seq_hdr.interlace;
         topFieldFirst = seq_hdr.topFieldFirst;
+        majorVersion  = seq_hdr.major_version;
+        frameRate     = seq_hdr.frameRate;
+        {
+          const utils::Rational fps = frames_per_second(frameRate);
+          pictureDeadline = (fps.numerator>0 ? fps.denominator/(fps.numerator*(interlaced ? 2.0 : 1.0)) : 0.0);
+        }
         lumaDepth     = seq_hdr.bitdepth;
         chromaDepth   = seq_hdr.bitdepth;
+        outputFormat  = chromaFormat;
+        if ((outputAs!=UNKNOWN) && (outputAs!=chromaFormat)) {
+          if (!can_convert_for_output(chromaFormat, outputAs))
+            throw std::invalid_argument("decoded output can only be converted to RGB, or to a colour format with more chroma");
+          outputFormat = outputAs;
+        }
 
         if (seq_hdr.bitdepth == 8)
           bytes = 1;
@@ -203,22 +377,23 @@ try { //Giant try block around all code to get error messages
       }
       break;
     case END_OF_SEQUENCE:
-      if (verbose) {
-        clog << "End of Sequence after " << frame << " frames, exiting" << endl;
-        return EXIT_SUCCESS;
-      }
+      if (verbose) clog << "End of Sequence after " << frame << " frames, exiting" << endl;
+      endOfSequence = true;
+      break;
     case LD_PICTURE:
       {
         if (verbose) clog << "Parsing Picture Header" << endl;
 
         PicturePreamble preamble;
         du.stream() >> dataunitio::lowDelay
+                    >> dataunitio::majorVersion(majorVersion)
                     >> preamble;
 
         if (verbose) {
           clog << "Picture number      : " << preamble.picture_number << endl;
           clog << "Wavelet Kernel      : " << preamble.wavelet_kernel << endl;
           clog << "Transform Depth     : " << preamble.depth << endl;
+          clog << "Horizontal Only     : " << preamble.depth_ho << endl;
           clog << "Slices Horizontally : " << preamble.slices_x << endl;
           clog << "Slices Verically    : " << preamble.slices_y << endl;
           clog << "Slice Bytes         : " << preamble.slice_bytes << endl;
@@ -227,6 +402,8 @@ try { //Giant try block around all code to get error messages
         ySlices = preamble.slices_y;
         xSlices = preamble.slices_x;
         waveletDepth = preamble.depth;
+        waveletDepthHo = preamble.depth_ho;
+        customQMatrix = preamble.quant_matrix;
         kernel = preamble.wavelet_kernel;
         compressedBytes = (preamble.slice_bytes.numerator*preamble.slices_y*preamble.slices_x)/preamble.slice_bytes.denominator;
       }
@@ -237,10 +414,10 @@ try { //Giant try block around all code to get error messages
         // Calculate number of slices per picture
         const int pictureHeight = ( (interlaced) ? height/2 : height);
         const int paddedPictureHeight = paddedSize(pictureHeight, waveletDepth);
-        const int paddedWidth = paddedSize(width, waveletDepth);
+        const int paddedWidth = paddedSize(width, waveletDepth+waveletDepthHo);
 
-        // Calculate the quantisation matrix
-        const Array1D qMatrix = quantMatrix(kernel, waveletDepth);
+        // Use the quantisation matrix from the picture header, if any, else calculate it
+        const Array1D qMatrix = (customQMatrix.size()>0 ? customQMatrix : quantMatrix(kernel, waveletDepth, waveletDepthHo));
         if (verbose) {
           clog << "Quantisation matrix = " << qMatrix[0];
           for (unsigned int i=1; i<qMatrix.size(); ++i) {
@@ -250,13 +427,14 @@ try { //Giant try block around all code to get error messages
         }
 
         // First calculate number of bytes for each slice
-        const int pictureBytes = (interlaced ? compressedBytes/2 : compressedBytes);
+        // (the slice bytes in the picture header are for this picture, even if it is a field)
+        const int pictureBytes = compressedBytes;
         const Array2D sliceBytes = slice_bytes(ySlices, xSlices, pictureBytes, 1);
-        const PictureFormat transformFormat(paddedPictureHeight, paddedWidth, chromaFormat);
-        Slices inSlices(transformFormat, waveletDepth, ySlices, xSlices);
+        const PictureFormat transformFormat = decodedFormat(paddedPictureHeight, paddedWidth, chromaFormat, lumaOnly);
+        Slices inSlices(transformFormat, waveletDepth, ySlices, xSlices, waveletDepthHo);
 
         // Define picture format (field or frame)
-        const PictureFormat picFormat(pictureHeight, width, chromaFormat);
+        const PictureFormat picFormat = decodedFormat(pictureHeight, width, chromaFormat, lumaOnly);
 
         // Read input from planar file
         if (verbose) {
@@ -267,6 +445,7 @@ try { //Giant try block around all code to get error messages
         }
         clog.flush(); // Make sure comments written to log file.
         du.stream() >> sliceio::lowDelay(sliceBytes); // Read input in Low Delay mode
+        if (benchmark) du.stream() >> sliceio::timeSlices(sliceTimes);
         du.stream() >> inSlices; // Read the compressed input picture
         // Check picture was read OK
         if (!du.stream()) {
@@ -274,10 +453,13 @@ try { //Giant try block around all code to get error messages
           continue;
         }
         else clog << endl;
+        stageStart = pictureStart;
+        lap(readTimes, decoderMetrics.read, stageStart);
     
         // Reorder quantised coefficients from slice order to transform order
         if (verbose) clog << "Merge slices into full picture" << endl;
         const Picture yuvQCoeffs = merge_blocks(inSlices.yuvSlices);
+        lap(mergeTimes, decoderMetrics.merge, stageStart);
 
         if (output==INDICES) {
           //Write quantisation indices as 1 byte unsigned values
@@ -305,7 +487,8 @@ try { //Giant try block around all code to get error messages
     
         // Inverse quantise in transform order
         if (verbose) clog << "Inverse quantise" << endl;
-        const Picture yuvTransform = inverse_quantise_transform(yuvQCoeffs, inSlices.qIndices, qMatrix);
+        const Picture yuvTransform = inverse_quantise_transform(yuvQCoeffs, inSlices.qIndices, qMatrix, waveletDepthHo);
+        lap(quantiseTimes, decoderMetrics.quantise, stageStart);
 
         if (output==TRANSFORM) {
           //Write transform output as 4 byte 2's comp values
@@ -321,15 +504,28 @@ try { //Giant try block around all code to get error messages
 
         // Inverse wavelet transform
         if (verbose) clog << "Inverse transform" << endl;
-        const Picture outPicture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picFormat);
+        const Picture outPicture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picFormat, waveletDepthHo);
+        lap(transformTimes, decoderMetrics.transform, stageStart);
+
+        if ((output==NONE) && !checksums) {
+          // Nothing to output, so skip assembling, clipping and formatting frames
+          pictureDecoded(0, decoderMetrics, pictureStart, pictureDeadline);
+          if (interlaced && (pic==0)) ++pic;
+          else {
+            pic = 0;
+            ++frame;
+          }
+          continue;
+        }
 
         // Copy picture to output frame
         if (verbose) clog << "Copy picture to output frame" << endl;
         if (interlaced) {
           if (pic == 0) {
-            const PictureFormat frameFormat(height, width, chromaFormat);
+            const PictureFormat frameFormat = decodedFormat(height, width, chromaFormat, lumaOnly);
             outFrame.reset(new Frame(frameFormat, interlaced, topFieldFirst));
             outFrame->firstField(outPicture);
+            pictureDecoded(benchmark ? &pictureTimes : 0, decoderMetrics, pictureStart, pictureDeadline);
               
             pic++;
             continue;
@@ -339,6 +535,8 @@ try { //Giant try block around all code to get error messages
           pic = 0;
         }
         else { //progressive
+          const PictureFormat frameFormat = decodedFormat(height, width, chromaFormat, lumaOnly);
+          outFrame.reset(new Frame(frameFormat, interlaced, topFieldFirst));
           outFrame->frame(outPicture);
         }
 
@@ -350,13 +548,57 @@ try { //Giant try block around all code to get error messages
           const int uvMax = utils::pow(2, chromaDepth-1)-1;
           outFrame->frame(clip(*outFrame, yMin, yMax, uvMin, uvMax));
         }
+        if (outputFormat!=chromaFormat) {
+          if (verbose) clog << "Converting output to " << outputFormat << endl;
+          outFrame->frame(convert_for_output(*outFrame, outputFormat, matrix, lumaDepth, interlaced));
+        }
+        pictureDecoded(benchmark ? &pictureTimes : 0, decoderMetrics, pictureStart, pictureDeadline);
+
+        if (y4mOutput && (frame==0)) {
+          // Decoded Y4M output starts with a header
+          const utils::Rational fps = frames_per_second(frameRate);
+          std::ostringstream header;
+          header << Y4MHeader(PictureFormat(height, width, outputFormat), lumaDepth,
+                              interlaced, topFieldFirst, fps.numerator, fps.denominator);
+          const string text = header.str();
+          outputMD5.update(text.data(), text.size());
+          outputCRC32C.update(text.data(), text.size());
+          if (!noPixels && (output!=NONE)) outStream.write(text.data(), text.size());
+          outStream << pictureio::y4m;
+        }
 
-        if (verbose) clog << "Writing decoded output file" << endl;
-        outStream << pictureio::wordWidth(bytes); // Set number of bytes per value in file
-        outStream << pictureio::left_justified;
-        outStream << pictureio::offset_binary;
-        outStream << pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
-        outStream << *outFrame;
+        if (checksums) {
+          // Format the frame once, then checksum and write the same bytes
+          if (verbose) clog << "Checksumming decoded frame" << endl;
+          std::ostringstream pixels;
+          if (y4mOutput) pixels << pictureio::y4m;
+          pixels << pictureio::wordWidth(bytes); // Set number of bytes per value in file
+          pixels << pictureio::left_justified;
+          pixels << pictureio::offset_binary;
+          pixels << pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
+          pixels << *outFrame;
+          const string data = pixels.str();
+          const PictureFormat frameFormat = outFrame->format();
+          const std::size_t lumaBytes = static_cast<std::size_t>(frameFormat.lumaHeight())*frameFormat.lumaWidth()*bytes;
+          const std::size_t chromaBytes = static_cast<std::size_t>(frameFormat.chromaHeight())*frameFormat.chromaWidth()*bytes;
+          const std::size_t planeBytes[3] = {lumaBytes, chromaBytes, chromaBytes};
+          if (md5File.is_open()) writeChecksums(md5File, frame, data, planeBytes, outputMD5);
+          else if (verifyMD5) outputMD5.update(data.data(), data.size());
+          if (crc32cFile.is_open()) writeChecksums(crc32cFile, frame, data, planeBytes, outputCRC32C);
+          if (!noPixels && (output!=NONE)) {
+            if (verbose) clog << "Writing decoded output file" << endl;
+            outStream.write(data.data(), data.size());
+          }
+          if (output==NONE) lap(verifyTimes, decoderMetrics.verify, stageStart);
+        }
+        else {
+          if (verbose) clog << "Writing decoded output file" << endl;
+          outStream << pictureio::wordWidth(bytes); // Set number of bytes per value in file
+          outStream << pictureio::left_justified;
+          outStream << pictureio::offset_binary;
+          outStream << pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
+          outStream << *outFrame;
+        }
         if (!outStream) {
           cerr << "Failed to write output file \"" << outFileName << "\"" << endl;
           return EXIT_FAILURE;
@@ -371,12 +613,14 @@ try { //Giant try block around all code to get error messages
 
         PicturePreamble preamble;
         du.stream() >> dataunitio::highQualityVBR(1)
+                    >> dataunitio::majorVersion(majorVersion)
                     >> preamble;
 
         if (verbose) {
           clog << "Picture number      : " << preamble.picture_number << endl;
           clog << "Wavelet Kernel      : " << preamble.wavelet_kernel << endl;
           clog << "Transform Depth     : " << preamble.depth << endl;
+          clog << "Horizontal Only     : " << preamble.depth_ho << endl;
           clog << "Slices Horizontally : " << preamble.slices_x << endl;
           clog << "Slices Verically    : " << preamble.slices_y << endl;
           clog << "Slice Prefix        : " << preamble.slice_prefix << endl;
@@ -386,6 +630,8 @@ try { //Giant try block around all code to get error messages
         ySlices = preamble.slices_y;
         xSlices = preamble.slices_x;
         waveletDepth = preamble.depth;
+        waveletDepthHo = preamble.depth_ho;
+        customQMatrix = preamble.quant_matrix;
         kernel = preamble.wavelet_kernel;
         sliceScalar = preamble.slice_size_scalar;
       }
@@ -396,10 +642,10 @@ try { //Giant try block around all code to get error messages
         // Calculate number of slices per picture
         const int pictureHeight = ( (interlaced) ? height/2 : height);
         const int paddedPictureHeight = paddedSize(pictureHeight, waveletDepth);
-        const int paddedWidth = paddedSize(width, waveletDepth);
+        const int paddedWidth = paddedSize(width, waveletDepth+waveletDepthHo);
 
-        // Calculate the quantisation matrix
-        const Array1D qMatrix = quantMatrix(kernel, waveletDepth);
+        // Use the quantisation matrix from the picture header, if any, else calculate it
+        const Array1D qMatrix = (customQMatrix.size()>0 ? customQMatrix : quantMatrix(kernel, waveletDepth, waveletDepthHo));
         if (verbose) {
           clog << "Quantisation matrix = " << qMatrix[0];
           for (unsigned int i=1; i<qMatrix.size(); ++i) {
@@ -409,11 +655,11 @@ try { //Giant try block around all code to get error messages
         }
 
         // Construct an container to read the compressed data into.
-        const PictureFormat transformFormat(paddedPictureHeight, paddedWidth, chromaFormat);
-        Slices inSlices(transformFormat, waveletDepth, ySlices, xSlices);
+        const PictureFormat transformFormat = decodedFormat(paddedPictureHeight, paddedWidth, chromaFormat, lumaOnly);
+        Slices inSlices(transformFormat, waveletDepth, ySlices, xSlices, waveletDepthHo);
 
         // Define picture format (field or frame)
-        const PictureFormat picFormat(pictureHeight, width, chromaFormat);
+        const PictureFormat picFormat = decodedFormat(pictureHeight, width, chromaFormat, lumaOnly);
 
 
         // Read input from planar file
@@ -425,6 +671,7 @@ try { //Giant try block around all code to get error messages
         }
         clog.flush(); // Make sure comments written to log file.
         du.stream() >> sliceio::highQualityVBR(sliceScalar); // Read input in HQ VBR mode
+        if (benchmark) du.stream() >> sliceio::timeSlices(sliceTimes);
         du.stream() >> inSlices; // Read the compressed input picture
         // Check picture was read OK
         if (!du.stream()) {
@@ -432,10 +679,13 @@ try { //Giant try block around all code to get error messages
           continue;
         }
         else clog << endl;
+        stageStart = pictureStart;
+        lap(readTimes, decoderMetrics.read, stageStart);
     
         // Reorder quantised coefficients from slice order to transform order
         if (verbose) clog << "Merge slices into full picture" << endl;
         const Picture yuvQCoeffs = merge_blocks(inSlices.yuvSlices);
+        lap(mergeTimes, decoderMetrics.merge, stageStart);
 
         if (output==INDICES) {
           //Write quantisation indices as 1 byte unsigned values
@@ -463,7 +713,8 @@ try { //Giant try block around all code to get error messages
     
         // Inverse quantise in transform order
         if (verbose) clog << "Inverse quantise" << endl;
-        const Picture yuvTransform = inverse_quantise_transform_np(yuvQCoeffs, inSlices.qIndices, qMatrix);
+        const Picture yuvTransform = inverse_quantise_transform_np(yuvQCoeffs, inSlices.qIndices, qMatrix, waveletDepthHo);
+        lap(quantiseTimes, decoderMetrics.quantise, stageStart);
 
         if (output==TRANSFORM) {
           //Write transform output as 4 byte 2's comp values
@@ -479,16 +730,29 @@ try { //Giant try block around all code to get error messages
 
         // Inverse wavelet transform
         if (verbose) clog << "Inverse transform" << endl;
-        const Picture outPicture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picFormat);
+        const Picture outPicture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picFormat, waveletDepthHo);
+        lap(transformTimes, decoderMetrics.transform, stageStart);
+
+        if ((output==NONE) && !checksums) {
+          // Nothing to output, so skip assembling, clipping and formatting frames
+          pictureDecoded(0, decoderMetrics, pictureStart, pictureDeadline);
+          if (interlaced && (pic==0)) ++pic;
+          else {
+            pic = 0;
+            ++frame;
+          }
+          continue;
+        }
   
         // Copy picture to output frame
         if (verbose) clog << "Copy picture to output frame" << endl;
         if (interlaced) {
           if (pic == 0) {
-            const PictureFormat frameFormat(height, width, chromaFormat);
+            const PictureFormat frameFormat = decodedFormat(height, width, chromaFormat, lumaOnly);
             outFrame.reset(new Frame(frameFormat, interlaced, topFieldFirst));
 
             outFrame->firstField(outPicture);
+            pictureDecoded(benchmark ? &pictureTimes : 0, decoderMetrics, pictureStart, pictureDeadline);
             pic++;
             continue;
           }
@@ -498,6 +762,8 @@ try { //Giant try block around all code to get error messages
           pic = 0;
         }
         else { //progressive
+          const PictureFormat frameFormat = decodedFormat(height, width, chromaFormat, lumaOnly);
+          outFrame.reset(new Frame(frameFormat, interlaced, topFieldFirst));
           outFrame->frame(outPicture);
         }
 
@@ -509,13 +775,57 @@ try { //Giant try block around all code to get error messages
           const int uvMax = utils::pow(2, chromaDepth-1)-1;
           outFrame->frame(clip(*outFrame, yMin, yMax, uvMin, uvMax));
         }
+        if (outputFormat!=chromaFormat) {
+          if (verbose) clog << "Converting output to " << outputFormat << endl;
+          outFrame->frame(convert_for_output(*outFrame, outputFormat, matrix, lumaDepth, interlaced));
+        }
+        pictureDecoded(benchmark ? &pictureTimes : 0, decoderMetrics, pictureStart, pictureDeadline);
+
+        if (y4mOutput && (frame==0)) {
+          // Decoded Y4M output starts with a header
+          const utils::Rational fps = frames_per_second(frameRate);
+          std::ostringstream header;
+          header << Y4MHeader(PictureFormat(height, width, outputFormat), lumaDepth,
+                              interlaced, topFieldFirst, fps.numerator, fps.denominator);
+          const string text = header.str();
+          outputMD5.update(text.data(), text.size());
+          outputCRC32C.update(text.data(), text.size());
+          if (!noPixels && (output!=NONE)) outStream.write(text.data(), text.size());
+          outStream << pictureio::y4m;
+        }
 
-        if (verbose) clog << "Writing decoded output file" << endl;
-        outStream << pictureio::wordWidth(bytes); // Set number of bytes per value in file
-        outStream << pictureio::left_justified;
-        outStream << pictureio::offset_binary;
-        outStream << pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
-        outStream << *outFrame;
+        if (checksums) {
+          // Format the frame once, then checksum and write the same bytes
+          if (verbose) clog << "Checksumming decoded frame" << endl;
+          std::ostringstream pixels;
+          if (y4mOutput) pixels << pictureio::y4m;
+          pixels << pictureio::wordWidth(bytes); // Set number of bytes per value in file
+          pixels << pictureio::left_justified;
+          pixels << pictureio::offset_binary;
+          pixels << pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
+          pixels << *outFrame;
+          const string data = pixels.str();
+          const PictureFormat frameFormat = outFrame->format();
+          const std::size_t lumaBytes = static_cast<std::size_t>(frameFormat.lumaHeight())*frameFormat.lumaWidth()*bytes;
+          const std::size_t chromaBytes = static_cast<std::size_t>(frameFormat.chromaHeight())*frameFormat.chromaWidth()*bytes;
+          const std::size_t planeBytes[3] = {lumaBytes, chromaBytes, chromaBytes};
+          if (md5File.is_open()) writeChecksums(md5File, frame, data, planeBytes, outputMD5);
+          else if (verifyMD5) outputMD5.update(data.data(), data.size());
+          if (crc32cFile.is_open()) writeChecksums(crc32cFile, frame, data, planeBytes, outputCRC32C);
+          if (!noPixels && (output!=NONE)) {
+            if (verbose) clog << "Writing decoded output file" << endl;
+            outStream.write(data.data(), data.size());
+          }
+          if (output==NONE) lap(verifyTimes, decoderMetrics.verify, stageStart);
+        }
+        else {
+          if (verbose) clog << "Writing decoded output file" << endl;
+          outStream << pictureio::wordWidth(bytes); // Set number of bytes per value in file
+          outStream << pictureio::left_justified;
+          outStream << pictureio::offset_binary;
+          outStream << pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
+          outStream << *outFrame;
+        }
         if (!outStream) {
           cerr << "Failed to write output file \"" << outFileName << "\"" << endl;
           return EXIT_FAILURE;
@@ -528,6 +838,49 @@ try { //Giant try block around all code to get error messages
       continue;
     }
   } //End frame loop
+  decoderMetrics.frames.add(frame-decoderMetrics.frames.value());
+
+  if (benchmark) {
+    clog << endl << "Decode times (excluding file input and output)" << endl;
+    timing::summarise(clog, "Pictures", pictureTimes, 1e3, "ms");
+    timing::summarise(clog, "Slices", sliceTimes, 1e6, "us");
+    const utils::Rational fps = frames_per_second(frameRate);
+    if ((fps.numerator>0) && (pictureTimes.count()>0)) {
+      const double deadline = fps.denominator/(fps.numerator*(interlaced ? 2.0 : 1.0));
+      const double worst = pictureTimes[pictureTimes.worst()];
+      clog << "Picture deadline at " << frameRate << (interlaced ? " (interlaced)" : "")
+           << " = " << 1e3*deadline << " ms, " << pictureTimes.late(deadline)
+           << " pictures late, worst case uses " << 100.0*worst/deadline << "% of deadline" << endl;
+    }
+  }
+
+  if (md5File.is_open()) md5File << "output " << outputMD5.digest() << endl;
+  if (crc32cFile.is_open()) crc32cFile << "output " << outputCRC32C.digest() << endl;
+  if ((md5File.is_open() && !md5File) || (crc32cFile.is_open() && !crc32cFile)) {
+    cerr << "Failed to write checksum file" << endl;
+    return EXIT_FAILURE;
+  }
+
+  if (output==NONE) {
+    const double seconds = timing::now()-decodeStart;
+    clog << endl << "Decoded " << frame << " frames in " << seconds << " s = "
+         << frame/seconds << " frames per second (including file input)" << endl;
+    timing::summarise(clog, "Read slices", readTimes, 1e3, "ms");
+    timing::summarise(clog, "Merge slices", mergeTimes, 1e3, "ms");
+    timing::summarise(clog, "Inverse quantise", quantiseTimes, 1e3, "ms");
+    timing::summarise(clog, "Inverse transform", transformTimes, 1e3, "ms");
+    if (checksums) timing::summarise(clog, "Clip, format and checksum", verifyTimes, 1e3, "ms");
+    if (verifyMD5) {
+      const string md5 = outputMD5.digest();
+      if (md5!=expectedMD5) {
+        cerr << "MD5 mismatch: expected " << expectedMD5 << ", decoded " << md5 << endl;
+        return EXIT_FAILURE;
+      }
+      clog << "MD5 verified: " << md5 << endl;
+    }
+  }
+
+  if (endOfSequence) return EXIT_SUCCESS;
 
 } // end of try block
 
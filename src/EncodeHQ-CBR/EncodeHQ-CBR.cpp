@@ -25,6 +25,11 @@ Its primary output is the compressed bytes. However it may produce alternative o
   6 the decoded sequence\n\
   7 the PSNR for each frame\n\
 Input and output (where appropriate) are in planar format (4:4:4, 4:2:2, 4:2:0 or RGB).\n\
+Input may also be Y4M, or a numbered sequence of RGB DPX files (named by its first file).\n\
+RGB input may be coded as YCbCr, and chroma subsampled before coding, with --codeAs.\n\
+With --estimatePSNR the PSNR is estimated from the quantisation error, without decoding.\n\
+With --autotune the slice size, slice scalar and number of threads are chosen by encoding\n\
+calibration frames, as the fastest configuration meeting a PSNR floor (--minPSNR).\n\
 There can be 1 to 4 bytes per sample and the data is left (MSB) justified.\n\
 Data is assumed offset binary (which is fine for both YCbCr or RGB).\n\
 \n\
@@ -41,6 +46,13 @@ const char* details[] = {version, summary, description};
 #include <algorithm>
 #include <functional>
 #include <cmath>
+#include <sstream>
+#include <vector>
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "EncodeParams.h"
 #include "Arrays.h"
@@ -50,7 +62,11 @@ const char* details[] = {version, summary, description};
 #include "Quantisation.h"
 #include "Slices.h"
 #include "DataUnit.h"
+#include "Colour.h"
 #include "Utils.h"
+#include "TaskGraph.h"
+#include "Numa.h"
+#include "Metrics.h"
 
 using std::cout;
 using std::cin;
@@ -64,46 +80,597 @@ using std::ios_base;
 using std::istream;
 using std::ostream;
 
+// Calculate the quantisation index for a single slice using a binary search
+const int quantIndex(const Picture& slice,
+                     const Array1D& qMatrix,
+                     const int sliceBytes,
+                     const int scalar,
+                     const int waveletDepthHo) {
+  // Wavelet depth & number of subbands derived from dimensions of qMatrix
+  const int numberOfSubbands = qMatrix.size();
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
+  // Available bytes is the size of slice less 4 byte overhead
+  const int bytesAvailable = sliceBytes - 4;
+  int trialQ = 63;
+  int q = 127;
+  int delta = 64;
+  while (delta>0) {
+    delta >>= 1;
+    const Picture trialSlice = quantise_transform_np(slice, trialQ, qMatrix, waveletDepthHo);
+    int bytesRequired = component_slice_bytes(trialSlice.y(), waveletDepth, scalar, waveletDepthHo);
+    bytesRequired += component_slice_bytes(trialSlice.c1(), waveletDepth, scalar, waveletDepthHo);
+    bytesRequired += component_slice_bytes(trialSlice.c2(), waveletDepth, scalar, waveletDepthHo);
+    if (bytesRequired <= bytesAvailable) {
+      if (trialQ<q) q=trialQ;
+      trialQ -= delta;
+    }
+    else {
+      trialQ +=delta;
+    }
+  }
+  return q;
+}
+
 // Calculate quantisation indices using a binary search
 const Array2D quantIndices(const Picture& coefficients,
                            const Array1D& qMatrix,
                            const Array2D& sliceBytes,
-                           const int scalar) {
+                           const int scalar,
+                           const int waveletDepthHo) {
   const int ySlices = sliceBytes.shape()[0];
   const int xSlices = sliceBytes.shape()[1];
   // Create an empty array of indices to fill and return
   Array2D indices(extents[ySlices][xSlices]); 
-  // Wavelet depth & number of subbands derived from dimensions of qMatrix
-  const int numberOfSubbands = qMatrix.size();
-  const int waveletDepth = (numberOfSubbands-1)/3;
   const PictureArray slices = split_into_blocks(coefficients, ySlices, xSlices);
   for (int row=0; row<ySlices; ++row) {
     for (int column=0; column<xSlices; ++column) {
-      // Available bytes is the size of slice less 4 byte overhead
-      const int bytesAvailable = sliceBytes[row][column] - 4;
-      int trialQ = 63;
-      int q = 127;
-      int delta = 64;
-      while (delta>0) {
-        delta >>= 1;
-        const Picture trialSlice = quantise_transform_np(slices[row][column], trialQ, qMatrix);
-        int bytesRequired = component_slice_bytes(trialSlice.y(), waveletDepth, scalar);
-        bytesRequired += component_slice_bytes(trialSlice.c1(), waveletDepth, scalar);
-        bytesRequired += component_slice_bytes(trialSlice.c2(), waveletDepth, scalar);
-        if (bytesRequired <= bytesAvailable) {
-          if (trialQ<q) q=trialQ;
-          trialQ -= delta;
-        }
-        else {
-          trialQ +=delta;
-        }
-      }
-      indices[row][column] = q;
-      }
+      indices[row][column] = quantIndex(slices[row][column], qMatrix, sliceBytes[row][column], scalar, waveletDepthHo);
+    }
   }
   return indices;
 }
 
+// Mean and standard deviation of quantisation index from a histogram of indices
+void quantiserStats(const int stats[128], const int totalSlices, float& mean, float& stdDev) {
+  int topIndex = -1;
+  for (int i=0; i<128; ++i) if (stats[i]>0) topIndex=i;
+  mean = 0.0;
+  float meanSquare = 0.0;
+  for (int z=0; z<=topIndex; ++z) {
+    mean += (z*stats[z]);
+    meanSquare += (z*z*stats[z]);
+  }
+  mean /= totalSlices;
+  meanSquare /= totalSlices;
+  stdDev = sqrt(meanSquare - (mean*mean));
+}
+
+namespace {
+
+// Compressed output is produced by a graph of tasks. Each picture is
+// transformed (one task per component), then each row of slices is rate
+// searched, quantised and coded as soon as the transform is complete.
+// Rows are coded into buffers of their own so they need not wait for each
+// other. Finally the picture is written, after the previous picture, so
+// successive pictures overlap rather than proceeding stage by stage.
+// With NUMA placement each picture is given a node, its buffers are moved to
+// that node and its tasks are queued for the workers bound to that node.
+
+// Maximum number of input frames being encoded at once
+const int maxFramesInFlight = 2;
+
+// Counts the pages of picture and transform buffers found on the node of the
+// thread transforming them, and on other (remote) nodes
+class PageStats {
+  public:
+    void add(const numa::PageCount& pages) {
+      boost::mutex::scoped_lock lock(mutex);
+      total.local += pages.local;
+      total.remote += pages.remote;
+    }
+    const numa::PageCount count() const {
+      boost::mutex::scoped_lock lock(mutex);
+      return total;
+    }
+  private:
+    mutable boost::mutex mutex;
+    numa::PageCount total;
+};
+
+// Live metrics of the encoder (with --metrics). Stage times are summed over
+// all the threads that run each stage.
+struct EncoderMetrics {
+  metrics::Counter frames;
+  metrics::Counter bytes; // Written to the output
+  metrics::Counter lateFrames; // Taking longer than a frame period to encode
+  metrics::Timer transform;
+  metrics::Timer search; // For the quantisation indices
+  metrics::Timer quantise;
+  metrics::Timer code;
+  metrics::Timer write;
+  metrics::Timer decode; // For Decoded and PSNR output
+  metrics::Gauge qIndexMean; // Of the last frame
+  metrics::Gauge qIndexStdDev;
+  metrics::Gauge framesInFlight;
+};
+
+// Encoding parameters common to all pictures
+struct EncoderSettings {
+  EncoderSettings(const WaveletKernel kernel, const int waveletDepth,
+                  const int waveletDepthHo,
+                  const Array1D& qMatrix, const Array2D& sliceBytes,
+                  const int sliceScalar, const Output output,
+                  PageStats* pageStats, const bool estimatePSNR,
+                  EncoderMetrics* metrics):
+    kernel(kernel), waveletDepth(waveletDepth), waveletDepthHo(waveletDepthHo),
+    qMatrix(qMatrix),
+    sliceBytes(sliceBytes), sliceScalar(sliceScalar), output(output),
+    pageStats(pageStats), estimatePSNR(estimatePSNR),
+    gains(subband_gains(kernel, waveletDepth, waveletDepthHo)),
+    metrics(metrics) {}
+  const WaveletKernel kernel;
+  const int waveletDepth;
+  const int waveletDepthHo;
+  const Array1D qMatrix;
+  const Array2D sliceBytes;
+  const int sliceScalar;
+  const Output output;
+  PageStats* const pageStats; // Null unless NUMA placement is used
+  const bool estimatePSNR; // From the quantisation error of each slice
+  const std::vector<float> gains; // Synthesis gain of each subband
+  EncoderMetrics* const metrics; // Null unless live metrics are exported
+};
+
+// PSNR of a mean square error, for samples of the given bit depth
+const float psnr(const double meanSquareError, const int bitDepth) {
+  return -20*log10(sqrt(meanSquareError)/utils::pow(2, bitDepth));
+}
+
+// Bind a worker thread to the NUMA node of the same number as its group
+void bindWorker(const int group) {
+  numa::run_on_node(group);
+}
+
+// The state of one picture (field or frame) as it passes through the graph.
+// Each task writes a distinct part of it (a component or a row of slices).
+class PictureEncoder {
+  public:
+    // Node is the NUMA node on which to encode the picture (-1 for any)
+    PictureEncoder(const EncoderSettings& settings, const Picture& picture,
+                   unsigned long number, int node);
+    void transform(const int component);
+    void search(const int row);
+    void quantise(const int row);
+    void code(const int row);
+    void write(std::ostream& stream);
+    const Array2D& indices() const {return qIndices;}
+    int node() const {return numaNode;}
+    double startTime() const {return start;} // When the picture was read
+    // Mean square error of each component, estimated from the quantisation
+    // error (when estimating PSNR), once every row has been quantised
+    const std::vector<double> estimatedErrors() const;
+  private:
+    const EncoderSettings& settings;
+    const Picture picture;
+    const unsigned long number;
+    const int numaNode;
+    const double start;
+    const int ySlices;
+    const int xSlices;
+    Picture coefficients;
+    Array2D qIndices;
+    std::vector<PictureArray> rows; // Each row of slices, before then after quantisation
+    std::vector<std::string> coded; // Each row of slices, coded
+    std::vector<std::vector<double> > errors; // Of each row, by component
+};
+
+const PictureFormat transformFormat(const PictureFormat& format,
+                                   const int waveletDepth, const int waveletDepthHo) {
+  return PictureFormat(paddedSize(format.lumaHeight(), waveletDepth),
+                       paddedSize(format.lumaWidth(), waveletDepth+waveletDepthHo),
+                       paddedSize(format.chromaHeight(), waveletDepth),
+                       paddedSize(format.chromaWidth(), waveletDepth+waveletDepthHo),
+                       format.chromaFormat());
+}
+
+// Pictures with horizontal only levels always signal their quantisation
+// matrix, other pictures use the default matrix
+const Array1D customQuantMatrix(const EncoderSettings& settings) {
+  return (settings.waveletDepthHo>0 ? settings.qMatrix : Array1D());
+}
+
+// Copy one row of slices out of a component of the transform
+const Array2D sliceRow(const Array2D& component, const int row, const int ySlices) {
+  const int height = component.shape()[0];
+  const int width = component.shape()[1];
+  const int top = row*height/ySlices;
+  const int bottom = (row+1)*height/ySlices;
+  Array2D result(extents[bottom-top][width]);
+  result = component[indices[Range(top, bottom)][Range(0, width)]];
+  return result;
+}
+
+PictureEncoder::PictureEncoder(const EncoderSettings& s, const Picture& p,
+                               unsigned long n, int node):
+  settings(s), picture(p), number(n), numaNode(node), start(timing::now()),
+  ySlices(s.sliceBytes.shape()[0]), xSlices(s.sliceBytes.shape()[1]),
+  coefficients(transformFormat(p.format(), s.waveletDepth, s.waveletDepthHo)),
+  qIndices(extents[ySlices][xSlices]),
+  rows(ySlices), coded(ySlices), errors(ySlices, std::vector<double>(3, 0.0)) {
+  // The picture and coefficients were first touched by the reading thread
+  if (numaNode>=0) {
+    numa::place(picture, numaNode);
+    numa::place(coefficients, numaNode);
+  }
+}
+
+void PictureEncoder::transform(const int component) {
+  const metrics::ScopedTimer timer(settings.metrics ? &settings.metrics->transform : 0);
+  const WaveletKernel kernel = settings.kernel;
+  const int depth = settings.waveletDepth;
+  const int depthHo = settings.waveletDepthHo;
+  const Array2D* input;
+  const Array2D* output;
+  switch (component) {
+    case 0:
+      coefficients.y(waveletTransform(picture.y(), kernel, depth, depthHo));
+      input = &picture.y();
+      output = &coefficients.y();
+      break;
+    case 1:
+      coefficients.c1(waveletTransform(picture.c1(), kernel, depth, depthHo));
+      input = &picture.c1();
+      output = &coefficients.c1();
+      break;
+    default:
+      coefficients.c2(waveletTransform(picture.c2(), kernel, depth, depthHo));
+      input = &picture.c2();
+      output = &coefficients.c2();
+      break;
+  }
+  if (settings.pageStats) {
+    const int node = numa::current_node();
+    settings.pageStats->add(numa::count_pages(*input, node));
+    settings.pageStats->add(numa::count_pages(*output, node));
+  }
+}
+
+void PictureEncoder::search(const int row) {
+  const metrics::ScopedTimer timer(settings.metrics ? &settings.metrics->search : 0);
+  const Array2D luma = sliceRow(coefficients.y(), row, ySlices);
+  const Array2D chroma1 = sliceRow(coefficients.c1(), row, ySlices);
+  const Array2D chroma2 = sliceRow(coefficients.c2(), row, ySlices);
+  const PictureFormat rowFormat(luma.shape()[0], luma.shape()[1],
+                                chroma1.shape()[0], chroma1.shape()[1],
+                                coefficients.format().chromaFormat());
+  rows[row] = split_into_blocks(Picture(rowFormat, luma, chroma1, chroma2), 1, xSlices);
+  for (int column=0; column<xSlices; ++column) {
+    qIndices[row][column] = quantIndex(rows[row][0][column], settings.qMatrix,
+                                       settings.sliceBytes[row][column], settings.sliceScalar,
+                                       settings.waveletDepthHo);
+  }
+}
+
+void PictureEncoder::quantise(const int row) {
+  const metrics::ScopedTimer timer(settings.metrics ? &settings.metrics->quantise : 0);
+  for (int column=0; column<xSlices; ++column) {
+    const Picture quantised = quantise_transform_np(rows[row][0][column], qIndices[row][column], settings.qMatrix, settings.waveletDepthHo);
+    if (settings.estimatePSNR) { // Sum the squared error of the slice
+      const Picture& slice = rows[row][0][column];
+      Array2D sliceIndex(extents[1][1]);
+      sliceIndex[0][0] = qIndices[row][column];
+      errors[row][0] += slice.y().num_elements()*
+        quantisation_error_np(slice.y(), quantised.y(), sliceIndex, settings.qMatrix, settings.gains, settings.waveletDepthHo);
+      errors[row][1] += slice.c1().num_elements()*
+        quantisation_error_np(slice.c1(), quantised.c1(), sliceIndex, settings.qMatrix, settings.gains, settings.waveletDepthHo);
+      errors[row][2] += slice.c2().num_elements()*
+        quantisation_error_np(slice.c2(), quantised.c2(), sliceIndex, settings.qMatrix, settings.gains, settings.waveletDepthHo);
+    }
+    rows[row][0][column] = quantised;
+  }
+}
+
+const std::vector<double> PictureEncoder::estimatedErrors() const {
+  std::vector<double> result(3, 0.0);
+  for (int row=0; row<ySlices; ++row) {
+    for (int component=0; component<3; ++component) result[component] += errors[row][component];
+  }
+  const PictureFormat format = coefficients.format();
+  result[0] /= format.lumaHeight()*format.lumaWidth();
+  result[1] /= format.chromaHeight()*format.chromaWidth();
+  result[2] /= format.chromaHeight()*format.chromaWidth();
+  return result;
+}
+
+void PictureEncoder::code(const int row) {
+  const metrics::ScopedTimer timer(settings.metrics ? &settings.metrics->code : 0);
+  Array2D rowBytes(extents[1][xSlices]);
+  rowBytes[0] = settings.sliceBytes[row];
+  Array2D rowIndices(extents[1][xSlices]);
+  rowIndices[0] = qIndices[row];
+  std::ostringstream buffer;
+  buffer << sliceio::highQualityCBR(rowBytes, settings.sliceScalar);
+  buffer << Slices(rows[row], settings.waveletDepth, rowIndices, settings.waveletDepthHo);
+  coded[row] = buffer.str();
+  rows[row] = PictureArray(); // No longer needed
+}
+
+void PictureEncoder::write(std::ostream& stream) {
+  const metrics::ScopedTimer timer(settings.metrics ? &settings.metrics->write : 0);
+  std::string slices;
+  for (int row=0; row<ySlices; ++row) slices += coded[row];
+  if (settings.output==STREAM) {
+    const int slicePrefix = 0;
+    const WrappedPicture outWrapped(number,
+                                    settings.kernel,
+                                    settings.waveletDepth,
+                                    xSlices,
+                                    ySlices,
+                                    slicePrefix,
+                                    settings.sliceScalar,
+                                    slices,
+                                    settings.waveletDepthHo,
+                                    customQuantMatrix(settings));
+    stream << dataunitio::highQualityCBR(settings.sliceBytes, settings.sliceScalar);
+    stream << outWrapped;
+  }
+  else { // PACKAGED
+    stream << slices;
+  }
+  if (!stream) throw std::runtime_error("Failed to write output file");
+}
+
+typedef boost::shared_ptr<PictureEncoder> PictureEncoderPtr;
+
+// Adds the tasks to encode a picture, written after task "previous" (if any).
+// Returns the task that writes the picture.
+const TaskGraph::Task schedule(TaskGraph& graph,
+                               const PictureEncoderPtr& encoder,
+                               std::ostream& stream,
+                               const TaskGraph::Task previous) {
+  const int node = encoder->node(); // Preferred group of workers
+  TaskGraph::Tasks transforms;
+  for (int component=0; component<3; ++component) {
+    transforms.push_back(graph.add(boost::bind(&PictureEncoder::transform, encoder, component),
+                                   TaskGraph::Tasks(), node));
+  }
+  TaskGraph::Tasks coded;
+  const int ySlices = encoder->indices().shape()[0];
+  for (int row=0; row<ySlices; ++row) {
+    const TaskGraph::Task search =
+      graph.add(boost::bind(&PictureEncoder::search, encoder, row), transforms, node);
+    const TaskGraph::Task quantise =
+      graph.add(boost::bind(&PictureEncoder::quantise, encoder, row), TaskGraph::Tasks(1, search), node);
+    coded.push_back(graph.add(boost::bind(&PictureEncoder::code, encoder, row), TaskGraph::Tasks(1, quantise), node));
+  }
+  if (previous>=0) coded.push_back(previous);
+  return graph.add(boost::bind(&PictureEncoder::write, encoder, boost::ref(stream)), coded);
+}
+
+// Log quantiser statistics (if verbose) and any estimated PSNR for a frame, and
+// update any live metrics, once it has been encoded. Frames taking longer than
+// "framePeriod" (seconds, if known) from being read to being written are late.
+void report(const int frame, const std::vector<PictureEncoderPtr>& pictures,
+            const bool verbose, const bool estimatePSNR,
+            const int lumaDepth, const int chromaDepth,
+            EncoderMetrics* metrics, const double framePeriod) {
+  int stats[128] = {0};
+  int totalSlices = 0;
+  for (unsigned int pic=0; pic<pictures.size(); ++pic) {
+    const Array2D& qIndices = pictures[pic]->indices();
+    for (const int* q=qIndices.data(); q!=qIndices.data()+qIndices.num_elements(); ++q) ++stats[*q];
+    totalSlices += qIndices.num_elements();
+  }
+  float mean, stdDev;
+  quantiserStats(stats, totalSlices, mean, stdDev);
+  if (metrics) {
+    metrics->frames.add();
+    metrics->qIndexMean.set(mean);
+    metrics->qIndexStdDev.set(stdDev);
+    if ((framePeriod>0.0) && (timing::now()-pictures[0]->startTime()>framePeriod)) metrics->lateFrames.add();
+  }
+  std::ostringstream message; // Logged in one piece as other threads may be logging too
+  if (verbose) {
+    message << std::fixed << std::setprecision(2);
+    message << "Frame " << frame << ": Mean, Standard Deviation of quantiser index = " << mean << ", " << stdDev << endl;
+  }
+  if (estimatePSNR) { // Fields each contribute half the error of a frame
+    std::vector<double> errors(3, 0.0);
+    for (unsigned int pic=0; pic<pictures.size(); ++pic) {
+      const std::vector<double> picErrors = pictures[pic]->estimatedErrors();
+      for (int component=0; component<3; ++component) errors[component] += picErrors[component]/pictures.size();
+    }
+    message << std::fixed << std::setprecision(4);
+    message << "Frame " << frame << ": Estimated PSNR for Y/R, U/G, V/B = " << psnr(errors[0], lumaDepth)
+            << ", " << psnr(errors[1], chromaDepth) << ", " << psnr(errors[2], chromaDepth) << endl;
+  }
+  if (!message.str().empty()) clog << message.str();
+}
+
+// Read the next input frame, converting its colour format for coding if
+// necessary. Returns false at the end of the input.
+const bool readFrame(istream& inStream, dpx::SequenceReader* dpxReader,
+                     Frame& inFrame, Frame& sourceFrame,
+                     const bool convertInput, const ColourMatrix matrix, const int lumaDepth) {
+  const ColourFormat chromaFormat = inFrame.format().chromaFormat();
+  const bool interlaced = inFrame.interlaced();
+  if (dpxReader) { // Read the next file of the sequence
+    Picture picture;
+    if (!dpxReader->next(picture)) return false;
+    inFrame.frame(convertInput ? convert_for_coding(picture, chromaFormat, matrix, lumaDepth, interlaced) : picture);
+  }
+  else if (convertInput) { // Read the input frame and convert its colour format
+    if (!(inStream >> sourceFrame)) return false;
+    inFrame.frame(convert_for_coding(sourceFrame, chromaFormat, matrix, lumaDepth, interlaced));
+  }
+  else inStream >> inFrame; // Read the input frame
+  return static_cast<bool>(inStream);
+}
+
+// --autotune encodes calibration frames with candidate slice sizes and
+// thread counts, using the smallest slice scalar each slice size allows.
+// Each slice size is first encoded with every thread, estimating its PSNR
+// from the quantisation error. The fastest few that meet the quality floor
+// are then timed with each thread count, without estimating the PSNR.
+
+// A configuration tried by --autotune, and how it performed
+struct Tuning {
+  int ySize; // In units of 2**(wavelet depth)
+  int xSize; // In units of 2**(wavelet depth + horizontal only depth)
+  int sliceScalar;
+  int threads;
+  double fps; // Frames encoded per second
+  double psnr; // Estimated PSNR of luma (dB)
+};
+
+// Number of slice sizes timed with each thread count
+const unsigned int tunedSliceSizes = 3;
+
+const bool fasterThan(const Tuning& a, const Tuning& b) {
+  return a.fps>b.fps;
+}
+
+// Candidate slice sizes, in units of the transform, for a padded picture
+// "units" long: powers of two up to 8, and the size given on the command
+// line, that divide it into whole slices
+const std::vector<int> sliceSizes(const int units, const int given) {
+  std::vector<int> sizes;
+  for (int size=1; size<=8; size*=2) {
+    if ((units%size==0) && (size!=given)) sizes.push_back(size);
+  }
+  if (units%given==0) sizes.push_back(given);
+  std::sort(sizes.begin(), sizes.end());
+  return sizes;
+}
+
+// The smallest slice scalar with which every slice can signal the length
+// of each of its components (at most 255 units of scalar bytes, with the
+// bytes per slice given by slice_bytes), or 0 if the slices are too small
+const int minimumScalar(const int pictureBytes, const int slices) {
+  for (int scalar=1; ; ++scalar) {
+    const int units = pictureBytes/scalar - 4*slices;
+    if (units<slices) return 0;
+    if ((units+slices-1)/slices<=255) return scalar;
+  }
+}
+
+// Encode calibration pictures with the given settings, discarding the
+// output. Returns the mean square error of luma estimated from the
+// quantisation error (if the settings estimate PSNR, else zero).
+const double encodeCalibration(const EncoderSettings& settings, const int threads,
+                               const std::vector<Picture>& pictures, const int framePics) {
+  TaskGraph graph(threads);
+  std::ostringstream output; // Discarded
+  std::vector<PictureEncoderPtr> encoders;
+  std::deque<TaskGraph::Task> framesInFlight;
+  TaskGraph::Task lastWrite = -1;
+  for (unsigned int pic=0; pic<pictures.size(); ++pic) {
+    const int frame = pic/framePics;
+    if ((pic%framePics==0) && (framesInFlight.size()>=static_cast<unsigned int>(maxFramesInFlight))) {
+      graph.wait(framesInFlight.front());
+      framesInFlight.pop_front();
+    }
+    encoders.push_back(PictureEncoderPtr(new PictureEncoder(settings, pictures[pic], frame, -1)));
+    lastWrite = schedule(graph, encoders.back(), output, lastWrite);
+    if (pic%framePics==static_cast<unsigned int>(framePics-1)) framesInFlight.push_back(lastWrite);
+  }
+  graph.wait();
+  double error = 0.0;
+  if (settings.estimatePSNR) {
+    for (unsigned int pic=0; pic<encoders.size(); ++pic) error += encoders[pic]->estimatedErrors()[0];
+    error /= encoders.size();
+  }
+  return error;
+}
+
+// Log a configuration tried by --autotune, as command line options
+void logTuning(const char* prefix, const Tuning& tuning) {
+  std::ostringstream message;
+  message << prefix << "-u " << tuning.ySize << " -a " << tuning.xSize
+          << " -S " << tuning.sliceScalar << " -j " << tuning.threads
+          << std::fixed << std::setprecision(2)
+          << ": " << tuning.fps << " fps, estimated luma PSNR " << tuning.psnr << " dB" << endl;
+  clog << message.str();
+}
+
+// Find the fastest configuration, from those tried by --autotune, that
+// meets the PSNR floor of the parameters. The pictures are fields, in
+// pairs, if interlaced. Throws std::runtime_error if none meets the floor.
+const Tuning autotune(const ProgramParams& params, const std::vector<Picture>& pictures) {
+  const int waveletDepth = params.waveletDepth;
+  const int waveletDepthHo = params.waveletDepthHo;
+  const int framePics = (params.interlaced ? 2 : 1);
+  const int frames = pictures.size()/framePics;
+  const int pictureBytes = (params.interlaced ? params.compressedBytes/2 : params.compressedBytes);
+  const int pictureHeight = (params.interlaced ? params.height/2 : params.height);
+  // Size of the padded transform, of luma and chroma, in units of slice size
+  const PictureFormat padded = transformFormat(PictureFormat(pictureHeight, params.width, params.chromaFormat),
+                                               waveletDepth, waveletDepthHo);
+  const int yUnits = padded.lumaHeight()/utils::pow(2, waveletDepth);
+  const int xUnits = padded.lumaWidth()/utils::pow(2, waveletDepth+waveletDepthHo);
+  const int yChromaUnits = padded.chromaHeight()/utils::pow(2, waveletDepth);
+  const int xChromaUnits = padded.chromaWidth()/utils::pow(2, waveletDepth+waveletDepthHo);
+  const Array1D qMatrix = quantMatrix(params.kernel, waveletDepth, waveletDepthHo);
+  const int lumaDepth = params.lumaDepth;
+
+  // Thread counts are powers of two up to, and including, the maximum
+  int maxThreads = (params.threads>0 ? params.threads : boost::thread::hardware_concurrency());
+  if (maxThreads<1) maxThreads = 1; // hardware_concurrency may return 0
+  std::vector<int> threadCounts;
+  for (int threads=1; threads<maxThreads; threads*=2) threadCounts.push_back(threads);
+  threadCounts.push_back(maxThreads);
+
+  // Estimate the PSNR of each slice size (independent of the threads)
+  std::vector<Tuning> sizes;
+  const std::vector<int> ySizes = sliceSizes(yUnits, params.ySize);
+  const std::vector<int> xSizes = sliceSizes(xUnits, params.xSize);
+  for (unsigned int y=0; y<ySizes.size(); ++y) {
+    for (unsigned int x=0; x<xSizes.size(); ++x) {
+      const int ySlices = yUnits/ySizes[y];
+      const int xSlices = xUnits/xSizes[x];
+      // Slices must also divide subsampled chroma into whole slices
+      if ((yChromaUnits%ySlices!=0) || (xChromaUnits%xSlices!=0)) continue;
+      const int scalar = minimumScalar(pictureBytes, ySlices*xSlices);
+      if (scalar==0) continue; // Slices too small for the compressed bytes
+      const EncoderSettings settings(params.kernel, waveletDepth, waveletDepthHo, qMatrix,
+                                     slice_bytes(ySlices, xSlices, pictureBytes, scalar),
+                                     scalar, params.output, 0, true, 0);
+      const double start = timing::now();
+      const double error = encodeCalibration(settings, maxThreads, pictures, framePics);
+      const Tuning tuning = {ySizes[y], xSizes[x], scalar, maxThreads,
+                             frames/(timing::now()-start), psnr(error, lumaDepth)};
+      if (params.verbose) logTuning("Autotune calibration (with PSNR estimation) ", tuning);
+      if (tuning.psnr>=params.minPSNR) sizes.push_back(tuning);
+    }
+  }
+  if (sizes.empty())
+    throw std::runtime_error("autotune found no slice size meeting the PSNR floor");
+
+  // Time the fastest slice sizes with each thread count
+  std::sort(sizes.begin(), sizes.end(), fasterThan);
+  if (sizes.size()>tunedSliceSizes) sizes.resize(tunedSliceSizes);
+  std::vector<Tuning> tunings;
+  for (unsigned int size=0; size<sizes.size(); ++size) {
+    Tuning tuning = sizes[size];
+    const int ySlices = yUnits/tuning.ySize;
+    const int xSlices = xUnits/tuning.xSize;
+    const EncoderSettings settings(params.kernel, waveletDepth, waveletDepthHo, qMatrix,
+                                   slice_bytes(ySlices, xSlices, pictureBytes, tuning.sliceScalar),
+                                   tuning.sliceScalar, params.output, 0, false, 0);
+    for (unsigned int t=0; t<threadCounts.size(); ++t) {
+      tuning.threads = threadCounts[t];
+      const double start = timing::now();
+      encodeCalibration(settings, tuning.threads, pictures, framePics);
+      tuning.fps = frames/(timing::now()-start);
+      if (params.verbose) logTuning("Autotune calibration ", tuning);
+      tunings.push_back(tuning);
+    }
+  }
+  return *std::min_element(tunings.begin(), tunings.end(), fasterThan);
+}
+
+} // end unnamed namespace
+
 int main(int argc, char * argv[]) {
   
 try { //Giant try block around all code to get error messages
@@ -119,22 +686,6 @@ try { //Giant try block around all code to get error messages
   const string inFileName = params.inFileName;
   const string outFileName = params.outFileName;
   const bool verbose = params.verbose;
-  const int height = params.height;
-  const int width = params.width;
-  const ColourFormat chromaFormat = params.chromaFormat;
-  const int bytes = params.bytes;
-  const int lumaDepth = params.lumaDepth;
-  const int chromaDepth = params.chromaDepth;
-  const bool interlaced = params.interlaced;
-  const bool topFieldFirst = params.topFieldFirst;
-  const WaveletKernel kernel = params.kernel;
-  const int waveletDepth = params.waveletDepth;
-  const int ySize = params.ySize;
-  const int xSize = params.xSize;
-  const int compressedBytes = params.compressedBytes;
-  const Output output = params.output;
-  const FrameRate frame_rate = params.frame_rate;
-  const int sliceScalar = params.slice_scalar;
 
   if (verbose) {
     clog << endl;
@@ -170,11 +721,89 @@ try { //Giant try block around all code to get error messages
   }
   istream inStream(pInBuffer);
 
+  // Read the picture format from the header of Y4M input
+  if (params.y4mInput) {
+    Y4MHeader header;
+    inStream >> header;
+    if (!inStream) {
+      cerr << "Failed to read Y4M header from input file \"" << inFileName << "\"" << endl;
+      return EXIT_FAILURE;
+    }
+    setY4MFormat(params, header);
+  }
+
+  // DPX input is a sequence of files, read ahead on threads of their own
+  boost::scoped_ptr<dpx::SequenceReader> dpxReader;
+  if (params.dpxInput) {
+    dpxReader.reset(new dpx::SequenceReader(inFileName, params.readThreads));
+    setDPXFormat(params, dpxReader->header());
+  }
+
+  // Create convenient aliases for the picture format and coding parameters
+  const int height = params.height;
+  const int width = params.width;
+  const ColourFormat chromaFormat = params.chromaFormat;
+  const ColourFormat inputFormat = params.inputFormat;
+  const bool convertInput = (inputFormat!=chromaFormat);
+  const ColourMatrix matrix = params.matrix;
+  const int bytes = params.bytes;
+  const int lumaDepth = params.lumaDepth;
+  const int chromaDepth = params.chromaDepth;
+  const bool interlaced = params.interlaced;
+  const bool topFieldFirst = params.topFieldFirst;
+  const WaveletKernel kernel = params.kernel;
+  const int waveletDepth = params.waveletDepth;
+  const int waveletDepthHo = params.waveletDepthHo;
+  int ySize = params.ySize; // Slice size, scalar and threads may be chosen by --autotune
+  int xSize = params.xSize;
+  const int compressedBytes = params.compressedBytes;
+  const Output output = params.output;
+  const FrameRate frame_rate = params.frame_rate;
+  int sliceScalar = params.slice_scalar;
+  int threads = params.threads;
+  const bool numaPlacement = params.numa;
+  const bool estimatePSNR = params.estimatePSNR;
+  const string metricsFile = params.metricsFile;
+  const double metricsInterval = params.metricsInterval;
+  const bool y4mInput = params.y4mInput;
+  const bool y4mOutput = params.y4mOutput;
+
   // Configure input stream to read the required picture format
   inStream >> pictureio::wordWidth(bytes); // Set number of bytes per value in file
   inStream >> pictureio::left_justified;
   inStream >> pictureio::offset_binary;
   inStream >> pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
+  if (y4mInput) inStream >> pictureio::y4m; // FRAME markers and Y4M sample format
+
+  // With --autotune the first frames are read for calibration, then encoded
+  // with the tuned configuration
+  std::deque<Frame> calibrationFrames;
+  if (params.autotuneFrames>0) {
+    Frame calibrationFrame(PictureFormat(height, width, chromaFormat), interlaced, topFieldFirst);
+    Frame sourceFrame(PictureFormat(height, width, inputFormat), interlaced, topFieldFirst);
+    std::vector<Picture> pictures; // Fields, if interlaced
+    while ((calibrationFrames.size()<static_cast<unsigned int>(params.autotuneFrames)) &&
+           readFrame(inStream, dpxReader.get(), calibrationFrame, sourceFrame, convertInput, matrix, lumaDepth)) {
+      calibrationFrames.push_back(calibrationFrame);
+      if (interlaced) {
+        pictures.push_back(calibrationFrame.firstField());
+        pictures.push_back(calibrationFrame.secondField());
+      }
+      else pictures.push_back(calibrationFrame);
+    }
+    if (calibrationFrames.empty()) {
+      cerr << "Failed to read input frame number 0" << endl;
+      return EXIT_FAILURE;
+    }
+    if (verbose) clog << "Autotuning with " << calibrationFrames.size() << " calibration frames" << endl;
+    const Tuning tuning = autotune(params, pictures);
+    logTuning("Autotune recommends ", tuning);
+    if (params.autotuneOnly) return EXIT_SUCCESS;
+    ySize = tuning.ySize;
+    xSize = tuning.xSize;
+    sliceScalar = tuning.sliceScalar;
+    threads = tuning.threads;
+  }
 
   // Open output file or use standard output.
   // Output stream is write only binary mode
@@ -197,7 +826,19 @@ try { //Giant try block around all code to get error messages
       return EXIT_FAILURE;
     }
   }
-  ostream outStream(pOutBuffer);
+  // With live metrics the bytes written are counted on their way to the output
+  EncoderMetrics encoderMetrics;
+  EncoderMetrics* const liveMetrics = (metricsFile.empty() ? 0 : &encoderMetrics);
+  metrics::CountingBuffer countingBuffer(pOutBuffer, encoderMetrics.bytes);
+  ostream outStream(liveMetrics ? &countingBuffer : pOutBuffer);
+
+  // Decoded Y4M output starts with a header
+  if (y4mOutput) {
+    const utils::Rational fps = frames_per_second(frame_rate);
+    outStream << Y4MHeader(PictureFormat(height, width, chromaFormat), lumaDepth,
+                           interlaced, topFieldFirst, fps.numerator, fps.denominator);
+    outStream << pictureio::y4m;
+  }
 
   PictureFormat format(height, width, chromaFormat);
 
@@ -208,22 +849,29 @@ try { //Giant try block around all code to get error messages
     clog << "height = " << format.lumaHeight() << endl;
     clog << "width = " << format.lumaWidth() << endl;
     clog << "chroma format = " << format.chromaFormat() << endl;
+    if (convertInput) clog << "input chroma format = " << inputFormat << endl;
+    if (convertInput && (inputFormat==RGB)) clog << "colour matrix = " << matrix << endl;
     clog << "interlaced = " << std::boolalpha << interlaced << endl;
     if (interlaced) clog << "top field first = " << std::boolalpha << topFieldFirst << endl;
     clog << "wavelet kernel = " << kernel << endl;
     clog << "wavelet depth = " << waveletDepth << endl;
+    clog << "horizontal only wavelet depth = " << waveletDepthHo << endl;
     clog << "vertical slice size (in units of 2**(wavelet depth)) = " << ySize << endl;
-    clog << "horizontal slice size (in units of 2**(wavelet depth)) = " << xSize << endl;
+    clog << "horizontal slice size (in units of 2**(wavelet depth+horizontal only depth)) = " << xSize << endl;
     clog << "compressed bytes = " << compressedBytes << endl;
     clog << "output = " << output << endl;
+    if (estimatePSNR) clog << "estimate PSNR = true" << endl;
+    if (liveMetrics) clog << "metrics file = " << metricsFile << " (every " << metricsInterval << " s)" << endl;
+    clog << "threads = " << threads << " (0 means one per hardware thread)" << endl;
+    clog << "NUMA placement = " << std::boolalpha << numaPlacement << " (" << numa::nodes() << " nodes)" << endl;
   }
 
   // Calculate number of slices per picture
   const int yTransformSize = ySize*utils::pow(2,waveletDepth);
-  const int xTransformSize = xSize*utils::pow(2,waveletDepth);
+  const int xTransformSize = xSize*utils::pow(2,waveletDepth+waveletDepthHo);
   const int pictureHeight = ( (interlaced) ? height/2 : height);
   const int paddedPictureHeight = paddedSize(pictureHeight, waveletDepth);
-  const int paddedWidth = paddedSize(width, waveletDepth);
+  const int paddedWidth = paddedSize(width, waveletDepth+waveletDepthHo);
   const int ySlices = paddedPictureHeight/yTransformSize;
   const int xSlices = paddedWidth/xTransformSize;
   if (paddedPictureHeight != (ySlices*yTransformSize) ) {
@@ -248,7 +896,7 @@ try { //Giant try block around all code to get error messages
   }
 
   // Calculate the quantisation matrix
-  const Array1D qMatrix = quantMatrix(kernel, waveletDepth);
+  const Array1D qMatrix = quantMatrix(kernel, waveletDepth, waveletDepthHo);
   if (verbose) {
     clog << "Quantisation matrix = " << qMatrix[0];
     for (unsigned int i=1; i<qMatrix.size(); ++i) {
@@ -263,24 +911,78 @@ try { //Giant try block around all code to get error messages
 
   //Create input & output frames
   Frame inFrame(format, interlaced, topFieldFirst);
+  // Input converted before coding (--codeAs) is read into its own frame first
+  Frame sourceFrame(PictureFormat(height, width, inputFormat), interlaced, topFieldFirst);
   Frame outFrame(format, interlaced, topFieldFirst); //used for decoded picture only
   Array2D yDiff(format.lumaShape()); // used for PSNR calculation only
   Array2D uDiff(format.chromaShape()); // used for PSNR calculation only
   Array2D vDiff(format.chromaShape()); // used for PSNR calculation only
 
+  // Compressed output is encoded by a task graph (see PictureEncoder)
+  const bool pipelined = ((output==STREAM) || (output==PACKAGED));
+  PageStats pageStats;
+  const EncoderSettings settings(kernel, waveletDepth, waveletDepthHo, qMatrix,
+                                 slice_bytes(ySlices, xSlices, (interlaced ? compressedBytes/2 : compressedBytes), sliceScalar),
+                                 sliceScalar, output,
+                                 (numaPlacement ? &pageStats : 0), estimatePSNR, liveMetrics);
+  // With NUMA placement there is a group of workers for each node
+  TaskGraph graph((pipelined ? threads : 1),
+                  (numaPlacement ? numa::nodes() : 1),
+                  (numaPlacement ? TaskGraph::Start(bindWorker) : TaskGraph::Start()));
+  std::deque<TaskGraph::Task> framesInFlight; // Final task for each frame being encoded
+  TaskGraph::Task lastWrite = -1;
+
+  // Frames taking longer than a frame period to encode are counted as late
+  const utils::Rational fps = frames_per_second(frame_rate);
+  const double framePeriod = (fps.numerator>0 ? double(fps.denominator)/fps.numerator : 0.0);
+  boost::scoped_ptr<metrics::Exporter> exporter;
+  if (liveMetrics) {
+    exporter.reset(new metrics::Exporter(metricsFile, metricsInterval));
+    exporter->add("vc2_encoder_frames_total", "Frames encoded", encoderMetrics.frames);
+    exporter->addRate("vc2_encoder_frames_per_second", "Frames encoded per second", encoderMetrics.frames);
+    exporter->add("vc2_encoder_late_frames_total", "Frames taking longer than a frame period to encode", encoderMetrics.lateFrames);
+    exporter->add("vc2_encoder_output_bytes_total", "Bytes written to the output", encoderMetrics.bytes);
+    const string help = "Time spent in each encoding stage, summed over threads";
+    exporter->add("vc2_encoder_stage_seconds_total", help, encoderMetrics.transform, "stage=\"transform\"");
+    exporter->add("vc2_encoder_stage_seconds_total", help, encoderMetrics.search, "stage=\"search\"");
+    exporter->add("vc2_encoder_stage_seconds_total", help, encoderMetrics.quantise, "stage=\"quantise\"");
+    exporter->add("vc2_encoder_stage_seconds_total", help, encoderMetrics.code, "stage=\"code\"");
+    exporter->add("vc2_encoder_stage_seconds_total", help, encoderMetrics.write, "stage=\"write\"");
+    exporter->add("vc2_encoder_stage_seconds_total", help, encoderMetrics.decode, "stage=\"decode\"");
+    exporter->add("vc2_encoder_quantiser_index_mean", "Mean quantisation index of the last frame", encoderMetrics.qIndexMean);
+    exporter->add("vc2_encoder_quantiser_index_stddev", "Standard deviation of the quantisation index of the last frame", encoderMetrics.qIndexStdDev);
+    exporter->add("vc2_encoder_frames_in_flight", "Frames queued or being encoded", encoderMetrics.framesInFlight);
+    exporter->start();
+  }
+
   int frame = 0;
   if (output==STREAM) {
     if (verbose) clog << endl << "Writing Sequence Header" << endl << endl;
     outStream << dataunitio::start_sequence;
-    outStream << SequenceHeader(PROFILE_HQ, format.lumaHeight(), format.lumaWidth(), format.chromaFormat(), interlaced, frame_rate, topFieldFirst, lumaDepth);
+    SequenceHeader sequence(PROFILE_HQ, format.lumaHeight(), format.lumaWidth(), format.chromaFormat(), interlaced, frame_rate, topFieldFirst, lumaDepth);
+    if (waveletDepthHo>0) sequence.major_version = 3; // Asymmetric transforms need version 3
+    outStream << sequence;
   }
   while (true) {
 
+    // Limit the number of frames being encoded at once
+    if (framesInFlight.size()>=static_cast<unsigned int>(maxFramesInFlight)) {
+      graph.wait(framesInFlight.front());
+      framesInFlight.pop_front();
+    }
+    if (liveMetrics) encoderMetrics.framesInFlight.set(framesInFlight.size());
+
     // Read input from planar file
     if (verbose) clog << "Reading input frame number " << frame;
-    inStream >> inFrame; // Read the input frame
+    bool haveFrame;
+    if (!calibrationFrames.empty()) { // Frames already read by --autotune come first
+      inFrame = calibrationFrames.front();
+      calibrationFrames.pop_front();
+      haveFrame = true;
+    }
+    else haveFrame = readFrame(inStream, dpxReader.get(), inFrame, sourceFrame, convertInput, matrix, lumaDepth);
     // Check frame was read OK
-    if (!inStream) {
+    if (!haveFrame) {
       if (frame==0) {
         cerr << "\rFailed to read input frame number " << frame << endl;
 	      return EXIT_FAILURE;
@@ -291,9 +993,29 @@ try { //Giant try block around all code to get error messages
       }
     }
     else if (verbose) clog << endl;
+    const double frameStart = timing::now();
+
+    if (pipelined) {
+      std::vector<PictureEncoderPtr> pictures;
+      for (int pic=0 ; pic<framePics; ++pic) {
+        const Picture picture = (interlaced ? (pic==0 ? inFrame.firstField() : inFrame.secondField()) : inFrame);
+        const int node = (numaPlacement ? (framePics*frame+pic)%graph.groups() : -1);
+        pictures.push_back(PictureEncoderPtr(new PictureEncoder(settings, picture, frame, node)));
+        lastWrite = schedule(graph, pictures.back(), outStream, lastWrite);
+      }
+      if (verbose || estimatePSNR || liveMetrics)
+        lastWrite = graph.add(boost::bind(report, frame, pictures, verbose, estimatePSNR, lumaDepth, chromaDepth,
+                                          liveMetrics, framePeriod), lastWrite);
+      framesInFlight.push_back(lastWrite);
+      ++frame;
+      continue;
+    }
 
     int stats[128] = {0}; //Define and initialise array to hold quantiser stats
 
+    // Mean square errors of the frame estimated from the quantisation error (--estimatePSNR)
+    double yMSE = 0.0, uMSE = 0.0, vMSE = 0.0;
+
     Picture picture; // define a picture, either a field or frame
     for (int pic=0 ; pic<framePics; ++pic) { // loop over fields if interlaced input
 
@@ -304,9 +1026,12 @@ try { //Giant try block around all code to get error messages
         picture = inFrame;
       }
 
+      double stageStart = timing::now();
+
       //Forward wavelet transform
       if (verbose) clog << "Forward transform" << endl;
-      Picture transform = waveletTransform(picture, kernel, waveletDepth);
+      Picture transform = waveletTransform(picture, kernel, waveletDepth, waveletDepthHo);
+      if (liveMetrics) metrics::lap(encoderMetrics.transform, stageStart);
 
       if (output==TRANSFORM) {
         //Write transform output as 4 byte 2's comp values
@@ -325,7 +1050,8 @@ try { //Giant try block around all code to get error messages
       const int pictureBytes = (interlaced ? compressedBytes/2 : compressedBytes);
       // Calculate number of bytes for each slice
       const Array2D bytes = slice_bytes(ySlices, xSlices, pictureBytes, sliceScalar);
-      Array2D qIndices = quantIndices(transform, qMatrix, bytes, sliceScalar);
+      Array2D qIndices = quantIndices(transform, qMatrix, bytes, sliceScalar, waveletDepthHo);
+      if (liveMetrics) metrics::lap(encoderMetrics.search, stageStart);
     
       // Analyse quantiser index stats
       for (int v=0; v<ySlices; ++v) {
@@ -347,7 +1073,14 @@ try { //Giant try block around all code to get error messages
       }
 
       if (verbose) clog << "Quantise transform coefficients" << endl;
-      const Picture quantisedSlices = quantise_transform_np(transform, qIndices, qMatrix);
+      const Picture quantisedSlices = quantise_transform_np(transform, qIndices, qMatrix, waveletDepthHo);
+      if (liveMetrics) metrics::lap(encoderMetrics.quantise, stageStart);
+
+      if (estimatePSNR) { // Fields each contribute half the error of a frame
+        yMSE += quantisation_error_np(transform.y(), quantisedSlices.y(), qIndices, qMatrix, settings.gains, waveletDepthHo)/framePics;
+        uMSE += quantisation_error_np(transform.c1(), quantisedSlices.c1(), qIndices, qMatrix, settings.gains, waveletDepthHo)/framePics;
+        vMSE += quantisation_error_np(transform.c2(), quantisedSlices.c2(), qIndices, qMatrix, settings.gains, waveletDepthHo)/framePics;
+      }
       
       if (output==QUANTISED) {
         //Write quantised transform output as 4 byte 2's comp values
@@ -361,55 +1094,15 @@ try { //Giant try block around all code to get error messages
         continue; // omit rest of processing for this picture
       }
 
-      // Split transform into slices
-      if (verbose) clog << "Split quantised coefficients into slices" << endl;
-      const PictureArray slices = split_into_blocks(quantisedSlices, ySlices, xSlices);
-
-      if (output==PACKAGED) {
-        // Package up data for output
-        const Slices outSlices(slices, waveletDepth, qIndices);
+      if (estimatePSNR) continue; // The PSNR is estimated without decoding the picture
 
-        //Write packaged output
-        if (verbose) clog << "Writing compressed output to file" << endl;
-        outStream << sliceio::highQualityCBR(bytes, sliceScalar); // Write output in HQ CBR mode
-        outStream << outSlices;
-        if (!outStream) {
-          cerr << "Failed to write output file \"" << outFileName << "\"" << endl;
-	        return EXIT_FAILURE;
-        }
-        continue; // omit rest of processing for this picture
-      }
-
-      if (output==STREAM) {
-        const int slicePrefix = 0;
-        const Slices outSlices(slices, waveletDepth, qIndices);
-        const WrappedPicture outWrapped(frame,
-                                        kernel,
-                                        waveletDepth,
-                                        xSlices,
-                                        ySlices,
-                                        slicePrefix,
-                                        sliceScalar,
-                                        outSlices);
-
-        //Write packaged output
-        if (verbose) clog << "Writing compressed output to file" << endl;
-        outStream << dataunitio::highQualityCBR(bytes, sliceScalar); // Write output in HQ CBR mode
-        outStream << outWrapped;
-        if (!outStream) {
-          cerr << "Failed to write output file \"" << outFileName << "\"" << endl;
-	        return EXIT_FAILURE;
-        }
-        continue; // omit rest of processing for this picture
-      }
-    
       // Inverse quantise in transform order
       if (verbose) clog << "Inverse quantise" << endl;
-      const Picture yuvTransform = inverse_quantise_transform_np(quantisedSlices, qIndices, qMatrix);
+      const Picture yuvTransform = inverse_quantise_transform_np(quantisedSlices, qIndices, qMatrix, waveletDepthHo);
 
       // Inverse wavelet transform
       if (verbose) clog << "Inverse transform" << endl;
-      picture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picture.format());
+      picture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picture.format(), waveletDepthHo);
 
       if (verbose) clog << "Clip decoded picture" << endl;
       {
@@ -419,6 +1112,7 @@ try { //Giant try block around all code to get error messages
         const int uvMax = utils::pow(2, chromaDepth-1)-1;
         picture = (clip(picture, yMin, yMax, uvMin, uvMax));
       }
+      if (liveMetrics) metrics::lap(encoderMetrics.decode, stageStart);
 
       // Assign either a field or the whole frame to outFrame
       if (interlaced) {
@@ -431,19 +1125,9 @@ try { //Giant try block around all code to get error messages
     } // end picture loop
 
     // Calculate mean and standard deviation of quantiser index
-    float mean, meanSquare, stdDev;
+    float mean, stdDev;
     if (output!=TRANSFORM) { // No quant stats if output is TRANSFORM
-      int topIndex = -1;
-      for (int i=0; i<128; ++i) if (stats[i]>0) topIndex=i;
-      mean = 0.0;
-      meanSquare = 0.0;
-      for (int z=0; z<=topIndex; ++z) {
-        mean += (z*stats[z]);
-        meanSquare += (z*z*stats[z]);
-      }
-      mean /= totalSlices;
-      meanSquare /= totalSlices;
-      stdDev = sqrt(meanSquare - (mean*mean));
+      quantiserStats(stats, totalSlices, mean, stdDev);
       if (verbose) {
         clog << endl;
         clog << std::fixed << std::setprecision(2);
@@ -453,7 +1137,16 @@ try { //Giant try block around all code to get error messages
 
     // Calculate PSNR of decoded frame
     float YPSNR, UPSNR, VPSNR;
-    if ((output==DECODED) || (output==PSNR)) {
+    if (estimatePSNR) {
+      YPSNR = psnr(yMSE, lumaDepth);
+      UPSNR = psnr(uMSE, chromaDepth);
+      VPSNR = psnr(vMSE, chromaDepth);
+      if (verbose || (output!=PSNR)) { // Logged for each coded frame
+        clog << std::fixed << std::setprecision(4);
+        clog << "Frame " << frame << ": Estimated PSNR for Y/R, U/G, V/B = " << YPSNR << ", " << UPSNR << ", " << VPSNR  << endl;
+      }
+    }
+    else if ((output==DECODED) || (output==PSNR)) {
       // Calculate difference and difference square picture, and sum of squares
       // Y or R component
       std::transform(inFrame.y().data(), inFrame.y().data()+inFrame.y().num_elements(),
@@ -519,9 +1212,30 @@ try { //Giant try block around all code to get error messages
         outStream << YPSNR << " " << UPSNR << " " << VPSNR  << endl;
     }
 
+    if (liveMetrics) {
+      encoderMetrics.frames.add();
+      if (output!=TRANSFORM) {
+        encoderMetrics.qIndexMean.set(mean);
+        encoderMetrics.qIndexStdDev.set(stdDev);
+      }
+      if ((framePeriod>0.0) && (timing::now()-frameStart>framePeriod)) encoderMetrics.lateFrames.add();
+    }
+
     ++frame;
   } //End frame loop
 
+  graph.wait(); // Finish encoding (reporting any errors)
+  if (liveMetrics) encoderMetrics.framesInFlight.set(0);
+
+  if (verbose && numaPlacement) {
+    const numa::PageCount pages = pageStats.count();
+    const long total = pages.local+pages.remote;
+    clog << "NUMA nodes used = " << graph.groups() << endl;
+    clog << "Remote page ratio for transformed buffers = "
+         << std::fixed << std::setprecision(4)
+         << (total ? double(pages.remote)/total : 0.0) << endl;
+  }
+
   if (output==STREAM) {
     outStream << dataunitio::end_sequence;
   }
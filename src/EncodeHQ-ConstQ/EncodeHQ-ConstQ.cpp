@@ -19,6 +19,7 @@ This program compresses an image sequence using SMPTE VC-2 HQ profile.\n\
 It implements coding using a constant quantisation index.\n\
 The bit rate is variable depending on picture content.\n\
 A quantisation index of zero gives mathematically lossless coding.\n\
+With index zero, --verify decodes each coded picture and checks it matches the input exactly.\n\
 The primary output is the compressed bytes. However it may produce alternative outputs which are:\n\
   1 the wavelet transform of the input\n\
   2 the quantised wavelet coefficients\n\
@@ -27,7 +28,18 @@ The primary output is the compressed bytes. However it may produce alternative o
   5 VC2 bitstream (default output)\n\
   6 the decoded sequence\n\
   7 the PSNR for each frame\n\
+  8 a report of the ranges of the coefficients (see below)\n\
 Input and output (where appropriate) are in planar format (4:4:4, 4:2:2, 4:2:0 or RGB).\n\
+Input may also be Y4M, or a numbered sequence of RGB DPX files (named by its first file).\n\
+RGB input may be coded as YCbCr, and chroma subsampled before coding, with --codeAs.\n\
+With --estimatePSNR the PSNR is estimated from the quantisation error, without decoding.\n\
+Ranges output reports, for each component, the ranges of values after each lifting\n\
+step of each level of the forward transform, and of the inverse transform of the\n\
+quantised coefficients, and of the coefficients of each subband. These are shown\n\
+beside their worst case bounds for any input of the same bit depth, as derived from\n\
+the filter taps. It reports whether they fit 16 bit storage (samples and coefficients)\n\
+and 16 bit lanes (also the filtered values), and tabulates which kernels and depths\n\
+are guaranteed to fit 16 bits for the bit depth of the input.\n\
 There can be 1 to 4 bytes per sample and the data is left (MSB) justified.\n\
 Data is assumed offset binary (which is fine for both YCbCr or RGB).\n\
 \n\
@@ -42,6 +54,8 @@ const char* details[] = {version, summary, description};
 #include <cstdio> // for perror
 #include <iomanip> // For reporting stats only
 
+#include <boost/scoped_ptr.hpp>
+
 #include "EncodeParams.h"
 #include "Arrays.h"
 #include "Picture.h"
@@ -51,6 +65,8 @@ const char* details[] = {version, summary, description};
 #include "Slices.h"
 #include "Utils.h"
 #include "DataUnit.h"
+#include "Colour.h"
+#include "Ranges.h"
 
 using std::cout;
 using std::cin;
@@ -76,6 +92,79 @@ const Array2D quantIndicesFixedQ(const Picture& coefficients,
   return indices;
 }
 
+// Decode quantised slices, as a decoder would after entropy decoding, and
+// check the result is identical to the original picture (i.e. the coding
+// was lossless). Entropy coding is exactly reversible so is not repeated.
+const bool decodesLosslessly(const PictureArray& slices,
+                             const Array2D& qIndices,
+                             const Array1D& qMatrix,
+                             const WaveletKernel kernel,
+                             const int waveletDepth,
+                             const int waveletDepthHo,
+                             const Picture& original) {
+  const Picture yuvTransform = inverse_quantise_transform_np(merge_blocks(slices), qIndices, qMatrix, waveletDepthHo);
+  const Picture decoded = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, original.format(), waveletDepthHo);
+  return ((decoded.y()==original.y()) &&
+          (decoded.c1()==original.c1()) &&
+          (decoded.c2()==original.c2()));
+}
+
+// Forward transform of each component, adding the ranges of its values to
+// those of the component (for Ranges output)
+const Picture profileTransform(const Picture& picture,
+                               const WaveletKernel kernel,
+                               const int waveletDepth,
+                               const int waveletDepthHo,
+                               std::vector<TransformRanges>& ranges) {
+  const Array2D y = profileWaveletTransform(picture.y(), kernel, waveletDepth, waveletDepthHo, ranges[0]);
+  const Array2D c1 = profileWaveletTransform(picture.c1(), kernel, waveletDepth, waveletDepthHo, ranges[1]);
+  const Array2D c2 = profileWaveletTransform(picture.c2(), kernel, waveletDepth, waveletDepthHo, ranges[2]);
+  const PictureFormat format(y.shape()[0], y.shape()[1], c1.shape()[0], c1.shape()[1],
+                             picture.format().chromaFormat());
+  return Picture(format, y, c1, c2);
+}
+
+// Inverse quantise and transform each component, as a decoder would, adding
+// the ranges of the quantised coefficients and of the inverse transform
+void profileDecode(const Picture& quantised,
+                   const Array2D& qIndices,
+                   const Array1D& qMatrix,
+                   const WaveletKernel kernel,
+                   const int waveletDepth,
+                   const int waveletDepthHo,
+                   const PictureFormat& format,
+                   std::vector<TransformRanges>& ranges) {
+  ranges[0].addQuantised(quantised.y());
+  ranges[1].addQuantised(quantised.c1());
+  ranges[2].addQuantised(quantised.c2());
+  const Picture transform = inverse_quantise_transform_np(quantised, qIndices, qMatrix, waveletDepthHo);
+  profileInverseWaveletTransform(transform.y(), kernel, waveletDepth, format.lumaShape(), waveletDepthHo, ranges[0]);
+  profileInverseWaveletTransform(transform.c1(), kernel, waveletDepth, format.chromaShape(), waveletDepthHo, ranges[1]);
+  profileInverseWaveletTransform(transform.c2(), kernel, waveletDepth, format.chromaShape(), waveletDepthHo, ranges[2]);
+}
+
+// Which kernels and depths are guaranteed to fit 16 bits, for any input of
+// the given bit depth (as a table of kernels by depth)
+void reportInt16Table(ostream& os, const int bitDepth, const int waveletDepthHo) {
+  const WaveletKernel kernels[] = {DD97, LeGall, DD137, Haar0, Haar1, Fidelity, Daub97};
+  const char* const names[] = {"DD97", "LeGall", "DD137", "Haar0", "Haar1", "Fidelity", "Daub97"};
+  const int maxDepth = 6;
+  os << "Worst case fit for " << bitDepth << " bit samples";
+  if (waveletDepthHo>0) os << " with " << waveletDepthHo << " horizontal only levels";
+  os << " (L: int16 lanes, S: int16 storage only, -: neither)" << endl;
+  os << "  " << std::left << std::setw(10) << "Depth" << std::right;
+  for (int depth=1; depth<=maxDepth; ++depth) os << " " << depth;
+  os << endl;
+  for (int k=0; k<7; ++k) {
+    os << "  " << std::left << std::setw(10) << names[k] << std::right;
+    for (int depth=1; depth<=maxDepth; ++depth) {
+      const TransformRanges bounds = transformBounds(kernels[k], depth, waveletDepthHo, bitDepth);
+      os << " " << (int16Lanes(bounds) ? "L" : (int16Storage(bounds) ? "S" : "-"));
+    }
+    os << endl;
+  }
+}
+
 int main(int argc, char * argv[]) {
   
 try { //Giant try block around all code to get error messages
@@ -91,22 +180,6 @@ try { //Giant try block around all code to get error messages
   const string inFileName = params.inFileName;
   const string outFileName = params.outFileName;
   const bool verbose = params.verbose;
-  const int height = params.height;
-  const int width = params.width;
-  const ColourFormat chromaFormat = params.chromaFormat;
-  const int bytes = params.bytes;
-  const int lumaDepth = params.lumaDepth;
-  const int chromaDepth = params.chromaDepth;
-  const bool interlaced = params.interlaced;
-  const bool topFieldFirst = params.topFieldFirst;
-  const WaveletKernel kernel = params.kernel;
-  const int waveletDepth = params.waveletDepth;
-  const int ySize = params.ySize;
-  const int xSize = params.xSize;
-  const int qIndex = params.qIndex;
-  const Output output = params.output;
-  const FrameRate frame_rate = params.frame_rate;
-  const int sliceScalar = params.slice_scalar;
 
   if (verbose) {
     clog << endl;
@@ -142,11 +215,56 @@ try { //Giant try block around all code to get error messages
   }
   istream inStream(pInBuffer);
 
+  // Read the picture format from the header of Y4M input
+  if (params.y4mInput) {
+    Y4MHeader header;
+    inStream >> header;
+    if (!inStream) {
+      cerr << "Failed to read Y4M header from input file \"" << inFileName << "\"" << endl;
+      return EXIT_FAILURE;
+    }
+    setY4MFormat(params, header);
+  }
+
+  // DPX input is a sequence of files, read ahead on threads of their own
+  boost::scoped_ptr<dpx::SequenceReader> dpxReader;
+  if (params.dpxInput) {
+    dpxReader.reset(new dpx::SequenceReader(inFileName, params.readThreads));
+    setDPXFormat(params, dpxReader->header());
+  }
+
+  // Create convenient aliases for the picture format and coding parameters
+  const int height = params.height;
+  const int width = params.width;
+  const ColourFormat chromaFormat = params.chromaFormat;
+  const ColourFormat inputFormat = params.inputFormat;
+  const bool convertInput = (inputFormat!=chromaFormat);
+  const ColourMatrix matrix = params.matrix;
+  const int bytes = params.bytes;
+  const int lumaDepth = params.lumaDepth;
+  const int chromaDepth = params.chromaDepth;
+  const bool interlaced = params.interlaced;
+  const bool topFieldFirst = params.topFieldFirst;
+  const WaveletKernel kernel = params.kernel;
+  const int waveletDepth = params.waveletDepth;
+  const int waveletDepthHo = params.waveletDepthHo;
+  const int ySize = params.ySize;
+  const int xSize = params.xSize;
+  const int qIndex = params.qIndex;
+  const Output output = params.output;
+  const FrameRate frame_rate = params.frame_rate;
+  const int sliceScalar = params.slice_scalar;
+  const bool verify = params.verify;
+  const bool estimatePSNR = params.estimatePSNR;
+  const bool y4mInput = params.y4mInput;
+  const bool y4mOutput = params.y4mOutput;
+
   // Configure input stream to read the required picture format
   inStream >> pictureio::wordWidth(bytes); // Set number of bytes per value in file
   inStream >> pictureio::left_justified;
   inStream >> pictureio::offset_binary;
   inStream >> pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
+  if (y4mInput) inStream >> pictureio::y4m; // FRAME markers and Y4M sample format
 
   // Open output file or use standard output.
   // Output stream is write only binary mode
@@ -171,6 +289,14 @@ try { //Giant try block around all code to get error messages
   }
   ostream outStream(pOutBuffer);
 
+  // Decoded Y4M output starts with a header
+  if (y4mOutput) {
+    const utils::Rational fps = frames_per_second(frame_rate);
+    outStream << Y4MHeader(PictureFormat(height, width, chromaFormat), lumaDepth,
+                           interlaced, topFieldFirst, fps.numerator, fps.denominator);
+    outStream << pictureio::y4m;
+  }
+
   PictureFormat format(height, width, chromaFormat);
 
   if (verbose) {
@@ -180,22 +306,27 @@ try { //Giant try block around all code to get error messages
     clog << "height = " << format.lumaHeight() << endl;
     clog << "width = " << format.lumaWidth() << endl;
     clog << "chroma format = " << format.chromaFormat() << endl;
+    if (convertInput) clog << "input chroma format = " << inputFormat << endl;
+    if (convertInput && (inputFormat==RGB)) clog << "colour matrix = " << matrix << endl;
     clog << "interlaced = " << std::boolalpha << interlaced << endl;
     if (interlaced) clog << "top field first = " << std::boolalpha << topFieldFirst << endl;
     clog << "wavelet kernel = " << kernel << endl;
     clog << "wavelet depth = " << waveletDepth << endl;
+    clog << "horizontal only wavelet depth = " << waveletDepthHo << endl;
     clog << "vertical slice size (in units of 2**(wavelet depth)) = " << ySize << endl;
-    clog << "horizontal slice size (in units of 2**(wavelet depth)) = " << xSize << endl;
+    clog << "horizontal slice size (in units of 2**(wavelet depth+horizontal only depth)) = " << xSize << endl;
     clog << "quantisation index = " << qIndex << endl;
+    if (verify) clog << "verify lossless coding = true" << endl;
+    if (estimatePSNR) clog << "estimate PSNR = true" << endl;
     clog << "output = " << output << endl;
   }
 
   // Calculate number of slices per picture
   const int yTransformSize = ySize*utils::pow(2,waveletDepth);
-  const int xTransformSize = xSize*utils::pow(2,waveletDepth);
+  const int xTransformSize = xSize*utils::pow(2,waveletDepth+waveletDepthHo);
   const int pictureHeight = ( (interlaced) ? height/2 : height);
   const int paddedPictureHeight = paddedSize(pictureHeight, waveletDepth);
-  const int paddedWidth = paddedSize(width, waveletDepth);
+  const int paddedWidth = paddedSize(width, waveletDepth+waveletDepthHo);
   const int ySlices = paddedPictureHeight/yTransformSize;
   const int xSlices = paddedWidth/xTransformSize;
   if (paddedPictureHeight != (ySlices*yTransformSize) ) {
@@ -213,7 +344,12 @@ try { //Giant try block around all code to get error messages
   }
 
   // Calculate the quantisation matrix
-  const Array1D qMatrix = quantMatrix(kernel, waveletDepth);
+  const Array1D qMatrix = quantMatrix(kernel, waveletDepth, waveletDepthHo);
+  // Synthesis gains of the subbands, to estimate the PSNR from the quantisation error
+  const std::vector<float> gains = subband_gains(kernel, waveletDepth, waveletDepthHo);
+
+  // Asymmetric transforms always signal their quantisation matrix
+  const Array1D customQMatrix = (waveletDepthHo>0 ? qMatrix : Array1D());
   if (verbose) {
     clog << "Quantisation matrix = " << qMatrix[0];
     for (unsigned int i=1; i<qMatrix.size(); ++i) {
@@ -226,22 +362,39 @@ try { //Giant try block around all code to get error messages
 
   //Create input & output frames
   Frame inFrame(format, interlaced, topFieldFirst);
+  // Input converted before coding (--codeAs) is read into its own frame first
+  Frame sourceFrame(PictureFormat(height, width, inputFormat), interlaced, topFieldFirst);
   Frame outFrame(format, interlaced, topFieldFirst); //used for decoded picture only
   Array2D yDiff(format.lumaShape()); // used for PSNR calculation only
   Array2D uDiff(format.chromaShape()); // used for PSNR calculation only
   Array2D vDiff(format.chromaShape()); // used for PSNR calculation only
 
+  // Ranges of the values in the coding of each component (for Ranges output)
+  std::vector<TransformRanges> ranges(3, TransformRanges(waveletDepth, waveletDepthHo));
+
   int frame = 0;
   if (output==STREAM) {
     if (verbose) clog << endl << "Writing Sequence Header" << endl << endl;
     outStream << dataunitio::start_sequence;
-    outStream << SequenceHeader(PROFILE_HQ, format.lumaHeight(), format.lumaWidth(), format.chromaFormat(), interlaced, frame_rate, topFieldFirst, lumaDepth);
+    SequenceHeader sequence(PROFILE_HQ, format.lumaHeight(), format.lumaWidth(), format.chromaFormat(), interlaced, frame_rate, topFieldFirst, lumaDepth);
+    if (waveletDepthHo>0) sequence.major_version = 3; // Asymmetric transforms need version 3
+    outStream << sequence;
   }
   while (true) {
 
     // Read input from planar file
     if (verbose) clog << "Reading input frame number " << frame;
-    inStream >> inFrame; // Read the input frame
+    if (dpxReader) { // Read the next file of the sequence
+      Picture picture;
+      if (dpxReader->next(picture))
+        inFrame.frame(convertInput ? convert_for_coding(picture, chromaFormat, matrix, lumaDepth, interlaced) : picture);
+      else inStream.setstate(ios_base::failbit);
+    }
+    else if (convertInput) { // Read the input frame and convert its colour format
+      if (inStream >> sourceFrame)
+        inFrame.frame(convert_for_coding(sourceFrame, chromaFormat, matrix, lumaDepth, interlaced));
+    }
+    else inStream >> inFrame; // Read the input frame
     // Check frame was read OK
     if (!inStream) {
       if (frame==0) {
@@ -257,6 +410,9 @@ try { //Giant try block around all code to get error messages
 
 //    int stats[128] = {0}; //Define and initialise array to hold quantiser stats
 
+    // Mean square errors of the frame estimated from the quantisation error (--estimatePSNR)
+    double yMSE = 0.0, uMSE = 0.0, vMSE = 0.0;
+
     Picture picture; // define a picture, either a field or frame
     for (int pic=0 ; pic<framePics; ++pic) { // loop over fields if interlaced input
 
@@ -269,7 +425,9 @@ try { //Giant try block around all code to get error messages
 
       //Forward wavelet transform
       if (verbose) clog << "Forward transform" << endl;
-      Picture transform = waveletTransform(picture, kernel, waveletDepth);
+      Picture transform = (output==RANGES ?
+        profileTransform(picture, kernel, waveletDepth, waveletDepthHo, ranges) :
+        waveletTransform(picture, kernel, waveletDepth, waveletDepthHo));
 
       if (output==TRANSFORM) {
         //Write transform output as 4 byte 2's comp values
@@ -287,7 +445,13 @@ try { //Giant try block around all code to get error messages
       Array2D qIndices = quantIndicesFixedQ(transform, ySlices, xSlices, qMatrix, qIndex);
 
       if (verbose) clog << "Quantise transform coefficients" << endl;
-      const Picture quantisedSlices = quantise_transform_np(transform, qIndices, qMatrix);
+      const Picture quantisedSlices = quantise_transform_np(transform, qIndices, qMatrix, waveletDepthHo);
+
+      if (estimatePSNR) { // Fields each contribute half the error of a frame
+        yMSE += quantisation_error_np(transform.y(), quantisedSlices.y(), qIndices, qMatrix, gains, waveletDepthHo)/framePics;
+        uMSE += quantisation_error_np(transform.c1(), quantisedSlices.c1(), qIndices, qMatrix, gains, waveletDepthHo)/framePics;
+        vMSE += quantisation_error_np(transform.c2(), quantisedSlices.c2(), qIndices, qMatrix, gains, waveletDepthHo)/framePics;
+      }
       
       if (output==QUANTISED) {
         //Write quantised transform output as 4 byte 2's comp values
@@ -301,13 +465,27 @@ try { //Giant try block around all code to get error messages
         continue; // omit rest of processing for this picture
       }
 
+      if (output==RANGES) {
+        if (verbose) clog << "Profile inverse quantisation and transform" << endl;
+        profileDecode(quantisedSlices, qIndices, qMatrix, kernel, waveletDepth, waveletDepthHo, picture.format(), ranges);
+        continue; // The report is written at the end
+      }
+
       // Split transform into slices
       if (verbose) clog << "Split quantised coefficients into slices" << endl;
       const PictureArray slices = split_into_blocks(quantisedSlices, ySlices, xSlices);
 
+      if (verify) {
+        if (verbose) clog << "Verify lossless coding" << endl;
+        if (!decodesLosslessly(slices, qIndices, qMatrix, kernel, waveletDepth, waveletDepthHo, picture)) {
+          cerr << "Verification failed: picture " << (framePics*frame+pic) << " does not decode to the input" << endl;
+          return EXIT_FAILURE;
+        }
+      }
+
       if (output==PACKAGED) { // Output compressed bytes only (not the complete VC-2 stream)
         // Package up data for output
-        const Slices outSlices(slices, waveletDepth, qIndices);
+        const Slices outSlices(slices, waveletDepth, qIndices, waveletDepthHo);
 
         //Write packaged output
         if (verbose) clog << "Writing compressed output to file" << endl;
@@ -322,9 +500,8 @@ try { //Giant try block around all code to get error messages
 
       if (output==STREAM) { // Output the complete VC-2 stream
         const int slicePrefix = 0;
-        const int sliceScalar = 1;
         // Package up data for output
-        const Slices outSlices(slices, waveletDepth, qIndices);
+        const Slices outSlices(slices, waveletDepth, qIndices, waveletDepthHo);
 
         const WrappedPicture outWrapped(pic,
                                         kernel,
@@ -333,7 +510,9 @@ try { //Giant try block around all code to get error messages
                                         ySlices,
                                         slicePrefix,
                                         sliceScalar,
-                                        outSlices);
+                                        outSlices,
+                                        waveletDepthHo,
+                                        customQMatrix);
 
         //Write packaged output
         if (verbose) clog << "Writing compressed output to file" << endl;
@@ -345,14 +524,16 @@ try { //Giant try block around all code to get error messages
         }
         continue; // omit rest of processing for this picture
       }
+
+      if (estimatePSNR) continue; // The PSNR is estimated without decoding the picture
     
       // Inverse quantise in transform order
       if (verbose) clog << "Inverse quantise" << endl;
-      const Picture yuvTransform = inverse_quantise_transform_np(quantisedSlices, qIndices, qMatrix);
+      const Picture yuvTransform = inverse_quantise_transform_np(quantisedSlices, qIndices, qMatrix, waveletDepthHo);
 
       // Inverse wavelet transform
       if (verbose) clog << "Inverse transform" << endl;
-      picture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picture.format());
+      picture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picture.format(), waveletDepthHo);
 
       if (verbose) clog << "Clip decoded picture" << endl;
       {
@@ -375,7 +556,16 @@ try { //Giant try block around all code to get error messages
 
     // Calculate PSNR of decoded frame
     float YPSNR, UPSNR, VPSNR;
-    if ((output==DECODED) || (output==PSNR)) {
+    if (estimatePSNR) {
+      YPSNR = -20*log10(sqrt(yMSE)/utils::pow(2, lumaDepth));
+      UPSNR = -20*log10(sqrt(uMSE)/utils::pow(2, chromaDepth));
+      VPSNR = -20*log10(sqrt(vMSE)/utils::pow(2, chromaDepth));
+      if (verbose || (output!=PSNR)) { // Logged for each coded frame
+        clog << std::fixed << std::setprecision(4);
+        clog << "Frame " << frame << ": Estimated PSNR for Y/R, U/G, V/B = " << YPSNR << ", " << UPSNR << ", " << VPSNR  << endl;
+      }
+    }
+    else if ((output==DECODED) || (output==PSNR)) {
       // Calculate difference and difference square picture, and sum of squares
       // Y or R component
       std::transform(inFrame.y().data(), inFrame.y().data()+inFrame.y().num_elements(),
@@ -440,6 +630,26 @@ try { //Giant try block around all code to get error messages
     outStream << dataunitio::end_sequence;
   }
 
+  if (output==RANGES) {
+    const char* const components[] = {"Y/G", "C1/B", "C2/R"};
+    outStream << "Ranges of " << frame << " frames coded with the " << kernel
+              << " kernel, depth " << waveletDepth;
+    if (waveletDepthHo>0) outStream << " (and " << waveletDepthHo << " horizontal only)";
+    outStream << ", quantisation index " << qIndex << endl;
+    for (int c=0; c<3; ++c) {
+      const int bitDepth = (c==0 ? lumaDepth : chromaDepth);
+      outStream << components[c] << " component (" << bitDepth << " bits)" << endl;
+      const TransformRanges bounds = transformBounds(kernel, waveletDepth, waveletDepthHo, bitDepth);
+      reportRanges(outStream, ranges[c], &bounds);
+    }
+    reportInt16Table(outStream, lumaDepth, waveletDepthHo);
+    if (chromaDepth!=lumaDepth) reportInt16Table(outStream, chromaDepth, waveletDepthHo);
+    if (!outStream) {
+      cerr << "Failed to write output file \"" << outFileName << "\"" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   if (inFileName!="-") inFileBuffer.close();
   if (outFileName!="-") outFileBuffer.close();
 } // end of try block
@@ -44,6 +44,11 @@ namespace TCLAP {
   struct ArgTraits<Output> { // Let TCLAP parse Output objects
     typedef ValueLike ValueCategory;
   };
+
+  template <>
+  struct ArgTraits<ColourMatrix> { // Let TCLAP parse ColourMatrix objects
+    typedef ValueLike ValueCategory;
+  };
 }
 
 ProgramParams getCommandLineParams(int argc, char * argv[], const char * details[]) {
@@ -71,11 +76,12 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char * details
     UnlabeledValueArg<string> outFile("outFile", "Output file name (use \"-\" for standard output)", true, "-", "string", cmd);
     SwitchArg verbosity("v", "verbose", "Output extra information to standard log", cmd);
     // "cla" prefix == command line argument
-    ValueArg<Output> cla_output("o", "output", "Program output (Transform, Quantised, Indices, Packaged, Stream, Decoded, PSNR)", false, STREAM, "string", cmd);
+    ValueArg<Output> cla_output("o", "output", "Program output (Transform, Quantised, Indices, Packaged, Stream, Decoded, PSNR, Ranges)", false, STREAM, "string", cmd);
     ValueArg<int> cla_quantIndex("q", "quantIndex", "Quantiser index (0 to 63)", true, 0, "integer", cmd);
-    ValueArg<int> cla_hSliceSize("a", "hSlice", "Horizontical slice size (in units of 2**(wavelet depth))", true, 0, "integer", cmd);
+    ValueArg<int> cla_hSliceSize("a", "hSlice", "Horizontical slice size (in units of 2**(wavelet depth + horizontal only depth))", true, 0, "integer", cmd);
     ValueArg<int> cla_vSliceSize("u", "vSlice", "Vertical slice size (in units of 2**(wavelet depth))", true, 0, "integer", cmd);
     ValueArg<int> cla_waveletDepth("d", "waveletDepth", "Wavelet transform depth", true, 0, "integer", cmd);
+    ValueArg<int> cla_waveletDepthHo("D", "waveletDepthHo", "Additional horizontal only wavelet transform depth (default 0)", false, 0, "integer", cmd);
     ValueArg<WaveletKernel> cla_kernel("k", "kernel", "Wavelet kernel (DD97, LeGall, DD137, Haar0, Haar1, Fidelity, Daub97)", true, NullKernel, "string", cmd);
     SwitchArg cla_bottomFieldFirst("b", "bottomFieldFirst", "Bottom field is earliest (defaults to top field first))", cmd, false);
     SwitchArg cla_topFieldFirst("t", "topFieldFirst", "Top field is earliest (defaults to top field first))", cmd, true);
@@ -85,11 +91,17 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char * details
     ValueArg<int> cla_lumaDepth("l", "lumaDepth", "Bit depth for luma (defaults to bits per input sample), for RGB use -z", false, 0, "integer", cmd);
     ValueArg<int> cla_bitDepth("z", "bitDepth", "Common bit depth for all components (defaults to bits per input sample)", false, 0, "integer", cmd);
     ValueArg<int> cla_bytes("n", "bytes", "Number of bytes per sample in image file (default 2)", false, 2, "integer", cmd);
-    ValueArg<ColourFormat> cla_format("f", "format", "Colour format (4:4:4, 4:2:2, 4:2:0 or RGB)", true, UNKNOWN, "string", cmd);
-    ValueArg<int> cla_width("x", "width", "Picture width", true, 0, "integer", cmd);
-    ValueArg<int> cla_height("y", "height", "Picture height", true, 0, "integer", cmd);
+    ValueArg<ColourFormat> cla_format("f", "format", "Colour format (4:4:4, 4:2:2, 4:2:0 or RGB)", false, UNKNOWN, "string", cmd);
+    ValueArg<int> cla_width("x", "width", "Picture width", false, 0, "integer", cmd);
+    ValueArg<int> cla_height("y", "height", "Picture height", false, 0, "integer", cmd);
     ValueArg<int> cla_framerate("r", "framerate", "Frame Rate ( 1 = 24/1.001, 2 = 24, 3 = 25, 4 = 30/1.001, 5 = 30, 6 = 50, 7 = 60/1.001, 8 = 60, 9 = 15/1.001, 10 = 25/2, 11 = 48 (default 3)", false, 3, "integer", cmd);
+    SwitchArg cla_y4m("Y", "y4m", "Input (and Decoded output) pictures are Y4M, with the picture format in the input header (the default for .y4m file names)", cmd, false);
+    ValueArg<int> cla_readThreads("", "readThreads", "Threads reading and unpacking DPX input ahead of the encoder (default 4, 0 means one per hardware thread)", false, 4, "integer", cmd);
+    ValueArg<ColourFormat> cla_codeAs("", "codeAs", "Colour format to code (4:4:4, 4:2:2 or 4:2:0), converted from RGB input or subsampled from input with more chroma (defaults to the input format)", false, UNKNOWN, "string", cmd);
+    ValueArg<ColourMatrix> cla_matrix("", "matrix", "Colour matrix for coding RGB input as YCbCr (709 or 2020, default 709)", false, MATRIX_UNKNOWN, "string", cmd);
     ValueArg<int> cla_sliceScalar("S", "scalar", "Slice size Scalar (default 1)", false, 1, "integer", cmd);
+    SwitchArg cla_verify("e", "verify", "Decode each compressed picture and check it is identical to the input (requires quantisation index 0)", cmd, false);
+    SwitchArg cla_estimatePSNR("", "estimatePSNR", "Estimate the PSNR of each frame from its quantisation error, without decoding it (output with -o PSNR, otherwise logged)", cmd, false);
 
     // Parse the argv array
     cmd.parse(argc, argv);
@@ -109,12 +121,21 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char * details
     bool topFieldFirst = !cla_bottomFieldFirst.isSet();
     const WaveletKernel kernel = cla_kernel.getValue();
     const int waveletDepth = cla_waveletDepth.getValue();
+    const int waveletDepthHo = cla_waveletDepthHo.getValue();
     const int ySize = cla_vSliceSize.getValue();
     const int xSize = cla_hSliceSize.getValue();
     const int qIndex = cla_quantIndex.getValue();
     const Output output = cla_output.getValue();
+    const bool y4mInput = cla_y4m.isSet() || pictureio::isY4MFileName(inFileName);
+    const bool y4mOutput = (output==DECODED) && (cla_y4m.isSet() || pictureio::isY4MFileName(outFileName));
+    const bool dpxInput = dpx::isDPXFileName(inFileName);
+    const int readThreads = cla_readThreads.getValue();
+    const ColourFormat codeAs = cla_codeAs.getValue();
+    const ColourMatrix matrix = cla_matrix.getValue();
     const int frame_rate = cla_framerate.getValue();
     const int sliceScalar = cla_sliceScalar.getValue();
+    const bool verify = cla_verify.getValue();
+    const bool estimatePSNR = cla_estimatePSNR.getValue();
 
     // Check for valid combinations of parameters and options
     if ((chromaFormat==RGB) && (cla_lumaDepth.isSet() || cla_chromaDepth.isSet()))
@@ -128,37 +149,75 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char * details
     if (cla_topFieldFirst.isSet() && cla_bottomFieldFirst.isSet())
       throw invalid_argument("image can't be both top field first and bottom field first: specify one or the other");
 
+    if (y4mInput && (cla_height.isSet() || cla_width.isSet() || cla_format.isSet() || cla_bytes.isSet() ||
+                     cla_bitDepth.isSet() || cla_lumaDepth.isSet() || cla_chromaDepth.isSet() ||
+                     cla_interlace.isSet() || cla_progressive.isSet() ||
+                     cla_topFieldFirst.isSet() || cla_bottomFieldFirst.isSet()))
+      throw invalid_argument("the picture format of Y4M input is read from its header, so can't be set on the command line");
+    if (dpxInput && (cla_height.isSet() || cla_width.isSet() || cla_format.isSet() || cla_bytes.isSet() ||
+                     cla_bitDepth.isSet() || cla_lumaDepth.isSet() || cla_chromaDepth.isSet()))
+      throw invalid_argument("the picture format of DPX input is read from its first file, so can't be set on the command line");
+    if (dpxInput && y4mInput)
+      throw invalid_argument("input can't be both DPX and Y4M");
+    if (dpxInput && y4mOutput && !cla_codeAs.isSet())
+      throw invalid_argument("Y4M output can't represent RGB (DPX input)");
+    if (cla_readThreads.isSet() && !dpxInput)
+      throw invalid_argument("read threads are only used for DPX input");
+    if (!y4mInput && !dpxInput && !(cla_height.isSet() && cla_width.isSet() && cla_format.isSet()))
+      throw invalid_argument("picture height, width and colour format are required (unless input is Y4M or DPX)");
+    if (y4mOutput && !y4mInput && (chromaFormat==RGB) && !cla_codeAs.isSet())
+      throw invalid_argument("Y4M output can't represent RGB");
+    if (codeAs==RGB)
+      throw invalid_argument("input can only be converted to YCbCr (4:4:4, 4:2:2 or 4:2:0) for coding");
+    if (cla_matrix.isSet() && !cla_codeAs.isSet())
+      throw invalid_argument("a colour matrix is only used when converting RGB input (with --codeAs)");
+    if (y4mOutput && !y4mInput && (cla_lumaDepth.isSet() || cla_chromaDepth.isSet()) &&
+        (cla_lumaDepth.getValue()!=cla_chromaDepth.getValue()))
+      throw invalid_argument("Y4M output needs the same luma and chroma bit depth");
+
     // Set default values
     if (!cla_bitDepth.isSet()) bitDepth = 8*bytes;
     if (!cla_lumaDepth.isSet()) lumaDepth = bitDepth;
     if (!cla_chromaDepth.isSet()) chromaDepth = lumaDepth;
 
     // Check parameter values
-    if (height<1) throw invalid_argument("picture height must be > 0");
-    if (width<1) throw invalid_argument("picture width must be > 0");
-    if (chromaFormat==UNKNOWN)
-      throw std::invalid_argument("unknown colour format");
-    if ( (1>bytes) || (bytes>4) )
-      throw std::invalid_argument("bytes must be in range 1 to 4");
-    if (cla_bitDepth.isSet()) {
-      if ( (1>bitDepth) || (bitDepth>(8*bytes)) )
-        throw std::invalid_argument("bit depth must be in range 1 to 8*(bytes per sample)");
-    }
-    else {
-      if ( (1>lumaDepth) || (lumaDepth>(8*bytes)) )
-        throw std::invalid_argument("luma bit depth must be in range 1 to 8*(bytes per sample)");
-      if ( (1>chromaDepth) || (chromaDepth>(8*bytes)) )
-        throw std::invalid_argument("chroma bit depth must be in range 1 to 8*(bytes per sample)");
+    if (readThreads<0)
+      throw std::invalid_argument("number of read threads must be >=0");
+    if (!y4mInput && !dpxInput) { // Y4M and DPX picture formats are checked when their headers are read
+      if (height<1) throw invalid_argument("picture height must be > 0");
+      if (width<1) throw invalid_argument("picture width must be > 0");
+      if (chromaFormat==UNKNOWN)
+        throw std::invalid_argument("unknown colour format");
+      if ( (1>bytes) || (bytes>4) )
+        throw std::invalid_argument("bytes must be in range 1 to 4");
+      if (cla_bitDepth.isSet()) {
+        if ( (1>bitDepth) || (bitDepth>(8*bytes)) )
+          throw std::invalid_argument("bit depth must be in range 1 to 8*(bytes per sample)");
+      }
+      else {
+        if ( (1>lumaDepth) || (lumaDepth>(8*bytes)) )
+          throw std::invalid_argument("luma bit depth must be in range 1 to 8*(bytes per sample)");
+        if ( (1>chromaDepth) || (chromaDepth>(8*bytes)) )
+          throw std::invalid_argument("chroma bit depth must be in range 1 to 8*(bytes per sample)");
+      }
     }
     if (kernel==NullKernel)
       throw std::invalid_argument("invalid wavelet kernel");
     if (waveletDepth<1)
       throw std::invalid_argument("wavelet depth must be 1 or more");
+    if (waveletDepthHo<0)
+      throw std::invalid_argument("horizontal only wavelet depth must be 0 or more");
     if ((qIndex<0) || (qIndex>63))
       throw std::invalid_argument("quantisation index must be in the range 0 to 119");
 
     if (sliceScalar < 1)
       throw std::invalid_argument("slice size scalar must be at least 1");
+    if (verify && (qIndex!=0))
+      throw std::invalid_argument("verify requires lossless coding (quantisation index 0)");
+    if (verify && (output!=PACKAGED) && (output!=STREAM))
+      throw std::invalid_argument("verify requires Packaged or Stream output");
+    if (estimatePSNR && ((output==TRANSFORM) || (output==DECODED) || (output==RANGES)))
+      throw std::invalid_argument("PSNR can only be estimated for Quantised, Packaged, Stream or PSNR output");
 
     params.inFileName = inFileName;
     params.outFileName = outFileName;
@@ -173,11 +232,21 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char * details
     params.topFieldFirst = topFieldFirst;
     params.kernel = kernel;
     params.waveletDepth = waveletDepth;
+    params.waveletDepthHo = waveletDepthHo;
     params.ySize = ySize;
     params.xSize = xSize;
     params.qIndex = qIndex;
     params.output = output;
+    params.y4mInput = y4mInput;
+    params.y4mOutput = y4mOutput;
+    params.dpxInput = dpxInput;
+    params.readThreads = readThreads;
+    params.codeAs = codeAs;
+    params.matrix = matrix;
+    if (!y4mInput && !dpxInput) setCodedFormat(params); // Otherwise when the header is read
     params.slice_scalar = sliceScalar;
+    params.verify = verify;
+    params.estimatePSNR = estimatePSNR;
 
     switch (frame_rate) {
     case 1:
@@ -217,6 +286,7 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char * details
       params.frame_rate = FR0;
       break;
     }
+    if (y4mInput && !cla_framerate.isSet()) params.frame_rate = FR0; // Use the Y4M header
   }
 
   // catch any TCLAP exceptions
@@ -232,6 +302,48 @@ ProgramParams getCommandLineParams(int argc, char * argv[], const char * details
   return params;
 }
 
+void setY4MFormat(ProgramParams& params, const Y4MHeader& header) {
+  params.height = header.height;
+  params.width = header.width;
+  params.chromaFormat = header.chromaFormat;
+  params.bytes = (header.bitDepth>8) ? 2 : 1;
+  params.lumaDepth = header.bitDepth;
+  params.chromaDepth = header.bitDepth;
+  params.interlaced = header.interlaced;
+  params.topFieldFirst = header.topFieldFirst;
+  if ((params.frame_rate==FR0) && (header.rateNumerator==0)) {
+    params.frame_rate = FR25; // No frame rate in the header, so use the default
+  }
+  else if (params.frame_rate==FR0) {
+    params.frame_rate = frame_rate(header.rateNumerator, header.rateDenominator);
+    if (params.frame_rate==FR0)
+      throw std::invalid_argument("the Y4M frame rate is not a VC-2 frame rate, so set one with -r");
+  }
+  setCodedFormat(params);
+}
+
+void setDPXFormat(ProgramParams& params, const dpx::Header& header) {
+  params.height = header.height;
+  params.width = header.width;
+  params.chromaFormat = RGB;
+  params.lumaDepth = header.bitDepth;
+  params.chromaDepth = header.bitDepth;
+  setCodedFormat(params);
+}
+
+void setCodedFormat(ProgramParams& params) {
+  params.inputFormat = params.chromaFormat;
+  if ((params.matrix!=MATRIX_UNKNOWN) && (params.inputFormat!=RGB))
+    throw std::invalid_argument("a colour matrix is only used for RGB input");
+  if ((params.codeAs==UNKNOWN) || (params.codeAs==params.inputFormat)) return;
+  if (!can_convert_for_coding(params.inputFormat, params.codeAs))
+    throw std::invalid_argument("input can only be converted from RGB, or to a colour format with less chroma, for coding");
+  if (params.lumaDepth!=params.chromaDepth)
+    throw std::invalid_argument("converting the input colour format needs the same luma and chroma bit depth");
+  if ((params.inputFormat==RGB) && (params.matrix==MATRIX_UNKNOWN)) params.matrix = BT709;
+  params.chromaFormat = params.codeAs;
+}
+
 std::ostream& operator<<(std::ostream& os, Output output) {
   const char* s;
   switch (output) {
@@ -253,6 +365,9 @@ std::ostream& operator<<(std::ostream& os, Output output) {
     case PSNR:
       s = "PSNR";
       break;
+    case RANGES:
+      s = "Ranges";
+      break;
     default:
       s = "Unknown output!";
       break;
@@ -269,6 +384,7 @@ std::istream& operator>>(std::istream& is, Output& output) {
         else if (text == "Stream") output = STREAM;
         else if (text == "Decoded") output = DECODED;
         else if (text == "PSNR") output = PSNR;
+        else if (text == "Ranges") output = RANGES;
         else is.setstate(std::ios_base::badbit|std::ios_base::failbit);
         // Alternatively
         // else throw std::invalid_argument("invalid input");
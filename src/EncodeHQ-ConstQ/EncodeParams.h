@@ -15,8 +15,10 @@
 #include "Picture.h"
 #include "WaveletTransform.h"
 #include "DataUnit.h"
+#include "DPX.h"
+#include "Colour.h"
 
-enum Output {TRANSFORM, QUANTISED, PACKAGED, STREAM, DECODED, PSNR};
+enum Output {TRANSFORM, QUANTISED, PACKAGED, STREAM, DECODED, PSNR, RANGES};
 
 std::ostream& operator<<(std::ostream&, Output value);
 
@@ -36,15 +38,36 @@ struct ProgramParams {
   bool topFieldFirst;
   enum WaveletKernel kernel;
   int waveletDepth;
+  int waveletDepthHo;
   int ySize;
   int xSize;
   int qIndex;
   enum Output output;
+  bool y4mInput; // Picture format is read from the input header
+  bool y4mOutput; // Decoded output is Y4M
+  bool dpxInput; // Input is a numbered sequence of DPX files
+  int readThreads; // For DPX input
+  enum ColourFormat inputFormat; // Of the input (chromaFormat is that coded)
+  enum ColourFormat codeAs; // UNKNOWN to code the input format
+  ColourMatrix matrix; // For coding R'G'B' input as Y'CbCr
   FrameRate frame_rate;
   int slice_scalar;
+  bool verify;
+  bool estimatePSNR; // From the quantisation error, without decoding
   std::string error;
 };
 
 ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]);
 
+// Set the picture format (and frame rate, unless given on the command line)
+// from the header of Y4M input
+void setY4MFormat(ProgramParams& params, const Y4MHeader& header);
+
+// Set the picture format from the header of the first file of DPX input
+void setDPXFormat(ProgramParams& params, const dpx::Header& header);
+
+// Set the coded colour format (and matrix) once the input format is known,
+// checking any conversion of the input before coding (--codeAs) is supported
+void setCodedFormat(ProgramParams& params);
+
 #endif // ENCODERPARAMS_18SEPTEMBER13
@@ -24,9 +24,17 @@ Its primary output is the VC-2 stream. However it may produce alternative output
   5 VC2 bitstream (default output)\n\
   6 the decoded sequence\n\
   7 the PSNR for each frame\n\
+  8 the simulated end to end latency of each line\n\
 Input and output (where appropriate) are in planar format (4:4:4, 4:2:2, 4:2:0 or RGB).\n\
+Input may also be Y4M, or a numbered sequence of RGB DPX files (named by its first file).\n\
+RGB input may be coded as YCbCr, and chroma subsampled before coding, with --codeAs.\n\
 There can be 1 to 4 bytes per sample and the data is left (MSB) justified.\n\
 Data is assumed offset binary (which is fine for both YCbCr or RGB).\n\
+Latency output simulates a low delay link. Input lines arrive at the line rate\n\
+of the frame rate, each row of slices is encoded once the lines it depends on\n\
+have arrived, sent over a constant bit rate channel and decoded in process.\n\
+The delay from the arrival of each input line until it is decoded is written\n\
+(in milliseconds) and its percentiles are reported to standard log.\n\
 \n\
 Example: EncodeLD -v -x 1920 -y 1080 -f 4:2:2 -l 10 -k LeGall -d 3 -u 1 -a 2 -s 829440 -i inFileName outFileName";
 const char* details[] = {version, summary, description};
@@ -41,6 +49,10 @@ const char* details[] = {version, summary, description};
 #include <algorithm>
 #include <functional>
 #include <cmath>
+#include <sstream>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
 
 #include "EncodeParams.h"
 #include "Arrays.h"
@@ -50,6 +62,8 @@ const char* details[] = {version, summary, description};
 #include "Quantisation.h"
 #include "Slices.h"
 #include "Utils.h"
+#include "Timing.h"
+#include "Colour.h"
 
 using std::cout;
 using std::cin;
@@ -66,7 +80,32 @@ using std::ostream;
 // Declare algorithm to calculate an array of quantisation indices
 const Array2D quantIndices(const Picture& coefficients,
                            const Array1D& qMatrix,
-                           const Array2D& sliceBytes);
+                           const Array2D& sliceBytes,
+                           const int waveletDepthHo);
+
+// Schedules pictures through a simulated low delay link: input lines paced
+// at the line rate, an encoder and a decoder working a row of slices at a
+// time, and a constant bit rate channel between them.
+class LoopbackLatency {
+  public:
+    LoopbackLatency(double linePeriod, // Seconds per input line
+                    double byteRate, // Channel bytes per second
+                    const std::vector<int>& inputLines, // Last input line for each row of slices
+                    const std::vector<int>& rowBytes, // Bytes in each row of slices
+                    const std::vector<int>& outputRows); // Last row of slices for each output line
+    // Schedules the next picture given the measured times to encode and to
+    // decode it. Returns the delay from the arrival of each input line until
+    // the corresponding output line is decoded.
+    const std::vector<double> picture(double encodeTime, double decodeTime);
+  private:
+    const double linePeriod;
+    const double byteRate;
+    const std::vector<int> inputLines;
+    const std::vector<int> rowBytes;
+    const std::vector<int> outputRows;
+    int pictures;
+    double encoderFree, channelFree, decoderFree;
+};
 
 int main(int argc, char * argv[]) {
   
@@ -83,21 +122,6 @@ try { //Giant try block around all code to get error messages
   const string inFileName = params.inFileName;
   const string outFileName = params.outFileName;
   const bool verbose = params.verbose;
-  const int height = params.height;
-  const int width = params.width;
-  const ColourFormat chromaFormat = params.chromaFormat;
-  const int bytes = params.bytes;
-  const int lumaDepth = params.lumaDepth;
-  const int chromaDepth = params.chromaDepth;
-  const bool interlaced = params.interlaced;
-  const bool topFieldFirst = params.topFieldFirst;
-  const WaveletKernel kernel = params.kernel;
-  const int waveletDepth = params.waveletDepth;
-  const int ySize = params.ySize;
-  const int xSize = params.xSize;
-  const int compressedBytes = params.compressedBytes;
-  const Output output = params.output;
-  const FrameRate frame_rate = params.frame_rate;
 
   if (verbose) {
     clog << endl;
@@ -133,11 +157,53 @@ try { //Giant try block around all code to get error messages
   }
   istream inStream(pInBuffer);
 
+  // Read the picture format from the header of Y4M input
+  if (params.y4mInput) {
+    Y4MHeader header;
+    inStream >> header;
+    if (!inStream) {
+      cerr << "Failed to read Y4M header from input file \"" << inFileName << "\"" << endl;
+      return EXIT_FAILURE;
+    }
+    setY4MFormat(params, header);
+  }
+
+  // DPX input is a sequence of files, read ahead on threads of their own
+  boost::scoped_ptr<dpx::SequenceReader> dpxReader;
+  if (params.dpxInput) {
+    dpxReader.reset(new dpx::SequenceReader(inFileName, params.readThreads));
+    setDPXFormat(params, dpxReader->header());
+  }
+
+  // Create convenient aliases for the picture format and coding parameters
+  const int height = params.height;
+  const int width = params.width;
+  const ColourFormat chromaFormat = params.chromaFormat;
+  const ColourFormat inputFormat = params.inputFormat;
+  const bool convertInput = (inputFormat!=chromaFormat);
+  const ColourMatrix matrix = params.matrix;
+  const int bytes = params.bytes;
+  const int lumaDepth = params.lumaDepth;
+  const int chromaDepth = params.chromaDepth;
+  const bool interlaced = params.interlaced;
+  const bool topFieldFirst = params.topFieldFirst;
+  const WaveletKernel kernel = params.kernel;
+  const int waveletDepth = params.waveletDepth;
+  const int waveletDepthHo = params.waveletDepthHo;
+  const int ySize = params.ySize;
+  const int xSize = params.xSize;
+  const int compressedBytes = params.compressedBytes;
+  const Output output = params.output;
+  const FrameRate frame_rate = params.frame_rate;
+  const bool y4mInput = params.y4mInput;
+  const bool y4mOutput = params.y4mOutput;
+
   // Configure input stream to read the required picture format
   inStream >> pictureio::wordWidth(bytes); // Set number of bytes per value in file
   inStream >> pictureio::left_justified;
   inStream >> pictureio::offset_binary;
   inStream >> pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
+  if (y4mInput) inStream >> pictureio::y4m; // FRAME markers and Y4M sample format
 
   // Open output file or use standard output.
   // Output stream is write only binary mode
@@ -162,6 +228,14 @@ try { //Giant try block around all code to get error messages
   }
   ostream outStream(pOutBuffer);
 
+  // Decoded Y4M output starts with a header
+  if (y4mOutput) {
+    const utils::Rational fps = frames_per_second(frame_rate);
+    outStream << Y4MHeader(PictureFormat(height, width, chromaFormat), lumaDepth,
+                           interlaced, topFieldFirst, fps.numerator, fps.denominator);
+    outStream << pictureio::y4m;
+  }
+
   PictureFormat format(height, width, chromaFormat);
 
   if (verbose) {
@@ -171,22 +245,25 @@ try { //Giant try block around all code to get error messages
     clog << "height = " << format.lumaHeight() << endl;
     clog << "width = " << format.lumaWidth() << endl;
     clog << "chroma format = " << format.chromaFormat() << endl;
+    if (convertInput) clog << "input chroma format = " << inputFormat << endl;
+    if (convertInput && (inputFormat==RGB)) clog << "colour matrix = " << matrix << endl;
     clog << "interlaced = " << std::boolalpha << interlaced << endl;
     if (interlaced) clog << "top field first = " << std::boolalpha << topFieldFirst << endl;
     clog << "wavelet kernel = " << kernel << endl;
     clog << "wavelet depth = " << waveletDepth << endl;
+    clog << "horizontal only wavelet depth = " << waveletDepthHo << endl;
     clog << "vertical slice size (in units of 2**(wavelet depth)) = " << ySize << endl;
-    clog << "horizontal slice size (in units of 2**(wavelet depth)) = " << xSize << endl;
+    clog << "horizontal slice size (in units of 2**(wavelet depth+horizontal only depth)) = " << xSize << endl;
     clog << "compressed bytes = " << compressedBytes << endl;
     clog << "output = " << output << endl;
   }
 
   // Calculate number of slices per picture
   const int yTransformSize = ySize*utils::pow(2,waveletDepth);
-  const int xTransformSize = xSize*utils::pow(2,waveletDepth);
+  const int xTransformSize = xSize*utils::pow(2,waveletDepth+waveletDepthHo);
   const int pictureHeight = ( (interlaced) ? height/2 : height);
   const int paddedPictureHeight = paddedSize(pictureHeight, waveletDepth);
-  const int paddedWidth = paddedSize(width, waveletDepth);
+  const int paddedWidth = paddedSize(width, waveletDepth+waveletDepthHo);
   const int ySlices = paddedPictureHeight/yTransformSize;
   const int xSlices = paddedWidth/xTransformSize;
   if (paddedPictureHeight != (ySlices*yTransformSize) ) {
@@ -211,7 +288,9 @@ try { //Giant try block around all code to get error messages
   }
 
   // Calculate the quantisation matrix
-  const Array1D qMatrix = quantMatrix(kernel, waveletDepth);
+  const Array1D qMatrix = quantMatrix(kernel, waveletDepth, waveletDepthHo);
+  // Asymmetric transforms always signal their quantisation matrix
+  const Array1D customQMatrix = (waveletDepthHo>0 ? qMatrix : Array1D());
   if (verbose) {
     clog << "Quantisation matrix = " << qMatrix[0];
     for (unsigned int i=1; i<qMatrix.size(); ++i) {
@@ -226,22 +305,55 @@ try { //Giant try block around all code to get error messages
 
   //Create input & output frames
   Frame inFrame(format, interlaced, topFieldFirst);
+  // Input converted before coding (--codeAs) is read into its own frame first
+  Frame sourceFrame(PictureFormat(height, width, inputFormat), interlaced, topFieldFirst);
   Frame outFrame(format, interlaced, topFieldFirst); //used for decoded picture only
   Array2D yDiff(format.lumaShape()); // used for PSNR calculation only
   Array2D uDiff(format.chromaShape()); // used for PSNR calculation only
   Array2D vDiff(format.chromaShape()); // used for PSNR calculation only
 
+  // Simulated link for latency output
+  const utils::Rational fps = frames_per_second(frame_rate);
+  const double picturePeriod =
+    (fps.numerator ? static_cast<double>(fps.denominator)/(fps.numerator*framePics) : 0.0);
+  const PictureFormat transformFormat(paddedPictureHeight, paddedWidth, chromaFormat);
+  const Array2D latencyBytes = slice_bytes(ySlices, xSlices, compressedBytes/framePics, 1);
+  std::vector<int> inputLines(ySlices), rowBytes(ySlices, 0), outputRows(pictureHeight);
+  for (int v=0; v<ySlices; ++v) {
+    inputLines[v] = std::min(pictureHeight-1, last_input_line(kernel, waveletDepth, yTransformSize, v));
+    for (int h=0; h<xSlices; ++h) rowBytes[v] += latencyBytes[v][h];
+  }
+  for (int line=0; line<pictureHeight; ++line) {
+    outputRows[line] = last_slice_row(kernel, waveletDepth, yTransformSize, paddedPictureHeight, line);
+  }
+  LoopbackLatency loopback(picturePeriod/pictureHeight,
+                           static_cast<double>(compressedBytes)*fps.numerator/fps.denominator,
+                           inputLines, rowBytes, outputRows);
+  timing::Samples lineLatencies, encodeTimes, decodeTimes;
+
   int frame = 0;
   if (output==STREAM) {
     if (verbose) clog << endl << "Writing Sequence Header" << endl << endl;
     outStream << dataunitio::start_sequence;
-    outStream << SequenceHeader(PROFILE_LD, format.lumaHeight(), format.lumaWidth(), format.chromaFormat(), interlaced, frame_rate, topFieldFirst, lumaDepth);
+    SequenceHeader sequence(PROFILE_LD, format.lumaHeight(), format.lumaWidth(), format.chromaFormat(), interlaced, frame_rate, topFieldFirst, lumaDepth);
+    if (waveletDepthHo>0) sequence.major_version = 3; // Asymmetric transforms need version 3
+    outStream << sequence;
   }
   while (true) {
 
     // Read input from planar file
     if (verbose) clog << "Reading input frame number " << frame;
-    inStream >> inFrame; // Read the input frame
+    if (dpxReader) { // Read the next file of the sequence
+      Picture picture;
+      if (dpxReader->next(picture))
+        inFrame.frame(convertInput ? convert_for_coding(picture, chromaFormat, matrix, lumaDepth, interlaced) : picture);
+      else inStream.setstate(ios_base::failbit);
+    }
+    else if (convertInput) { // Read the input frame and convert its colour format
+      if (inStream >> sourceFrame)
+        inFrame.frame(convert_for_coding(sourceFrame, chromaFormat, matrix, lumaDepth, interlaced));
+    }
+    else inStream >> inFrame; // Read the input frame
     // Check frame was read OK
     if (!inStream) {
       if (frame==0) {
@@ -267,9 +379,11 @@ try { //Giant try block around all code to get error messages
         picture = inFrame;
       }
 
+      const double encodeStart = timing::now();
+
       //Forward wavelet transform
       if (verbose) clog << "Forward transform" << endl;
-      Picture transform = waveletTransform(picture, kernel, waveletDepth);
+      Picture transform = waveletTransform(picture, kernel, waveletDepth, waveletDepthHo);
 
       if (output==TRANSFORM) {
         //Write transform output as 4 byte 2's comp values
@@ -288,7 +402,7 @@ try { //Giant try block around all code to get error messages
       const int pictureBytes = (interlaced ? compressedBytes/2 : compressedBytes);
       // Calculate number of bytes for each slice
       const Array2D bytes = slice_bytes(ySlices, xSlices, pictureBytes, 1);
-      Array2D qIndices = quantIndices(transform, qMatrix, bytes);
+      Array2D qIndices = quantIndices(transform, qMatrix, bytes, waveletDepthHo);
     
       // Analyse quantiser index stats
       for (int v=0; v<ySlices; ++v) {
@@ -310,7 +424,7 @@ try { //Giant try block around all code to get error messages
       }
 
       if (verbose) clog << "Quantise transform coefficients" << endl;
-      const Picture quantisedSlices = quantise_transform(transform, qIndices, qMatrix);
+      const Picture quantisedSlices = quantise_transform(transform, qIndices, qMatrix, waveletDepthHo);
       
       if (output==QUANTISED) {
         //Write quantised transform output as 4 byte 2's comp values
@@ -330,7 +444,7 @@ try { //Giant try block around all code to get error messages
       
       if (output==PACKAGED) {
         // Package up data for output
-        const Slices outSlices(slices, waveletDepth, qIndices);
+        const Slices outSlices(slices, waveletDepth, qIndices, waveletDepthHo);
 
         //Write packaged output
         if (verbose) clog << "Writing compressed output to file" << endl;
@@ -343,17 +457,58 @@ try { //Giant try block around all code to get error messages
         continue; // omit rest of processing for this picture
       }
 
+      if (output==LATENCY) {
+        // Send the picture, a row of slices at a time, to an in process decoder
+        const Slices outSlices(slices, waveletDepth, qIndices, waveletDepthHo);
+        std::ostringstream channel;
+        channel << sliceio::lowDelay(bytes);
+        channel << outSlices;
+        const double encodeTime = timing::now() - encodeStart;
+
+        const double decodeStart = timing::now();
+        std::istringstream received(channel.str());
+        Slices inSlices(transformFormat, waveletDepth, ySlices, xSlices, waveletDepthHo);
+        received >> sliceio::lowDelay(bytes);
+        received >> inSlices;
+        if (!received) throw std::logic_error("Failed to decode picture sent over simulated channel");
+        const Picture yuvTransform =
+          inverse_quantise_transform(merge_blocks(inSlices.yuvSlices), inSlices.qIndices, qMatrix, waveletDepthHo);
+        picture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picture.format(), waveletDepthHo);
+        picture = clip(picture, -utils::pow(2, lumaDepth-1), utils::pow(2, lumaDepth-1)-1,
+                       -utils::pow(2, chromaDepth-1), utils::pow(2, chromaDepth-1)-1);
+        const double decodeTime = timing::now() - decodeStart;
+
+        encodeTimes.add(encodeTime);
+        decodeTimes.add(decodeTime);
+        const std::vector<double> latencies = loopback.picture(encodeTime, decodeTime);
+        outStream << "Frame " << frame;
+        if (interlaced) outStream << " field " << pic;
+        outStream << endl;
+        outStream << std::fixed << std::setprecision(3);
+        for (unsigned int line=0; line<latencies.size(); ++line) {
+          lineLatencies.add(latencies[line]);
+          outStream << 1000*latencies[line] << endl;
+        }
+        if (!outStream) {
+          cerr << "Failed to write output file \"" << outFileName << "\"" << endl;
+          return EXIT_FAILURE;
+        }
+        continue; // omit rest of processing for this picture
+      }
+
       if (output==STREAM) { 
         const utils::Rational rationalBytes = utils::rationalise(pictureBytes, (ySlices*xSlices));
         // Package up data for output
-        const Slices outSlices(slices, waveletDepth, qIndices);
+        const Slices outSlices(slices, waveletDepth, qIndices, waveletDepthHo);
         const WrappedPicture outWrapped(frame,
                                         kernel,
                                         waveletDepth,
                                         xSlices,
                                         ySlices,
                                         rationalBytes,
-                                        outSlices);
+                                        outSlices,
+                                        waveletDepthHo,
+                                        customQMatrix);
 
         //Write packaged output
         if (verbose) clog << "Writing compressed picture to file" << endl;
@@ -368,11 +523,11 @@ try { //Giant try block around all code to get error messages
     
       // Inverse quantise in transform order
       if (verbose) clog << "Inverse quantise" << endl;
-      const Picture yuvTransform = inverse_quantise_transform_np(quantisedSlices, qIndices, qMatrix);
+      const Picture yuvTransform = inverse_quantise_transform_np(quantisedSlices, qIndices, qMatrix, waveletDepthHo);
 
       // Inverse wavelet transform
       if (verbose) clog << "Inverse transform" << endl;
-      picture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picture.format());
+      picture = inverseWaveletTransform(yuvTransform, kernel, waveletDepth, picture.format(), waveletDepthHo);
 
       if (verbose) clog << "Clip decoded picture" << endl;
       {
@@ -487,6 +642,19 @@ try { //Giant try block around all code to get error messages
   if (output==STREAM) {
     outStream << dataunitio::end_sequence;
   }
+
+  if (output==LATENCY) {
+    const double linePeriod = picturePeriod/pictureHeight;
+    clog << endl << "Simulated end to end latency (input line arrival to output line decoded)" << endl;
+    clog << "Picture period = " << 1000*picturePeriod << " ms, line period = "
+         << 1e6*linePeriod << " us" << endl;
+    timing::summarise(clog, "Encode per picture", encodeTimes, 1000, "ms");
+    timing::summarise(clog, "Decode per picture", decodeTimes, 1000, "ms");
+    timing::summarise(clog, "Line latency", lineLatencies, 1000, "ms");
+    if (lineLatencies.count()>0) {
+      clog << "Worst case latency = " << lineLatencies[lineLatencies.worst()]/linePeriod << " lines" << endl;
+    }
+  }
   
   if (inFileName!="-") inFileBuffer.close();
   if (outFileName!="-") outFileBuffer.close();
@@ -506,7 +674,8 @@ class SliceQuantiserRef: public SliceQuantiser {
   public:
     SliceQuantiserRef(const Array2D& coefficients,
                       int vSlices, int hSlices,
-                      const Array1D& quantMatrix);
+                      const Array1D& quantMatrix,
+                      const int depthHo);
     virtual const Array2D& quantise_slice(int qIndex);
   private:
     const Array2D& coeffs; //Keep a reference to transform coefficients
@@ -516,22 +685,23 @@ class SliceQuantiserRef: public SliceQuantiser {
 
 SliceQuantiserRef::SliceQuantiserRef(const Array2D& coefficients,
                                      int vSlices, int hSlices,
-                                     const Array1D& quantMatrix):
-  SliceQuantiser(coefficients, vSlices, hSlices, quantMatrix),
+                                     const Array1D& quantMatrix,
+                                     const int depthHo):
+  SliceQuantiser(coefficients, vSlices, hSlices, quantMatrix, depthHo),
   coeffs(coefficients)
 {
   const int LLHeight = coeffsHeight/transformSize;
-  const int LLWidth = coeffsWidth/transformSize;
+  const int LLWidth = coeffsWidth/transformWidth;
   decodedLLCoeffs.resize(extents[LLHeight][LLWidth]);
   qMatrix.resize(extents[sliceHeight][sliceWidth]);
   // Fill qMatrix with the appropriate values
-  BlockVector xQMatrix = split_into_subbands(qMatrix, waveletDepth);
+  BlockVector xQMatrix = split_into_subbands(qMatrix, waveletDepth, waveletDepthHo);
   for (int band=0; band<numberOfSubbands; ++band) {
     std::fill(xQMatrix[band].data(),
               xQMatrix[band].data()+xQMatrix[band].num_elements(),
               quantMatrix[band]);
   }
-  qMatrix = merge_subbands(xQMatrix);
+  qMatrix = merge_subbands(xQMatrix, waveletDepthHo);
 }
 
 const Array2D& SliceQuantiserRef::quantise_slice(int qIndex) {
@@ -539,10 +709,10 @@ const Array2D& SliceQuantiserRef::quantise_slice(int qIndex) {
     for (int x=0, xPos=h*sliceWidth; x<sliceWidth; ++x, ++xPos) {
       const int adjustedQ = adjust_quant_index(qIndex, qMatrix[y][x]);
       // Note: for efficiency test could be done by bit compare of LSBs
-      if ( ((y%transformSize)==0)&&((x%transformSize)==0) ) { // LL Subband
+      if ( ((y%transformSize)==0)&&((x%transformWidth)==0) ) { // LL Subband
         // Note: For efficiency division could be done by a bit shift.
         const int yLL = yPos/transformSize; // index to LL subband
-        const int xLL = xPos/transformSize; // index to LL subband
+        const int xLL = xPos/transformWidth; // index to LL subband
         const int prediction = predictDC(decodedLLCoeffs, yLL, xLL);
         qSlice[y][x] = quant(coeffs[yPos][xPos]-prediction, adjustedQ);
         decodedLLCoeffs[yLL][xLL] = scale(qSlice[y][x], adjustedQ)+prediction;
@@ -557,18 +727,19 @@ const Array2D& SliceQuantiserRef::quantise_slice(int qIndex) {
 
 const Array2D quantIndices(const Picture& coefficients,
                            const Array1D& qMatrix,
-                           const Array2D& sliceBytes) {
+                           const Array2D& sliceBytes,
+                           const int waveletDepthHo) {
   const int ySlices = sliceBytes.shape()[0];
   const int xSlices = sliceBytes.shape()[1];
   // Create an empty array of indices to fill and return
   Array2D indices(extents[ySlices][xSlices]); 
   // Wavelet depth & number of subbands derived from dimensions of qMatrix
   const int numberOfSubbands = qMatrix.size();
-  const int waveletDepth = (numberOfSubbands-1)/3;
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
   // Create state machines to quantise slices, with trial quantisers, in raster order
-  SliceQuantiserRef ySliceQuantiser(coefficients.y(), ySlices, xSlices, qMatrix);
-  SliceQuantiserRef uSliceQuantiser(coefficients.c1(), ySlices, xSlices, qMatrix);
-  SliceQuantiserRef vSliceQuantiser(coefficients.c2(), ySlices, xSlices, qMatrix);
+  SliceQuantiserRef ySliceQuantiser(coefficients.y(), ySlices, xSlices, qMatrix, waveletDepthHo);
+  SliceQuantiserRef uSliceQuantiser(coefficients.c1(), ySlices, xSlices, qMatrix, waveletDepthHo);
+  SliceQuantiserRef vSliceQuantiser(coefficients.c2(), ySlices, xSlices, qMatrix, waveletDepthHo);
   bool sliceAvailable = true;
   while (sliceAvailable) {
     const int bytes = sliceBytes[ySliceQuantiser.row()][ySliceQuantiser.column()];
@@ -583,8 +754,8 @@ const Array2D quantIndices(const Picture& coefficients,
       const Array2D yTrialSlice = ySliceQuantiser.quantise_slice(trialQ);
       const Array2D uTrialSlice = uSliceQuantiser.quantise_slice(trialQ);
       const Array2D vTrialSlice = vSliceQuantiser.quantise_slice(trialQ);
-      int bitsRequired = luma_slice_bits(yTrialSlice, waveletDepth);
-      bitsRequired += chroma_slice_bits(uTrialSlice, vTrialSlice, waveletDepth);
+      int bitsRequired = luma_slice_bits(yTrialSlice, waveletDepth, waveletDepthHo);
+      bitsRequired += chroma_slice_bits(uTrialSlice, vTrialSlice, waveletDepth, waveletDepthHo);
       if (bitsRequired<=bitsAvailable) {
         if (trialQ<q) q=trialQ;
         trialQ -= delta;
@@ -606,3 +777,42 @@ const Array2D quantIndices(const Picture& coefficients,
   }
   return indices;
 }
+
+LoopbackLatency::LoopbackLatency(double linePeriod,
+                                 double byteRate,
+                                 const std::vector<int>& inputLines,
+                                 const std::vector<int>& rowBytes,
+                                 const std::vector<int>& outputRows):
+  linePeriod(linePeriod),
+  byteRate(byteRate),
+  inputLines(inputLines),
+  rowBytes(rowBytes),
+  outputRows(outputRows),
+  pictures(0),
+  encoderFree(0.0),
+  channelFree(0.0),
+  decoderFree(0.0) {
+}
+
+const std::vector<double> LoopbackLatency::picture(double encodeTime, double decodeTime) {
+  const int rows = inputLines.size();
+  const int lines = outputRows.size();
+  const double start = static_cast<double>(pictures)*lines*linePeriod;
+  // Each row of slices is encoded, sent and decoded as soon as its input has
+  // arrived and the previous row has finished each stage. The library works on
+  // whole pictures so the measured times are shared equally between rows.
+  std::vector<double> decoded(rows);
+  for (int row=0; row<rows; ++row) {
+    const double arrived = start + (inputLines[row]+1)*linePeriod;
+    encoderFree = std::max(arrived, encoderFree) + encodeTime/rows;
+    channelFree = std::max(encoderFree, channelFree) + rowBytes[row]/byteRate;
+    decoderFree = std::max(channelFree, decoderFree) + decodeTime/rows;
+    decoded[row] = decoderFree;
+  }
+  std::vector<double> latencies(lines);
+  for (int line=0; line<lines; ++line) {
+    latencies[line] = decoded[outputRows[line]] - (start + (line+1)*linePeriod);
+  }
+  ++pictures;
+  return latencies;
+}
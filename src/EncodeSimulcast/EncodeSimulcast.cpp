@@ -0,0 +1,795 @@
+/*********************************************************************/
+/* EncodeSimulcast.cpp                                               */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Reads image data in from a planar file.                           */
+/* Compresses each picture to both a VC-2 Low Delay and a VC-2 High  */
+/* Quality profile stream, from a single wavelet transform.          */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+const char version[] = __DATE__ " @ " __TIME__ ;
+const char summary[] = "Encodes an uncompressed planar video file with both VC-2 Low Delay and High Quality profiles at constant bit rate";
+const char description[] = "\
+This program compresses an image sequence to two SMPTE VC-2 streams at once, a Low Delay\n\
+profile stream (e.g. for a live link) and a High Quality profile stream (e.g. for storage).\n\
+Both streams use the same wavelet kernel and depth, so each picture is read and transformed\n\
+once. The Low Delay stream is then rate controlled with DC prediction, exactly as EncodeLD,\n\
+and the High Quality stream without, exactly as EncodeHQ-CBR, each with its own slice size\n\
+and bit rate. Each stream is identical to that produced by the corresponding encoder alone.\n\
+Both are strictly constant bit rate, specified by the number of compressed bytes per frame.\n\
+Pictures are encoded by a shared pool of threads, and the two streams are written concurrently.\n\
+Input is in planar format (4:4:4, 4:2:2, 4:2:0 or RGB).\n\
+Input may also be Y4M, or a numbered sequence of RGB DPX files (named by its first file).\n\
+RGB input may be coded as YCbCr, and chroma subsampled before coding, with --codeAs.\n\
+There can be 1 to 4 bytes per sample and the data is left (MSB) justified.\n\
+Data is assumed offset binary (which is fine for both YCbCr or RGB).\n\
+\n\
+Example: EncodeSimulcast -v -x 1920 -y 1080 -f 4:2:2 -l 10 -k LeGall -d 3 -i\n\
+           --ldVSlice 1 --ldHSlice 2 --ldBytes 829440\n\
+           --hqVSlice 4 --hqHSlice 4 --hqBytes 4147200 inFileName ldFileName hqFileName";
+const char* details[] = {version, summary, description};
+
+#include <cstdlib> //for EXIT_SUCCESS, EXIT_FAILURE, atoi
+#include <stdexcept> //For standard logic errors
+#include <iostream> //For cin, cout, cerr
+#include <string>
+#include <fstream>
+#include <cstdio> // for perror
+#include <iomanip> // For reporting stats only
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "SimulcastParams.h"
+#include "Arrays.h"
+#include "Picture.h"
+#include "Frame.h"
+#include "WaveletTransform.h"
+#include "Quantisation.h"
+#include "Slices.h"
+#include "DataUnit.h"
+#include "Colour.h"
+#include "Utils.h"
+#include "TaskGraph.h"
+
+using std::cout;
+using std::cin;
+using std::cerr;
+using std::clog;
+using std::endl;
+using std::string;
+using std::filebuf;
+using std::streambuf;
+using std::ios_base;
+using std::istream;
+using std::ostream;
+
+namespace {
+
+// Low Delay rate control (as EncodeLD). Quantises slices in raster order,
+// predicting the DC coefficients from those already (locally) decoded.
+class SliceQuantiserRef: public SliceQuantiser {
+  public:
+    SliceQuantiserRef(const Array2D& coefficients,
+                      int vSlices, int hSlices,
+                      const Array1D& quantMatrix,
+                      const int depthHo);
+    virtual const Array2D& quantise_slice(int qIndex);
+  private:
+    const Array2D& coeffs; //Keep a reference to transform coefficients
+    Array2D decodedLLCoeffs; //Locally decoded LL subband coefficients
+    Array2D qMatrix; //quantMatrix values in slice format
+};
+
+SliceQuantiserRef::SliceQuantiserRef(const Array2D& coefficients,
+                                     int vSlices, int hSlices,
+                                     const Array1D& quantMatrix,
+                                     const int depthHo):
+  SliceQuantiser(coefficients, vSlices, hSlices, quantMatrix, depthHo),
+  coeffs(coefficients)
+{
+  const int LLHeight = coeffsHeight/transformSize;
+  const int LLWidth = coeffsWidth/transformWidth;
+  decodedLLCoeffs.resize(extents[LLHeight][LLWidth]);
+  qMatrix.resize(extents[sliceHeight][sliceWidth]);
+  // Fill qMatrix with the appropriate values
+  BlockVector xQMatrix = split_into_subbands(qMatrix, waveletDepth, waveletDepthHo);
+  for (int band=0; band<numberOfSubbands; ++band) {
+    std::fill(xQMatrix[band].data(),
+              xQMatrix[band].data()+xQMatrix[band].num_elements(),
+              quantMatrix[band]);
+  }
+  qMatrix = merge_subbands(xQMatrix, waveletDepthHo);
+}
+
+const Array2D& SliceQuantiserRef::quantise_slice(int qIndex) {
+  for (int y=0, yPos=v*sliceHeight; y<sliceHeight; ++y, ++yPos) {
+    for (int x=0, xPos=h*sliceWidth; x<sliceWidth; ++x, ++xPos) {
+      const int adjustedQ = adjust_quant_index(qIndex, qMatrix[y][x]);
+      if ( ((y%transformSize)==0)&&((x%transformWidth)==0) ) { // LL Subband
+        const int yLL = yPos/transformSize; // index to LL subband
+        const int xLL = xPos/transformWidth; // index to LL subband
+        const int prediction = predictDC(decodedLLCoeffs, yLL, xLL);
+        qSlice[y][x] = quant(coeffs[yPos][xPos]-prediction, adjustedQ);
+        decodedLLCoeffs[yLL][xLL] = scale(qSlice[y][x], adjustedQ)+prediction;
+      }
+      else {
+        qSlice[y][x] = quant(coeffs[yPos][xPos], adjustedQ);
+      }
+    }
+  }
+  return qSlice;
+}
+
+// Low Delay quantisation indices, for all the slices of a picture, using a
+// binary search for each slice in turn
+const Array2D ldQuantIndices(const Picture& coefficients,
+                             const Array1D& qMatrix,
+                             const Array2D& sliceBytes,
+                             const int waveletDepthHo) {
+  const int ySlices = sliceBytes.shape()[0];
+  const int xSlices = sliceBytes.shape()[1];
+  Array2D indices(extents[ySlices][xSlices]);
+  // Wavelet depth & number of subbands derived from dimensions of qMatrix
+  const int numberOfSubbands = qMatrix.size();
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
+  // Create state machines to quantise slices, with trial quantisers, in raster order
+  SliceQuantiserRef ySliceQuantiser(coefficients.y(), ySlices, xSlices, qMatrix, waveletDepthHo);
+  SliceQuantiserRef uSliceQuantiser(coefficients.c1(), ySlices, xSlices, qMatrix, waveletDepthHo);
+  SliceQuantiserRef vSliceQuantiser(coefficients.c2(), ySlices, xSlices, qMatrix, waveletDepthHo);
+  bool sliceAvailable = true;
+  while (sliceAvailable) {
+    const int bytes = sliceBytes[ySliceQuantiser.row()][ySliceQuantiser.column()];
+    const int length_bits = utils::intlog2(8*bytes-7);
+    const int bitsAvailable = 8*bytes - 7 - length_bits;
+    int trialQ = 63;
+    int q = 127;
+    int delta = 64;
+    while (delta>0) {
+      delta >>= 1;
+      const Array2D yTrialSlice = ySliceQuantiser.quantise_slice(trialQ);
+      const Array2D uTrialSlice = uSliceQuantiser.quantise_slice(trialQ);
+      const Array2D vTrialSlice = vSliceQuantiser.quantise_slice(trialQ);
+      int bitsRequired = luma_slice_bits(yTrialSlice, waveletDepth, waveletDepthHo);
+      bitsRequired += chroma_slice_bits(uTrialSlice, vTrialSlice, waveletDepth, waveletDepthHo);
+      if (bitsRequired<=bitsAvailable) {
+        if (trialQ<q) q=trialQ;
+        trialQ -= delta;
+      }
+      else {
+        trialQ +=delta;
+      }
+    }
+    // The slices must be requantised with the correct q to ensure correct DC prediction
+    ySliceQuantiser.quantise_slice(q);
+    uSliceQuantiser.quantise_slice(q);
+    vSliceQuantiser.quantise_slice(q);
+    indices[ySliceQuantiser.row()][ySliceQuantiser.column()] = q;
+    // Go to next slice
+    sliceAvailable = ySliceQuantiser.next_slice();
+    uSliceQuantiser.next_slice();
+    vSliceQuantiser.next_slice();
+  }
+  return indices;
+}
+
+// High Quality quantisation index for a single slice (as EncodeHQ-CBR),
+// using a binary search
+const int hqQuantIndex(const Picture& slice,
+                       const Array1D& qMatrix,
+                       const int sliceBytes,
+                       const int scalar,
+                       const int waveletDepthHo) {
+  const int numberOfSubbands = qMatrix.size();
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
+  // Available bytes is the size of slice less 4 byte overhead
+  const int bytesAvailable = sliceBytes - 4;
+  int trialQ = 63;
+  int q = 127;
+  int delta = 64;
+  while (delta>0) {
+    delta >>= 1;
+    const Picture trialSlice = quantise_transform_np(slice, trialQ, qMatrix, waveletDepthHo);
+    int bytesRequired = component_slice_bytes(trialSlice.y(), waveletDepth, scalar, waveletDepthHo);
+    bytesRequired += component_slice_bytes(trialSlice.c1(), waveletDepth, scalar, waveletDepthHo);
+    bytesRequired += component_slice_bytes(trialSlice.c2(), waveletDepth, scalar, waveletDepthHo);
+    if (bytesRequired <= bytesAvailable) {
+      if (trialQ<q) q=trialQ;
+      trialQ -= delta;
+    }
+    else {
+      trialQ +=delta;
+    }
+  }
+  return q;
+}
+
+// Mean and standard deviation of a set of quantisation indices
+void quantiserStats(const std::vector<const Array2D*>& indices, float& mean, float& stdDev) {
+  int stats[128] = {0};
+  int totalSlices = 0;
+  for (unsigned int pic=0; pic<indices.size(); ++pic) {
+    const Array2D& qIndices = *indices[pic];
+    for (const int* q=qIndices.data(); q!=qIndices.data()+qIndices.num_elements(); ++q) ++stats[*q];
+    totalSlices += qIndices.num_elements();
+  }
+  mean = 0.0;
+  float meanSquare = 0.0;
+  for (int z=0; z<128; ++z) {
+    mean += (z*stats[z]);
+    meanSquare += (z*z*stats[z]);
+  }
+  mean /= totalSlices;
+  meanSquare /= totalSlices;
+  stdDev = sqrt(meanSquare - (mean*mean));
+}
+
+// Both streams are produced by a graph of tasks. Each picture is transformed
+// once (one task per component). Then the Low Delay stream is rate
+// controlled, quantised and split into slices by one task, since its DC
+// prediction runs across the whole picture in raster order, while each row of
+// slices of the High Quality stream is rate searched, quantised and coded by
+// tasks of its own. Each stream is written, after its previous picture, by a
+// task of its own, so the two streams are written concurrently.
+
+// Maximum number of input frames being encoded at once
+const int maxFramesInFlight = 2;
+
+// Slice geometry and bit rate of a stream, for each picture
+struct StreamSettings {
+  StreamSettings(const int ySlices, const int xSlices, const int pictureBytes,
+                 const int sliceScalar):
+    sliceBytes(slice_bytes(ySlices, xSlices, pictureBytes, sliceScalar)),
+    sliceScalar(sliceScalar),
+    rationalBytes(utils::rationalise(pictureBytes, ySlices*xSlices)) {}
+  const Array2D sliceBytes;
+  const int sliceScalar;
+  const utils::Rational rationalBytes; // Bytes per slice (as signalled by LD)
+};
+
+// Encoding parameters common to all pictures
+struct EncoderSettings {
+  EncoderSettings(const WaveletKernel kernel, const int waveletDepth,
+                  const int waveletDepthHo, const Array1D& qMatrix,
+                  const StreamSettings& ld, const StreamSettings& hq):
+    kernel(kernel), waveletDepth(waveletDepth), waveletDepthHo(waveletDepthHo),
+    qMatrix(qMatrix), ld(ld), hq(hq) {}
+  const WaveletKernel kernel;
+  const int waveletDepth;
+  const int waveletDepthHo;
+  const Array1D qMatrix;
+  const StreamSettings ld;
+  const StreamSettings hq;
+};
+
+const PictureFormat transformFormat(const PictureFormat& format,
+                                   const int waveletDepth, const int waveletDepthHo) {
+  return PictureFormat(paddedSize(format.lumaHeight(), waveletDepth),
+                       paddedSize(format.lumaWidth(), waveletDepth+waveletDepthHo),
+                       paddedSize(format.chromaHeight(), waveletDepth),
+                       paddedSize(format.chromaWidth(), waveletDepth+waveletDepthHo),
+                       format.chromaFormat());
+}
+
+// Pictures with horizontal only levels always signal their quantisation
+// matrix, other pictures use the default matrix
+const Array1D customQuantMatrix(const EncoderSettings& settings) {
+  return (settings.waveletDepthHo>0 ? settings.qMatrix : Array1D());
+}
+
+// Copy one row of slices out of a component of the transform
+const Array2D sliceRow(const Array2D& component, const int row, const int ySlices) {
+  const int height = component.shape()[0];
+  const int width = component.shape()[1];
+  const int top = row*height/ySlices;
+  const int bottom = (row+1)*height/ySlices;
+  Array2D result(extents[bottom-top][width]);
+  result = component[indices[Range(top, bottom)][Range(0, width)]];
+  return result;
+}
+
+// The state of one picture (field or frame) as it passes through the graph.
+// Each task writes a distinct part of it (a component, the Low Delay slices,
+// or a row of High Quality slices). The coefficients are shared, read only
+// once transformed, by both streams.
+class PictureEncoder {
+  public:
+    PictureEncoder(const EncoderSettings& settings, const Picture& picture,
+                   unsigned long number);
+    void transform(const int component);
+    void encodeLD();
+    void searchHQ(const int row);
+    void quantiseHQ(const int row);
+    void codeHQ(const int row);
+    void writeLD(std::ostream& stream);
+    void writeHQ(std::ostream& stream);
+    const Array2D& ldIndices() const {return ldQIndices;}
+    const Array2D& hqIndices() const {return hqQIndices;}
+  private:
+    const EncoderSettings& settings;
+    const Picture picture;
+    const unsigned long number;
+    Picture coefficients;
+    // Low Delay stream
+    const int ldYSlices;
+    const int ldXSlices;
+    Array2D ldQIndices;
+    PictureArray ldSlices; // Quantised
+    // High Quality stream
+    const int hqYSlices;
+    const int hqXSlices;
+    Array2D hqQIndices;
+    std::vector<PictureArray> hqRows; // Each row of slices, before then after quantisation
+    std::vector<std::string> hqCoded; // Each row of slices, coded
+};
+
+PictureEncoder::PictureEncoder(const EncoderSettings& s, const Picture& p,
+                               unsigned long n):
+  settings(s), picture(p), number(n),
+  coefficients(transformFormat(p.format(), s.waveletDepth, s.waveletDepthHo)),
+  ldYSlices(s.ld.sliceBytes.shape()[0]), ldXSlices(s.ld.sliceBytes.shape()[1]),
+  ldQIndices(extents[ldYSlices][ldXSlices]),
+  hqYSlices(s.hq.sliceBytes.shape()[0]), hqXSlices(s.hq.sliceBytes.shape()[1]),
+  hqQIndices(extents[hqYSlices][hqXSlices]),
+  hqRows(hqYSlices), hqCoded(hqYSlices) {
+}
+
+void PictureEncoder::transform(const int component) {
+  const WaveletKernel kernel = settings.kernel;
+  const int depth = settings.waveletDepth;
+  const int depthHo = settings.waveletDepthHo;
+  switch (component) {
+    case 0:
+      coefficients.y(waveletTransform(picture.y(), kernel, depth, depthHo));
+      break;
+    case 1:
+      coefficients.c1(waveletTransform(picture.c1(), kernel, depth, depthHo));
+      break;
+    default:
+      coefficients.c2(waveletTransform(picture.c2(), kernel, depth, depthHo));
+      break;
+  }
+}
+
+void PictureEncoder::encodeLD() {
+  ldQIndices = ldQuantIndices(coefficients, settings.qMatrix, settings.ld.sliceBytes, settings.waveletDepthHo);
+  const Picture quantised = quantise_transform(coefficients, ldQIndices, settings.qMatrix, settings.waveletDepthHo);
+  ldSlices = split_into_blocks(quantised, ldYSlices, ldXSlices);
+}
+
+void PictureEncoder::searchHQ(const int row) {
+  const Array2D luma = sliceRow(coefficients.y(), row, hqYSlices);
+  const Array2D chroma1 = sliceRow(coefficients.c1(), row, hqYSlices);
+  const Array2D chroma2 = sliceRow(coefficients.c2(), row, hqYSlices);
+  const PictureFormat rowFormat(luma.shape()[0], luma.shape()[1],
+                                chroma1.shape()[0], chroma1.shape()[1],
+                                coefficients.format().chromaFormat());
+  hqRows[row] = split_into_blocks(Picture(rowFormat, luma, chroma1, chroma2), 1, hqXSlices);
+  for (int column=0; column<hqXSlices; ++column) {
+    hqQIndices[row][column] = hqQuantIndex(hqRows[row][0][column], settings.qMatrix,
+                                           settings.hq.sliceBytes[row][column], settings.hq.sliceScalar,
+                                           settings.waveletDepthHo);
+  }
+}
+
+void PictureEncoder::quantiseHQ(const int row) {
+  for (int column=0; column<hqXSlices; ++column) {
+    hqRows[row][0][column] = quantise_transform_np(hqRows[row][0][column], hqQIndices[row][column],
+                                                   settings.qMatrix, settings.waveletDepthHo);
+  }
+}
+
+void PictureEncoder::codeHQ(const int row) {
+  Array2D rowBytes(extents[1][hqXSlices]);
+  rowBytes[0] = settings.hq.sliceBytes[row];
+  Array2D rowIndices(extents[1][hqXSlices]);
+  rowIndices[0] = hqQIndices[row];
+  std::ostringstream buffer;
+  buffer << sliceio::highQualityCBR(rowBytes, settings.hq.sliceScalar);
+  buffer << Slices(hqRows[row], settings.waveletDepth, rowIndices, settings.waveletDepthHo);
+  hqCoded[row] = buffer.str();
+  hqRows[row] = PictureArray(); // No longer needed
+}
+
+// Low Delay slices are coded as they are written, since the stream records
+// the offset of the previous data unit
+void PictureEncoder::writeLD(std::ostream& stream) {
+  const Slices outSlices(ldSlices, settings.waveletDepth, ldQIndices, settings.waveletDepthHo);
+  const WrappedPicture outWrapped(number,
+                                  settings.kernel,
+                                  settings.waveletDepth,
+                                  ldXSlices,
+                                  ldYSlices,
+                                  settings.ld.rationalBytes,
+                                  outSlices,
+                                  settings.waveletDepthHo,
+                                  customQuantMatrix(settings));
+  stream << sliceio::lowDelay(settings.ld.sliceBytes);
+  stream << outWrapped;
+  if (!stream) throw std::runtime_error("Failed to write Low Delay output file");
+  ldSlices = PictureArray(); // No longer needed
+}
+
+void PictureEncoder::writeHQ(std::ostream& stream) {
+  std::string slices;
+  for (int row=0; row<hqYSlices; ++row) slices += hqCoded[row];
+  const int slicePrefix = 0;
+  const WrappedPicture outWrapped(number,
+                                  settings.kernel,
+                                  settings.waveletDepth,
+                                  hqXSlices,
+                                  hqYSlices,
+                                  slicePrefix,
+                                  settings.hq.sliceScalar,
+                                  slices,
+                                  settings.waveletDepthHo,
+                                  customQuantMatrix(settings));
+  stream << dataunitio::highQualityCBR(settings.hq.sliceBytes, settings.hq.sliceScalar);
+  stream << outWrapped;
+  if (!stream) throw std::runtime_error("Failed to write High Quality output file");
+}
+
+typedef boost::shared_ptr<PictureEncoder> PictureEncoderPtr;
+
+// The tasks writing the latest picture of each stream (-1 for none)
+struct Writes {
+  Writes(): ld(-1), hq(-1) {}
+  TaskGraph::Task ld;
+  TaskGraph::Task hq;
+};
+
+// Adds the tasks to encode a picture, with each stream written after its
+// previous picture (if any). Returns the tasks that write the picture.
+const Writes schedule(TaskGraph& graph,
+                      const PictureEncoderPtr& encoder,
+                      std::ostream& ldStream,
+                      std::ostream& hqStream,
+                      const Writes& previous) {
+  TaskGraph::Tasks transforms;
+  for (int component=0; component<3; ++component) {
+    transforms.push_back(graph.add(boost::bind(&PictureEncoder::transform, encoder, component)));
+  }
+  // Low Delay
+  TaskGraph::Tasks ldEncoded(1, graph.add(boost::bind(&PictureEncoder::encodeLD, encoder), transforms));
+  if (previous.ld>=0) ldEncoded.push_back(previous.ld);
+  // High Quality
+  TaskGraph::Tasks hqCoded;
+  const int ySlices = encoder->hqIndices().shape()[0];
+  for (int row=0; row<ySlices; ++row) {
+    const TaskGraph::Task search =
+      graph.add(boost::bind(&PictureEncoder::searchHQ, encoder, row), transforms);
+    const TaskGraph::Task quantise =
+      graph.add(boost::bind(&PictureEncoder::quantiseHQ, encoder, row), search);
+    hqCoded.push_back(graph.add(boost::bind(&PictureEncoder::codeHQ, encoder, row), quantise));
+  }
+  if (previous.hq>=0) hqCoded.push_back(previous.hq);
+  Writes writes;
+  writes.ld = graph.add(boost::bind(&PictureEncoder::writeLD, encoder, boost::ref(ldStream)), ldEncoded);
+  writes.hq = graph.add(boost::bind(&PictureEncoder::writeHQ, encoder, boost::ref(hqStream)), hqCoded);
+  return writes;
+}
+
+// Log the quantiser statistics of both streams for a frame, once it has
+// been encoded
+void report(const int frame, const std::vector<PictureEncoderPtr>& pictures) {
+  std::vector<const Array2D*> ldIndices, hqIndices;
+  for (unsigned int pic=0; pic<pictures.size(); ++pic) {
+    ldIndices.push_back(&pictures[pic]->ldIndices());
+    hqIndices.push_back(&pictures[pic]->hqIndices());
+  }
+  float ldMean, ldStdDev, hqMean, hqStdDev;
+  quantiserStats(ldIndices, ldMean, ldStdDev);
+  quantiserStats(hqIndices, hqMean, hqStdDev);
+  std::ostringstream message; // Logged in one piece as other threads may be logging too
+  message << std::fixed << std::setprecision(2);
+  message << "Frame " << frame << ": Mean, Standard Deviation of quantiser index = "
+          << ldMean << ", " << ldStdDev << " (LD), "
+          << hqMean << ", " << hqStdDev << " (HQ)" << endl;
+  clog << message.str();
+}
+
+// Read the next input frame, converting its colour format for coding if
+// necessary. Returns false at the end of the input.
+const bool readFrame(istream& inStream, dpx::SequenceReader* dpxReader,
+                     Frame& inFrame, Frame& sourceFrame,
+                     const bool convertInput, const ColourMatrix matrix, const int lumaDepth) {
+  const ColourFormat chromaFormat = inFrame.format().chromaFormat();
+  const bool interlaced = inFrame.interlaced();
+  if (dpxReader) { // Read the next file of the sequence
+    Picture picture;
+    if (!dpxReader->next(picture)) return false;
+    inFrame.frame(convertInput ? convert_for_coding(picture, chromaFormat, matrix, lumaDepth, interlaced) : picture);
+  }
+  else if (convertInput) { // Read the input frame and convert its colour format
+    if (!(inStream >> sourceFrame)) return false;
+    inFrame.frame(convert_for_coding(sourceFrame, chromaFormat, matrix, lumaDepth, interlaced));
+  }
+  else inStream >> inFrame; // Read the input frame
+  return static_cast<bool>(inStream);
+}
+
+// Open an output file, or use standard output for "-". Returns null (having
+// reported the error) if the file can't be opened.
+streambuf* openOutput(const string& fileName, filebuf& fileBuffer) {
+  if (fileName=="-") { // Use standard out
+    //Set standard output to binary mode.
+    //Only relevant for Windows (*nix is always binary)
+    if ( utils::setstdoutmode(std::ios_base::binary) == -1 ) {
+        cerr << "Error: could not set standard output to binary mode" << endl;
+        return 0;
+    }
+    return cout.rdbuf();
+  }
+  streambuf* pBuffer = fileBuffer.open(fileName.c_str(), ios_base::out|ios_base::binary);
+  if (!pBuffer) perror((string("Failed to open output file \"")+fileName+"\"").c_str());
+  return pBuffer;
+}
+
+// Number of slices in each dimension of a picture for a stream
+void sliceCounts(const StreamParams& stream, const int pictureHeight, const int width,
+                 const int waveletDepth, const int waveletDepthHo,
+                 int& ySlices, int& xSlices) {
+  const int yTransformSize = stream.ySize*utils::pow(2,waveletDepth);
+  const int xTransformSize = stream.xSize*utils::pow(2,waveletDepth+waveletDepthHo);
+  const int paddedPictureHeight = paddedSize(pictureHeight, waveletDepth);
+  const int paddedWidth = paddedSize(width, waveletDepth+waveletDepthHo);
+  ySlices = paddedPictureHeight/yTransformSize;
+  xSlices = paddedWidth/xTransformSize;
+  if (paddedPictureHeight != (ySlices*yTransformSize) )
+    throw std::logic_error("Padded picture height is not divisible by slice height");
+  if (paddedWidth != (xSlices*xTransformSize) )
+    throw std::logic_error("Padded width is not divisible by slice width");
+}
+
+} // end unnamed namespace
+
+int main(int argc, char * argv[]) {
+
+try { //Giant try block around all code to get error messages
+
+  // get command line parameters
+  ProgramParams params = getCommandLineParams(argc, argv, details);
+  if (!params.error.empty()) {
+    cerr << "Command line error: " << params.error << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Create convenient aliases for program parameters
+  const string inFileName = params.inFileName;
+  const StreamParams& ld = params.ld;
+  const StreamParams& hq = params.hq;
+  const bool verbose = params.verbose;
+
+  if (verbose) {
+    clog << endl;
+    for (int arg=0; arg<argc; ++arg) { //Output command line
+      if (arg) clog << " ";
+      clog << argv[arg];
+    }
+    clog << endl;
+    clog << "input file = " << inFileName << endl;
+    clog << "Low Delay output file = " << ld.fileName << endl;
+    clog << "High Quality output file = " << hq.fileName << endl;
+  }
+
+  // Open input file or use standard input
+  // Input stream is read only binary mode.
+  // No point in continuing if can't open input file.
+  filebuf inFileBuffer; // For file input. Needs to be defined here to remain in scope
+  streambuf *pInBuffer; // Either standard input buffer or a file buffer
+  if (inFileName=="-") { // Use standard in
+    //Set standard input to binary mode.
+    //Only relevant for Windows (*nix is always binary)
+    if ( utils::setstdinmode(std::ios_base::binary) == -1 ) {
+        cerr << "Error: could not set standard input to binary mode" << endl;
+        return EXIT_FAILURE;
+    }
+    pInBuffer = cin.rdbuf();
+  }
+  else { // Open file inFileName and use it for input
+    pInBuffer = inFileBuffer.open(inFileName.c_str(), ios_base::in|ios_base::binary);
+    if (!pInBuffer) {
+      perror((string("Failed to open input file \"")+inFileName+"\"").c_str());
+      return EXIT_FAILURE;
+    }
+  }
+  istream inStream(pInBuffer);
+
+  // Read the picture format from the header of Y4M input
+  if (params.y4mInput) {
+    Y4MHeader header;
+    inStream >> header;
+    if (!inStream) {
+      cerr << "Failed to read Y4M header from input file \"" << inFileName << "\"" << endl;
+      return EXIT_FAILURE;
+    }
+    setY4MFormat(params, header);
+  }
+
+  // DPX input is a sequence of files, read ahead on threads of their own
+  boost::scoped_ptr<dpx::SequenceReader> dpxReader;
+  if (params.dpxInput) {
+    dpxReader.reset(new dpx::SequenceReader(inFileName, params.readThreads));
+    setDPXFormat(params, dpxReader->header());
+  }
+
+  // Create convenient aliases for the picture format and coding parameters
+  const int height = params.height;
+  const int width = params.width;
+  const ColourFormat chromaFormat = params.chromaFormat;
+  const ColourFormat inputFormat = params.inputFormat;
+  const bool convertInput = (inputFormat!=chromaFormat);
+  const ColourMatrix matrix = params.matrix;
+  const int bytes = params.bytes;
+  const int lumaDepth = params.lumaDepth;
+  const int chromaDepth = params.chromaDepth;
+  const bool interlaced = params.interlaced;
+  const bool topFieldFirst = params.topFieldFirst;
+  const WaveletKernel kernel = params.kernel;
+  const int waveletDepth = params.waveletDepth;
+  const int waveletDepthHo = params.waveletDepthHo;
+  const FrameRate frame_rate = params.frame_rate;
+  const int threads = params.threads;
+
+  // Configure input stream to read the required picture format
+  inStream >> pictureio::wordWidth(bytes); // Set number of bytes per value in file
+  inStream >> pictureio::left_justified;
+  inStream >> pictureio::offset_binary;
+  inStream >> pictureio::bitDepth(lumaDepth, chromaDepth); // Set luma and chroma bit depths
+
+  if (params.y4mInput) inStream >> pictureio::y4m; // FRAME markers and Y4M sample format
+
+  // Open the output files (or use standard output for one of them).
+  // Output streams are write only binary mode
+  // No point in continuing if can't open output files.
+  filebuf ldFileBuffer, hqFileBuffer; // For file output. Need to be defined here to remain in scope
+  streambuf *pLDBuffer = openOutput(ld.fileName, ldFileBuffer);
+  if (!pLDBuffer) return EXIT_FAILURE;
+  streambuf *pHQBuffer = openOutput(hq.fileName, hqFileBuffer);
+  if (!pHQBuffer) return EXIT_FAILURE;
+  ostream ldStream(pLDBuffer);
+  ostream hqStream(pHQBuffer);
+
+  PictureFormat format(height, width, chromaFormat);
+
+  if (verbose) {
+    clog << "bytes per sample= " << bytes << endl;
+    clog << "luma depth (bits) = " << lumaDepth << endl;
+    clog << "chroma depth (bits) = " << chromaDepth << endl;
+    clog << "height = " << format.lumaHeight() << endl;
+    clog << "width = " << format.lumaWidth() << endl;
+    clog << "chroma format = " << format.chromaFormat() << endl;
+    if (convertInput) clog << "input chroma format = " << inputFormat << endl;
+    if (convertInput && (inputFormat==RGB)) clog << "colour matrix = " << matrix << endl;
+    clog << "interlaced = " << std::boolalpha << interlaced << endl;
+    if (interlaced) clog << "top field first = " << std::boolalpha << topFieldFirst << endl;
+    clog << "wavelet kernel = " << kernel << endl;
+    clog << "wavelet depth = " << waveletDepth << endl;
+    clog << "horizontal only wavelet depth = " << waveletDepthHo << endl;
+    clog << "Low Delay vertical slice size (in units of 2**(wavelet depth)) = " << ld.ySize << endl;
+    clog << "Low Delay horizontal slice size (in units of 2**(wavelet depth+horizontal only depth)) = " << ld.xSize << endl;
+    clog << "Low Delay compressed bytes = " << ld.compressedBytes << endl;
+    clog << "High Quality vertical slice size (in units of 2**(wavelet depth)) = " << hq.ySize << endl;
+    clog << "High Quality horizontal slice size (in units of 2**(wavelet depth+horizontal only depth)) = " << hq.xSize << endl;
+    clog << "High Quality compressed bytes = " << hq.compressedBytes << endl;
+    clog << "High Quality slice scalar = " << hq.slice_scalar << endl;
+    clog << "threads = " << threads << " (0 means one per hardware thread)" << endl;
+  }
+
+  // Calculate number of slices per picture of each stream
+  const int pictureHeight = ( (interlaced) ? height/2 : height);
+  int ldYSlices, ldXSlices, hqYSlices, hqXSlices;
+  sliceCounts(ld, pictureHeight, width, waveletDepth, waveletDepthHo, ldYSlices, ldXSlices);
+  sliceCounts(hq, pictureHeight, width, waveletDepth, waveletDepthHo, hqYSlices, hqXSlices);
+  const int framePics = (interlaced ? 2 : 1);
+
+  if (verbose) {
+    clog << "Low Delay vertical slices per picture      = " << ldYSlices << endl;
+    clog << "Low Delay horizontal slices per picture    = " << ldXSlices << endl;
+    clog << "High Quality vertical slices per picture   = " << hqYSlices << endl;
+    clog << "High Quality horizontal slices per picture = " << hqXSlices << endl;
+  }
+
+  // Calculate the quantisation matrix
+  const Array1D qMatrix = quantMatrix(kernel, waveletDepth, waveletDepthHo);
+  if (verbose) {
+    clog << "Quantisation matrix = " << qMatrix[0];
+    for (unsigned int i=1; i<qMatrix.size(); ++i) {
+      clog << ", " << qMatrix[i];
+    }
+    clog << endl;
+  }
+
+  //Create input frames
+  Frame inFrame(format, interlaced, topFieldFirst);
+  // Input converted before coding (--codeAs) is read into its own frame first
+  Frame sourceFrame(PictureFormat(height, width, inputFormat), interlaced, topFieldFirst);
+
+  // Both streams are encoded by a task graph (see PictureEncoder)
+  const EncoderSettings settings(kernel, waveletDepth, waveletDepthHo, qMatrix,
+                                 StreamSettings(ldYSlices, ldXSlices, ld.compressedBytes/framePics, 1),
+                                 StreamSettings(hqYSlices, hqXSlices, hq.compressedBytes/framePics, hq.slice_scalar));
+  TaskGraph graph(threads);
+  std::deque<TaskGraph::Tasks> framesInFlight; // Final tasks for each frame being encoded
+  Writes lastWrites;
+  TaskGraph::Task lastReport = -1; // Frames are reported in order
+
+  if (verbose) clog << endl << "Writing Sequence Headers" << endl << endl;
+  ldStream << dataunitio::start_sequence;
+  SequenceHeader ldSequence(PROFILE_LD, format.lumaHeight(), format.lumaWidth(), format.chromaFormat(), interlaced, frame_rate, topFieldFirst, lumaDepth);
+  if (waveletDepthHo>0) ldSequence.major_version = 3; // Asymmetric transforms need version 3
+  ldStream << ldSequence;
+  hqStream << dataunitio::start_sequence;
+  SequenceHeader hqSequence(PROFILE_HQ, format.lumaHeight(), format.lumaWidth(), format.chromaFormat(), interlaced, frame_rate, topFieldFirst, lumaDepth);
+  if (waveletDepthHo>0) hqSequence.major_version = 3; // Asymmetric transforms need version 3
+  hqStream << hqSequence;
+
+  int frame = 0;
+  while (true) {
+
+    // Limit the number of frames being encoded at once
+    if (framesInFlight.size()>=static_cast<unsigned int>(maxFramesInFlight)) {
+      const TaskGraph::Tasks& oldest = framesInFlight.front();
+      for (unsigned int task=0; task<oldest.size(); ++task) graph.wait(oldest[task]);
+      framesInFlight.pop_front();
+    }
+
+    // Read input from planar file
+    if (verbose) clog << "Reading input frame number " << frame;
+    if (!readFrame(inStream, dpxReader.get(), inFrame, sourceFrame, convertInput, matrix, lumaDepth)) {
+      if (frame==0) {
+        cerr << "\rFailed to read input frame number " << frame << endl;
+        return EXIT_FAILURE;
+      }
+      else {
+        if (verbose) clog << "\rEnd of input reached after " << frame << " frames" << endl;
+        break;
+      }
+    }
+    else if (verbose) clog << endl;
+
+    std::vector<PictureEncoderPtr> pictures;
+    for (int pic=0 ; pic<framePics; ++pic) {
+      const Picture picture = (interlaced ? (pic==0 ? inFrame.firstField() : inFrame.secondField()) : inFrame);
+      pictures.push_back(PictureEncoderPtr(new PictureEncoder(settings, picture, frame)));
+      lastWrites = schedule(graph, pictures.back(), ldStream, hqStream, lastWrites);
+    }
+    TaskGraph::Tasks written;
+    written.push_back(lastWrites.ld);
+    written.push_back(lastWrites.hq);
+    if (verbose) {
+      if (lastReport>=0) written.push_back(lastReport);
+      lastReport = graph.add(boost::bind(report, frame, pictures), written);
+      written = TaskGraph::Tasks(1, lastReport);
+    }
+    framesInFlight.push_back(written);
+    ++frame;
+  } //End frame loop
+
+  graph.wait(); // Finish encoding (reporting any errors)
+
+  ldStream << dataunitio::end_sequence;
+  hqStream << dataunitio::end_sequence;
+
+  if (inFileName!="-") inFileBuffer.close();
+  if (ld.fileName!="-") ldFileBuffer.close();
+  if (hq.fileName!="-") hqFileBuffer.close();
+
+} // end of try block
+
+// Report error messages from try block
+catch (const std::exception& ex) {
+    cout << "Error: " << ex.what() << endl;
+    return EXIT_FAILURE;
+}
+
+  return EXIT_SUCCESS;
+}
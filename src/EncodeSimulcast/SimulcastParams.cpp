@@ -0,0 +1,346 @@
+/*********************************************************************/
+/* SimulcastParams.cpp                                               */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines getting program parameters from command line.             */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include "SimulcastParams.h"
+#include "Picture.h"
+#include "WaveletTransform.h"
+
+#include <cstdlib> // For exit
+#include <iostream> //For cin, cout, cerr
+#include <stdexcept> // For invalid_argument
+#include <string>
+
+using std::clog;
+using std::endl;
+using std::string;
+using std::invalid_argument;
+
+#include <tclap/CmdLine.h>
+
+using TCLAP::CmdLine;
+using TCLAP::SwitchArg;
+using TCLAP::ValueArg;
+using TCLAP::UnlabeledValueArg;
+
+// Tell tclap that various enums are to be treated as tclap values
+namespace TCLAP {
+  template <>
+  struct ArgTraits<ColourFormat> { // Let TCLAP parse ColourFormat objects
+    typedef ValueLike ValueCategory;
+  };
+
+  template <>
+  struct ArgTraits<WaveletKernel> { // Let TCLAP parse WaveletKernel objects
+    typedef ValueLike ValueCategory;
+  };
+
+  template <>
+  struct ArgTraits<ColourMatrix> { // Let TCLAP parse ColourMatrix objects
+    typedef ValueLike ValueCategory;
+  };
+}
+
+namespace {
+
+  // Check the slice geometry and bit rate of an output stream
+  void checkStream(const StreamParams& stream, const string& name) {
+    if (stream.compressedBytes<1)
+      throw invalid_argument("number of "+name+" compressed bytes must be >0");
+    if (stream.ySize<1)
+      throw invalid_argument(name+" vertical slice size must be >0");
+    if (stream.xSize<1)
+      throw invalid_argument(name+" horizontal slice size must be >0");
+    if (stream.slice_scalar<1)
+      throw invalid_argument(name+" slice scalar must be >0");
+  }
+
+} // end unnamed namespace
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char * details[]) {
+
+  const char * const version = details[0];
+  const char * const summary = details[1];
+  const char * const description = details[2];
+
+  if (argc<2) {
+    clog << "Version: " << version << endl;
+    clog << description << endl;
+    clog << "\nFor more details and useage use -h or --help" << endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  ProgramParams params;
+
+  try {
+
+    // Define tclap command line object
+    CmdLine cmd(summary, ' ', version);
+
+    // Define tclap command line parameters (and add them to tclap command line)
+    UnlabeledValueArg<string> inFile("inFile", "Input file name (use \"-\" for standard input)", true, "-", "string", cmd);
+    UnlabeledValueArg<string> ldFile("ldFile", "Low Delay output stream file name (use \"-\" for standard output)", true, "-", "string", cmd);
+    UnlabeledValueArg<string> hqFile("hqFile", "High Quality output stream file name (use \"-\" for standard output)", true, "-", "string", cmd);
+    SwitchArg verbosity("v", "verbose", "Output extra information to standard log", cmd);
+    // "cla" prefix == command line argument
+    ValueArg<int> cla_ldBytes("", "ldBytes", "Low Delay compressed bytes per frame", true, 0, "integer", cmd);
+    ValueArg<int> cla_ldHSliceSize("", "ldHSlice", "Low Delay horizontal slice size (in units of 2**(wavelet depth + horizontal only depth))", true, 0, "integer", cmd);
+    ValueArg<int> cla_ldVSliceSize("", "ldVSlice", "Low Delay vertical slice size (in units of 2**(wavelet depth))", true, 0, "integer", cmd);
+    ValueArg<int> cla_hqBytes("", "hqBytes", "High Quality compressed bytes per frame", true, 0, "integer", cmd);
+    ValueArg<int> cla_hqHSliceSize("", "hqHSlice", "High Quality horizontal slice size (in units of 2**(wavelet depth + horizontal only depth))", true, 0, "integer", cmd);
+    ValueArg<int> cla_hqVSliceSize("", "hqVSlice", "High Quality vertical slice size (in units of 2**(wavelet depth))", true, 0, "integer", cmd);
+    ValueArg<int> cla_hqScalar("", "hqScalar", "High Quality slice size scalar (default 1)", false, 1, "integer", cmd);
+    ValueArg<int> cla_waveletDepth("d", "waveletDepth", "Wavelet transform depth", true, 0, "integer", cmd);
+    ValueArg<int> cla_waveletDepthHo("D", "waveletDepthHo", "Additional horizontal only wavelet transform depth (default 0)", false, 0, "integer", cmd);
+    ValueArg<WaveletKernel> cla_kernel("k", "kernel", "Wavelet kernel (DD97, LeGall, DD137, Haar0, Haar1, Fidelity, Daub97)", true, NullKernel, "string", cmd);
+    SwitchArg cla_bottomFieldFirst("b", "bottomFieldFirst", "Bottom field is earliest (defaults to top field first))", cmd, false);
+    SwitchArg cla_topFieldFirst("t", "topFieldFirst", "Top field is earliest (defaults to top field first))", cmd, true);
+    SwitchArg cla_interlace("i", "interlace", "Use interlace coding (defaults to progressive coding))", cmd, false);
+    SwitchArg cla_progressive("p", "progressive", "Use progressive coding (defaults to progressive coding))", cmd, true);
+    ValueArg<int> cla_chromaDepth("c", "chromaDepth", "Bit depth for chroma (defaults to luma_depth), for RGB use -z)", false, 0, "integer", cmd);
+    ValueArg<int> cla_lumaDepth("l", "lumaDepth", "Bit depth for luma (defaults to bits per input sample), for RGB use -z", false, 0, "integer", cmd);
+    ValueArg<int> cla_bitDepth("z", "bitDepth", "Common bit depth for all components (defaults to bits per input sample)", false, 0, "integer", cmd);
+    ValueArg<int> cla_bytes("n", "bytes", "Number of bytes per sample in image file (default 2)", false, 2, "integer", cmd);
+    ValueArg<ColourFormat> cla_format("f", "format", "Colour format (4:4:4, 4:2:2, 4:2:0 or RGB)", false, UNKNOWN, "string", cmd);
+    ValueArg<int> cla_width("x", "width", "Picture width", false, 0, "integer", cmd);
+    ValueArg<int> cla_height("y", "height", "Picture height", false, 0, "integer", cmd);
+    ValueArg<int> cla_framerate("r", "framerate", "Frame Rate ( 1 = 24/1.001, 2 = 24, 3 = 25, 4 = 30/1.001, 5 = 30, 6 = 50, 7 = 60/1.001, 8 = 60, 9 = 15/1.001, 10 = 25/2, 11 = 48 (default 3)", false, 3, "integer", cmd);
+    SwitchArg cla_y4m("Y", "y4m", "Input pictures are Y4M, with the picture format in the input header (the default for .y4m file names)", cmd, false);
+    ValueArg<int> cla_readThreads("", "readThreads", "Threads reading and unpacking DPX input ahead of the encoder (default 4, 0 means one per hardware thread)", false, 4, "integer", cmd);
+    ValueArg<ColourFormat> cla_codeAs("", "codeAs", "Colour format to code (4:4:4, 4:2:2 or 4:2:0), converted from RGB input or subsampled from input with more chroma (defaults to the input format)", false, UNKNOWN, "string", cmd);
+    ValueArg<ColourMatrix> cla_matrix("", "matrix", "Colour matrix for coding RGB input as YCbCr (709 or 2020, default 709)", false, MATRIX_UNKNOWN, "string", cmd);
+    ValueArg<int> cla_threads("j", "threads", "Number of encoding threads, shared by both streams (default one per hardware thread)", false, 0, "integer", cmd);
+
+    // Parse the argv array
+    cmd.parse(argc, argv);
+
+    // Initialise program parameters
+    const string inFileName = inFile.getValue();
+    const bool verbose = verbosity.getValue();
+    const int height = cla_height.getValue();
+    const int width = cla_width.getValue();
+    const ColourFormat chromaFormat = cla_format.getValue();
+    const int bytes = cla_bytes.getValue();
+    int bitDepth = cla_bitDepth.getValue();
+    int lumaDepth = cla_lumaDepth.getValue();
+    int chromaDepth = cla_chromaDepth.getValue();
+    bool interlaced = cla_interlace.isSet();
+    bool topFieldFirst = !cla_bottomFieldFirst.isSet();
+    const WaveletKernel kernel = cla_kernel.getValue();
+    const int waveletDepth = cla_waveletDepth.getValue();
+    const int waveletDepthHo = cla_waveletDepthHo.getValue();
+    const bool y4mInput = cla_y4m.isSet() || pictureio::isY4MFileName(inFileName);
+    const bool dpxInput = dpx::isDPXFileName(inFileName);
+    const int readThreads = cla_readThreads.getValue();
+    const ColourFormat codeAs = cla_codeAs.getValue();
+    const ColourMatrix matrix = cla_matrix.getValue();
+    const int frame_rate = cla_framerate.getValue();
+    const int threads = cla_threads.getValue();
+
+    StreamParams ld;
+    ld.fileName = ldFile.getValue();
+    ld.ySize = cla_ldVSliceSize.getValue();
+    ld.xSize = cla_ldHSliceSize.getValue();
+    ld.compressedBytes = cla_ldBytes.getValue();
+    ld.slice_scalar = 1;
+
+    StreamParams hq;
+    hq.fileName = hqFile.getValue();
+    hq.ySize = cla_hqVSliceSize.getValue();
+    hq.xSize = cla_hqHSliceSize.getValue();
+    hq.compressedBytes = cla_hqBytes.getValue();
+    hq.slice_scalar = cla_hqScalar.getValue();
+
+    // Check for valid combinations of parameters and options
+    if ((chromaFormat==RGB) && (cla_lumaDepth.isSet() || cla_chromaDepth.isSet()))
+      throw invalid_argument("luma/chroma depth is not appropriate for RGB (use -z or --bitDepth)");
+    if (cla_bitDepth.isSet() && (cla_lumaDepth.isSet() || cla_chromaDepth.isSet()))
+      throw invalid_argument("bitDepth is incompatible with luma depth (and/or chroma depth): use one or the other");
+    if (cla_progressive.isSet() && cla_interlace.isSet())
+      throw invalid_argument("image can't be both interlaced and progressive: specify one or the other");
+    if (cla_progressive.isSet() && (cla_topFieldFirst.isSet() || cla_bottomFieldFirst.isSet()))
+      throw invalid_argument("field parity is incompatible with progressive image");
+    if (cla_topFieldFirst.isSet() && cla_bottomFieldFirst.isSet())
+      throw invalid_argument("image can't be both top field first and bottom field first: specify one or the other");
+
+    if (y4mInput && (cla_height.isSet() || cla_width.isSet() || cla_format.isSet() || cla_bytes.isSet() ||
+                     cla_bitDepth.isSet() || cla_lumaDepth.isSet() || cla_chromaDepth.isSet() ||
+                     cla_interlace.isSet() || cla_progressive.isSet() ||
+                     cla_topFieldFirst.isSet() || cla_bottomFieldFirst.isSet()))
+      throw invalid_argument("the picture format of Y4M input is read from its header, so can't be set on the command line");
+    if (dpxInput && (cla_height.isSet() || cla_width.isSet() || cla_format.isSet() || cla_bytes.isSet() ||
+                     cla_bitDepth.isSet() || cla_lumaDepth.isSet() || cla_chromaDepth.isSet()))
+      throw invalid_argument("the picture format of DPX input is read from its first file, so can't be set on the command line");
+    if (dpxInput && y4mInput)
+      throw invalid_argument("input can't be both DPX and Y4M");
+    if (cla_readThreads.isSet() && !dpxInput)
+      throw invalid_argument("read threads are only used for DPX input");
+    if (!y4mInput && !dpxInput && !(cla_height.isSet() && cla_width.isSet() && cla_format.isSet()))
+      throw invalid_argument("picture height, width and colour format are required (unless input is Y4M or DPX)");
+    if (codeAs==RGB)
+      throw invalid_argument("input can only be converted to YCbCr (4:4:4, 4:2:2 or 4:2:0) for coding");
+    if (cla_matrix.isSet() && !cla_codeAs.isSet())
+      throw invalid_argument("a colour matrix is only used when converting RGB input (with --codeAs)");
+    if (ld.fileName==hq.fileName)
+      throw invalid_argument("the Low Delay and High Quality streams must be written to different outputs");
+
+    // Set default values
+    if (!cla_bitDepth.isSet()) bitDepth = 8*bytes;
+    if (!cla_lumaDepth.isSet()) lumaDepth = bitDepth;
+    if (!cla_chromaDepth.isSet()) chromaDepth = lumaDepth;
+
+    // Check parameter values
+    if (readThreads<0)
+      throw std::invalid_argument("number of read threads must be >=0");
+    if (!y4mInput && !dpxInput) { // Y4M and DPX picture formats are checked when their headers are read
+      if (height<1) throw invalid_argument("picture height must be > 0");
+      if (width<1) throw invalid_argument("picture width must be > 0");
+      if (chromaFormat==UNKNOWN)
+        throw std::invalid_argument("unknown colour format");
+      if ( (1>bytes) || (bytes>4) )
+        throw std::invalid_argument("bytes must be in range 1 to 4");
+      if (cla_bitDepth.isSet()) {
+        if ( (1>bitDepth) || (bitDepth>(8*bytes)) )
+          throw std::invalid_argument("bit depth must be in range 1 to 8*(bytes per sample)");
+      }
+      else {
+        if ( (1>lumaDepth) || (lumaDepth>(8*bytes)) )
+          throw std::invalid_argument("luma bit depth must be in range 1 to 8*(bytes per sample)");
+        if ( (1>chromaDepth) || (chromaDepth>(8*bytes)) )
+          throw std::invalid_argument("chroma bit depth must be in range 1 to 8*(bytes per sample)");
+      }
+    }
+    if (kernel==NullKernel)
+      throw std::invalid_argument("invalid wavelet kernel");
+    if (waveletDepth<1)
+      throw std::invalid_argument("wavelet depth must be 1 or more");
+    if (waveletDepthHo<0)
+      throw std::invalid_argument("horizontal only wavelet depth must be 0 or more");
+    checkStream(ld, "Low Delay");
+    checkStream(hq, "High Quality");
+    if (threads<0)
+      throw std::invalid_argument("number of threads must be >=0");
+
+    params.inFileName = inFileName;
+    params.ld = ld;
+    params.hq = hq;
+    params.verbose = verbose;
+    params.height = height;
+    params.width = width;
+    params.chromaFormat = chromaFormat;
+    params.bytes = bytes;
+    params.lumaDepth = lumaDepth;
+    params.chromaDepth = chromaDepth;
+    params.interlaced = interlaced;
+    params.topFieldFirst = topFieldFirst;
+    params.kernel = kernel;
+    params.waveletDepth = waveletDepth;
+    params.waveletDepthHo = waveletDepthHo;
+    params.y4mInput = y4mInput;
+    params.dpxInput = dpxInput;
+    params.readThreads = readThreads;
+    params.codeAs = codeAs;
+    params.matrix = matrix;
+    if (!y4mInput && !dpxInput) setCodedFormat(params); // Otherwise when the header is read
+    params.threads = threads;
+
+    switch (frame_rate) {
+    case 1:
+      params.frame_rate = FR24000_1001;
+      break;
+    case 2:
+      params.frame_rate = FR24;
+      break;
+    case 3:
+      params.frame_rate = FR25;
+      break;
+    case 4:
+      params.frame_rate = FR30000_1001;
+      break;
+    case 5:
+      params.frame_rate = FR30;
+      break;
+    case 6:
+      params.frame_rate = FR50;
+      break;
+    case 7:
+      params.frame_rate = FR60000_1001;
+      break;
+    case 8:
+      params.frame_rate = FR60;
+      break;
+    case 9:
+      params.frame_rate = FR15000_1001;
+      break;
+    case 10:
+      params.frame_rate = FR25_2;
+      break;
+    case 11:
+      params.frame_rate = FR48;
+      break;
+    default:
+      params.frame_rate = FR0;
+      break;
+    }
+    if (y4mInput && !cla_framerate.isSet()) params.frame_rate = FR0; // Use the Y4M header
+  }
+
+  // catch any TCLAP exceptions
+  catch (TCLAP::ArgException &e) {
+    params.error = string("Command line error: ") + e.error() + " for arg " + e.argId();
+  }
+
+  // catch other exceptions
+  catch(const std::exception& ex) {
+    params.error = string(ex.what());
+  }
+
+  return params;
+}
+
+void setY4MFormat(ProgramParams& params, const Y4MHeader& header) {
+  params.height = header.height;
+  params.width = header.width;
+  params.chromaFormat = header.chromaFormat;
+  params.bytes = (header.bitDepth>8) ? 2 : 1;
+  params.lumaDepth = header.bitDepth;
+  params.chromaDepth = header.bitDepth;
+  params.interlaced = header.interlaced;
+  params.topFieldFirst = header.topFieldFirst;
+  if ((params.frame_rate==FR0) && (header.rateNumerator==0)) {
+    params.frame_rate = FR25; // No frame rate in the header, so use the default
+  }
+  else if (params.frame_rate==FR0) {
+    params.frame_rate = frame_rate(header.rateNumerator, header.rateDenominator);
+    if (params.frame_rate==FR0)
+      throw std::invalid_argument("the Y4M frame rate is not a VC-2 frame rate, so set one with -r");
+  }
+  setCodedFormat(params);
+}
+
+void setDPXFormat(ProgramParams& params, const dpx::Header& header) {
+  params.height = header.height;
+  params.width = header.width;
+  params.chromaFormat = RGB;
+  params.lumaDepth = header.bitDepth;
+  params.chromaDepth = header.bitDepth;
+  setCodedFormat(params);
+}
+
+void setCodedFormat(ProgramParams& params) {
+  params.inputFormat = params.chromaFormat;
+  if ((params.matrix!=MATRIX_UNKNOWN) && (params.inputFormat!=RGB))
+    throw std::invalid_argument("a colour matrix is only used for RGB input");
+  if ((params.codeAs==UNKNOWN) || (params.codeAs==params.inputFormat)) return;
+  if (!can_convert_for_coding(params.inputFormat, params.codeAs))
+    throw std::invalid_argument("input can only be converted from RGB, or to a colour format with less chroma, for coding");
+  if (params.lumaDepth!=params.chromaDepth)
+    throw std::invalid_argument("converting the input colour format needs the same luma and chroma bit depth");
+  if ((params.inputFormat==RGB) && (params.matrix==MATRIX_UNKNOWN)) params.matrix = BT709;
+  params.chromaFormat = params.codeAs;
+}
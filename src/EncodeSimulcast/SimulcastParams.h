@@ -0,0 +1,70 @@
+/*********************************************************************/
+/* SimulcastParams.h                                                 */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares getting program parameters from command line.            */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef SIMULCASTPARAMS_18OCT26
+#define SIMULCASTPARAMS_18OCT26
+
+#include <string>
+
+#include "Picture.h"
+#include "WaveletTransform.h"
+#include "DataUnit.h"
+#include "DPX.h"
+#include "Colour.h"
+
+// Slice geometry and bit rate of one of the output streams
+struct StreamParams {
+  std::string fileName;
+  int ySize; // In units of 2**(wavelet depth)
+  int xSize; // In units of 2**(wavelet depth + horizontal only depth)
+  int compressedBytes; // Per frame
+  int slice_scalar; // HQ only (always 1 for LD)
+};
+
+struct ProgramParams {
+  std::string inFileName;
+  StreamParams ld; // The Low Delay stream
+  StreamParams hq; // The High Quality stream
+  bool verbose;
+  int height;
+  int width;
+  enum ColourFormat chromaFormat;
+  int bytes;
+  int lumaDepth;
+  int chromaDepth;
+  bool interlaced;
+  bool topFieldFirst;
+  enum WaveletKernel kernel;
+  int waveletDepth;
+  int waveletDepthHo;
+  bool y4mInput; // Picture format is read from the input header
+  bool dpxInput; // Input is a numbered sequence of DPX files
+  int readThreads; // For DPX input
+  enum ColourFormat inputFormat; // Of the input (chromaFormat is that coded)
+  enum ColourFormat codeAs; // UNKNOWN to code the input format
+  ColourMatrix matrix; // For coding R'G'B' input as Y'CbCr
+  FrameRate frame_rate;
+  int threads;
+  std::string error;
+};
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]);
+
+// Set the picture format (and frame rate, unless given on the command line)
+// from the header of Y4M input
+void setY4MFormat(ProgramParams& params, const Y4MHeader& header);
+
+// Set the picture format from the header of the first file of DPX input
+void setDPXFormat(ProgramParams& params, const dpx::Header& header);
+
+// Set the coded colour format (and matrix) once the input format is known,
+// checking any conversion of the input before coding (--codeAs) is supported
+void setCodedFormat(ProgramParams& params);
+
+#endif // SIMULCASTPARAMS_18OCT26
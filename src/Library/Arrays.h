@@ -125,6 +125,18 @@ namespace arrayio {
   // Set data to be right justified within the data word
   std::istream& right_justified(std::istream& stream);
 
+  // Set multi-byte words to be most significant byte first (the default)
+  std::ostream& big_endian(std::ostream& stream);
+
+  // Set multi-byte words to be most significant byte first (the default)
+  std::istream& big_endian(std::istream& stream);
+
+  // Set multi-byte words to be least significant byte first
+  std::ostream& little_endian(std::ostream& stream);
+
+  // Set multi-byte words to be least significant byte first
+  std::istream& little_endian(std::istream& stream);
+
   // Set data format to offset binary
   std::ostream& offset_binary(std::ostream& stream);
 
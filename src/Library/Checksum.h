@@ -0,0 +1,51 @@
+/*********************************************************************/
+/* Checksum.h                                                        */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares incremental MD5 and CRC32C checksums (in namespace       */
+/* checksum) for verifying decoded output without writing it out.    */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef CHECKSUM_18OCT26
+#define CHECKSUM_18OCT26
+
+#include <cstddef>
+#include <string>
+#include <boost/cstdint.hpp>
+
+namespace checksum {
+
+  // MD5 message digest (RFC 1321)
+  class MD5 {
+    public:
+      MD5();
+      void update(const char* data, std::size_t bytes);
+      // Lower case hex digest of all the data so far (more data may follow)
+      const std::string digest() const;
+    private:
+      void block(const unsigned char* data);
+      boost::uint32_t state[4];
+      boost::uint64_t length; // in bytes
+      unsigned char buffer[64];
+  };
+
+  // CRC-32C (Castagnoli polynomial, as used by iSCSI and ext4)
+  // Uses the SSE4.2 crc32 instruction when the processor supports it
+  class CRC32C {
+    public:
+      CRC32C(): crc(0xFFFFFFFF) {}
+      void update(const char* data, std::size_t bytes);
+      // Eight hex digits, most significant first (more data may follow)
+      const std::string digest() const;
+    private:
+      boost::uint32_t crc;
+  };
+
+  // True if CRC32C uses a hardware instruction rather than tables
+  const bool hardwareCRC32C();
+
+} // end namespace checksum
+
+#endif //CHECKSUM_18OCT26
@@ -0,0 +1,61 @@
+/*********************************************************************/
+/* Colour.h                                                          */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares colour conversion (R'G'B' to and from Y'CbCr) and chroma */
+/* resampling (4:4:4, 4:2:2 and 4:2:0) of whole pictures, so the     */
+/* encoders and decoders can code and output other colour formats    */
+/* than those of their input.                                        */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef COLOUR_18OCT26
+#define COLOUR_18OCT26
+
+#include <iostream>
+
+#include "Picture.h"
+
+// Y'CbCr colour matrices (MATRIX_UNKNOWN for no conversion)
+enum ColourMatrix {MATRIX_UNKNOWN, BT709, BT2020};
+
+std::ostream& operator<<(std::ostream& os, ColourMatrix matrix);
+
+std::istream& operator>>(std::istream& strm, ColourMatrix& matrix);
+
+// R'G'B' pictures are full range and use the VC-2 component order (G' in
+// the Y component, B' in C1 and R' in C2). Y'CbCr pictures are video
+// (narrow) range. Both have the same bit depth.
+// Chroma is subsampled horizontally with a [1 2 1]/4 filter, keeping
+// chroma co-sited with the even luma samples, and vertically (for 4:2:0)
+// by averaging pairs of lines, so chroma lies midway between them.
+// Interlaced pictures are resampled vertically within each field.
+// Upsampling uses linear interpolation with the same siting.
+// The rows of large pictures are converted in bands on threads of their
+// own. Each row is converted in a single pass (matrix and filters).
+
+// True if a picture may be converted, before coding, from one colour
+// format to another: R'G'B' to any Y'CbCr format, or Y'CbCr to a format
+// with less chroma resolution.
+const bool can_convert_for_coding(ColourFormat from, ColourFormat to);
+
+// True if a decoded picture may be converted, for output, from one colour
+// format to another: Y'CbCr to R'G'B', or to a format with more chroma
+// resolution.
+const bool can_convert_for_output(ColourFormat from, ColourFormat to);
+
+// Convert a picture for coding as the given colour format. The matrix is
+// only used for R'G'B' pictures. Throws std::invalid_argument if the
+// conversion isn't supported, or 4:2:0 is wanted from a picture without
+// an even number of lines (per field, if interlaced).
+const Picture convert_for_coding(const Picture& picture, ColourFormat format,
+                                 ColourMatrix matrix, int bitDepth, bool interlaced);
+
+// Convert a decoded picture for output as the given colour format. The
+// matrix is only used for R'G'B' output, which is clipped to range.
+// Throws std::invalid_argument if the conversion isn't supported.
+const Picture convert_for_output(const Picture& picture, ColourFormat format,
+                                 ColourMatrix matrix, int bitDepth, bool interlaced);
+
+#endif //COLOUR_18OCT26
@@ -0,0 +1,88 @@
+/*********************************************************************/
+/* DPX.h                                                             */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares reading of DPX (SMPTE 268M) image sequences, one file    */
+/* per frame, as RGB pictures. Files are read ahead, and unpacked,   */
+/* on a pool of threads.                                             */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef DPX_18OCT26
+#define DPX_18OCT26
+
+#include <string>
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+
+#include "Picture.h"
+#include "ThreadPool.h"
+
+namespace dpx {
+
+  // True if a file name ends ".dpx" (in either case)
+  const bool isDPXFileName(const std::string& fileName);
+
+  // The name of a file in a numbered sequence. The last run of digits in
+  // the name of the first file is increased by "index", keeping at least
+  // the same number of digits (e.g. "shot.000099.dpx", 2 -> "shot.000101.dpx").
+  // Returns an empty string if the first file name is not numbered (and
+  // so is a sequence of one file) and index is not 0.
+  const std::string sequenceFileName(const std::string& firstFile, int index);
+
+  // The image format of a DPX file. Only uncompressed RGB images, in a
+  // single image element stored top to bottom, are supported: 10 bit
+  // (filled to 32 bit words, method A or B), or 12 bit (filled to 16 bit
+  // words, method A or B) or 16 bit.
+  struct Header {
+    Header();
+    int height;
+    int width;
+    int bitDepth;
+    int packing; // 0 = packed, 1 = filled method A, 2 = filled method B
+    bool bigEndian;
+    long dataOffset; // bytes from the start of the file
+    long lineBytes; // including any end of line padding
+  };
+
+  // Reads and checks the header of a DPX file.
+  // Throws std::invalid_argument for unsupported files.
+  const Header readHeader(std::istream& stream);
+
+  // Reads a DPX image as an RGB picture, with offset binary samples made
+  // signed (as the other picture input formats). The VC-2 component order
+  // for RGB is used: G in the Y component, B in C1 and R in C2.
+  // Throws std::invalid_argument if the image can't be read or its format
+  // differs from "format" (e.g. that of the first file in a sequence).
+  const Picture readImage(const std::string& fileName, const Header& format);
+
+  // Reads a sequence of DPX files, in order, reading and unpacking up to
+  // two files per thread ahead of the caller.
+  class SequenceReader {
+    public:
+      // A thread count of zero (or less) means one thread per hardware thread.
+      // The header of the first file is read (and checked) by the constructor.
+      SequenceReader(const std::string& firstFile, int threads);
+      const Header& header() const;
+      // Gets the next picture of the sequence, returning false after the
+      // last file. Errors reading a file are rethrown here.
+      bool next(Picture& picture);
+    private:
+      struct Job;
+      typedef boost::shared_ptr<Job> JobPtr;
+      SequenceReader(const SequenceReader&); // Not copyable
+      SequenceReader& operator=(const SequenceReader&); // Not assignable
+      void readAhead();
+      const std::string firstFileName;
+      Header format;
+      std::deque<JobPtr> jobs; // Files being read, in sequence order
+      int nextIndex; // Of the next file to be read
+      bool finished; // No more files in the sequence
+      ThreadPool pool; // Last member, so destroyed (completing queued jobs) first
+  };
+
+} // end namespace dpx
+
+#endif //DPX_18OCT26
@@ -11,6 +11,7 @@
 #define DATAUNIT_17JUN15
 
 #include <iosfwd>
+#include <string>
 
 #include "Utils.h"
 #include "Picture.h"
@@ -33,6 +34,9 @@ class DataUnit {
 
     std::istream &stream();
     DataUnitType type;
+    unsigned long next_parse_offset;
+    unsigned long prev_parse_offset;
+    bool prefix_follows; // The next parse info prefix was found after this data unit
 
     friend std::istream& operator >> (std::istream& stream, DataUnit &d);
 
@@ -49,7 +53,9 @@ class WrappedPicture {
                    const int slices_y,
                    const int slice_prefix,
                    const int slice_size_scalar,
-                   const Slices &slices);
+                   const Slices &slices,
+                   const int depth_ho=0,
+                   const Array1D &quant_matrix=Array1D());
 
     WrappedPicture(const unsigned long picture_number,
                    const WaveletKernel wavelet_kernel,
@@ -57,7 +63,21 @@ class WrappedPicture {
                    const int slices_x,
                    const int slices_y,
                    const utils::Rational slice_bytes,
-                   const Slices &slices);
+                   const Slices &slices,
+                   const int depth_ho=0,
+                   const Array1D &quant_matrix=Array1D());
+
+    // HQ picture whose slices have already been written (in order) to a string
+    WrappedPicture(const unsigned long picture_number,
+                   const WaveletKernel wavelet_kernel,
+                   const int depth,
+                   const int slices_x,
+                   const int slices_y,
+                   const int slice_prefix,
+                   const int slice_size_scalar,
+                   const std::string &coded_slices,
+                   const int depth_ho=0,
+                   const Array1D &quant_matrix=Array1D());
     unsigned long picture_number;
     WaveletKernel wavelet_kernel;
     int depth;
@@ -67,6 +87,9 @@ class WrappedPicture {
     int slice_size_scalar;
     utils::Rational slice_bytes;
     Slices slices;
+    std::string coded_slices;
+    int depth_ho; // Horizontal only wavelet levels (requires major version 3)
+    Array1D quant_matrix; // Custom quantisation matrix (empty for the default)
 };
 
 enum FrameRate { FR0, FR24000_1001, FR24, FR25, FR30000_1001, FR30, FR50, FR60000_1001, FR60, FR15000_1001, FR25_2, FR48 };
@@ -108,6 +131,8 @@ class PicturePreamble {
   int slice_prefix;
   int slice_size_scalar;
   utils::Rational slice_bytes;
+  int depth_ho;
+  Array1D quant_matrix; // Empty unless a custom quantisation matrix was signalled
 };
 
 namespace dataunitio {
@@ -120,8 +145,23 @@ namespace dataunitio {
 
   std::ostream& start_sequence(std::ostream& stream);
   std::ostream& end_sequence(std::ostream& stream);
+
+  // Format manipulator to set the major version of the stream syntax.
+  // Picture headers contain extended transform parameters (for asymmetric
+  // transforms) from major version 3. Writing a sequence header sets this.
+  class majorVersion {
+    public:
+      majorVersion(const int v): version(v) {};
+      void operator () (std::ios_base& stream) const;
+    private:
+      const int version;
+  };
 };
 
+std::ostream& operator << (std::ostream& stream, dataunitio::majorVersion arg);
+
+std::istream& operator >> (std::istream& stream, dataunitio::majorVersion arg);
+
 std::ostream& operator << (std::ostream& stream, const WrappedPicture& d);
 
 std::ostream& operator << (std::ostream& stream, const SequenceHeader& s);
@@ -130,6 +170,12 @@ std::ostream& operator << (std::ostream& stream, const DataUnitType& t);
 
 std::ostream& operator << (std::ostream& stream, const FrameRate& t);
 
+// Returns the number of frames per second as a rational number (0/1 if unknown)
+const utils::Rational frames_per_second(const FrameRate rate);
+
+// Returns the frame rate with a given number of frames per second (FR0 if none)
+const FrameRate frame_rate(int numerator, int denominator);
+
 std::istream& operator >> (std::istream& stream, DataUnit &d);
 
 std::istream& operator >> (std::istream& stream, SequenceHeader &hdr);
@@ -0,0 +1,134 @@
+/*********************************************************************/
+/* Metrics.h                                                         */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares live metrics (in namespace metrics) for long running     */
+/* encodes and decodes. Counters and gauges are updated without      */
+/* locking, and a thread of their own periodically rewrites them to  */
+/* a text file in Prometheus exposition format.                      */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef METRICS_18OCT26
+#define METRICS_18OCT26
+
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "Timing.h"
+
+namespace metrics {
+
+  // A count that only goes up (e.g. frames or bytes)
+  class Counter {
+    public:
+      Counter(): total(0) {}
+      void add(long long n = 1) {total.fetch_add(n, boost::memory_order_relaxed);}
+      const long long value() const {return total.load(boost::memory_order_relaxed);}
+    private:
+      boost::atomic<long long> total;
+  };
+
+  // A value that may go up or down (e.g. a queue depth, or the mean
+  // quantisation index of the last frame)
+  class Gauge {
+    public:
+      Gauge(): bits(0) {}
+      void set(double x);
+      const double value() const;
+    private:
+      boost::atomic<boost::uint64_t> bits; // Of a double
+  };
+
+  // The total time spent in a stage of processing, in seconds
+  class Timer {
+    public:
+      Timer(): nanoseconds(0) {}
+      void add(double seconds) {
+        nanoseconds.fetch_add(static_cast<long long>(1e9*seconds), boost::memory_order_relaxed);
+      }
+      const double value() const {return 1e-9*nanoseconds.load(boost::memory_order_relaxed);}
+    private:
+      boost::atomic<long long> nanoseconds;
+  };
+
+  // Adds the time from its construction to its destruction to a timer,
+  // unless the timer is null (e.g. when metrics are not exported)
+  class ScopedTimer {
+    public:
+      explicit ScopedTimer(Timer* timer): timer(timer), start(timer ? timing::now() : 0.0) {}
+      ~ScopedTimer() {if (timer) timer->add(timing::now()-start);}
+    private:
+      Timer* const timer;
+      const double start;
+  };
+
+  // Add the time since start to a timer, then restart from now (as
+  // timing::lap, for successive stages of a process)
+  void lap(Timer& timer, double& start);
+
+  // A stream buffer that counts the bytes written through it to another
+  // buffer (e.g. to count the bytes of an output file)
+  class CountingBuffer: public std::streambuf {
+    public:
+      CountingBuffer(std::streambuf* target, Counter& bytes);
+    protected:
+      virtual int_type overflow(int_type c);
+      virtual std::streamsize xsputn(const char* s, std::streamsize n);
+      virtual int sync();
+    private:
+      std::streambuf* const target;
+      Counter& bytes;
+  };
+
+  // Writes metrics to a file every "interval" seconds, replacing the file
+  // each time so readers (e.g. a Prometheus node exporter) never see a
+  // partial file. Metrics are added, before start, by name (and optional
+  // labels, e.g. "stage=\"transform\""), and must outlive the exporter.
+  // Metrics of the same name should be added one after another.
+  class Exporter {
+    public:
+      Exporter(const std::string& fileName, double interval);
+      // Stops the exporter, writing the file a last time
+      ~Exporter();
+      void add(const std::string& name, const std::string& help,
+               const Counter& counter, const std::string& labels = "");
+      void add(const std::string& name, const std::string& help,
+               const Gauge& gauge, const std::string& labels = "");
+      // Exposed as a counter of seconds
+      void add(const std::string& name, const std::string& help,
+               const Timer& timer, const std::string& labels = "");
+      // Exposes the rate (per second) of a counter over the last interval,
+      // and its average since start, as gauges "name" and "name_average"
+      void addRate(const std::string& name, const std::string& help,
+                   const Counter& counter);
+      // Starts writing the file (on a thread of its own)
+      void start();
+    private:
+      Exporter(const Exporter&); // Not copyable
+      Exporter& operator=(const Exporter&); // Not assignable
+      struct Metric;
+      void run();
+      const bool write(); // False on failure
+      const std::string fileName;
+      const double interval;
+      std::vector<Metric> entries;
+      double startTime;
+      double lastTime; // Of the last write
+      boost::mutex mutex;
+      boost::condition_variable stopped;
+      bool stopping;
+      boost::thread writer;
+  };
+
+} // end namespace metrics
+
+#endif //METRICS_18OCT26
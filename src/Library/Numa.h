@@ -0,0 +1,49 @@
+/*********************************************************************/
+/* Numa.h                                                            */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares NUMA (non uniform memory access) placement functions.    */
+/* On machines with several memory nodes these let threads and       */
+/* picture buffers be kept on the same node. Where NUMA is not       */
+/* supported (or there is only one node) they have no effect.        */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef NUMA_18OCT26
+#define NUMA_18OCT26
+
+#include <cstddef>
+
+#include "Arrays.h"
+#include "Picture.h"
+
+namespace numa {
+
+  // Number of memory nodes (1 if NUMA is not supported)
+  int nodes();
+
+  // Node on which the calling thread is currently running
+  int current_node();
+
+  // Restrict the calling thread to the CPUs of a node
+  void run_on_node(int node);
+
+  // Move the (whole) pages of a region of memory to a node. Pages not yet
+  // touched are allocated on that node when first used.
+  void place(const void* start, std::size_t bytes, int node);
+  void place(const Array2D& array, int node);
+  void place(const Picture& picture, int node);
+
+  // Count the (whole) pages of a region of memory that are on, and not on, a node
+  struct PageCount {
+    PageCount(): local(0), remote(0) {};
+    long local;
+    long remote;
+  };
+  const PageCount count_pages(const void* start, std::size_t bytes, int node);
+  const PageCount count_pages(const Array2D& array, int node);
+
+} // end namespace numa
+
+#endif //NUMA_18OCT26
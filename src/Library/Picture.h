@@ -11,6 +11,9 @@
 #define PICTURE_3MAY11
 
 #include <iosfwd>
+#include <string>
+
+#include <boost/function.hpp>
 
 #include "Arrays.h"
 
@@ -50,6 +53,10 @@ class PictureFormat {
     ColourFormat uvFormat;
 };
 
+// The format of a picture without its chroma samples, e.g. when only luma
+// is decoded. Picture processing functions skip the (empty) chroma components.
+const PictureFormat luma_only_format(const PictureFormat& format);
+
 class Picture {
 public:
   Picture();  //Needed for arrays of pictures. Picture can be set by assignment (only)
@@ -78,6 +85,31 @@ const PictureArray split_into_blocks(const Picture& picture, int ySlices, int xS
 
 const Picture merge_blocks(const PictureArray& blocks);
 
+// The components of a picture are independent so may be processed concurrently.
+// This constructs a picture, of the given format, from the results of three
+// functions, one per component. For large pictures the chroma components are
+// computed in threads of their own while luma is computed in the calling thread.
+// Small pictures (e.g. slices) are processed serially because starting threads
+// would cost more than it saves. Only luma is computed for luma only formats.
+// Exceptions are passed on to the caller.
+typedef boost::function<const Array2D ()> ComponentFunction;
+const Picture concurrent_components(const PictureFormat& format,
+                                    const ComponentFunction& luma,
+                                    const ComponentFunction& chroma1,
+                                    const ComponentFunction& chroma2);
+
+// While a SerialComponents exists concurrent_components computes components
+// serially in its thread. For threads which are already one of a pool of
+// workers, where extra threads would oversubscribe the processors.
+class SerialComponents {
+  public:
+    SerialComponents();
+    ~SerialComponents();
+  private:
+    SerialComponents(const SerialComponents&); // Not copyable
+    SerialComponents& operator=(const SerialComponents&); // Not assignable
+};
+
 // Clip a Picture to specified limits
 // First function clips all components to the same values (good for RGB)
 const Picture clip(const Picture& picture, const int min_value, const int max_value);
@@ -103,6 +135,25 @@ namespace pictureio {
 
   using arrayio::ioFormat;
 
+  using arrayio::big_endian;
+  using arrayio::little_endian;
+
+  // Read or write pictures as the frames of a Y4M (YUV4MPEG2) file. Each
+  // picture follows a FRAME line and its samples are little endian and
+  // right justified, in one byte for bit depths up to 8 and two bytes
+  // otherwise. This overrides (and resets) the word width, justification
+  // and byte order set on the stream; set the bit depths and offset binary
+  // format as for planar files.
+  std::ostream& y4m(std::ostream& stream);
+  std::istream& y4m(std::istream& stream);
+
+  // Read or write pictures as headerless planar data (the default)
+  std::ostream& planar(std::ostream& stream);
+  std::istream& planar(std::istream& stream);
+
+  // True if a file name ends with ".y4m", so is assumed to be a Y4M file
+  const bool isY4MFileName(const std::string& fileName);
+
   // Use to set data format as an alternative to manipulators above or
   // use for different data formats for luma and chroma
   class format {
@@ -158,5 +209,33 @@ std::istream& operator >> (std::istream& stream, pictureio::offset);
 std::istream& operator >> (std::istream& stream, Picture& array);
 
 std::ostream& operator << (std::ostream& stream, const Picture& array);
+
+//**** Y4M (YUV4MPEG2) file header ****//
+
+// The picture format at the start of a Y4M file. Y4M has no RGB, so
+// chroma format is 4:4:4, 4:2:2 or 4:2:0. Frame rate is unknown if
+// rateNumerator is zero (and is then not written).
+struct Y4MHeader {
+  Y4MHeader();
+  Y4MHeader(const PictureFormat& format, int bitDepth, bool interlaced,
+            bool topFieldFirst, int rateNumerator=0, int rateDenominator=1);
+  const PictureFormat format() const;
+  int height;
+  int width;
+  ColourFormat chromaFormat;
+  int bitDepth; // Same for luma and chroma
+  bool interlaced;
+  bool topFieldFirst;
+  int rateNumerator;
+  int rateDenominator;
+};
+
+// Read a Y4M file header. Throws std::invalid_argument if the stream is
+// not Y4M, or uses a feature without a VC-2 equivalent (such as mono or
+// mixed interlace). Sets failbit if the stream ends first.
+std::istream& operator >> (std::istream& stream, Y4MHeader& header);
+
+// Write a Y4M file header (throws std::invalid_argument for RGB)
+std::ostream& operator << (std::ostream& stream, const Y4MHeader& header);
   
 #endif //PICTURE_3MAY11
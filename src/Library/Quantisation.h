@@ -10,6 +10,8 @@
 #ifndef QUANTISATION_14MAY10
 #define QUANTISATION_14MAY10
 
+#include <vector>
+
 #include "Arrays.h"
 #include "Picture.h"
 
@@ -19,6 +21,11 @@ const Array1D adjust_quant_indices(const Array1D& qIndices, const int qMatrix);
 
 const Array2D adjust_quant_indices(const Array2D& qIndices, const int qMatrix);
 
+// True if every quantiser is index 0 (the identity) once adjusted by the
+// quantisation matrix, i.e. for lossless coding. Quantisation and inverse
+// quantisation are then skipped.
+const bool identity_quantisers(const Array2D& qIndices, const Array1D& qMatrix);
+
 // Quantise according to parameter q
 const int quant(int value, int q);
 
@@ -45,6 +52,9 @@ const Array2D inverse_quantise_block(const ConstView2D& block, int q);
 // latter case this function will inverse quantise codeblocks
 const Array2D inverse_quantise_block(const ConstView2D& block, const Array2D& qIndices);
 
+// In the following waveletDepthHo is the number of horizontal only wavelet
+// levels in the transform (see WaveletTransform.h).
+
 /***** Predictive Quantisation for Simple, Main and Low Delay Profiles *****/
 
 // Predict LL subband coefficient, at position [y][x],
@@ -54,63 +64,92 @@ const int predictDC(const Array2D& llSubband, int y, int x);
 // Quantise in-place transformed coefficients (using LL subband prediction)
 const Array2D quantise_transform(const Array2D& coefficients,
                                  const Array2D& qIndices,
-                                 const Array1D& qMatrix);
+                                 const Array1D& qMatrix,
+                                 const int waveletDepthHo=0);
 
 // Inverse quantise in-place transformed coefficients (using LL subband prediction)
 const Array2D inverse_quantise_transform(const Array2D& qCoeffs,
                                          const Array2D& qIndices,
-                                         const Array1D& qMatrix);
+                                         const Array1D& qMatrix,
+                                         const int waveletDepthHo=0);
 
 /***** Non-predictive Quantisation for High Quality Profile *****/
 
 // Quantise in-place transformed coefficients (without LL subband prediction)
 const Array2D quantise_transform_np(const Array2D& coefficients,
                                     const int qIndex,
-                                    const Array1D& qMatrix);
+                                    const Array1D& qMatrix,
+                                    const int waveletDepthHo=0);
 
 const Array2D quantise_transform_np(const Array2D& coefficients,
                                     const Array2D& qIndices,
-                                    const Array1D& qMatrix);
+                                    const Array1D& qMatrix,
+                                    const int waveletDepthHo=0);
 
 // Inverse quantise in-place transformed coefficients (without LL subband prediction)
 const Array2D inverse_quantise_transform_np(const Array2D& qCoeffs,
                                              const Array2D& qIndices,
-                                             const Array1D& qMatrix);
+                                             const Array1D& qMatrix,
+                                             const int waveletDepthHo=0);
 
 // Quantise in-place transformed coefficients (using LL subband prediction)
 const Picture quantise_transform(const Picture& coefficients,
                                  const int qIndex,
-                                 const Array1D& qMatrix);
+                                 const Array1D& qMatrix,
+                                 const int waveletDepthHo=0);
 
 const Picture quantise_transform(const Picture& coefficients,
                                  const Array2D& qIndices,
-                                 const Array1D& qMatrix);
+                                 const Array1D& qMatrix,
+                                 const int waveletDepthHo=0);
 
 // Inverse quantise in-place transformed coefficients (using LL subband prediction)
 const Picture inverse_quantise_transform(const Picture& qCoeffs,
                                          const int qIndex,
-                                         const Array1D& qMatrix);
+                                         const Array1D& qMatrix,
+                                         const int waveletDepthHo=0);
 
 const Picture inverse_quantise_transform(const Picture& qCoeffs,
                                          const Array2D& qIndices,
-                                         const Array1D& qMatrix);
+                                         const Array1D& qMatrix,
+                                         const int waveletDepthHo=0);
 
 // Quantise in-place transformed coefficients (without LL subband prediction)
 const Picture quantise_transform_np(const Picture& coefficients,
                                     const int qIndex,
-                                    const Array1D& qMatrix);
+                                    const Array1D& qMatrix,
+                                    const int waveletDepthHo=0);
 
 const Picture quantise_transform_np(const Picture& coefficients,
                                     const Array2D& qIndices,
-                                    const Array1D& qMatrix);
+                                    const Array1D& qMatrix,
+                                    const int waveletDepthHo=0);
 
 // Inverse quantise in-place transformed coefficients (without LL subband prediction)
 const Picture inverse_quantise_transform_np(const Picture& qCoeffs,
                                             const int qIndex,
-                                            const Array1D& qMatrix);
+                                            const Array1D& qMatrix,
+                                            const int waveletDepthHo=0);
 
 const Picture inverse_quantise_transform_np(const Picture& qCoeffs,
                                             const Array2D& qIndices,
-                                            const Array1D& qMatrix);
+                                            const Array1D& qMatrix,
+                                            const int waveletDepthHo=0);
+
+/***** Distortion estimate (without decoding) *****/
+
+// Estimate the mean square error, per picture sample, of quantising an
+// in-place transform (without LL subband prediction) as slices, without
+// inverse quantising or inverse transforming it. The error of each
+// coefficient (its value less its inverse quantised value) is squared and
+// weighted by the squared synthesis gain of its subband (see subband_gains).
+// Errors from rounding in the inverse transform, and from clipping, are
+// ignored, so this is an estimate of the error of the decoded picture.
+const double quantisation_error_np(const Array2D& coefficients,
+                                   const Array2D& qCoeffs,
+                                   const Array2D& qIndices,
+                                   const Array1D& qMatrix,
+                                   const std::vector<float>& gains,
+                                   const int waveletDepthHo=0);
 
 #endif //QUANTISATION_14MAY10
@@ -0,0 +1,98 @@
+/*********************************************************************/
+/* Ranges.h                                                          */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares the ranges of values taken by wavelet coefficients, and  */
+/* the intermediate values of each lifting step, in each level of    */
+/* the transform of a component. Used to find whether coefficients   */
+/* can be stored, or filtered, in 16 bit integers.                   */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef RANGES_18OCT26
+#define RANGES_18OCT26
+
+#include <iostream>
+#include <vector>
+
+#include "Arrays.h"
+
+// The range of values taken by a quantity (initially empty)
+class ValueRange {
+  public:
+    ValueRange();
+    ValueRange(long long min, long long max);
+    void add(long long value);
+    void add(const ValueRange& range);
+    const bool empty() const;
+    const long long min() const;
+    const long long max() const;
+    // Bits of a two's complement integer holding the range
+    const int bits() const;
+    const bool fitsInt16() const;
+  private:
+    long long lo;
+    long long hi;
+};
+
+// Writes "[min, max] bits" (or "-" if empty)
+std::ostream& operator<<(std::ostream& os, const ValueRange& range);
+
+// Ranges of a lifting step: the filtered value (the weighted sum of the
+// taps, before it is shifted and added to or subtracted from the target
+// samples), and the lifted (target) samples
+struct StepRanges {
+  ValueRange filter;
+  ValueRange samples;
+};
+
+// Ranges of one level of a forward or inverse transform. Steps are in the
+// order applied (horizontal then vertical for the forward transform, and
+// the reverse for the inverse). Horizontal only levels have no vertical
+// steps. The input of a forward level includes its accuracy bits, as does
+// the input of an inverse level.
+struct LevelRanges {
+  ValueRange input;
+  std::vector<StepRanges> horizontal;
+  std::vector<StepRanges> vertical;
+  ValueRange output;
+  void add(const LevelRanges& level);
+};
+
+// Ranges in the transform of one component. Levels are in the order they
+// are applied, i.e. the forward transform from the finest 2D level to the
+// horizontal only levels, the inverse from the horizontal only levels to
+// the finest 2D level. Subbands are in the order they are coded (as
+// subband_indices and quantMatrix).
+struct TransformRanges {
+  TransformRanges();
+  TransformRanges(int depth, int depthHo);
+  int depth;
+  int depthHo;
+  std::vector<LevelRanges> forward;
+  std::vector<LevelRanges> inverse;
+  std::vector<ValueRange> subbands; // Transform coefficients
+  std::vector<ValueRange> quantised; // Quantised coefficients
+  // Merge the ranges of another transform of the same depths
+  void add(const TransformRanges& ranges);
+  // Add the ranges of the subbands of an in place transform (e.g. the
+  // result of waveletTransform), or of its quantised coefficients
+  void addSubbands(const Array2D& transform);
+  void addQuantised(const Array2D& quantised);
+};
+
+// True if all the samples and coefficients (not the filtered values) fit
+// in 16 bit integers, i.e. could be stored as int16
+const bool int16Storage(const TransformRanges& ranges);
+
+// True if the filtered values also fit in 16 bit integers, i.e. the
+// lifting could be computed in 16 bit (e.g. SIMD) arithmetic
+const bool int16Lanes(const TransformRanges& ranges);
+
+// Write a report of the ranges of a component, beside their worst case
+// bounds (if not null, e.g. from transformBounds)
+void reportRanges(std::ostream& os, const TransformRanges& measured,
+                  const TransformRanges* bounds);
+
+#endif //RANGES_18OCT26
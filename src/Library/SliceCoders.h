@@ -0,0 +1,45 @@
+/*********************************************************************/
+/* SliceCoders.h                                                     */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares functions to code the coefficients of one component of a */
+/* slice, in subband order, directly from an in place transform.     */
+/* Common slice geometries use coders specialised at compile time,   */
+/* other geometries use a generic coder.                             */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef SLICECODERS_18OCT26
+#define SLICECODERS_18OCT26
+
+#include <iostream>
+
+#include "Arrays.h"
+
+namespace slicecoder {
+
+  // Write the coefficients of a component slice as signed VLCs in subband order
+  void write(std::ostream& stream, const Array2D& slice, int depth, int depthHo);
+
+  // Write two (chroma) component slices, interleaved coefficient by coefficient
+  void write(std::ostream& stream, const Array2D& u, const Array2D& v, int depth, int depthHo);
+
+  // Read the coefficients of a component slice (which must already have the right shape)
+  void read(std::istream& stream, Array2D& slice, int depth, int depthHo);
+
+  // Read two interleaved (chroma) component slices
+  void read(std::istream& stream, Array2D& u, Array2D& v, int depth, int depthHo);
+
+  // Number of bits needed to code a component slice, excluding trailing zeros
+  const int bits(const Array2D& slice, int depth, int depthHo);
+
+  // Number of bits needed to code two interleaved component slices, excluding trailing zeros
+  const int bits(const Array2D& u, const Array2D& v, int depth, int depthHo);
+
+  // True if there is a compile time specialised coder for the slice geometry
+  const bool specialised(int height, int width, int depth, int depthHo);
+
+} // end namespace slicecoder
+
+#endif //SLICECODERS_18OCT26
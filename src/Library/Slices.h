@@ -13,6 +13,7 @@
 
 #include "Arrays.h"
 #include "Picture.h"
+#include "Timing.h"
 
 // This slice_bytes returns the actual number of bytes for a slice at specific co-ordinates
 const int slice_bytes(int v, int h, // Slice co-ordinates
@@ -23,20 +24,22 @@ const int slice_bytes(int v, int h, // Slice co-ordinates
 const Array2D slice_bytes(const int ySlices, const int xSlices, const int totalBytes, const int scalar);
 
 // luma_slice_bits returns the number of bits in an LD luma slice after VLC coding
-const int luma_slice_bits(const Array2D& lumaSlice, const char waveletDepth);
+const int luma_slice_bits(const Array2D& lumaSlice, const char waveletDepth, const char waveletDepthHo=0);
 
 // chroma_slice_bits returns the number of bits in an LD luma slice after VLC coding
-const int chroma_slice_bits(const Array2D& uSlice, const Array2D& vSlice, const char waveletDepth);
+const int chroma_slice_bits(const Array2D& uSlice, const Array2D& vSlice, const char waveletDepth, const char waveletDepthHo=0);
 
 // Returns the number of bytes in a component HQ slice after VLC coding (no DC prediction)
-const int component_slice_bytes(const Array2D& componentSlice, const char waveletDepth, const int scalar);
+const int component_slice_bytes(const Array2D& componentSlice, const char waveletDepth, const int scalar,
+                                const char waveletDepthHo=0);
 
 // Define a state machine for quantising slices
 class SliceQuantiser {
   public:
     SliceQuantiser(const Array2D& coefficients,
                    int vSlices, int hSlices,
-                   const Array1D& quantMatrix);
+                   const Array1D& quantMatrix,
+                   int depthHo=0);
     const int row() const {return v;} //Get row number for slice
     const int column() const {return h;} //Get column number for slice
     const bool next_slice(); //Go to next slice in raster order (returns false if no more slices)
@@ -50,8 +53,10 @@ class SliceQuantiser {
     const int sliceHeight;
     const int sliceWidth;
     const int numberOfSubbands;
+    const int waveletDepthHo; // Number of horizontal only levels
     const int waveletDepth;
     const int transformSize; // 2**waveletDepth
+    const int transformWidth; // 2**(waveletDepth+waveletDepthHo)
     int v; //Current row
     int h; //Current column
     Array2D qSlice; // Slice array of quantised coeffs to be returned by "quantise_slice"
@@ -63,11 +68,13 @@ class SliceQuantiser {
 //**** Slice IO declarations ****//
 
 struct Slices { 
-    Slices(const PictureArray& yuvSlices, const int waveletDepth, const Array2D& qIndices);
+    Slices(const PictureArray& yuvSlices, const int waveletDepth, const Array2D& qIndices,
+           const int waveletDepthHo=0);
     Slices(const PictureFormat& pictureFormat, int waveletDepth,
-           int ySlices, int xSlices);
+           int ySlices, int xSlices, int waveletDepthHo=0);
     PictureArray yuvSlices;
     const int waveletDepth;
+    const int waveletDepthHo; // Number of horizontal only wavelet levels
     Array2D qIndices;
 };
 
@@ -105,6 +112,16 @@ namespace sliceio {
     private:
       const int scalar;
   };
+
+  // Record the time taken to code each slice (in raster order) when Slices
+  // are written or read. Times are appended to the samples given.
+  class timeSlices {
+    public:
+      timeSlices(timing::Samples& t): times(t) {};
+      void operator () (std::ios_base& stream) const;
+    private:
+      timing::Samples& times;
+  };
 } // end namespace sliceio
 
 // ostream low delay format manipulator
@@ -125,4 +142,10 @@ std::ostream& operator << (std::ostream& stream, sliceio::highQualityVBR arg);
 // istream low delay format manipulator
 std::istream& operator >> (std::istream& stream, sliceio::highQualityVBR arg);
 
+// ostream slice timing manipulator
+std::ostream& operator << (std::ostream& stream, sliceio::timeSlices arg);
+
+// istream slice timing manipulator
+std::istream& operator >> (std::istream& stream, sliceio::timeSlices arg);
+
 #endif //SLICES_24JUNE11
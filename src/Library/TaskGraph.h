@@ -0,0 +1,89 @@
+/*********************************************************************/
+/* TaskGraph.h                                                       */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares a dependency driven task scheduler.                      */
+/* Each task runs once all the tasks it depends on have finished,    */
+/* on a fixed set of worker threads. Each worker prefers tasks it    */
+/* made ready itself (which are likely still in its cache) and       */
+/* steals from other workers when it has none of its own.            */
+/* Workers may be grouped (e.g. by NUMA node) and tasks given a      */
+/* preferred group, in which case they are queued for that group     */
+/* and workers steal from their own group first.                     */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef TASKGRAPH_18OCT26
+#define TASKGRAPH_18OCT26
+
+#include <vector>
+#include <deque>
+#include <map>
+
+#include <boost/function.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+class TaskGraph {
+  public:
+    typedef boost::function<void ()> Work;
+    typedef long Task;
+    typedef std::vector<Task> Tasks;
+    typedef boost::function<void (int group)> Start;
+    // A thread count of zero (or less) means one thread per hardware thread
+    explicit TaskGraph(int threads = 0);
+    // Workers divided into groups (at most one per thread). Each worker calls
+    // "start", with its group, before running any tasks (e.g. to bind itself
+    // to the CPUs of a NUMA node).
+    TaskGraph(int threads, int groups, const Start& start);
+    // Completes all outstanding tasks before joining the worker threads
+    ~TaskGraph();
+    // Adds a task which may run as soon as its predecessors have finished.
+    // Tasks may be added at any time, including by other tasks.
+    const Task add(const Work& work);
+    const Task add(const Work& work, const Task predecessor);
+    const Task add(const Work& work, const Tasks& predecessors);
+    // Adds a task preferring the workers of a group (-1 for no preference)
+    const Task add(const Work& work, const Tasks& predecessors, const int group);
+    // Block until a task (or all tasks added so far) has finished.
+    // If any task throws the remaining tasks are skipped (but still count
+    // as finished) and every subsequent wait rethrows the first exception.
+    void wait(const Task task);
+    void wait();
+    int size() const;
+    int groups() const;
+  private:
+    TaskGraph(const TaskGraph&); // Not copyable
+    TaskGraph& operator=(const TaskGraph&); // Not assignable
+    struct Node {
+      Work work;
+      int pending; // Number of unfinished predecessors
+      int group; // Preferred group of workers
+      Tasks successors;
+    };
+    void initialise(const Start& start);
+    void worker(const int id, const Start start);
+    bool take(const int id, Task& task);
+    void queue(const Task task, const int group, const int worker);
+    void finish(const Task task, const int id);
+    boost::thread_group workers;
+    std::map<Task, Node> nodes; // Unfinished tasks only
+    std::vector<std::deque<Task> > ready; // Ready tasks, one queue per worker
+    std::vector<int> workerGroup; // Group of each worker
+    std::vector<std::vector<int> > groupWorkers; // Workers in each group
+    std::vector<int> nextWorker; // Next worker in each group for tasks added externally
+    boost::mutex mutex;
+    boost::condition_variable workReady;
+    boost::condition_variable taskFinished;
+    boost::exception_ptr error;
+    int threadCount;
+    int groupCount;
+    Task nextTask;
+    int nextQueue;
+    bool stopping;
+};
+
+#endif //TASKGRAPH_18OCT26
@@ -0,0 +1,68 @@
+/*********************************************************************/
+/* ThreadPool.h                                                      */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares a fixed size pool of worker threads.                     */
+/* Tasks are queued and run, in the order submitted, by the first    */
+/* idle worker. Used where independent jobs (e.g. whole encodes)     */
+/* are to share a bounded number of threads. Tasks may be given a    */
+/* deadline, in which case they run earliest deadline first, before  */
+/* any tasks without one.                                            */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef THREADPOOL_18OCT26
+#define THREADPOOL_18OCT26
+
+#include <queue>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+class ThreadPool {
+  public:
+    typedef boost::function<void ()> Task;
+    // A thread count of zero (or less) means one thread per hardware thread
+    explicit ThreadPool(int threads = 0);
+    // Completes any queued tasks before joining the worker threads
+    ~ThreadPool();
+    // Tasks should handle their own errors. Any exception escaping a task
+    // is reported to standard error and discarded.
+    void submit(const Task& task);
+    // Tasks with equal deadlines (e.g. timing::now() values) run in the
+    // order submitted. Tasks may submit further tasks.
+    void submit(const Task& task, double deadline);
+    // Blocks until every task submitted so far has completed
+    void wait();
+    int size() const;
+  private:
+    ThreadPool(const ThreadPool&); // Not copyable
+    ThreadPool& operator=(const ThreadPool&); // Not assignable
+    void worker();
+    struct Queued {
+      Task task;
+      double deadline;
+      long number; // In order of submission
+    };
+    // Orders the queue so its top is the earliest deadline, then the first submitted
+    struct Later {
+      bool operator()(const Queued& a, const Queued& b) const {
+        return (a.deadline!=b.deadline) ? (a.deadline>b.deadline) : (a.number>b.number);
+      }
+    };
+    boost::thread_group workers;
+    std::priority_queue<Queued, std::vector<Queued>, Later> tasks;
+    boost::mutex mutex;
+    boost::condition_variable taskReady;
+    boost::condition_variable idle;
+    int threadCount;
+    long submitted;
+    int busy;
+    bool stopping;
+};
+
+#endif //THREADPOOL_18OCT26
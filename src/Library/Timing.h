@@ -0,0 +1,51 @@
+/*********************************************************************/
+/* Timing.h                                                          */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares a monotonic clock and a collection of timing samples     */
+/* (in namespace timing) for reporting worst case and percentile     */
+/* processing times.                                                 */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef TIMING_18OCT26
+#define TIMING_18OCT26
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace timing {
+
+  // Seconds since an arbitrary fixed time, from a clock that never goes back
+  const double now();
+
+  // A sequence of times (in seconds), in the order they were measured
+  class Samples {
+    public:
+      void add(double seconds) {samples.push_back(seconds);}
+      const int count() const {return samples.size();}
+      const double operator[](int i) const {return samples[i];}
+      const int worst() const; // Index of the longest time (-1 if none)
+      const double mean() const;
+      // Time not exceeded by a proportion p (0 to 1) of the samples
+      const double percentile(double p) const;
+      // Number of samples longer than a deadline
+      const int late(double deadline) const;
+    private:
+      std::vector<double> samples;
+  };
+
+  // Add the time since start to samples, then restart from now (for timing
+  // successive stages of a process)
+  void lap(Samples& samples, double& start);
+
+  // Write a one line summary: count, mean, 50%, 90%, 99%, 99.9% and maximum,
+  // in units of 1/scale seconds (e.g. scale 1000 for milliseconds)
+  void summarise(std::ostream& stream, const std::string& label,
+                 const Samples& samples, double scale, const std::string& units);
+
+} // end namespace timing
+
+#endif //TIMING_18OCT26
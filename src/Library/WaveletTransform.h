@@ -11,8 +11,10 @@
 #define WAVELETTRANSFORM_1MARCH10
 
 #include <iosfwd>
+#include <vector>
 #include "Arrays.h"
 #include "Picture.h"
+#include "Ranges.h"
 
 // Define enumeration for different ypes of wavelet kernel
 // Kernels are: Deslauriers-Dubuc (9,7)
@@ -30,36 +32,102 @@ std::ostream& operator<<(std::ostream& os, WaveletKernel kernel);
 std::istream& operator>>(std::istream& strm, WaveletKernel& kernel);
 
 // Return the size of a padded array given image size and wavelet depth.
+// (Widths of asymmetric transforms are padded for depth+depthHo levels.)
 const int paddedSize(int size, int depth);
 
+// Asymmetric transforms (VC-2 version 3) follow the "depth" 2D levels with
+// "depthHo" extra horizontal only levels, applied to the lowest frequencies.
+// The subbands are then, in order, the L ("DC") subband, an H subband for
+// each horizontal only level, then HL, LH & HH for each 2D level.
+// With depthHo==0 this is the usual transform, with an LL ("DC") subband.
+
 //Forward wavelet transform, including padding if necessary
-const Array2D waveletTransform(const Array2D& picture, WaveletKernel kernel, int depth);
+const Array2D waveletTransform(const Array2D& picture, WaveletKernel kernel, int depth, int depthHo=0);
 
 //Inverse wavelet transform, removes padding if necessary.
 // "shape" give size of unpadded image
 const Array2D inverseWaveletTransform(const Array2D& transform,
                                       WaveletKernel kernel,
                                       int depth,
-                                      Shape2D shape);
+                                      Shape2D shape,
+                                      int depthHo=0);
+
+// Forward and inverse transforms, as above, which also add the ranges of the
+// values of each lifting step of each level (and, for the forward
+// transform, of each subband) to "ranges", which must be of the same
+// depths. The results are identical, but they are slower, so are for
+// profiling only.
+const Array2D profileWaveletTransform(const Array2D& picture, WaveletKernel kernel,
+                                      int depth, int depthHo, TransformRanges& ranges);
+const Array2D profileInverseWaveletTransform(const Array2D& transform,
+                                             WaveletKernel kernel,
+                                             int depth,
+                                             Shape2D shape,
+                                             int depthHo,
+                                             TransformRanges& ranges);
+
+// Worst case ranges of the forward transform of any picture with samples of
+// "bitDepth" bits, and of its coefficients (quantised or not), derived from
+// the taps of the lifting steps of the kernel (allowing for rounding). So if
+// int16Storage (or int16Lanes) is true of the bounds, the coefficients (or
+// the lifting arithmetic) of that kernel, depth and bit depth can safely be
+// 16 bit. The inverse transform of quantised coefficients has no such
+// bounds (it depends on the quantisation), so must be profiled.
+const TransformRanges transformBounds(WaveletKernel kernel, int depth, int depthHo, int bitDepth);
+
+// Vertical latency of the transform for line based (e.g. low delay) coding,
+// where the picture is coded in rows of slices "sliceLines" high.
+// The last picture line used to compute the coefficients of a row of slices
+// (may be beyond the picture, in which case the last picture line is used)
+const int last_input_line(WaveletKernel kernel, int depth, int sliceLines, int row);
+// The last row of slices needed to reconstruct a picture line, for a picture
+// whose padded height is "height"
+const int last_slice_row(WaveletKernel kernel, int depth, int sliceLines, int height, int line);
 
 // Return the default quantisation matrix for a given wavelet kernel and depth
-const Array1D quantMatrix(WaveletKernel kernel, int depth);
+// (there are 3*depth+depthHo+1 subbands)
+const Array1D quantMatrix(WaveletKernel kernel, int depth, int depthHo=0);
+
+// Return the synthesis gain of each subband, in subband order. That is the
+// (L2) norm of the picture reconstructed from a unit coefficient, so an error
+// in a coefficient adds about its square times the gain squared to the sum of
+// squared errors of the picture. quantMatrix is derived from these gains.
+const std::vector<float> subband_gains(WaveletKernel kernel, int depth, int depthHo=0);
+
+// Return the samples of each subband, in order, within an in place transform
+const std::vector<ArrayIndices2D> subband_indices(Index height, Index width, int depth, int depthHo=0);
 
 // Convert a Array2D containing an in place wavelet transform into a 1D array of subbands
-const BlockVector split_into_subbands(const Array2D& picture, const char waveletDepth);
+const BlockVector split_into_subbands(const Array2D& picture, const char waveletDepth, const char waveletDepthHo=0);
 
 // Converts a 1D array of subbands back to a single single Array2D corresponding
 // to an in-place wavelet transform
-const Array2D merge_subbands(const BlockVector& subbands);
+const Array2D merge_subbands(const BlockVector& subbands, const char waveletDepthHo=0);
 
 //Forward wavelet transform, including padding if necessary
-const Picture waveletTransform(const Picture& picture, enum WaveletKernel kernel, int depth);
+const Picture waveletTransform(const Picture& picture, enum WaveletKernel kernel, int depth, int depthHo=0);
 
 //Inverse wavelet transform, removes padding if necessary.
 // "format" specifies format of unpadded image
 const Picture inverseWaveletTransform(const Picture& transform,
                                       enum WaveletKernel kernel,
                                       int depth,
-                                      PictureFormat format);
+                                      PictureFormat format,
+                                      int depthHo=0);
+
+// The format of a proxy picture, reduced by 2**level in each dimension
+// (rounded up) from a picture of the given format
+const PictureFormat proxyFormat(const PictureFormat& format, int level);
+
+// Inverse wavelet transform to a proxy picture (of proxyFormat) from the LL
+// subband of a 2D level (1 to depth), so the finer levels are not inverted.
+// Samples are rescaled by the gain of the LL subbands of the levels skipped.
+// "format" specifies the format of the unpadded (full size) image.
+const Picture inverseWaveletProxy(const Picture& transform,
+                                  enum WaveletKernel kernel,
+                                  int depth,
+                                  PictureFormat format,
+                                  int level,
+                                  int depthHo=0);
 
 #endif //WAVELETTRANSFORM_1MARCH10
@@ -142,6 +142,11 @@ namespace {
       return stream.iword(i);
   }
 
+  long& is_little_endian(std::ios_base& stream) {
+      static const int i = std::ios_base::xalloc();
+      return stream.iword(i);
+  }
+
   long& is_text(std::ios_base& stream) {
       static const int i = std::ios_base::xalloc();
       return stream.iword(i);
@@ -286,6 +291,30 @@ std::istream& arrayio::right_justified(std::istream& stream) {
   return stream;
 }
 
+// ostream big endian format manipulator
+std::ostream& arrayio::big_endian(std::ostream& stream) {
+  is_little_endian(stream) = static_cast<long>(false);
+  return stream;
+}
+
+// istream big endian format manipulator
+std::istream& arrayio::big_endian(std::istream& stream) {
+  is_little_endian(stream) = static_cast<long>(false);
+  return stream;
+}
+
+// ostream little endian format manipulator
+std::ostream& arrayio::little_endian(std::ostream& stream) {
+  is_little_endian(stream) = static_cast<long>(true);
+  return stream;
+}
+
+// istream little endian format manipulator
+std::istream& arrayio::little_endian(std::istream& stream) {
+  is_little_endian(stream) = static_cast<long>(true);
+  return stream;
+}
+
 // Set data format to offset binary
 std::ostream& arrayio::offset_binary(std::ostream& stream) {
   is_signed(stream) = static_cast<long>(false);
@@ -348,11 +377,17 @@ std::istream& operator >> (std::istream& stream, Array2D& array) {
   const int width = array.shape()[1];
   const int shift = ioShift(stream);
   const int offset = ioZero(stream);
+  const bool littleEndian = is_little_endian(stream);
+  if (littleEndian && ((wordBytes<1) || (wordBytes>4)))
+    throw std::domain_error("Word width of input stream must be in range 1 to 4");
   unsigned int value, byte = 0;
   for (int y=0; y<height; ++y) {
     for (int x=0; x<width; ++x) {
       value = 0;
-      switch (wordBytes) {
+      if (littleEndian) {
+        for (int b=0; b<wordBytes; ++b) value |= (inBuffer[byte++]<<(8*b));
+      }
+      else switch (wordBytes) {
         // Only allowed 4 bytes word width in 32 bit systems
         case 4:
           value |= (inBuffer[byte++]<<24);
@@ -388,12 +423,18 @@ std::ostream& operator << (std::ostream& stream, const Array2D& array) {
   const int width = array.shape()[1];
   const int shift = ioShift(stream);
   const int offset = ioZero(stream);
+  const bool littleEndian = is_little_endian(stream);
+  if (littleEndian && ((wordBytes<1) || (wordBytes>4)))
+    throw std::domain_error("Word width of output stream must be in range 1 to 4");
   unsigned int value, byte = 0;
   for (int y=0; y<height; ++y) {
     for (int x=0; x<width; ++x) {
       value = array[y][x]+offset;
       value <<= shift;
-      switch (wordBytes) {
+      if (littleEndian) {
+        for (int b=0; b<wordBytes; ++b) outBuffer[byte++] = (value>>(8*b));
+      }
+      else switch (wordBytes) {
         // Only allowed 4 bytes word width in 32 bit systems
         case 4:
           outBuffer[byte++] = (value>>24);
@@ -0,0 +1,224 @@
+/*********************************************************************/
+/* Checksum.cpp                                                      */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines incremental MD5 and CRC32C checksums.                     */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include <cstring> // For memcpy
+#include <cstdio> // For sprintf
+
+#include "Checksum.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define USE_SSE42_CRC32
+#endif
+
+using boost::uint32_t;
+using boost::uint64_t;
+
+namespace {
+
+  inline uint32_t rotl(uint32_t x, int n) {
+    return (x<<n) | (x>>(32-n));
+  }
+
+  inline uint32_t load32(const unsigned char* p) {
+    return p[0] | (p[1]<<8) | (p[2]<<16) | (static_cast<uint32_t>(p[3])<<24);
+  }
+
+  const std::string hex(const unsigned char* bytes, int count) {
+    std::string result;
+    char digits[3];
+    for (int i=0; i<count; ++i) {
+      std::sprintf(digits, "%02x", bytes[i]);
+      result += digits;
+    }
+    return result;
+  }
+
+  // Per round shift amounts and sine derived constants from RFC 1321
+  const int md5Shifts[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+  const uint32_t md5Constants[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+  // Tables for CRC32C "slicing by 8" (8 bytes per step, without hardware support)
+  struct CRC32CTables {
+    CRC32CTables() {
+      const uint32_t polynomial = 0x82F63B78; // Castagnoli, bit reversed
+      for (int n=0; n<256; ++n) {
+        uint32_t crc = n;
+        for (int bit=0; bit<8; ++bit) crc = (crc>>1) ^ ((crc&1) ? polynomial : 0);
+        table[0][n] = crc;
+      }
+      for (int n=0; n<256; ++n) {
+        for (int k=1; k<8; ++k) {
+          table[k][n] = (table[k-1][n]>>8) ^ table[0][table[k-1][n]&0xFF];
+        }
+      }
+    }
+    uint32_t table[8][256];
+  };
+
+  const CRC32CTables crcTables;
+
+  uint32_t crc32cTables(uint32_t crc, const unsigned char* data, std::size_t bytes) {
+    const uint32_t (*t)[256] = crcTables.table;
+    while (bytes>=8) {
+      const uint32_t low = load32(data) ^ crc;
+      const uint32_t high = load32(data+4);
+      crc = t[7][low&0xFF] ^ t[6][(low>>8)&0xFF] ^ t[5][(low>>16)&0xFF] ^ t[4][low>>24] ^
+            t[3][high&0xFF] ^ t[2][(high>>8)&0xFF] ^ t[1][(high>>16)&0xFF] ^ t[0][high>>24];
+      data += 8;
+      bytes -= 8;
+    }
+    while (bytes--) crc = (crc>>8) ^ t[0][(crc^*data++)&0xFF];
+    return crc;
+  }
+
+#ifdef USE_SSE42_CRC32
+
+  __attribute__((target("sse4.2")))
+  uint32_t crc32cHardware(uint32_t crc, const unsigned char* data, std::size_t bytes) {
+    while ((bytes>0) && (reinterpret_cast<std::size_t>(data)&7)) {
+      crc = __builtin_ia32_crc32qi(crc, *data++);
+      --bytes;
+    }
+    uint64_t crc64 = crc;
+    while (bytes>=8) {
+      uint64_t word;
+      std::memcpy(&word, data, 8);
+      crc64 = __builtin_ia32_crc32di(crc64, word);
+      data += 8;
+      bytes -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+    while (bytes--) crc = __builtin_ia32_crc32qi(crc, *data++);
+    return crc;
+  }
+
+  const bool haveSSE42() {
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+  }
+
+#endif
+
+} // end unnamed namespace
+
+checksum::MD5::MD5(): length(0) {
+  state[0] = 0x67452301;
+  state[1] = 0xefcdab89;
+  state[2] = 0x98badcfe;
+  state[3] = 0x10325476;
+}
+
+void checksum::MD5::block(const unsigned char* data) {
+  uint32_t m[16];
+  for (int i=0; i<16; ++i) m[i] = load32(data+4*i);
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  for (int i=0; i<64; ++i) {
+    uint32_t f;
+    int g;
+    switch (i/16) {
+      case 0:
+        f = (b&c) | (~b&d);
+        g = i;
+        break;
+      case 1:
+        f = (d&b) | (~d&c);
+        g = (5*i+1)%16;
+        break;
+      case 2:
+        f = b^c^d;
+        g = (3*i+5)%16;
+        break;
+      default:
+        f = c^(b|~d);
+        g = (7*i)%16;
+        break;
+    }
+    const uint32_t temp = d;
+    d = c;
+    c = b;
+    b = b + rotl(a + f + md5Constants[i] + m[g], md5Shifts[i]);
+    a = temp;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+}
+
+void checksum::MD5::update(const char* data, std::size_t bytes) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  std::size_t used = length%64;
+  length += bytes;
+  if (used>0) { // Top up a partly full buffer first
+    const std::size_t fill = (bytes<64-used) ? bytes : 64-used;
+    std::memcpy(buffer+used, p, fill);
+    p += fill;
+    bytes -= fill;
+    used += fill;
+    if (used<64) return;
+    block(buffer);
+  }
+  while (bytes>=64) {
+    block(p);
+    p += 64;
+    bytes -= 64;
+  }
+  std::memcpy(buffer, p, bytes);
+}
+
+const std::string checksum::MD5::digest() const {
+  MD5 padded(*this);
+  const uint64_t bits = 8*length;
+  unsigned char padding[72] = {0x80};
+  const std::size_t padBytes = ((length%64)<56) ? 56-(length%64) : 120-(length%64);
+  for (int i=0; i<8; ++i) padding[padBytes+i] = static_cast<unsigned char>(bits>>(8*i));
+  padded.update(reinterpret_cast<const char*>(padding), padBytes+8);
+  unsigned char result[16];
+  for (int i=0; i<16; ++i) result[i] = static_cast<unsigned char>(padded.state[i/4]>>(8*(i%4)));
+  return hex(result, 16);
+}
+
+void checksum::CRC32C::update(const char* data, std::size_t bytes) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+#ifdef USE_SSE42_CRC32
+  if (haveSSE42()) {
+    crc = crc32cHardware(crc, p, bytes);
+    return;
+  }
+#endif
+  crc = crc32cTables(crc, p, bytes);
+}
+
+const std::string checksum::CRC32C::digest() const {
+  const uint32_t value = ~crc;
+  unsigned char result[4];
+  for (int i=0; i<4; ++i) result[i] = static_cast<unsigned char>(value>>(8*(3-i)));
+  return hex(result, 4);
+}
+
+const bool checksum::hardwareCRC32C() {
+#ifdef USE_SSE42_CRC32
+  return haveSSE42();
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,445 @@
+/*********************************************************************/
+/* Colour.cpp                                                        */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines colour conversion and chroma resampling of pictures.      */
+/* Each row is converted to floating point, converted (matrix and    */
+/* filters) in line buffers, then rounded back, so the rows of a     */
+/* picture are only read and written once.                           */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include <cmath> // For lrintf
+#include <vector>
+#include <algorithm> // For copy, min, max
+#include <stdexcept>
+#include <string>
+
+#include <boost/bind/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/exception_ptr.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Colour.h"
+
+std::ostream& operator<<(std::ostream& os, ColourMatrix matrix) {
+  const char* s;
+  switch (matrix) {
+    case BT709:
+      s = "BT709";
+      break;
+    case BT2020:
+      s = "BT2020";
+      break;
+    default:
+      s = "Unknown colour matrix!";
+      break;
+  }
+  return os<<s;
+}
+
+std::istream& operator>>(std::istream& strm, ColourMatrix& matrix) {
+  std::string text;
+  strm >> text;
+  if ((text=="BT709") || (text=="709")) matrix = BT709;
+  else if ((text=="BT2020") || (text=="2020")) matrix = BT2020;
+  else strm.setstate(std::ios_base::badbit|std::ios_base::failbit);
+  return strm;
+}
+
+namespace {
+
+  const int minBandSamples = 1<<16; // Smaller bands aren't worth a thread of their own
+
+  // Chroma resolution of Y'CbCr formats (R'G'B' counts as 4:4:4)
+  int chroma_resolution(ColourFormat format) {
+    switch (format) {
+      case RGB:
+      case CF444:
+        return 2;
+      case CF422:
+        return 1;
+      case CF420:
+        return 0;
+      default:
+        return -1;
+    }
+  }
+
+  // Each output is a weighted sum of three inputs plus an offset
+  struct Matrix {
+    float w[3][4];
+  };
+
+  void luma_weights(ColourMatrix matrix, double& kr, double& kb) {
+    switch (matrix) {
+      case BT709:
+        kr = 0.2126;
+        kb = 0.0722;
+        break;
+      case BT2020:
+        kr = 0.2627;
+        kb = 0.0593;
+        break;
+      default:
+        throw std::invalid_argument("unknown colour matrix");
+    }
+  }
+
+  // Full range G'B'R' (signed, as pictures are) to video range Y'CbCr
+  const Matrix coding_matrix(ColourMatrix matrix, int bitDepth) {
+    double kr, kb;
+    luma_weights(matrix, kr, kb);
+    const double kg = 1.0-kr-kb;
+    const double half = std::pow(2.0, bitDepth-1);
+    const double full = std::pow(2.0, bitDepth)-1;
+    const double unit = std::pow(2.0, bitDepth-8); // Video range levels are in units of 8 bit levels
+    const double s = 219*unit/full;
+    const double u = 224*unit/full/(2*(1-kb));
+    const double v = 224*unit/full/(2*(1-kr));
+    const double m[3][4] = {{s*kg, s*kb, s*kr, s*half+16*unit-half},
+                            {-u*kg, u*(1-kb), -u*kr, 0},
+                            {-v*kg, -v*kb, v*(1-kr), 0}};
+    Matrix result;
+    for (int i=0; i<3; ++i)
+      for (int j=0; j<4; ++j) result.w[i][j] = static_cast<float>(m[i][j]);
+    return result;
+  }
+
+  // Video range Y'CbCr to full range G'B'R' (signed, as pictures are)
+  const Matrix output_matrix(ColourMatrix matrix, int bitDepth) {
+    double kr, kb;
+    luma_weights(matrix, kr, kb);
+    const double kg = 1.0-kr-kb;
+    const double half = std::pow(2.0, bitDepth-1);
+    const double full = std::pow(2.0, bitDepth)-1;
+    const double unit = std::pow(2.0, bitDepth-8);
+    const double a = full/(219*unit);
+    const double c = full/(224*unit);
+    const double offset = a*(half-16*unit)-half;
+    const double m[3][4] = {{a, -c*2*kb*(1-kb)/kg, -c*2*kr*(1-kr)/kg, offset},
+                            {a, c*2*(1-kb), 0, offset},
+                            {a, 0, c*2*(1-kr), offset}};
+    Matrix result;
+    for (int i=0; i<3; ++i)
+      for (int j=0; j<4; ++j) result.w[i][j] = static_cast<float>(m[i][j]);
+    return result;
+  }
+
+  // The SIMD and scalar versions of these row functions evaluate the same
+  // expressions, in the same order, so results don't depend on alignment.
+
+  void to_float(const int* in, int width, float* out) {
+    int x = 0;
+#ifdef __SSE2__
+    for (; x+4<=width; x+=4)
+      _mm_storeu_ps(out+x, _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in+x))));
+#endif
+    for (; x<width; ++x) out[x] = static_cast<float>(in[x]);
+  }
+
+  // Clip, then round to nearest (even)
+  void to_int(const float* in, int width, int* out, const float minValue, const float maxValue) {
+    int x = 0;
+#ifdef __SSE2__
+    const __m128 low = _mm_set1_ps(minValue);
+    const __m128 high = _mm_set1_ps(maxValue);
+    for (; x+4<=width; x+=4)
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out+x),
+                       _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in+x), low), high)));
+#endif
+    for (; x<width; ++x) {
+      const float value = std::min(std::max(in[x], minValue), maxValue);
+      out[x] = static_cast<int>(lrintf(value));
+    }
+  }
+
+  // Outputs must not overlap the inputs
+  void matrix_row(const float* in0, const float* in1, const float* in2, int width,
+                  const Matrix& m, float* out0, float* out1, float* out2) {
+    float* const out[3] = {out0, out1, out2};
+    int x = 0;
+#ifdef __SSE2__
+    __m128 w[3][4];
+    for (int i=0; i<3; ++i)
+      for (int j=0; j<4; ++j) w[i][j] = _mm_set1_ps(m.w[i][j]);
+    for (; x+4<=width; x+=4) {
+      const __m128 a = _mm_loadu_ps(in0+x);
+      const __m128 b = _mm_loadu_ps(in1+x);
+      const __m128 c = _mm_loadu_ps(in2+x);
+      for (int i=0; i<3; ++i)
+        _mm_storeu_ps(out[i]+x, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(w[i][0], a),
+                                                                 _mm_mul_ps(w[i][1], b)),
+                                                      _mm_mul_ps(w[i][2], c)),
+                                           w[i][3]));
+    }
+#endif
+    for (; x<width; ++x) {
+      const float a = in0[x], b = in1[x], c = in2[x];
+      for (int i=0; i<3; ++i)
+        out[i][x] = m.w[i][0]*a + m.w[i][1]*b + m.w[i][2]*c + m.w[i][3];
+    }
+  }
+
+  // [1 2 1]/4 filter, keeping the samples co-sited with even input samples
+  void decimate_row(const float* in, int inWidth, int outWidth, float* out) {
+    for (int x=0; x<outWidth; ++x) {
+      const float left = in[std::max(2*x-1, 0)];
+      const float right = in[std::min(2*x+1, inWidth-1)];
+      out[x] = 0.25f*left + 0.5f*in[2*x] + 0.25f*right;
+    }
+  }
+
+  // Linear interpolation, inverting decimate_row's siting
+  void interpolate_row(const float* in, int inWidth, int outWidth, float* out) {
+    for (int x=0; x<outWidth; ++x) {
+      const float here = in[std::min(x/2, inWidth-1)];
+      if (x%2==0) out[x] = here;
+      else out[x] = 0.5f*(here + in[std::min(x/2+1, inWidth-1)]);
+    }
+  }
+
+  typedef boost::function<void (int first, int last)> BandFunction;
+
+  void convert_band(const BandFunction& convert, int first, int last,
+                    boost::exception_ptr& error) {
+    try {
+      convert(first, last);
+    }
+    catch (...) {
+      error = boost::current_exception();
+    }
+  }
+
+  // Convert units (rows, or pairs of rows) of a picture in bands,
+  // on threads of their own if the picture is large enough
+  void convert_in_bands(int units, int samples, const BandFunction& convert) {
+    const int hardwareThreads = std::max<int>(boost::thread::hardware_concurrency(), 1);
+    const int bands = std::max(std::min(std::min(samples/minBandSamples, hardwareThreads), units), 1);
+    if (bands==1) {
+      convert(0, units);
+      return;
+    }
+    std::vector<boost::exception_ptr> errors(bands);
+    boost::thread_group threads;
+    for (int band=1; band<bands; ++band) {
+      threads.create_thread(boost::bind(convert_band, boost::cref(convert),
+                                        band*units/bands, (band+1)*units/bands,
+                                        boost::ref(errors[band])));
+    }
+    convert_band(convert, 0, units/bands, errors[0]);
+    threads.join_all();
+    for (int band=0; band<bands; ++band) {
+      if (errors[band]) boost::rethrow_exception(errors[band]);
+    }
+  }
+
+  // Converts units of a picture for coding. A unit is a row, or (for 4:2:0
+  // from more chroma lines) the pair of rows averaged for one chroma row.
+  struct CodingConversion {
+    CodingConversion(const Picture& in, ColourFormat to, const Matrix& matrix,
+                     int bitDepth, bool interlaced, Array2D& y, Array2D& c1, Array2D& c2):
+      in(in), to(to), matrix(matrix), interlaced(interlaced), y(y), c1(c1), c2(c2),
+      minValue(-std::pow(2.0f, bitDepth-1)), maxValue(std::pow(2.0f, bitDepth-1)-1) {
+    }
+    void operator()(int first, int last) const {
+      const ColourFormat from = in.format().chromaFormat();
+      const int width = in.format().lumaWidth();
+      const int inChromaWidth = in.format().chromaWidth();
+      const int outChromaWidth = c1.shape()[1];
+      const bool horizontal = (outChromaWidth<inChromaWidth);
+      const bool vertical = (to==CF420) && (from!=CF420);
+      std::vector<float> buffer(11*width);
+      float* const g = &buffer[0];
+      float* const b = g+width;
+      float* const r = b+width;
+      float* const luma = r+width;
+      float* const cbFull = luma+width;
+      float* const crFull = cbFull+width;
+      float* const cb[2] = {crFull+width, crFull+2*width};
+      float* const cr[2] = {crFull+3*width, crFull+4*width};
+      for (int unit=first; unit<last; ++unit) {
+        int rows[2] = {unit, unit};
+        if (vertical) {
+          rows[0] = (interlaced ? 4*(unit/2)+unit%2 : 2*unit);
+          rows[1] = rows[0] + (interlaced ? 2 : 1);
+        }
+        for (int i=0; i<(vertical ? 2 : 1); ++i) {
+          const int row = rows[i];
+          float* const cbRow = (horizontal ? cbFull : cb[i]);
+          float* const crRow = (horizontal ? crFull : cr[i]);
+          if (from==RGB) {
+            to_float(&in.y()[row][0], width, g);
+            to_float(&in.c1()[row][0], width, b);
+            to_float(&in.c2()[row][0], width, r);
+            matrix_row(g, b, r, width, matrix, luma, cbRow, crRow);
+            to_int(luma, width, &y[row][0], minValue, maxValue);
+          }
+          else {
+            std::copy(&in.y()[row][0], &in.y()[row][0]+width, &y[row][0]);
+            to_float(&in.c1()[row][0], inChromaWidth, cbRow);
+            to_float(&in.c2()[row][0], inChromaWidth, crRow);
+          }
+          if (horizontal) {
+            decimate_row(cbFull, inChromaWidth, outChromaWidth, cb[i]);
+            decimate_row(crFull, inChromaWidth, outChromaWidth, cr[i]);
+          }
+        }
+        if (vertical) {
+          for (int x=0; x<outChromaWidth; ++x) {
+            cb[0][x] = 0.5f*(cb[0][x]+cb[1][x]);
+            cr[0][x] = 0.5f*(cr[0][x]+cr[1][x]);
+          }
+        }
+        to_int(cb[0], outChromaWidth, &c1[unit][0], minValue, maxValue);
+        to_int(cr[0], outChromaWidth, &c2[unit][0], minValue, maxValue);
+      }
+    }
+    const Picture& in;
+    const ColourFormat to;
+    const Matrix matrix;
+    const bool interlaced;
+    Array2D& y;
+    Array2D& c1;
+    Array2D& c2;
+    const float minValue;
+    const float maxValue;
+  };
+
+  // Converts rows of a decoded picture for output
+  struct OutputConversion {
+    OutputConversion(const Picture& in, ColourFormat to, const Matrix& matrix,
+                     int bitDepth, bool interlaced, Array2D& y, Array2D& c1, Array2D& c2):
+      in(in), to(to), matrix(matrix), interlaced(interlaced), y(y), c1(c1), c2(c2),
+      minValue(-std::pow(2.0f, bitDepth-1)), maxValue(std::pow(2.0f, bitDepth-1)-1) {
+    }
+    void operator()(int first, int last) const {
+      const ColourFormat from = in.format().chromaFormat();
+      const int width = in.format().lumaWidth();
+      const int inChromaWidth = in.format().chromaWidth();
+      const int inChromaHeight = in.format().chromaHeight();
+      const int outChromaWidth = c1.shape()[1];
+      const bool horizontal = (outChromaWidth>inChromaWidth);
+      const bool vertical = (from==CF420) && (to!=CF420);
+      std::vector<float> buffer(10*width);
+      float* const luma = &buffer[0];
+      float* const cbLine = luma+width;
+      float* const crLine = cbLine+width;
+      float* const cbFull = crLine+width;
+      float* const crFull = cbFull+width;
+      float* const near = crFull+width;
+      float* const far = near+width;
+      float* const g = far+width;
+      float* const b = g+width;
+      float* const r = b+width;
+      for (int row=first; row<last; ++row) {
+        if (vertical) {
+          // Chroma rows nearest to, and next nearest to, this luma row
+          int nearRow, farRow;
+          if (interlaced) {
+            const int field = row%2;
+            const int fieldRows = (inChromaHeight-field+1)/2;
+            const int fieldLine = row/2;
+            const int nearLine = std::min(fieldLine/2, fieldRows-1);
+            const int farLine = std::min(std::max((fieldLine%2==0) ? nearLine-1 : nearLine+1, 0), fieldRows-1);
+            nearRow = 2*nearLine+field;
+            farRow = 2*farLine+field;
+          }
+          else {
+            nearRow = std::min(row/2, inChromaHeight-1);
+            farRow = std::min(std::max((row%2==0) ? nearRow-1 : nearRow+1, 0), inChromaHeight-1);
+          }
+          to_float(&in.c1()[nearRow][0], inChromaWidth, near);
+          to_float(&in.c1()[farRow][0], inChromaWidth, far);
+          for (int x=0; x<inChromaWidth; ++x) cbLine[x] = 0.75f*near[x] + 0.25f*far[x];
+          to_float(&in.c2()[nearRow][0], inChromaWidth, near);
+          to_float(&in.c2()[farRow][0], inChromaWidth, far);
+          for (int x=0; x<inChromaWidth; ++x) crLine[x] = 0.75f*near[x] + 0.25f*far[x];
+        }
+        else {
+          to_float(&in.c1()[row][0], inChromaWidth, cbLine);
+          to_float(&in.c2()[row][0], inChromaWidth, crLine);
+        }
+        const float* cb = cbLine;
+        const float* cr = crLine;
+        if (horizontal) {
+          interpolate_row(cbLine, inChromaWidth, outChromaWidth, cbFull);
+          interpolate_row(crLine, inChromaWidth, outChromaWidth, crFull);
+          cb = cbFull;
+          cr = crFull;
+        }
+        if (to==RGB) {
+          to_float(&in.y()[row][0], width, luma);
+          matrix_row(luma, cb, cr, width, matrix, g, b, r);
+          to_int(g, width, &y[row][0], minValue, maxValue);
+          to_int(b, width, &c1[row][0], minValue, maxValue);
+          to_int(r, width, &c2[row][0], minValue, maxValue);
+        }
+        else {
+          std::copy(&in.y()[row][0], &in.y()[row][0]+width, &y[row][0]);
+          to_int(cb, outChromaWidth, &c1[row][0], minValue, maxValue);
+          to_int(cr, outChromaWidth, &c2[row][0], minValue, maxValue);
+        }
+      }
+    }
+    const Picture& in;
+    const ColourFormat to;
+    const Matrix matrix;
+    const bool interlaced;
+    Array2D& y;
+    Array2D& c1;
+    Array2D& c2;
+    const float minValue;
+    const float maxValue;
+  };
+
+} // end unnamed namespace
+
+const bool can_convert_for_coding(ColourFormat from, ColourFormat to) {
+  if ((to==RGB) || (to==UNKNOWN) || (from==UNKNOWN)) return false;
+  return (from==RGB) || (chroma_resolution(to)<chroma_resolution(from));
+}
+
+const bool can_convert_for_output(ColourFormat from, ColourFormat to) {
+  if ((from==RGB) || (to==UNKNOWN) || (from==UNKNOWN)) return false;
+  return (to==RGB) || (chroma_resolution(to)>chroma_resolution(from));
+}
+
+const Picture convert_for_coding(const Picture& picture, ColourFormat format,
+                                 ColourMatrix matrix, int bitDepth, bool interlaced) {
+  const PictureFormat inFormat = picture.format();
+  if (!can_convert_for_coding(inFormat.chromaFormat(), format))
+    throw std::invalid_argument("unsupported colour conversion for coding");
+  const bool vertical = (format==CF420) && (inFormat.chromaFormat()!=CF420);
+  if (vertical && (inFormat.lumaHeight()%(interlaced ? 4 : 2)!=0))
+    throw std::invalid_argument("4:2:0 needs an even number of lines (in each field if interlaced)");
+  const PictureFormat outFormat(inFormat.lumaHeight(), inFormat.lumaWidth(), format);
+  Array2D y(outFormat.lumaShape());
+  Array2D c1(outFormat.chromaShape());
+  Array2D c2(outFormat.chromaShape());
+  const Matrix weights = (inFormat.chromaFormat()==RGB) ? coding_matrix(matrix, bitDepth) : Matrix();
+  const CodingConversion convert(picture, format, weights, bitDepth, interlaced, y, c1, c2);
+  const int units = (vertical ? outFormat.chromaHeight() : outFormat.lumaHeight());
+  convert_in_bands(units, inFormat.samples(), BandFunction(boost::cref(convert)));
+  return Picture(outFormat, y, c1, c2);
+}
+
+const Picture convert_for_output(const Picture& picture, ColourFormat format,
+                                 ColourMatrix matrix, int bitDepth, bool interlaced) {
+  const PictureFormat inFormat = picture.format();
+  if (!can_convert_for_output(inFormat.chromaFormat(), format))
+    throw std::invalid_argument("unsupported colour conversion for output");
+  const PictureFormat outFormat(inFormat.lumaHeight(), inFormat.lumaWidth(), format);
+  Array2D y(outFormat.lumaShape());
+  Array2D c1(outFormat.chromaShape());
+  Array2D c2(outFormat.chromaShape());
+  const Matrix weights = (format==RGB) ? output_matrix(matrix, bitDepth) : Matrix();
+  const OutputConversion convert(picture, format, weights, bitDepth, interlaced, y, c1, c2);
+  convert_in_bands(outFormat.lumaHeight(), outFormat.samples(), BandFunction(boost::cref(convert)));
+  return Picture(outFormat, y, c1, c2);
+}
@@ -0,0 +1,307 @@
+/*********************************************************************/
+/* DPX.cpp                                                           */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines reading of DPX image sequences.                           */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <cctype> // For isdigit, tolower
+
+#include <boost/bind/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "DPX.h"
+
+using std::string;
+using std::invalid_argument;
+
+namespace {
+
+  // Byte offsets of the header fields used (SMPTE 268M generic header)
+  const int magicOffset = 0;
+  const int imageOffsetOffset = 4;
+  const int orientationOffset = 768;
+  const int elementsOffset = 770;
+  const int pixelsPerLineOffset = 772;
+  const int linesOffset = 776;
+  const int descriptorOffset = 800;
+  const int bitSizeOffset = 803;
+  const int packingOffset = 804;
+  const int encodingOffset = 806;
+  const int dataOffsetOffset = 808;
+  const int eolPaddingOffset = 812;
+  const int headerBytes = 820; // Enough for the fields above
+
+  const int descriptorRGB = 50;
+  const unsigned long undefined32 = 0xFFFFFFFF;
+
+  unsigned long load32(const unsigned char* p, bool bigEndian) {
+    if (bigEndian)
+      return (static_cast<unsigned long>(p[0])<<24) | (p[1]<<16) | (p[2]<<8) | p[3];
+    else
+      return (static_cast<unsigned long>(p[3])<<24) | (p[2]<<16) | (p[1]<<8) | p[0];
+  }
+
+  unsigned int load16(const unsigned char* p, bool bigEndian) {
+    return bigEndian ? ((p[0]<<8) | p[1]) : ((p[1]<<8) | p[0]);
+  }
+
+  // Unpack a line of 10 bit RGB, three samples per 32 bit word. Method A
+  // has the padding in the 2 least significant bits, method B in the 2 most.
+  void unpack10(const unsigned char* line, const dpx::Header& format, const int offset,
+                int* r, int* g, int* b) {
+    const int width = format.width;
+    const int pad = (format.packing==1) ? 2 : 0;
+    int x = 0;
+#ifdef __SSE2__
+    // Four pixels at a time. SSE2 implies a little endian host.
+    const __m128i mask = _mm_set1_epi32(0x3FF);
+    const __m128i zero = _mm_set1_epi32(offset);
+    const __m128i rShift = _mm_cvtsi32_si128(20+pad);
+    const __m128i gShift = _mm_cvtsi32_si128(10+pad);
+    const __m128i bShift = _mm_cvtsi32_si128(pad);
+    for (; x+4<=width; x+=4) {
+      __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line+4*x));
+      if (format.bigEndian) { // Reverse the bytes of each word
+        words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+        words = _mm_shufflehi_epi16(_mm_shufflelo_epi16(words, 0xB1), 0xB1);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(r+x),
+                       _mm_sub_epi32(_mm_and_si128(_mm_srl_epi32(words, rShift), mask), zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(g+x),
+                       _mm_sub_epi32(_mm_and_si128(_mm_srl_epi32(words, gShift), mask), zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(b+x),
+                       _mm_sub_epi32(_mm_and_si128(_mm_srl_epi32(words, bShift), mask), zero));
+    }
+#endif
+    for (; x<width; ++x) {
+      const unsigned long word = load32(line+4*x, format.bigEndian);
+      r[x] = static_cast<int>((word>>(20+pad))&0x3FF) - offset;
+      g[x] = static_cast<int>((word>>(10+pad))&0x3FF) - offset;
+      b[x] = static_cast<int>((word>>pad)&0x3FF) - offset;
+    }
+  }
+
+  // Unpack a line of 12 bit (filled to 16 bits, method A padding the least
+  // significant bits, method B the most) or 16 bit RGB
+  void unpack16(const unsigned char* line, const dpx::Header& format, const int offset,
+                int* r, int* g, int* b) {
+    const int width = format.width;
+    const int shift = ((format.bitDepth==12) && (format.packing==1)) ? 4 : 0;
+    const unsigned int mask = (1<<format.bitDepth)-1;
+    for (int x=0; x<width; ++x) {
+      const unsigned char* p = line+6*x;
+      r[x] = static_cast<int>((load16(p, format.bigEndian)>>shift)&mask) - offset;
+      g[x] = static_cast<int>((load16(p+2, format.bigEndian)>>shift)&mask) - offset;
+      b[x] = static_cast<int>((load16(p+4, format.bigEndian)>>shift)&mask) - offset;
+    }
+  }
+
+  const bool sameFormat(const dpx::Header& lhs, const dpx::Header& rhs) {
+    return (lhs.height==rhs.height) && (lhs.width==rhs.width) &&
+           (lhs.bitDepth==rhs.bitDepth) && (lhs.packing==rhs.packing) &&
+           (lhs.bigEndian==rhs.bigEndian);
+  }
+
+} // end unnamed namespace
+
+const bool dpx::isDPXFileName(const std::string& fileName) {
+  const string::size_type length = fileName.size();
+  if (length<4) return false;
+  string suffix = fileName.substr(length-4);
+  for (string::size_type i=0; i<suffix.size(); ++i)
+    suffix[i] = std::tolower(static_cast<unsigned char>(suffix[i]));
+  return suffix==".dpx";
+}
+
+const std::string dpx::sequenceFileName(const std::string& firstFile, int index) {
+  // Find the last run of digits in the name (not in the directory)
+  const string::size_type slash = firstFile.find_last_of("/\\");
+  const string::size_type nameStart = (slash==string::npos) ? 0 : slash+1;
+  string::size_type end = firstFile.size();
+  while ((end>nameStart) && !std::isdigit(static_cast<unsigned char>(firstFile[end-1]))) --end;
+  if (end==nameStart) return (index==0) ? firstFile : string();
+  string::size_type start = end;
+  while ((start>nameStart) && std::isdigit(static_cast<unsigned char>(firstFile[start-1]))) --start;
+  const string digits = firstFile.substr(start, end-start);
+  long number = 0;
+  std::istringstream(digits) >> number;
+  std::ostringstream name;
+  name << firstFile.substr(0, start);
+  name.width(digits.size());
+  name.fill('0');
+  name << (number+index);
+  name << firstFile.substr(end);
+  return name.str();
+}
+
+dpx::Header::Header():
+  height(0), width(0), bitDepth(0), packing(0), bigEndian(true), dataOffset(0), lineBytes(0) {
+}
+
+const dpx::Header dpx::readHeader(std::istream& stream) {
+  unsigned char buffer[headerBytes];
+  stream.read(reinterpret_cast<char*>(buffer), headerBytes);
+  if (!stream) throw invalid_argument("DPX: file is too short for a DPX header");
+  Header header;
+  const string magic(reinterpret_cast<const char*>(buffer+magicOffset), 4);
+  if (magic=="SDPX") header.bigEndian = true;
+  else if (magic=="XPDS") header.bigEndian = false;
+  else throw invalid_argument("DPX: not a DPX file (no SDPX signature)");
+  const bool bigEndian = header.bigEndian;
+  if (load16(buffer+orientationOffset, bigEndian)!=0)
+    throw invalid_argument("DPX: only left to right, top to bottom images are supported");
+  if (load16(buffer+elementsOffset, bigEndian)<1)
+    throw invalid_argument("DPX: no image elements");
+  if (buffer[descriptorOffset]!=descriptorRGB)
+    throw invalid_argument("DPX: only RGB images (descriptor 50) are supported");
+  if (load16(buffer+encodingOffset, bigEndian)!=0)
+    throw invalid_argument("DPX: run length encoded images are not supported");
+  const unsigned long width = load32(buffer+pixelsPerLineOffset, bigEndian);
+  const unsigned long height = load32(buffer+linesOffset, bigEndian);
+  if ((width<1) || (height<1) || (width>65536) || (height>65536))
+    throw invalid_argument("DPX: invalid image size");
+  header.width = width;
+  header.height = height;
+  header.bitDepth = buffer[bitSizeOffset];
+  header.packing = load16(buffer+packingOffset, bigEndian);
+  switch (header.bitDepth) {
+    case 10:
+      if ((header.packing!=1) && (header.packing!=2))
+        throw invalid_argument("DPX: 10 bit images must be filled to 32 bit words (packing method A or B)");
+      header.lineBytes = 4*width;
+      break;
+    case 12:
+      if ((header.packing!=1) && (header.packing!=2))
+        throw invalid_argument("DPX: 12 bit images must be filled to 16 bit words (packing method A or B)");
+      header.lineBytes = 6*width;
+      break;
+    case 16:
+      header.lineBytes = 6*width;
+      break;
+    default:
+      throw invalid_argument("DPX: only 10, 12 and 16 bit images are supported");
+  }
+  const unsigned long eolPadding = load32(buffer+eolPaddingOffset, bigEndian);
+  if (eolPadding!=undefined32) header.lineBytes += eolPadding;
+  unsigned long dataOffset = load32(buffer+dataOffsetOffset, bigEndian);
+  if ((dataOffset==0) || (dataOffset==undefined32))
+    dataOffset = load32(buffer+imageOffsetOffset, bigEndian);
+  header.dataOffset = dataOffset;
+  return header;
+}
+
+const Picture dpx::readImage(const std::string& fileName, const Header& format) {
+  std::ifstream file(fileName.c_str(), std::ios_base::in|std::ios_base::binary);
+  if (!file) throw invalid_argument("DPX: failed to open \""+fileName+"\"");
+  const Header header = readHeader(file);
+  if (!sameFormat(header, format))
+    throw invalid_argument("DPX: format of \""+fileName+"\" differs from the first file of the sequence");
+  std::vector<unsigned char> data(static_cast<std::size_t>(header.lineBytes)*header.height);
+  file.seekg(header.dataOffset);
+  file.read(reinterpret_cast<char*>(&data[0]), data.size());
+  if (!file) throw invalid_argument("DPX: image data is truncated in \""+fileName+"\"");
+  const PictureFormat pictureFormat(header.height, header.width, RGB);
+  Array2D r(pictureFormat.lumaShape());
+  Array2D g(pictureFormat.lumaShape());
+  Array2D b(pictureFormat.lumaShape());
+  const int offset = 1<<(header.bitDepth-1);
+  for (int y=0; y<header.height; ++y) {
+    const unsigned char* line = &data[0]+static_cast<std::size_t>(y)*header.lineBytes;
+    if (header.bitDepth==10) unpack10(line, header, offset, &r[y][0], &g[y][0], &b[y][0]);
+    else unpack16(line, header, offset, &r[y][0], &g[y][0], &b[y][0]);
+  }
+  return Picture(pictureFormat, g, b, r);
+}
+
+struct dpx::SequenceReader::Job {
+  Job(): done(false), exists(true) {}
+  boost::mutex mutex;
+  boost::condition_variable ready;
+  bool done;
+  bool exists; // False after the end of the sequence
+  Picture picture;
+  string error;
+};
+
+namespace {
+
+  // Read one file of a sequence (on a pool thread), storing the picture,
+  // or the error, in the job. The reader only looks at the job once it is
+  // done (which is set under the lock), so the job is filled in unlocked.
+  template <class JobPtr>
+  void readJob(const JobPtr job, const string fileName, const dpx::Header format) {
+    try {
+      if (fileName.empty() || !std::ifstream(fileName.c_str(), std::ios_base::in|std::ios_base::binary))
+        job->exists = false;
+      else job->picture = dpx::readImage(fileName, format);
+    }
+    catch (const std::exception& ex) {
+      job->error = ex.what();
+    }
+    boost::mutex::scoped_lock lock(job->mutex);
+    job->done = true;
+    job->ready.notify_all();
+  }
+
+} // end unnamed namespace
+
+dpx::SequenceReader::SequenceReader(const std::string& firstFile, int threads):
+  firstFileName(firstFile),
+  nextIndex(0),
+  finished(false),
+  pool(threads) {
+  std::ifstream file(firstFile.c_str(), std::ios_base::in|std::ios_base::binary);
+  if (!file) throw invalid_argument("DPX: failed to open \""+firstFile+"\"");
+  format = readHeader(file);
+  readAhead();
+}
+
+const dpx::Header& dpx::SequenceReader::header() const {
+  return format;
+}
+
+void dpx::SequenceReader::readAhead() {
+  while (!finished && (jobs.size()<static_cast<std::size_t>(2*pool.size()))) {
+    const string fileName = sequenceFileName(firstFileName, nextIndex);
+    if ((nextIndex>0) && fileName.empty()) { // Not a numbered sequence
+      finished = true;
+      break;
+    }
+    ++nextIndex;
+    const JobPtr job(new Job);
+    jobs.push_back(job);
+    pool.submit(boost::bind(readJob<JobPtr>, job, fileName, format));
+  }
+}
+
+bool dpx::SequenceReader::next(Picture& picture) {
+  readAhead();
+  if (jobs.empty()) return false;
+  const JobPtr job = jobs.front();
+  jobs.pop_front();
+  {
+    boost::mutex::scoped_lock lock(job->mutex);
+    while (!job->done) job->ready.wait(lock);
+  }
+  if (!job->error.empty()) throw invalid_argument(job->error);
+  if (!job->exists) { // End of the sequence, so later files are not used
+    finished = true;
+    jobs.clear();
+    return false;
+  }
+  picture = job->picture;
+  readAhead();
+  return true;
+}
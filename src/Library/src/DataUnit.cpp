@@ -16,6 +16,9 @@
 
 DataUnit::DataUnit()
   : type (UNKNOWN_DATA_UNIT)
+  , next_parse_offset (0)
+  , prev_parse_offset (0)
+  , prefix_follows (false)
   , strm () {}
 
 std::istream &DataUnit::stream() { return strm; }
@@ -27,7 +30,9 @@ WrappedPicture::WrappedPicture(const unsigned long p,
                                const int y,
                                const int sp,
                                const int ss,
-                               const Slices &s)
+                               const Slices &s,
+                               const int ho,
+                               const Array1D &qm)
   : picture_number (p),
     wavelet_kernel (w),
     depth (d),
@@ -36,7 +41,9 @@ WrappedPicture::WrappedPicture(const unsigned long p,
     slice_prefix (sp),
     slice_size_scalar (ss),
     slice_bytes (),
-    slices (s) {
+    slices (s),
+    depth_ho (ho),
+    quant_matrix (qm) {
 }
 
 WrappedPicture::WrappedPicture(const unsigned long p,
@@ -45,7 +52,9 @@ WrappedPicture::WrappedPicture(const unsigned long p,
                                const int x,
                                const int y,
                                const utils::Rational sb,
-                               const Slices &s)
+                               const Slices &s,
+                               const int ho,
+                               const Array1D &qm)
   : picture_number (p),
     wavelet_kernel (w),
     depth (d),
@@ -54,7 +63,33 @@ WrappedPicture::WrappedPicture(const unsigned long p,
     slice_prefix (0),
     slice_size_scalar (0),
     slice_bytes(sb),
-    slices (s) {
+    slices (s),
+    depth_ho (ho),
+    quant_matrix (qm) {
+}
+
+WrappedPicture::WrappedPicture(const unsigned long p,
+                               const WaveletKernel w,
+                               const int d,
+                               const int x,
+                               const int y,
+                               const int sp,
+                               const int ss,
+                               const std::string &cs,
+                               const int ho,
+                               const Array1D &qm)
+  : picture_number (p),
+    wavelet_kernel (w),
+    depth (d),
+    slices_x (x),
+    slices_y (y),
+    slice_prefix (sp),
+    slice_size_scalar (ss),
+    slice_bytes (),
+    slices (PictureArray(), d, Array2D(), ho),
+    coded_slices (cs),
+    depth_ho (ho),
+    quant_matrix (qm) {
 }
 
 namespace {
@@ -62,8 +97,53 @@ namespace {
     static const int i = std::ios_base::xalloc();
     return stream.iword(i);
   }
+
+  long& major_version(std::ios_base& stream) {
+    static const int i = std::ios_base::xalloc();
+    return stream.iword(i);
+  }
+
+  // Extended transform parameters (major version 3 and above)
+  // The same wavelet kernel is always used for the horizontal only levels.
+  void write_extended_transform_parameters(std::ostream& ss, const WrappedPicture& d) {
+    if (major_version(ss) >= 3) {
+      ss << Boolean(false) // asym_transform_index_flag
+         << Boolean(d.depth_ho > 0); // asym_transform_flag
+      if (d.depth_ho > 0) ss << UnsignedVLC(d.depth_ho);
+    }
+    else if (d.depth_ho > 0) {
+      throw std::logic_error("DataUnitIO: asymmetric transforms require major version 3");
+    }
+  }
+
+  void write_quant_matrix(std::ostream& ss, const WrappedPicture& d) {
+    const bool custom_quant_matrix = (d.quant_matrix.size() > 0);
+    ss << Boolean(custom_quant_matrix);
+    if (custom_quant_matrix) {
+      if (static_cast<int>(d.quant_matrix.size()) != 3*d.depth+d.depth_ho+1) {
+        throw std::logic_error("DataUnitIO: quantisation matrix does not match transform depth");
+      }
+      for (unsigned int band=0; band<d.quant_matrix.size(); ++band) {
+        ss << UnsignedVLC(d.quant_matrix[band]);
+      }
+    }
+  }
 };
 
+void dataunitio::majorVersion::operator() (std::ios_base& stream) const {
+  major_version(stream) = version;
+}
+
+std::ostream& operator << (std::ostream& stream, dataunitio::majorVersion arg) {
+  arg(stream);
+  return stream;
+}
+
+std::istream& operator >> (std::istream& stream, dataunitio::majorVersion arg) {
+  arg(stream);
+  return stream;
+}
+
 class ParseInfoIO {
 public:
   ParseInfoIO(const DataUnitType du)
@@ -115,13 +195,14 @@ std::ostream& LDWrappedPictureIO(std::ostream& stream, const WrappedPicture& d)
   // Transform Params
   ss << vlc::unbounded
      << UnsignedVLC(d.wavelet_kernel)
-     << UnsignedVLC(d.depth)
-     << UnsignedVLC(d.slices_x)
+     << UnsignedVLC(d.depth);
+  write_extended_transform_parameters(ss, d);
+  ss << UnsignedVLC(d.slices_x)
      << UnsignedVLC(d.slices_y)
      << UnsignedVLC(d.slice_bytes.numerator)
-     << UnsignedVLC(d.slice_bytes.denominator)
-     << Boolean(false)
-     << vlc::align;
+     << UnsignedVLC(d.slice_bytes.denominator);
+  write_quant_matrix(ss, d);
+  ss << vlc::align;
 
   // Transform Data
   ss << d.slices;
@@ -141,16 +222,18 @@ std::ostream& HQWrappedPictureIO(std::ostream& stream, const WrappedPicture& d)
   // Transform Params
   ss << vlc::unbounded
      << UnsignedVLC(d.wavelet_kernel)
-     << UnsignedVLC(d.depth)
-     << UnsignedVLC(d.slices_x)
+     << UnsignedVLC(d.depth);
+  write_extended_transform_parameters(ss, d);
+  ss << UnsignedVLC(d.slices_x)
      << UnsignedVLC(d.slices_y)
      << UnsignedVLC(d.slice_prefix)
-     << UnsignedVLC(d.slice_size_scalar)
-     << Boolean(false)
-     << vlc::align;
+     << UnsignedVLC(d.slice_size_scalar);
+  write_quant_matrix(ss, d);
+  ss << vlc::align;
 
-  // Transform Data
+  // Transform Data (either slices or slices that have already been coded)
   ss << d.slices;
+  ss << d.coded_slices;
 
   stream << ParseInfoIO(HQ_PICTURE, ss.str().size());
 
@@ -574,6 +657,9 @@ std::ostream& operator << (std::ostream& stream, const SequenceHeader& s) {
 
   stream << ParseInfoIO(SEQUENCE_HEADER, ss.str().size()) << ss.str();
 
+  // Subsequent pictures are written using this version of the syntax
+  major_version(stream) = s.major_version;
+
   return stream;
 }
 
@@ -626,17 +712,22 @@ std::istream& operator >> (std::istream& stream, DataUnit &d) {
   Bytes prev_parse_offset(4);
 
   stream >> next_parse_offset >> prev_parse_offset;
+  d.next_parse_offset = next_parse_offset;
+  d.prev_parse_offset = prev_parse_offset;
 
   if ((unsigned long) next_parse_offset == 0) {
     d.strm.str(std::string());
   } else {
-    char buf[((unsigned long) next_parse_offset) - 13];
-    stream.read(buf, sizeof(buf));
-    d.strm.str(std::string(buf, sizeof(buf)));
+    // Read into the heap, a large picture can be bigger than the stack
+    std::string buf(((unsigned long) next_parse_offset) - 13, '\0');
+    stream.read(&buf[0], buf.size());
+    buf.resize(stream.gcount()); // Keep only what was read from a truncated stream
+    d.strm.str(buf);
   }
 
   Bytes prefix(4);
   stream >> prefix;
+  d.prefix_follows = !stream.fail() && ((unsigned long) prefix == 0x42424344);
 
   return stream;
 }
@@ -677,6 +768,39 @@ std::ostream& operator << (std::ostream& stream, const FrameRate& r) {
   return stream;
 }
 
+const utils::Rational frames_per_second(const FrameRate rate) {
+  utils::Rational fps;
+  fps.denominator = 1;
+  switch(rate) {
+  case FR24000_1001: fps.numerator = 24000; fps.denominator = 1001; break;
+  case FR24: fps.numerator = 24; break;
+  case FR25: fps.numerator = 25; break;
+  case FR30000_1001: fps.numerator = 30000; fps.denominator = 1001; break;
+  case FR30: fps.numerator = 30; break;
+  case FR50: fps.numerator = 50; break;
+  case FR60000_1001: fps.numerator = 60000; fps.denominator = 1001; break;
+  case FR60: fps.numerator = 60; break;
+  case FR15000_1001: fps.numerator = 15000; fps.denominator = 1001; break;
+  case FR25_2: fps.numerator = 25; fps.denominator = 2; break;
+  case FR48: fps.numerator = 48; break;
+  default: fps.numerator = 0; break;
+  }
+  return fps;
+}
+
+const FrameRate frame_rate(int numerator, int denominator) {
+  const FrameRate rates[] = { FR24000_1001, FR24, FR25, FR30000_1001, FR30, FR50,
+                              FR60000_1001, FR60, FR15000_1001, FR25_2, FR48 };
+  for (unsigned int i=0; i<sizeof(rates)/sizeof(rates[0]); ++i) {
+    const utils::Rational fps = frames_per_second(rates[i]);
+    // Compare as fractions, so 50/2 matches 25/1
+    if ((denominator>0) &&
+        (static_cast<long long>(fps.numerator)*denominator == static_cast<long long>(numerator)*fps.denominator))
+      return rates[i];
+  }
+  return FR0;
+}
+
 SequenceHeader & operator << (SequenceHeader &hdr, video_format &fmt) {
   switch (fmt.base_video_format) {
   case  0: hdr = SequenceHeader(PROFILE_UNKNOWN, 480,  640,  CF420, false, FR24000_1001, false,  8); break;
@@ -706,6 +830,9 @@ SequenceHeader & operator << (SequenceHeader &hdr, video_format &fmt) {
     throw std::logic_error("DataUnitIO: unknown base video format");
   }
 
+  hdr.major_version = fmt.major_version;
+  hdr.minor_version = fmt.minor_version;
+
   if (fmt.profile == 0)
     hdr.profile = PROFILE_LD;
   else if (fmt.profile == 3)
@@ -740,6 +867,7 @@ std::istream& operator >> (std::istream& stream, SequenceHeader &hdr) {
   video_format fmt;
   stream >> fmt;
   hdr << fmt;
+  major_version(stream) = hdr.major_version;
   return stream;
 }
 
@@ -751,7 +879,9 @@ PicturePreamble::PicturePreamble()
   , slices_y (0)
   , slice_prefix (0)
   , slice_size_scalar (0)
-  , slice_bytes() {
+  , slice_bytes()
+  , depth_ho (0)
+  , quant_matrix () {
 }
 
 std::istream& operator >> (std::istream& stream, PicturePreamble &hdr) {
@@ -772,6 +902,26 @@ std::istream& operator >> (std::istream& stream, PicturePreamble &hdr) {
   }
   hdr.depth = depth;
 
+  hdr.depth_ho = 0;
+  if (major_version(stream) >= 3) {
+    Boolean asym_transform_index_flag;
+    stream >> asym_transform_index_flag;
+    if (asym_transform_index_flag) {
+      UnsignedVLC wavelet_index_ho;
+      stream >> wavelet_index_ho;
+      if (wavelet_index_ho != wavelet_index) {
+        throw std::logic_error("DataUnitIO: different horizontal only wavelet kernel not supported");
+      }
+    }
+    Boolean asym_transform_flag;
+    stream >> asym_transform_flag;
+    if (asym_transform_flag) {
+      UnsignedVLC depth_ho;
+      stream >> depth_ho;
+      hdr.depth_ho = depth_ho;
+    }
+  }
+
   if (sliceio::sliceIOMode(stream) == sliceio::HQVBR || sliceio::sliceIOMode(stream) == sliceio::HQCBR) {
     UnsignedVLC slices_x, slices_y, slice_prefix, slice_size_scalar;
     stream >> slices_x >> slices_y >> slice_prefix >> slice_size_scalar;
@@ -797,7 +947,16 @@ std::istream& operator >> (std::istream& stream, PicturePreamble &hdr) {
   stream >> custom_quant_matrix;
 
   if (custom_quant_matrix) {
-    throw std::logic_error("DataUnitIO: Custom Quantisation Matrix flag not supported");
+    // Values are in subband order, lowest frequencies first
+    hdr.quant_matrix.resize(extents[3*hdr.depth+hdr.depth_ho+1]);
+    for (unsigned int band=0; band<hdr.quant_matrix.size(); ++band) {
+      UnsignedVLC value;
+      stream >> value;
+      hdr.quant_matrix[band] = value;
+    }
+  }
+  else {
+    hdr.quant_matrix.resize(extents[0]);
   }
 
   stream >> vlc::align;
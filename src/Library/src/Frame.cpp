@@ -89,6 +89,7 @@ void Frame::bottomField(const Picture& f) {
   const int uvBottom = format().chromaHeight();
   using boost::indices;
   luma[indices[Range(top,yBottom,2)][Range()]] = f.y();
+  if (uvBottom==0) return; // Luma only frame
   chroma1[indices[Range(top,uvBottom,2)][Range()]] = f.c1();
   chroma2[indices[Range(top,uvBottom,2)][Range()]] = f.c2();
 }
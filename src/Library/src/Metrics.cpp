@@ -0,0 +1,184 @@
+/*********************************************************************/
+/* Metrics.cpp                                                       */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines live metrics and their export to a text file.             */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include <cstdio> // For rename
+#include <cstring> // For memcpy
+#include <fstream>
+#include <sstream>
+#include <iostream> // For cerr
+#include <stdexcept>
+
+#include <boost/bind/bind.hpp>
+#include <boost/thread/thread_time.hpp>
+
+#include "Metrics.h"
+#include "Timing.h"
+
+void metrics::Gauge::set(double x) {
+  boost::uint64_t b;
+  std::memcpy(&b, &x, sizeof(b));
+  bits.store(b, boost::memory_order_relaxed);
+}
+
+const double metrics::Gauge::value() const {
+  const boost::uint64_t b = bits.load(boost::memory_order_relaxed);
+  double x;
+  std::memcpy(&x, &b, sizeof(x));
+  return x;
+}
+
+void metrics::lap(Timer& timer, double& start) {
+  const double end = timing::now();
+  timer.add(end-start);
+  start = end;
+}
+
+metrics::CountingBuffer::CountingBuffer(std::streambuf* target, Counter& bytes):
+  target(target), bytes(bytes) {
+}
+
+metrics::CountingBuffer::int_type metrics::CountingBuffer::overflow(int_type c) {
+  if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+  const int_type result = target->sputc(traits_type::to_char_type(c));
+  if (!traits_type::eq_int_type(result, traits_type::eof())) bytes.add();
+  return result;
+}
+
+std::streamsize metrics::CountingBuffer::xsputn(const char* s, std::streamsize n) {
+  const std::streamsize written = target->sputn(s, n);
+  bytes.add(written);
+  return written;
+}
+
+int metrics::CountingBuffer::sync() {
+  return target->pubsync();
+}
+
+struct metrics::Exporter::Metric {
+  enum Type {COUNTER, GAUGE, TIMER, RATE};
+  Type type;
+  std::string name;
+  std::string help;
+  std::string labels;
+  const Counter* counter; // For counters and rates
+  const Gauge* gauge;
+  const Timer* timer;
+  long long lastCount; // Of a rate, at the last write
+};
+
+metrics::Exporter::Exporter(const std::string& fileName, double interval):
+  fileName(fileName),
+  interval(interval),
+  startTime(timing::now()),
+  lastTime(startTime),
+  stopping(false) {
+  if (interval<=0.0) throw std::invalid_argument("metrics interval must be >0");
+}
+
+metrics::Exporter::~Exporter() {
+  if (writer.joinable()) {
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      stopping = true;
+    }
+    stopped.notify_all();
+    writer.join();
+    write(); // The final values
+  }
+}
+
+void metrics::Exporter::add(const std::string& name, const std::string& help,
+                            const Counter& counter, const std::string& labels) {
+  const Metric metric = {Metric::COUNTER, name, help, labels, &counter, 0, 0, 0};
+  entries.push_back(metric);
+}
+
+void metrics::Exporter::add(const std::string& name, const std::string& help,
+                            const Gauge& gauge, const std::string& labels) {
+  const Metric metric = {Metric::GAUGE, name, help, labels, 0, &gauge, 0, 0};
+  entries.push_back(metric);
+}
+
+void metrics::Exporter::add(const std::string& name, const std::string& help,
+                            const Timer& timer, const std::string& labels) {
+  const Metric metric = {Metric::TIMER, name, help, labels, 0, 0, &timer, 0};
+  entries.push_back(metric);
+}
+
+void metrics::Exporter::addRate(const std::string& name, const std::string& help,
+                                const Counter& counter) {
+  const Metric metric = {Metric::RATE, name, help, "", &counter, 0, 0, counter.value()};
+  entries.push_back(metric);
+}
+
+void metrics::Exporter::start() {
+  if (writer.joinable()) throw std::logic_error("metrics exporter already started");
+  startTime = lastTime = timing::now();
+  // Write the file once first, so a file that can't be written is reported
+  // before processing starts
+  if (!write()) throw std::runtime_error("Failed to write metrics file \""+fileName+"\"");
+  writer = boost::thread(boost::bind(&Exporter::run, this));
+}
+
+void metrics::Exporter::run() {
+  boost::mutex::scoped_lock lock(mutex);
+  while (!stopping) {
+    const boost::system_time deadline =
+      boost::get_system_time()+boost::posix_time::microseconds(static_cast<long long>(1e6*interval));
+    while (!stopping && stopped.timed_wait(lock, deadline)) {}
+    if (stopping) break;
+    if (!write()) std::cerr << "Failed to write metrics file \"" << fileName << "\"" << std::endl;
+  }
+}
+
+// Writes a new file, then renames it over the old one
+const bool metrics::Exporter::write() {
+  const double now = timing::now();
+  const double elapsed = now-lastTime;
+  std::ostringstream text;
+  text.precision(10);
+  std::string lastName;
+  for (std::vector<Metric>::iterator m = entries.begin(); m!=entries.end(); ++m) {
+    const std::string series = (m->labels.empty() ? m->name : m->name+"{"+m->labels+"}");
+    if (m->name!=lastName) {
+      text << "# HELP " << m->name << " " << m->help << "\n";
+      text << "# TYPE " << m->name << ((m->type==Metric::GAUGE || m->type==Metric::RATE) ? " gauge" : " counter") << "\n";
+      lastName = m->name;
+    }
+    switch (m->type) {
+      case Metric::COUNTER:
+        text << series << " " << m->counter->value() << "\n";
+        break;
+      case Metric::GAUGE:
+        text << series << " " << m->gauge->value() << "\n";
+        break;
+      case Metric::TIMER:
+        text << series << " " << m->timer->value() << "\n";
+        break;
+      case Metric::RATE:
+        {
+          const long long count = m->counter->value();
+          text << series << " " << (elapsed>0.0 ? (count-m->lastCount)/elapsed : 0.0) << "\n";
+          text << "# HELP " << m->name << "_average " << m->help << " (average since start)\n";
+          text << "# TYPE " << m->name << "_average gauge\n";
+          text << m->name << "_average " << (now>startTime ? count/(now-startTime) : 0.0) << "\n";
+          m->lastCount = count;
+        }
+        break;
+    }
+  }
+  lastTime = now;
+  const std::string tempName = fileName+".tmp";
+  {
+    std::ofstream file(tempName.c_str());
+    file << text.str();
+    if (!file) return false;
+  }
+  return (std::rename(tempName.c_str(), fileName.c_str())==0);
+}
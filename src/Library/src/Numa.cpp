@@ -0,0 +1,135 @@
+/*********************************************************************/
+/* Numa.cpp                                                          */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines NUMA placement functions (using libnuma where available). */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(HAVE_LIBNUMA) && defined(HAVE_NUMA_H) && defined(HAVE_NUMAIF_H)
+#define USE_NUMA
+#endif
+
+#include <vector>
+
+#ifdef USE_NUMA
+#include <unistd.h> // For sysconf
+#include <sched.h> // For sched_getcpu
+#include <numa.h>
+#include <numaif.h>
+#endif
+
+#include "Numa.h"
+
+#ifdef USE_NUMA
+
+namespace {
+
+  // The whole pages within a region of memory
+  struct Pages {
+    Pages(const void* start, std::size_t bytes) {
+      const unsigned long pageSize = sysconf(_SC_PAGESIZE);
+      const unsigned long begin = reinterpret_cast<unsigned long>(start);
+      first = ((begin+pageSize-1)/pageSize)*pageSize;
+      const unsigned long last = ((begin+bytes)/pageSize)*pageSize;
+      count = (last>first) ? (last-first)/pageSize : 0;
+      size = pageSize;
+    }
+    unsigned long first;
+    unsigned long count;
+    unsigned long size;
+  };
+
+} // end unnamed namespace
+
+int numa::nodes() {
+  if (numa_available()<0) return 1;
+  return numa_max_node()+1;
+}
+
+int numa::current_node() {
+  if (nodes()<2) return 0;
+  const int cpu = sched_getcpu();
+  if (cpu<0) return 0;
+  return numa_node_of_cpu(cpu);
+}
+
+void numa::run_on_node(int node) {
+  if (nodes()<2) return;
+  numa_run_on_node(node);
+}
+
+void numa::place(const void* start, std::size_t bytes, int node) {
+  if (nodes()<2) return;
+  const Pages pages(start, bytes);
+  if (pages.count==0) return;
+  std::vector<unsigned long> mask(node/(8*sizeof(unsigned long))+1, 0);
+  mask[node/(8*sizeof(unsigned long))] = 1UL<<(node%(8*sizeof(unsigned long)));
+  // Failure just leaves the pages where they are
+  mbind(reinterpret_cast<void*>(pages.first), pages.count*pages.size,
+        MPOL_BIND, &mask[0], 8*sizeof(unsigned long)*mask.size(), MPOL_MF_MOVE);
+}
+
+const numa::PageCount numa::count_pages(const void* start, std::size_t bytes, int node) {
+  PageCount result;
+  const Pages pages(start, bytes);
+  if ((nodes()<2) || (pages.count==0)) {
+    result.local = pages.count;
+    return result;
+  }
+  std::vector<void*> addresses(pages.count);
+  for (unsigned long p=0; p<pages.count; ++p) {
+    addresses[p] = reinterpret_cast<void*>(pages.first+p*pages.size);
+  }
+  std::vector<int> status(pages.count);
+  if (move_pages(0, pages.count, &addresses[0], 0, &status[0], 0)!=0) return result;
+  for (unsigned long p=0; p<pages.count; ++p) {
+    if (status[p]<0) continue; // Page not present
+    if (status[p]==node) ++result.local;
+    else ++result.remote;
+  }
+  return result;
+}
+
+#else // No NUMA support, so a single node
+
+int numa::nodes() {
+  return 1;
+}
+
+int numa::current_node() {
+  return 0;
+}
+
+void numa::run_on_node(int) {
+}
+
+void numa::place(const void*, std::size_t, int) {
+}
+
+const numa::PageCount numa::count_pages(const void*, std::size_t bytes, int) {
+  PageCount result;
+  result.local = bytes/4096;
+  return result;
+}
+
+#endif
+
+void numa::place(const Array2D& array, int node) {
+  place(array.data(), array.num_elements()*sizeof(Array2D::element), node);
+}
+
+void numa::place(const Picture& picture, int node) {
+  place(picture.y(), node);
+  place(picture.c1(), node);
+  place(picture.c2(), node);
+}
+
+const numa::PageCount numa::count_pages(const Array2D& array, int node) {
+  return count_pages(array.data(), array.num_elements()*sizeof(Array2D::element), node);
+}
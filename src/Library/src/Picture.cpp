@@ -10,8 +10,15 @@
 /*********************************************************************/
 
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <stdexcept> // For invalid_argument
+#include <cstdlib> // For atoi
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/bind/bind.hpp>
 
 #include "Picture.h"
 #include "FrameResolutions.h" //List of frame resolutions (frameResolutions)
@@ -101,6 +108,10 @@ PictureFormat::operator const bool() const {
 
 const ColourFormat PictureFormat::chromaFormat() const {return uvFormat;}
 
+const PictureFormat luma_only_format(const PictureFormat& format) {
+  return PictureFormat(format.lumaHeight(), format.lumaWidth(), 0, 0, format.chromaFormat());
+}
+
 const Shape2D PictureFormat::lumaShape() const {
   Shape2D result = {{yHeight, yWidth}};
   return result; }
@@ -275,28 +286,101 @@ const Picture merge_blocks(const PictureArray& blocks) {
   const int width = luma.shape()[1];
   const ColourFormat colourFormat = blocks[0][0].format().chromaFormat();
   const PictureFormat pictureFormat(height, width, colourFormat);
+  if (chroma1.num_elements()==0) // Luma only blocks
+    return Picture(luma_only_format(pictureFormat), luma, chroma1, chroma2);
   return Picture(pictureFormat, luma, chroma1, chroma2);
 }
 
 // Clip a Picture to specified limits
 // First function clips all components to the same values (good for RGB)
-const Picture clip(const Picture& picture, const int min_value, const int max_value) {
-  Picture result(picture.format());
-  result.y(clip(picture.y(), min_value, max_value));
-  result.c1(clip(picture.c1(), min_value, max_value));
-  result.c2(clip(picture.c2(), min_value, max_value));
+namespace {
+
+  // Pictures with fewer samples than this are processed serially
+  const int minConcurrentSamples = 1<<16;
+
+  typedef void (Picture::*ComponentSetter)(const Array2D&);
+
+  // Sets one component of a picture, keeping any exception for the caller
+  void set_component(Picture& picture,
+                     ComponentSetter setter,
+                     const ComponentFunction& function,
+                     boost::exception_ptr& error) {
+    try {
+      (picture.*setter)(function());
+    }
+    catch (...) {
+      error = boost::current_exception();
+    }
+  }
+
+  // Number of SerialComponents in scope in each thread
+  boost::thread_specific_ptr<int> serialScopes;
+
+  // Selects the Array2D overload of clip, for binding
+  const Array2D clip_component(const Array2D& component, const int min_value, const int max_value) {
+    return clip(component, min_value, max_value);
+  }
+
+} // end unnamed namespace
+
+const Picture concurrent_components(const PictureFormat& format,
+                                    const ComponentFunction& luma,
+                                    const ComponentFunction& chroma1,
+                                    const ComponentFunction& chroma2) {
+  Picture result(format);
+  if ((format.chromaHeight()==0) || (format.chromaWidth()==0)) { // Luma only
+    result.y(luma());
+    return result;
+  }
+  if ((format.samples()<minConcurrentSamples) || (serialScopes.get() && (*serialScopes>0))) {
+    result.y(luma());
+    result.c1(chroma1());
+    result.c2(chroma2());
+    return result;
+  }
+  const ComponentSetter setY = &Picture::y;
+  const ComponentSetter setC1 = &Picture::c1;
+  const ComponentSetter setC2 = &Picture::c2;
+  boost::exception_ptr errors[3];
+  boost::thread c1Thread(boost::bind(set_component, boost::ref(result), setC1,
+                                     boost::cref(chroma1), boost::ref(errors[1])));
+  boost::thread c2Thread(boost::bind(set_component, boost::ref(result), setC2,
+                                     boost::cref(chroma2), boost::ref(errors[2])));
+  set_component(result, setY, luma, errors[0]);
+  c1Thread.join();
+  c2Thread.join();
+  for (int component=0; component<3; ++component) {
+    if (errors[component]) boost::rethrow_exception(errors[component]);
+  }
   return result;
 }
 
+SerialComponents::SerialComponents() {
+  if (!serialScopes.get()) serialScopes.reset(new int(0));
+  ++*serialScopes;
+}
+
+SerialComponents::~SerialComponents() {
+  --*serialScopes;
+}
+
+// Clip a Picture to specified limits
+// First function clips all components to the same values (good for RGB)
+const Picture clip(const Picture& picture, const int min_value, const int max_value) {
+  return concurrent_components(picture.format(),
+                               boost::bind(clip_component, boost::cref(picture.y()), min_value, max_value),
+                               boost::bind(clip_component, boost::cref(picture.c1()), min_value, max_value),
+                               boost::bind(clip_component, boost::cref(picture.c2()), min_value, max_value));
+}
+
 // Second function clips luma and chroma values separately (good for YUV)
 const Picture clip(const Picture& picture,
                    const int luma_min, const int luma_max,
                    const int chroma_min, const int chroma_max) {
-  Picture result(picture.format());
-  result.y(clip(picture.y(), luma_min, luma_max));
-  result.c1(clip(picture.c1(), chroma_min, chroma_max));
-  result.c2(clip(picture.c2(), chroma_min, chroma_max));
-  return result;
+  return concurrent_components(picture.format(),
+                               boost::bind(clip_component, boost::cref(picture.y()), luma_min, luma_max),
+                               boost::bind(clip_component, boost::cref(picture.c1()), chroma_min, chroma_max),
+                               boost::bind(clip_component, boost::cref(picture.c2()), chroma_min, chroma_max));
 }
 
 //**************** IO functions ****************//
@@ -356,6 +440,17 @@ namespace {
       return stream.iword(i);
   }
 
+  // Returns true if pictures are Y4M frames
+  long& picture_y4m(std::ios_base& stream) {
+      static const int i = std::ios_base::xalloc();
+      return stream.iword(i);
+  }
+
+  // Y4M word width for a bit depth (8 bits if not set)
+  const int y4mBytes(std::ios_base& stream, const long bitDepth) {
+    return ((picture_bit_depth(stream) && (bitDepth>8)) ? 2 : 1);
+  }
+
 } // end unnamed namespace
 
 // io format manipulator
@@ -415,20 +510,60 @@ std::istream& operator >> (std::istream& stream, pictureio::offset o) {
   return stream;
 }
 
+// Y4M picture manipulators
+std::ostream& pictureio::y4m(std::ostream& stream) {
+  picture_y4m(stream) = static_cast<long>(true);
+  return stream;
+}
+
+std::istream& pictureio::y4m(std::istream& stream) {
+  picture_y4m(stream) = static_cast<long>(true);
+  return stream;
+}
+
+// Planar picture manipulators
+std::ostream& pictureio::planar(std::ostream& stream) {
+  picture_y4m(stream) = static_cast<long>(false);
+  return stream;
+}
+
+std::istream& pictureio::planar(std::istream& stream) {
+  picture_y4m(stream) = static_cast<long>(false);
+  return stream;
+}
+
+const bool pictureio::isY4MFileName(const std::string& fileName) {
+  const std::string extension(".y4m");
+  return ((fileName.size()>extension.size()) &&
+          (fileName.compare(fileName.size()-extension.size(), extension.size(), extension)==0));
+}
+
 std::istream& operator >> (std::istream& stream, Picture& frame) {
   using arrayio::ioFormat;
   using arrayio::format;
   using arrayio::bitDepth;
   using arrayio::offset;
+  using arrayio::wordWidth;
+  const bool y4m = picture_y4m(stream);
+  if (y4m) {
+    // Each frame starts with a FRAME line (which may have parameters)
+    std::string marker;
+    if (!std::getline(stream, marker)) return stream; // End of file
+    if (marker.compare(0, 5, "FRAME")!=0)
+      throw std::invalid_argument("Y4M FRAME marker not found");
+    stream >> arrayio::right_justified >> arrayio::little_endian;
+  }
   // Set luma data format, bit depth and offset
   if (picture_format(stream)) stream >> format(static_cast<ioFormat>(luma_format(stream)));
   if (picture_bit_depth(stream)) stream >> bitDepth(luma_bit_depth(stream));
   if (picture_offset(stream)) stream >> offset(luma_offset(stream));
+  if (y4m) stream >> wordWidth(y4mBytes(stream, luma_bit_depth(stream)));
   stream >> frame.luma;
   // Set chroma data format, bit depth and offset
   if (picture_format(stream)) stream >> format(static_cast<ioFormat>(chroma_format(stream)));
   if (picture_bit_depth(stream)) stream >> bitDepth(chroma_bit_depth(stream));
   if (picture_offset(stream)) stream >> offset(chroma_offset(stream));
+  if (y4m) stream >> wordWidth(y4mBytes(stream, chroma_bit_depth(stream)));
   stream >> frame.chroma1 >> frame.chroma2;
   return stream;
 }
@@ -438,15 +573,132 @@ std::ostream& operator << (std::ostream& stream, const Picture& frame) {
   using arrayio::format;
   using arrayio::bitDepth;
   using arrayio::offset;
+  using arrayio::wordWidth;
+  const bool y4m = picture_y4m(stream);
+  if (y4m) {
+    stream.write("FRAME\n", 6);
+    stream << arrayio::right_justified << arrayio::little_endian;
+  }
   // Set luma data format, bit depth and offset
   if (picture_format(stream)) stream << format(static_cast<ioFormat>(luma_format(stream)));
   if (picture_bit_depth(stream)) stream << bitDepth(luma_bit_depth(stream));
   if (picture_offset(stream)) stream << offset(luma_offset(stream));
+  if (y4m) stream << wordWidth(y4mBytes(stream, luma_bit_depth(stream)));
   stream << frame.y();
   // Set chroma data format, bit depth and offset
   if (picture_format(stream)) stream << format(static_cast<ioFormat>(chroma_format(stream)));
   if (picture_bit_depth(stream)) stream << bitDepth(chroma_bit_depth(stream));
   if (picture_offset(stream)) stream << offset(chroma_offset(stream));
+  if (y4m) stream << wordWidth(y4mBytes(stream, chroma_bit_depth(stream)));
   stream << frame.c1() << frame.c2();
   return stream;
 }
+
+Y4MHeader::Y4MHeader():
+  height(0), width(0), chromaFormat(UNKNOWN), bitDepth(8),
+  interlaced(false), topFieldFirst(true), rateNumerator(0), rateDenominator(1) {
+}
+
+Y4MHeader::Y4MHeader(const PictureFormat& format, int depth, bool interlace,
+                     bool tff, int rateN, int rateD):
+  height(format.lumaHeight()), width(format.lumaWidth()), chromaFormat(format.chromaFormat()),
+  bitDepth(depth), interlaced(interlace), topFieldFirst(tff),
+  rateNumerator(rateN), rateDenominator(rateD) {
+}
+
+const PictureFormat Y4MHeader::format() const {
+  return PictureFormat(height, width, chromaFormat);
+}
+
+std::istream& operator >> (std::istream& stream, Y4MHeader& header) {
+  std::string line;
+  if (!std::getline(stream, line)) return stream;
+  std::istringstream fields(line);
+  std::string field;
+  fields >> field;
+  if (field!="YUV4MPEG2")
+    throw std::invalid_argument("not a Y4M stream (no YUV4MPEG2 signature)");
+  Y4MHeader result;
+  result.chromaFormat = CF420; // Default if there is no colour space field
+  while (fields >> field) {
+    const std::string value = field.substr(1);
+    switch (field[0]) {
+      case 'W':
+        result.width = std::atoi(value.c_str());
+        break;
+      case 'H':
+        result.height = std::atoi(value.c_str());
+        break;
+      case 'F': {
+          const std::size_t colon = value.find(':');
+          if (colon==std::string::npos)
+            throw std::invalid_argument("invalid Y4M frame rate " + value);
+          result.rateNumerator = std::atoi(value.substr(0, colon).c_str());
+          result.rateDenominator = std::atoi(value.substr(colon+1).c_str());
+        }
+        break;
+      case 'I':
+        if (value=="p") result.interlaced = false;
+        else if (value=="t") {
+          result.interlaced = true;
+          result.topFieldFirst = true;
+        }
+        else if (value=="b") {
+          result.interlaced = true;
+          result.topFieldFirst = false;
+        }
+        else if (value!="?")
+          throw std::invalid_argument("unsupported Y4M interlace mode " + value);
+        break;
+      case 'C': {
+          // e.g. 420jpeg, 420paldv, 422, 444, 420p10, 422p12
+          const std::string subsampling = value.substr(0, 3);
+          if (subsampling=="420") result.chromaFormat = CF420;
+          else if (subsampling=="422") result.chromaFormat = CF422;
+          else if (subsampling=="444") result.chromaFormat = CF444;
+          else throw std::invalid_argument("unsupported Y4M colour space " + value);
+          const std::size_t p = value.find('p', 3);
+          if ((p==3) && (value.size()>4)) result.bitDepth = std::atoi(value.substr(4).c_str());
+          else if ((value.size()>3) && (value!="420jpeg") && (value!="420paldv") && (value!="420mpeg2"))
+            throw std::invalid_argument("unsupported Y4M colour space " + value);
+        }
+        break;
+      default: // Ignore aspect ratio (A), extensions (X) and any others
+        break;
+    }
+  }
+  if ((result.width<1) || (result.height<1))
+    throw std::invalid_argument("Y4M header has no picture size");
+  if ((result.bitDepth<8) || (result.bitDepth>16))
+    throw std::invalid_argument("unsupported Y4M bit depth");
+  header = result;
+  return stream;
+}
+
+std::ostream& operator << (std::ostream& stream, const Y4MHeader& header) {
+  const char* colourSpace;
+  switch (header.chromaFormat) {
+    case CF420:
+      colourSpace = (header.bitDepth>8) ? "420p" : "420jpeg";
+      break;
+    case CF422:
+      colourSpace = (header.bitDepth>8) ? "422p" : "422";
+      break;
+    case CF444:
+      colourSpace = (header.bitDepth>8) ? "444p" : "444";
+      break;
+    default:
+      throw std::invalid_argument("Y4M can only represent 4:2:0, 4:2:2 or 4:4:4 colour formats");
+  }
+  std::ostringstream line;
+  line << "YUV4MPEG2 W" << header.width << " H" << header.height;
+  if (header.rateNumerator>0)
+    line << " F" << header.rateNumerator << ":" << header.rateDenominator;
+  line << " I" << (header.interlaced ? (header.topFieldFirst ? "t" : "b") : "p");
+  line << " A1:1 C" << colourSpace;
+  if (header.bitDepth>8) line << header.bitDepth;
+  line << "\n";
+  const std::string text = line.str();
+  stream.write(text.data(), text.size());
+  return stream;
+}
@@ -11,6 +11,10 @@
 #include "WaveletTransform.h"
 #include "Utils.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <boost/bind/bind.hpp>
+
 using utils::pow;
 
 const int adjust_quant_index(const int qIndex, const int qMatrix) {
@@ -61,6 +65,14 @@ const int quant_factor(int q) {
   return static_cast<int>(lookup[q]);
 }
 
+// Quantisers all become index 0 (the identity) once adjusted by the matrix
+const bool identity_quantisers(const Array2D& qIndices, const Array1D& qMatrix) {
+  if (qIndices.num_elements()==0 || qMatrix.num_elements()==0) return true;
+  const int maxIndex = *std::max_element(qIndices.data(), qIndices.data()+qIndices.num_elements());
+  const int minMatrix = *std::min_element(qMatrix.data(), qMatrix.data()+qMatrix.num_elements());
+  return (adjust_quant_index(maxIndex, minMatrix)==0);
+}
+
 // Quantise according to parameter q
 const int quant(int value, int q) {
   bool negative = (value<0);
@@ -95,6 +107,11 @@ const int scale(int value, int q) {
 const Array2D quantise_block(const ConstView2D& block, int q) {
   // Construct a new array with same size as block
   Array2D quantisedBlock(block.ranges());
+  // Index 0 is the identity (value<<2 divided by 4), so just copy the block
+  if (q<=0) {
+    quantisedBlock = block;
+    return quantisedBlock;
+  }
   const int blockHeight = block.shape()[0];
   const int blockWidth = block.shape()[1];
   for (int y=0; y<blockHeight; ++y) {
@@ -170,6 +187,11 @@ const Array2D inverse_quantise_block(const ConstView2D& block,
 const Array2D inverse_quantise_block(const ConstView2D& block, int q) {
   // Construct a new array with same size as block
   Array2D invQuantisedBlock(block.ranges());
+  // Index 0 is the identity ((4*value+3)/4), so just copy the block
+  if (q<=0) {
+    invQuantisedBlock = block;
+    return invQuantisedBlock;
+  }
   const int blockHeight = block.shape()[0];
   const int blockWidth = block.shape()[1];
   for (int y=0; y<blockHeight; ++y) {
@@ -232,46 +254,26 @@ const Array2D quantise_LLSubband(const ConstView2D& llSubband,
 // Quantise a subband in in-place transform order
 // This version of quantise_subbands assumes multiple quantisers per subband.
 // It may be used for either quantising slices or for quantising subbands with codeblocks
-const Array2D quantise_subbands(const Array2D& coefficients, const BlockVector& qIndices) {
-  const Index transformHeight = coefficients.shape()[0];
-  const Index transformWidth = coefficients.shape()[1];
-  // TO DO: Check numberOfSubbands=3n+1 ?
+const Array2D quantise_subbands(const Array2D& coefficients, const BlockVector& qIndices, const int waveletDepthHo) {
+  // TO DO: Check numberOfSubbands=3n+waveletDepthHo+1 ?
   const int numberOfSubbands = qIndices.size();
-  const int waveletDepth = (numberOfSubbands-1)/3;
-  Index stride, offset; // stride is subsampling factor, offset is subsampling phase
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
   Array2D result(coefficients.ranges());
 
+  // ArrayIndices2D objects specify the subset of array elements within a view,
+  // that is they specify the subsampling factor and subsampling phase.
+  // Subands go from zero ("DC") to numberOfSubbands-1 for HH at the highest level
+  const std::vector<ArrayIndices2D> bands =
+    subband_indices(coefficients.shape()[0], coefficients.shape()[1], waveletDepth, waveletDepthHo);
+
   // Create a view of the coefficients, representing the LL subband, quantise it,
   // then assign the result a view of the results array. This puts the quantised
   // LL subband into the result array in in-place transform order.
-  // ArrayIndices2D objects specify the subset of array elements within a view,
-  // that is they specify the subsampling factor and subsampling phase.
-  stride = pow(2, waveletDepth);
-  const ArrayIndices2D LLindices = // LLindices specifies the samples in the LL subband
-    indices[Range(0,transformHeight,stride)][Range(0,transformWidth,stride)];
-  result[LLindices] =
-    quantise_LLSubband(coefficients[LLindices], qIndices[0]);
+  result[bands[0]] = quantise_LLSubband(coefficients[bands[0]], qIndices[0]);
 
   // Next quantise the other subbands
-  // Note: Level numbers go from zero for the lowest ("DC") frequencies to depth for
-  // the high frequencies. This corresponds to the convention in the VC-2 specification.
-  // Subands go from zero ("DC") to numberOfSubbands-1 for HH at the highest level
-  for (char level=1, band=1; level<=waveletDepth; ++level) {
-    stride = pow(2, waveletDepth+1-level);
-    offset = stride/2;
-    // Create a view of coefficients corresponding to a subband, then quantise it
-    //Quantise HL subband
-    const ArrayIndices2D HLindices = // HLindices specifies the samples in the HL subband
-      indices[Range(0,transformHeight,stride)][Range(offset,transformWidth,stride)];
-    result[HLindices] = quantise_block(coefficients[HLindices], qIndices[band++]);
-    //Quantise LH subband
-    const ArrayIndices2D LHindices = // LHindices specifies the samples in the LH subband
-      indices[Range(offset,transformHeight,stride)][Range(0,transformWidth,stride)];
-    result[LHindices] = quantise_block(coefficients[LHindices], qIndices[band++]);
-    //Quantise HH subband
-    const ArrayIndices2D HHindices = // HHindices specifies the samples in the HH subband
-      indices[Range(offset,transformHeight,stride)][Range(offset,transformWidth,stride)];
-    result[HHindices] = quantise_block(coefficients[HHindices], qIndices[band++]);
+  for (int band=1; band<numberOfSubbands; ++band) {
+    result[bands[band]] = quantise_block(coefficients[bands[band]], qIndices[band]);
   }
 
   return result;
@@ -304,45 +306,26 @@ const Array2D inverse_quantise_LLSubband(const ConstView2D& llSubband,
 // Inverse quantise a subband in in-place transform order
 // This version of inverse_quantise_subbands assumes mulitple quantisers per subband.
 // It may be used for either inverse quantising slices or for inverse quantising subbands with codeblocks
-const Array2D inverse_quantise_subbands(const Array2D& coefficients, const BlockVector& qIndices) {
-  const Index transformHeight = coefficients.shape()[0];
-  const Index transformWidth = coefficients.shape()[1];
-  // TO DO: Check numberOfSubbands=3n+1 ?
+const Array2D inverse_quantise_subbands(const Array2D& coefficients, const BlockVector& qIndices, const int waveletDepthHo) {
+  // TO DO: Check numberOfSubbands=3n+waveletDepthHo+1 ?
   const int numberOfSubbands = qIndices.size();
-  const int waveletDepth = (numberOfSubbands-1)/3;
-  Index stride, offset; // stride is subsampling factor, offset is subsampling phase
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
   Array2D result(coefficients.ranges());
 
+  // ArrayIndices2D objects specify the subset of array elements within a view,
+  // that is they specify the subsampling factor and subsampling phase.
+  // Subands go from zero ("DC") to numberOfSubbands-1 for HH at the highest level
+  const std::vector<ArrayIndices2D> bands =
+    subband_indices(coefficients.shape()[0], coefficients.shape()[1], waveletDepth, waveletDepthHo);
+
   // Create a view of the coefficients, representing the LL subband, quantise it,
   // then assign the result a view of the results array. This puts the quantised
   // LL subband into the result array in in-place transform order.
-  // ArrayIndices2D objects specify the subset of array elements within a view,
-  // that is they specify the subsampling factor and subsampling phase.
-  stride = pow(2, waveletDepth);
-  const ArrayIndices2D LLindices = // LLindices specifies the samples in the LL subband
-    indices[Range(0,transformHeight,stride)][Range(0,transformWidth,stride)];
-  result[LLindices] = inverse_quantise_LLSubband(coefficients[LLindices], qIndices[0]);
+  result[bands[0]] = inverse_quantise_LLSubband(coefficients[bands[0]], qIndices[0]);
 
   // Next quantise the other subbands
-  // Note: Level numbers go from zero for the lowest ("DC") frequencies to depth for
-  // the high frequencies. This corresponds to the convention in the VC-2 specification.
-  // Subands go from zero ("DC") to numberOfSubbands-1 for HH at the highest level
-  for (char level=1, band=1; level<=waveletDepth; ++level) {
-    stride = pow(2, waveletDepth+1-level);
-    offset = stride/2;
-    // Create a view of coefficients corresponding to a subband, then quantise it
-    //Quantise HL subband
-    const ArrayIndices2D HLindices = // HLindices specifies the samples in the HL subband
-      indices[Range(0,transformHeight,stride)][Range(offset,transformWidth,stride)];
-    result[HLindices] = inverse_quantise_block(coefficients[HLindices], qIndices[band++]);
-    //Quantise LH subband
-    const ArrayIndices2D LHindices = // LHindices specifies the samples in the LH subband
-      indices[Range(offset,transformHeight,stride)][Range(0,transformWidth,stride)];
-    result[LHindices] = inverse_quantise_block(coefficients[LHindices], qIndices[band++]);
-    //Quantise HH subband
-    const ArrayIndices2D HHindices = // HHindices specifies the samples in the HH subband
-      indices[Range(offset,transformHeight,stride)][Range(offset,transformWidth,stride)];
-    result[HHindices] = inverse_quantise_block(coefficients[HHindices], qIndices[band++]);
+  for (int band=1; band<numberOfSubbands; ++band) {
+    result[bands[band]] = inverse_quantise_block(coefficients[bands[band]], qIndices[band]);
   }
 
   return result;
@@ -352,26 +335,28 @@ const Array2D inverse_quantise_subbands(const Array2D& coefficients, const Block
 // Uses a quantisation matrix
 const Array2D quantise_transform(const Array2D& coefficients,
                                  const Array2D& qIndices,
-                                 const Array1D& qMatrix) {
-  // TO DO: Check numberOfSubbands=3n+1 ?
+                                 const Array1D& qMatrix,
+                                 const int waveletDepthHo) {
+  // TO DO: Check numberOfSubbands=3n+waveletDepthHo+1 ?
   BlockVector aQIndices(qMatrix.ranges());
   const int numberOfSubbands = qMatrix.size();
   for (char band=0; band<numberOfSubbands; ++band) {
     aQIndices[band] = adjust_quant_indices(qIndices, qMatrix[band]);
   }
-  return quantise_subbands(coefficients, aQIndices);
+  return quantise_subbands(coefficients, aQIndices, waveletDepthHo);
 }
 
 const Array2D inverse_quantise_transform(const Array2D& qCoeffs,
                                          const Array2D& qIndices,
-                                         const Array1D& qMatrix) {
-  // TO DO: Check numberOfSubbands=3n+1 ?
+                                         const Array1D& qMatrix,
+                                         const int waveletDepthHo) {
+  // TO DO: Check numberOfSubbands=3n+waveletDepthHo+1 ?
   BlockVector aQIndices(qMatrix.ranges());
   const int numberOfSubbands = qMatrix.size();
   for (char band=0; band<numberOfSubbands; ++band) {
     aQIndices[band] = adjust_quant_indices(qIndices, qMatrix[band]);
   }
-  return inverse_quantise_subbands(qCoeffs, aQIndices);
+  return inverse_quantise_subbands(qCoeffs, aQIndices, waveletDepthHo);
 }
 
 /***** Non-predictive Quantisation for High Quality Profile *****/
@@ -379,45 +364,26 @@ const Array2D inverse_quantise_transform(const Array2D& qCoeffs,
 // Quantise a subband in in-place transform order (without LL subband prediction)
 // This version of quantise_subbands assumes multiple quantisers per subband.
 // It may be used for either quantising slices or for quantising subbands with codeblocks
-const Array2D quantise_subbands_np(const Array2D& coefficients, const BlockVector& qIndices) {
-  const Index transformHeight = coefficients.shape()[0];
-  const Index transformWidth = coefficients.shape()[1];
-  // TO DO: Check numberOfSubbands=3n+1 ?
+const Array2D quantise_subbands_np(const Array2D& coefficients, const BlockVector& qIndices, const int waveletDepthHo) {
+  // TO DO: Check numberOfSubbands=3n+waveletDepthHo+1 ?
   const int numberOfSubbands = qIndices.size();
-  const int waveletDepth = (numberOfSubbands-1)/3;
-  Index stride, offset; // stride is subsampling factor, offset is subsampling phase
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
   Array2D result(coefficients.ranges());
 
+  // ArrayIndices2D objects specify the subset of array elements within a view,
+  // that is they specify the subsampling factor and subsampling phase.
+  // Subands go from zero ("DC") to numberOfSubbands-1 for HH at the highest level
+  const std::vector<ArrayIndices2D> bands =
+    subband_indices(coefficients.shape()[0], coefficients.shape()[1], waveletDepth, waveletDepthHo);
+
   // Create a view of the coefficients, representing the LL subband, quantise it,
   // then assign the result a view of the results array. This puts the quantised
   // LL subband into the result array in in-place transform order.
-  // ArrayIndices2D objects specify the subset of array elements within a view,
-  // that is they specify the subsampling factor and subsampling phase.
-  stride = pow(2, waveletDepth);
-  const ArrayIndices2D LLindices = // LLindices specifies the samples in the LL subband
-    indices[Range(0,transformHeight,stride)][Range(0,transformWidth,stride)];
-  result[LLindices] = quantise_block(coefficients[LLindices], qIndices[0]);
+  result[bands[0]] = quantise_block(coefficients[bands[0]], qIndices[0]);
 
   // Next quantise the other subbands
-  // Note: Level numbers go from zero for the lowest ("DC") frequencies to depth for
-  // the high frequencies. This corresponds to the convention in the VC-2 specification.
-  // Subands go from zero ("DC") to numberOfSubbands-1 for HH at the highest level
-  for (char level=1, band=1; level<=waveletDepth; ++level) {
-    stride = pow(2, waveletDepth+1-level);
-    offset = stride/2;
-    // Create a view of coefficients corresponding to a subband, then quantise it
-    //Quantise HL subband
-    const ArrayIndices2D HLindices = // HLindices specifies the samples in the LL subband
-      indices[Range(0,transformHeight,stride)][Range(offset,transformWidth,stride)];
-    result[HLindices] = quantise_block(coefficients[HLindices], qIndices[band++]);
-    //Quantise LH subband
-    const ArrayIndices2D LHindices = // LHindices specifies the samples in the LL subband
-      indices[Range(offset,transformHeight,stride)][Range(0,transformWidth,stride)];
-    result[LHindices] = quantise_block(coefficients[LHindices], qIndices[band++]);
-    //Quantise HH subband
-    const ArrayIndices2D HHindices = // HHindices specifies the samples in the LL subband
-      indices[Range(offset,transformHeight,stride)][Range(offset,transformWidth,stride)];
-    result[HHindices] = quantise_block(coefficients[HHindices], qIndices[band++]);
+  for (int band=1; band<numberOfSubbands; ++band) {
+    result[bands[band]] = quantise_block(coefficients[bands[band]], qIndices[band]);
   }
 
   return result;
@@ -426,45 +392,26 @@ const Array2D quantise_subbands_np(const Array2D& coefficients, const BlockVecto
 // Inverse quantise a subband in in-place transform order (without LL subband prediction)
 // This version of inverse_quantise_subbands assumes mulitple quantisers per subband.
 // It may be used for either inverse quantising slices or for inverse quantising subbands with codeblocks
-const Array2D inverse_quantise_subbands_np(const Array2D& coefficients, const BlockVector& qIndices) {
-  const Index transformHeight = coefficients.shape()[0];
-  const Index transformWidth = coefficients.shape()[1];
-  // TO DO: Check numberOfSubbands=3n+1 ?
+const Array2D inverse_quantise_subbands_np(const Array2D& coefficients, const BlockVector& qIndices, const int waveletDepthHo) {
+  // TO DO: Check numberOfSubbands=3n+waveletDepthHo+1 ?
   const int numberOfSubbands = qIndices.size();
-  const int waveletDepth = (numberOfSubbands-1)/3;
-  Index stride, offset; // stride is subsampling factor, offset is subsampling phase
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
   Array2D result(coefficients.ranges());
 
+  // ArrayIndices2D objects specify the subset of array elements within a view,
+  // that is they specify the subsampling factor and subsampling phase.
+  // Subands go from zero ("DC") to numberOfSubbands-1 for HH at the highest level
+  const std::vector<ArrayIndices2D> bands =
+    subband_indices(coefficients.shape()[0], coefficients.shape()[1], waveletDepth, waveletDepthHo);
+
   // Create a view of the coefficients, representing the LL subband, quantise it,
   // then assign the result a view of the results array. This puts the quantised
   // LL subband into the result array in in-place transform order.
-  // ArrayIndices2D objects specify the subset of array elements within a view,
-  // that is they specify the subsampling factor and subsampling phase.
-  stride = pow(2, waveletDepth);
-  const ArrayIndices2D LLindices = // LLindices specifies the samples in the LL subband
-    indices[Range(0,transformHeight,stride)][Range(0,transformWidth,stride)];
-  result[LLindices] = inverse_quantise_block(coefficients[LLindices], qIndices[0]);
+  result[bands[0]] = inverse_quantise_block(coefficients[bands[0]], qIndices[0]);
 
   // Next quantise the other subbands
-  // Note: Level numbers go from zero for the lowest ("DC") frequencies to depth for
-  // the high frequencies. This corresponds to the convention in the VC-2 specification.
-  // Subands go from zero ("DC") to numberOfSubbands-1 for HH at the highest level
-  for (char level=1, band=1; level<=waveletDepth; ++level) {
-    stride = pow(2, waveletDepth+1-level);
-    offset = stride/2;
-    // Create a view of coefficients corresponding to a subband, then quantise it
-    //Quantise HL subband
-    const ArrayIndices2D HLindices = // HLindices specifies the samples in the LL subband
-      indices[Range(0,transformHeight,stride)][Range(offset,transformWidth,stride)];
-    result[HLindices] = inverse_quantise_block(coefficients[HLindices], qIndices[band++]);
-    //Quantise LH subband
-    const ArrayIndices2D LHindices = // LHindices specifies the samples in the LL subband
-      indices[Range(offset,transformHeight,stride)][Range(0,transformWidth,stride)];
-    result[LHindices] = inverse_quantise_block(coefficients[LHindices], qIndices[band++]);
-    //Quantise HH subband
-    const ArrayIndices2D HHindices = // HHindices specifies the samples in the LL subband
-      indices[Range(offset,transformHeight,stride)][Range(offset,transformWidth,stride)];
-    result[HHindices] = inverse_quantise_block(coefficients[HHindices], qIndices[band++]);
+  for (int band=1; band<numberOfSubbands; ++band) {
+    result[bands[band]] = inverse_quantise_block(coefficients[bands[band]], qIndices[band]);
   }
 
   return result;
@@ -474,19 +421,24 @@ const Array2D inverse_quantise_subbands_np(const Array2D& coefficients, const Bl
 // Uses a quantisation matrix
 const Array2D quantise_transform_np(const Array2D& coefficients,
                                     const Array2D& qIndices,
-                                    const Array1D& qMatrix) {
-  // TO DO: Check numberOfSubbands=3n+1 ?
+                                    const Array1D& qMatrix,
+                                    const int waveletDepthHo) {
+  // Lossless coding: quantisation is the identity for every slice and subband
+  if (identity_quantisers(qIndices, qMatrix)) return coefficients;
+  // TO DO: Check numberOfSubbands=3n+waveletDepthHo+1 ?
   BlockVector aQIndices(qMatrix.ranges());
   const int numberOfSubbands = qMatrix.size();
   for (char band=0; band<numberOfSubbands; ++band) {
     aQIndices[band] = adjust_quant_indices(qIndices, qMatrix[band]);
   }
-  return quantise_subbands_np(coefficients, aQIndices);
+  return quantise_subbands_np(coefficients, aQIndices, waveletDepthHo);
 }
 
 // Quantise all the coefficients in a block using
 // the same quantiser index
 const Array2D quantise_block(const Array2D& block, int q) {
+  // Index 0 is the identity, so just copy the block
+  if (q<=0) return block;
   // Construct a new array with same size as block
   Array2D quantisedBlock(block.ranges());
   const int blockHeight = block.shape()[0];
@@ -502,28 +454,34 @@ const Array2D quantise_block(const Array2D& block, int q) {
 // Quantise in-place transformed coefficients (without LL subband prediction)
 const Array2D quantise_transform_np(const Array2D& coefficients,
                                     const int qIndex,
-                                    const Array1D& qMatrix) {
-  // TO DO: Check numberOfSubbands=3n+1 ?
+                                    const Array1D& qMatrix,
+                                    const int waveletDepthHo) {
+  // Lossless coding: quantisation is the identity for every subband
+  if (adjust_quant_index(qIndex, *std::min_element(qMatrix.begin(), qMatrix.end()))==0) return coefficients;
+  // TO DO: Check numberOfSubbands=3n+waveletDepthHo+1 ?
   const int numberOfSubbands = qMatrix.size();
-  const int waveletDepth = (numberOfSubbands-1)/3;
-  BlockVector subbands = split_into_subbands(coefficients, waveletDepth);
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
+  BlockVector subbands = split_into_subbands(coefficients, waveletDepth, waveletDepthHo);
   for (int band=0; band<numberOfSubbands; ++band) {
     const int aQIndex = adjust_quant_index(qIndex, qMatrix[band]);
     subbands[band] = quantise_block(subbands[band], aQIndex);
   }
-  return merge_subbands(subbands);
+  return merge_subbands(subbands, waveletDepthHo);
 }
 
 const Array2D inverse_quantise_transform_np(const Array2D& qCoeffs,
                                             const Array2D& qIndices,
-                                            const Array1D& qMatrix) {
-  // TO DO: Check numberOfSubbands=3n+1 ?
+                                            const Array1D& qMatrix,
+                                            const int waveletDepthHo) {
+  // Lossless coding: inverse quantisation is the identity everywhere
+  if (identity_quantisers(qIndices, qMatrix)) return qCoeffs;
+  // TO DO: Check numberOfSubbands=3n+waveletDepthHo+1 ?
   BlockVector aQIndices(qMatrix.ranges());
   const int numberOfSubbands = qMatrix.size();
   for (char band=0; band<numberOfSubbands; ++band) {
     aQIndices[band] = adjust_quant_indices(qIndices, qMatrix[band]);
   }
-  return inverse_quantise_subbands_np(qCoeffs, aQIndices);
+  return inverse_quantise_subbands_np(qCoeffs, aQIndices, waveletDepthHo);
 }
 
 // Quantise in-place transformed coefficients of a whole picture as slices
@@ -531,22 +489,26 @@ const Array2D inverse_quantise_transform_np(const Array2D& qCoeffs,
 // Uses a quantisation matrix
 const Picture quantise_transform(const Picture& transform,
                                  const Array2D& qIndices,
-                                 const Array1D& qMatrix) {
-  Picture result(transform.format());
-  result.y(quantise_transform(transform.y(), qIndices, qMatrix));
-  result.c1(quantise_transform(transform.c1(), qIndices, qMatrix));
-  result.c2(quantise_transform(transform.c2(), qIndices, qMatrix));
-  return result;
+                                 const Array1D& qMatrix,
+                                 const int waveletDepthHo) {
+  typedef const Array2D (*Component)(const Array2D&, const Array2D&, const Array1D&, const int);
+  const Component component = quantise_transform;
+  return concurrent_components(transform.format(),
+                               boost::bind(component, boost::cref(transform.y()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(transform.c1()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(transform.c2()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo));
 }
 
 const Picture inverse_quantise_transform(const Picture& qCoeffs,
                                          const Array2D& qIndices,
-                                         const Array1D& qMatrix) {
-  Picture result(qCoeffs.format());
-  result.y(inverse_quantise_transform(qCoeffs.y(), qIndices, qMatrix));
-  result.c1(inverse_quantise_transform(qCoeffs.c1(), qIndices, qMatrix));
-  result.c2(inverse_quantise_transform(qCoeffs.c2(), qIndices, qMatrix));
-  return result;
+                                         const Array1D& qMatrix,
+                                         const int waveletDepthHo) {
+  typedef const Array2D (*Component)(const Array2D&, const Array2D&, const Array1D&, const int);
+  const Component component = inverse_quantise_transform;
+  return concurrent_components(qCoeffs.format(),
+                               boost::bind(component, boost::cref(qCoeffs.y()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(qCoeffs.c1()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(qCoeffs.c2()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo));
 }
 
 // Quantise in-place transformed coefficients of a whole picture as slices
@@ -554,31 +516,95 @@ const Picture inverse_quantise_transform(const Picture& qCoeffs,
 // Uses a quantisation matrix
 const Picture quantise_transform_np(const Picture& transform,
                                     const Array2D& qIndices,
-                                    const Array1D& qMatrix) {
-  Picture result(transform.format());
-  result.y(quantise_transform_np(transform.y(), qIndices, qMatrix));
-  result.c1(quantise_transform_np(transform.c1(), qIndices, qMatrix));
-  result.c2(quantise_transform_np(transform.c2(), qIndices, qMatrix));
-  return result;
+                                    const Array1D& qMatrix,
+                                    const int waveletDepthHo) {
+  typedef const Array2D (*Component)(const Array2D&, const Array2D&, const Array1D&, const int);
+  const Component component = quantise_transform_np;
+  return concurrent_components(transform.format(),
+                               boost::bind(component, boost::cref(transform.y()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(transform.c1()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(transform.c2()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo));
 }
 
 // Quantise in-place transformed coefficients (without LL subband prediction)
 const Picture quantise_transform_np(const Picture& transform,
                                     const int qIndex,
-                                    const Array1D& qMatrix) {
-  Picture result(transform.format());
-  result.y(quantise_transform_np(transform.y(), qIndex, qMatrix));
-  result.c1(quantise_transform_np(transform.c1(), qIndex, qMatrix));
-  result.c2(quantise_transform_np(transform.c2(), qIndex, qMatrix));
-  return result;
+                                    const Array1D& qMatrix,
+                                    const int waveletDepthHo) {
+  typedef const Array2D (*Component)(const Array2D&, const int, const Array1D&, const int);
+  const Component component = quantise_transform_np;
+  return concurrent_components(transform.format(),
+                               boost::bind(component, boost::cref(transform.y()), qIndex, boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(transform.c1()), qIndex, boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(transform.c2()), qIndex, boost::cref(qMatrix), waveletDepthHo));
 }
 
 const Picture inverse_quantise_transform_np(const Picture& qCoeffs,
                                             const Array2D& qIndices,
-                                            const Array1D& qMatrix) {
-  Picture result(qCoeffs.format());
-  result.y(inverse_quantise_transform_np(qCoeffs.y(), qIndices, qMatrix));
-  result.c1(inverse_quantise_transform_np(qCoeffs.c1(), qIndices, qMatrix));
-  result.c2(inverse_quantise_transform_np(qCoeffs.c2(), qIndices, qMatrix));
-  return result;
+                                            const Array1D& qMatrix,
+                                            const int waveletDepthHo) {
+  typedef const Array2D (*Component)(const Array2D&, const Array2D&, const Array1D&, const int);
+  const Component component = inverse_quantise_transform_np;
+  return concurrent_components(qCoeffs.format(),
+                               boost::bind(component, boost::cref(qCoeffs.y()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(qCoeffs.c1()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo),
+                               boost::bind(component, boost::cref(qCoeffs.c2()), boost::cref(qIndices), boost::cref(qMatrix), waveletDepthHo));
+}
+
+/***** Distortion estimate (without decoding) *****/
+
+namespace {
+
+  // Sum of squared quantisation errors of a subband quantised as slices
+  // (partitioned in the same way as quantise_block)
+  const double subband_error(const ConstView2D& band,
+                               const ConstView2D& qBand,
+                               const Array2D& qIndices,
+                               const int qMatrix) {
+    double sum = 0.0;
+    const int bandHeight = band.shape()[0];
+    const int bandWidth = band.shape()[1];
+    const int yBlocks = qIndices.shape()[0];
+    const int xBlocks = qIndices.shape()[1];
+    for (int y=0, top=0, bottom=bandHeight/yBlocks;
+         y<yBlocks;
+         ++y, top=bottom, bottom=((y+1)*bandHeight/yBlocks) ) {
+      for (int x=0, left=0, right=bandWidth/xBlocks;
+           x<xBlocks;
+           ++x, left=right, right=((x+1)*bandWidth/xBlocks) ) {
+        const int q = adjust_quant_index(qIndices[y][x], qMatrix);
+        if (q==0) continue; // Index 0 is the identity, so there is no error
+        for (int row=top; row<bottom; ++row) {
+          for (int col=left; col<right; ++col) {
+            const double error = band[row][col] - scale(qBand[row][col], q);
+            sum += error*error;
+          }
+        }
+      }
+    }
+    return sum;
+  }
+
+} // end unnamed namespace
+
+const double quantisation_error_np(const Array2D& coefficients,
+                                   const Array2D& qCoeffs,
+                                   const Array2D& qIndices,
+                                   const Array1D& qMatrix,
+                                   const std::vector<float>& gains,
+                                   const int waveletDepthHo) {
+  if (coefficients.num_elements()==0) return 0.0;
+  if (identity_quantisers(qIndices, qMatrix)) return 0.0; // Lossless
+  const int numberOfSubbands = qMatrix.size();
+  const int waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
+  if (static_cast<int>(gains.size())!=numberOfSubbands)
+    throw std::logic_error("quantisation_error_np: a gain is needed for each subband");
+  const std::vector<ArrayIndices2D> bands =
+    subband_indices(coefficients.shape()[0], coefficients.shape()[1], waveletDepth, waveletDepthHo);
+  double sum = 0.0;
+  for (int band=0; band<numberOfSubbands; ++band) {
+    const double gain = gains[band];
+    sum += gain*gain*subband_error(coefficients[bands[band]], qCoeffs[bands[band]], qIndices, qMatrix[band]);
+  }
+  return sum/coefficients.num_elements();
 }
@@ -0,0 +1,280 @@
+/*********************************************************************/
+/* Ranges.cpp                                                        */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines the ranges of values taken by wavelet coefficients.       */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include <algorithm> // For min and max
+#include <iomanip> // For setw
+#include <sstream>
+#include <string>
+#include <stdexcept>
+
+#include "Ranges.h"
+#include "WaveletTransform.h"
+
+ValueRange::ValueRange(): lo(1), hi(0) {
+}
+
+ValueRange::ValueRange(long long min, long long max): lo(min), hi(max) {
+  if (min>max) throw std::invalid_argument("ValueRange: minimum is greater than maximum");
+}
+
+void ValueRange::add(long long value) {
+  if (empty()) lo = hi = value;
+  else {
+    lo = std::min(lo, value);
+    hi = std::max(hi, value);
+  }
+}
+
+void ValueRange::add(const ValueRange& range) {
+  if (range.empty()) return;
+  add(range.lo);
+  add(range.hi);
+}
+
+const bool ValueRange::empty() const {
+  return (lo>hi);
+}
+
+const long long ValueRange::min() const {
+  return lo;
+}
+
+const long long ValueRange::max() const {
+  return hi;
+}
+
+const int ValueRange::bits() const {
+  if (empty()) return 0;
+  int bits = 1; // The sign bit
+  while ((lo<-(1LL<<(bits-1))) || (hi>(1LL<<(bits-1))-1)) ++bits;
+  return bits;
+}
+
+const bool ValueRange::fitsInt16() const {
+  return (bits()<=16);
+}
+
+std::ostream& operator<<(std::ostream& os, const ValueRange& range) {
+  std::ostringstream text;
+  if (range.empty()) text << "-";
+  else text << "[" << range.min() << ", " << range.max() << "] " << range.bits();
+  return os << text.str();
+}
+
+namespace {
+
+  void addAll(std::vector<StepRanges>& to, const std::vector<StepRanges>& from) {
+    if (to.size()<from.size()) to.resize(from.size());
+    for (unsigned int step=0; step<from.size(); ++step) {
+      to[step].filter.add(from[step].filter);
+      to[step].samples.add(from[step].samples);
+    }
+  }
+
+  void addAll(std::vector<LevelRanges>& to, const std::vector<LevelRanges>& from) {
+    if (to.size()<from.size()) to.resize(from.size());
+    for (unsigned int level=0; level<from.size(); ++level) to[level].add(from[level]);
+  }
+
+  void addAll(std::vector<ValueRange>& to, const std::vector<ValueRange>& from) {
+    if (to.size()<from.size()) to.resize(from.size());
+    for (unsigned int band=0; band<from.size(); ++band) to[band].add(from[band]);
+  }
+
+} // end unnamed namespace
+
+void LevelRanges::add(const LevelRanges& level) {
+  input.add(level.input);
+  addAll(horizontal, level.horizontal);
+  addAll(vertical, level.vertical);
+  output.add(level.output);
+}
+
+TransformRanges::TransformRanges(): depth(0), depthHo(0) {
+}
+
+TransformRanges::TransformRanges(int depth, int depthHo):
+  depth(depth), depthHo(depthHo) {
+}
+
+void TransformRanges::add(const TransformRanges& ranges) {
+  if ((ranges.depth!=depth) || (ranges.depthHo!=depthHo))
+    throw std::invalid_argument("TransformRanges: can't merge the ranges of transforms of different depths");
+  addAll(forward, ranges.forward);
+  addAll(inverse, ranges.inverse);
+  addAll(subbands, ranges.subbands);
+  addAll(quantised, ranges.quantised);
+}
+
+namespace {
+
+  // The ranges of the coefficients in each subband of an in place transform
+  const std::vector<ValueRange> subbandRanges(const Array2D& transform, int depth, int depthHo) {
+    const std::vector<ArrayIndices2D> bands =
+      subband_indices(transform.shape()[0], transform.shape()[1], depth, depthHo);
+    std::vector<ValueRange> ranges(bands.size());
+    for (unsigned int band=0; band<bands.size(); ++band) {
+      const ConstView2D subband = transform[bands[band]];
+      const Index height = subband.shape()[0];
+      const Index width = subband.shape()[1];
+      for (Index y=0; y<height; ++y) {
+        for (Index x=0; x<width; ++x) ranges[band].add(subband[y][x]);
+      }
+    }
+    return ranges;
+  }
+
+} // end unnamed namespace
+
+void TransformRanges::addSubbands(const Array2D& transform) {
+  addAll(subbands, subbandRanges(transform, depth, depthHo));
+}
+
+void TransformRanges::addQuantised(const Array2D& coefficients) {
+  addAll(quantised, subbandRanges(coefficients, depth, depthHo));
+}
+
+namespace {
+
+  const bool fits(const std::vector<LevelRanges>& levels, bool filters) {
+    for (std::vector<LevelRanges>::const_iterator level=levels.begin(); level!=levels.end(); ++level) {
+      if (!level->input.fitsInt16() || !level->output.fitsInt16()) return false;
+      for (int direction=0; direction<2; ++direction) {
+        const std::vector<StepRanges>& steps = (direction==0 ? level->horizontal : level->vertical);
+        for (std::vector<StepRanges>::const_iterator step=steps.begin(); step!=steps.end(); ++step) {
+          if (!step->samples.fitsInt16()) return false;
+          if (filters && !step->filter.fitsInt16()) return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  const bool fits(const std::vector<ValueRange>& ranges) {
+    for (std::vector<ValueRange>::const_iterator range=ranges.begin(); range!=ranges.end(); ++range) {
+      if (!range->fitsInt16()) return false;
+    }
+    return true;
+  }
+
+} // end unnamed namespace
+
+const bool int16Storage(const TransformRanges& ranges) {
+  return fits(ranges.forward, false) && fits(ranges.inverse, false) &&
+         fits(ranges.subbands) && fits(ranges.quantised);
+}
+
+const bool int16Lanes(const TransformRanges& ranges) {
+  return int16Storage(ranges) && fits(ranges.forward, true) && fits(ranges.inverse, true);
+}
+
+namespace {
+
+  // Names subbands as VC-2 levels, from 1 for the coarsest, with the DC
+  // subband as level 0
+  const std::string subbandName(int band, int depth, int depthHo) {
+    static const char* const names[] = {"HL", "LH", "HH"};
+    std::ostringstream name;
+    if (band==0) name << "Level 0 " << (depthHo>0 ? "L" : "LL");
+    else if (band<=depthHo) name << "Level " << band << " H";
+    else name << "Level " << depthHo+1+(band-1-depthHo)/3 << " " << names[(band-1-depthHo)%3];
+    return name.str();
+  }
+
+  const int labelWidth = 34;
+  const int rangeWidth = 30;
+
+  void line(std::ostream& os, const std::string& label, const ValueRange& measured,
+            const ValueRange* bound) {
+    os << "  " << std::left << std::setw(labelWidth) << label
+       << std::setw(rangeWidth) << measured;
+    if (bound) os << *bound;
+    os << std::right << "\n";
+  }
+
+  // Bounds of a level, step, or subband, if known
+  const LevelRanges* boundLevel(const TransformRanges* bounds, unsigned int level) {
+    if (!bounds || (level>=bounds->forward.size())) return 0;
+    return &bounds->forward[level];
+  }
+
+  const StepRanges* boundStep(const std::vector<StepRanges>* steps, unsigned int step) {
+    if (!steps || (step>=steps->size())) return 0;
+    return &(*steps)[step];
+  }
+
+  const ValueRange* boundBand(const TransformRanges* bounds, unsigned int band) {
+    if (!bounds || (band>=bounds->subbands.size())) return 0;
+    return &bounds->subbands[band];
+  }
+
+  void reportLevels(std::ostream& os, const std::vector<LevelRanges>& levels,
+                    const TransformRanges* bounds, int depth, int depthHo, bool forward) {
+    for (unsigned int index=0; index<levels.size(); ++index) {
+      // Levels are numbered as VC-2, from 1 for the coarsest
+      const int number = (forward ? depth+depthHo-index : index+1);
+      const bool horizontalOnly = (number<=depthHo);
+      std::ostringstream name;
+      name << "Level " << number << (horizontalOnly ? " (horizontal only)" : "");
+      const LevelRanges& level = levels[index];
+      const LevelRanges* bound = (forward ? boundLevel(bounds, index) : 0);
+      line(os, name.str()+" input", level.input, bound ? &bound->input : 0);
+      for (int pass=0; pass<2; ++pass) {
+        const bool vertical = (forward ? (pass==1) : (pass==0));
+        const std::vector<StepRanges>& steps = (vertical ? level.vertical : level.horizontal);
+        const std::vector<StepRanges>* boundSteps = (bound ? (vertical ? &bound->vertical : &bound->horizontal) : 0);
+        for (unsigned int s=0; s<steps.size(); ++s) {
+          std::ostringstream step;
+          step << "  " << (vertical ? "vertical" : "horizontal") << " step " << s+1;
+          const StepRanges* boundS = boundStep(boundSteps, s);
+          line(os, step.str()+" filter", steps[s].filter, boundS ? &boundS->filter : 0);
+          line(os, step.str()+" samples", steps[s].samples, boundS ? &boundS->samples : 0);
+        }
+      }
+      line(os, name.str()+" output", level.output, bound ? &bound->output : 0);
+    }
+  }
+
+  const std::string verdict(bool measured, const TransformRanges* bounds, bool bound) {
+    std::string text = (measured ? "yes" : "no");
+    if (bounds) text += (bound ? " (worst case forward transform: yes)" : " (worst case forward transform: no)");
+    return text;
+  }
+
+} // end unnamed namespace
+
+void reportRanges(std::ostream& os, const TransformRanges& measured,
+                  const TransformRanges* bounds) {
+  const int depth = measured.depth;
+  const int depthHo = measured.depthHo;
+  os << "  " << std::left << std::setw(labelWidth) << "Values: [min, max] bits"
+     << std::setw(rangeWidth) << "measured" << (bounds ? "worst case" : "") << std::right << "\n";
+  if (!measured.forward.empty()) {
+    os << "  Forward transform\n";
+    reportLevels(os, measured.forward, bounds, depth, depthHo, true);
+  }
+  if (!measured.subbands.empty()) {
+    os << "  Transform coefficients\n";
+    for (unsigned int band=0; band<measured.subbands.size(); ++band) {
+      line(os, subbandName(band, depth, depthHo), measured.subbands[band], boundBand(bounds, band));
+    }
+  }
+  if (!measured.quantised.empty()) {
+    os << "  Quantised coefficients\n";
+    for (unsigned int band=0; band<measured.quantised.size(); ++band) {
+      line(os, subbandName(band, depth, depthHo), measured.quantised[band], boundBand(bounds, band));
+    }
+  }
+  if (!measured.inverse.empty()) {
+    os << "  Inverse transform (of the quantised coefficients)\n";
+    reportLevels(os, measured.inverse, 0, depth, depthHo, false);
+  }
+  os << "  Fits int16 storage: " << verdict(int16Storage(measured), bounds, bounds && int16Storage(*bounds)) << "\n";
+  os << "  Fits int16 lanes: " << verdict(int16Lanes(measured), bounds, bounds && int16Lanes(*bounds)) << "\n";
+}
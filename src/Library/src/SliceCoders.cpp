@@ -0,0 +1,312 @@
+/*********************************************************************/
+/* SliceCoders.cpp                                                   */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines the generic and compile time specialised slice coders.    */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include <stdexcept>
+
+#include "SliceCoders.h"
+#include "VLC.h"
+
+namespace {
+
+  //**** Operations applied to each coefficient in coding order ****//
+
+  // Coefficients are addressed by their offset (y*width+x) within the slice
+
+  struct Write {
+    Write(std::ostream& s, const int* c): stream(s), coeffs(c) {};
+    void operator()(int i) {stream << SignedVLC(coeffs[i]);}
+    std::ostream& stream;
+    const int* const coeffs;
+  };
+
+  struct WritePair {
+    WritePair(std::ostream& s, const int* u, const int* v): stream(s), uCoeffs(u), vCoeffs(v) {};
+    void operator()(int i) {
+      stream << SignedVLC(uCoeffs[i]);
+      stream << SignedVLC(vCoeffs[i]);
+    }
+    std::ostream& stream;
+    const int* const uCoeffs;
+    const int* const vCoeffs;
+  };
+
+  struct Read {
+    Read(std::istream& s, int* c): stream(s), coeffs(c) {};
+    void operator()(int i) {
+      stream >> inVLC;
+      coeffs[i] = inVLC;
+    }
+    std::istream& stream;
+    int* const coeffs;
+    SignedVLC inVLC;
+  };
+
+  struct ReadPair {
+    ReadPair(std::istream& s, int* u, int* v): stream(s), uCoeffs(u), vCoeffs(v) {};
+    void operator()(int i) {
+      stream >> inVLC;
+      uCoeffs[i] = inVLC;
+      stream >> inVLC;
+      vCoeffs[i] = inVLC;
+    }
+    std::istream& stream;
+    int* const uCoeffs;
+    int* const vCoeffs;
+    SignedVLC inVLC;
+  };
+
+  // Trailing zeros (one bit each) need not be coded, so count only up to
+  // the last coefficient that needs more than one bit.
+  struct Count {
+    Count(const int* c): coeffs(c), gross(0), count(0) {};
+    void operator()(int i) {
+      const int numBits = SignedVLC(coeffs[i]).numOfBits();
+      gross += numBits;
+      if (numBits>1) count=gross;
+    }
+    const int* const coeffs;
+    int gross;
+    int count;
+  };
+
+  struct CountPair {
+    CountPair(const int* u, const int* v): uCoeffs(u), vCoeffs(v), gross(0), count(0) {};
+    void operator()(int i) {
+      int numBits = SignedVLC(uCoeffs[i]).numOfBits();
+      gross += numBits;
+      if (numBits>1) count=gross;
+      numBits = SignedVLC(vCoeffs[i]).numOfBits();
+      gross += numBits;
+      if (numBits>1) count=gross;
+    }
+    const int* const uCoeffs;
+    const int* const vCoeffs;
+    int gross;
+    int count;
+  };
+
+  //**** Generic scan, for any slice geometry ****//
+
+  // Visit each coefficient of a height x width in place transform in the
+  // order of subband_indices (see WaveletTransform.cpp)
+  template <class Op>
+  void scan_band(Op& op, int height, int width,
+                 int yStride, int yOffset, int xStride, int xOffset) {
+    for (int y=yOffset; y<height; y+=yStride) {
+      for (int x=xOffset; x<width; x+=xStride) {
+        op(y*width+x);
+      }
+    }
+  }
+
+  template <class Op>
+  void scan_slice(Op& op, int height, int width, int depth, int depthHo) {
+    const int yStride = 1<<depth;
+    int stride = 1<<(depth+depthHo);
+    scan_band(op, height, width, yStride, 0, stride, 0); // DC
+    for (int level=1; level<=depthHo; ++level) {
+      stride = 1<<(depth+depthHo+1-level);
+      scan_band(op, height, width, yStride, 0, stride, stride/2); // H
+    }
+    for (int level=1; level<=depth; ++level) {
+      stride = 1<<(depth+1-level);
+      const int offset = stride/2;
+      scan_band(op, height, width, stride, 0, stride, offset); // HL
+      scan_band(op, height, width, stride, offset, stride, 0); // LH
+      scan_band(op, height, width, stride, offset, stride, offset); // HH
+    }
+  }
+
+  //**** Specialised scan, geometry fixed at compile time ****//
+
+  // All loop bounds and strides are constants so the compiler may unroll the
+  // scan and fold the coefficient offsets into the addressing.
+  template <int height, int width, int yStride, int yOffset, int xStride, int xOffset, class Op>
+  inline void scan_band(Op& op) {
+    for (int y=yOffset; y<height; y+=yStride) {
+      for (int x=xOffset; x<width; x+=xStride) {
+        op(y*width+x);
+      }
+    }
+  }
+
+  template <int height, int width, int depth, int level, bool done = (level>depth)>
+  struct ScanLevels {
+    enum {stride = 1<<(depth+1-level), offset = stride/2};
+    template <class Op>
+    static void scan(Op& op) {
+      scan_band<height, width, stride, 0, stride, offset>(op); // HL
+      scan_band<height, width, stride, offset, stride, 0>(op); // LH
+      scan_band<height, width, stride, offset, stride, offset>(op); // HH
+      ScanLevels<height, width, depth, level+1>::scan(op);
+    }
+  };
+
+  template <int height, int width, int depth, int level>
+  struct ScanLevels<height, width, depth, level, true> {
+    template <class Op>
+    static void scan(Op&) {}
+  };
+
+  template <int height, int width, int depth, class Op>
+  inline void scan_slice(Op& op) {
+    scan_band<height, width, (1<<depth), 0, (1<<depth), 0>(op); // DC
+    ScanLevels<height, width, depth, 1>::scan(op);
+  }
+
+  template <int height, int width, int depth>
+  void write_fixed(std::ostream& stream, const int* coeffs) {
+    Write op(stream, coeffs);
+    scan_slice<height, width, depth>(op);
+  }
+
+  template <int height, int width, int depth>
+  void write_pair_fixed(std::ostream& stream, const int* u, const int* v) {
+    WritePair op(stream, u, v);
+    scan_slice<height, width, depth>(op);
+  }
+
+  template <int height, int width, int depth>
+  void read_fixed(std::istream& stream, int* coeffs) {
+    Read op(stream, coeffs);
+    scan_slice<height, width, depth>(op);
+  }
+
+  template <int height, int width, int depth>
+  void read_pair_fixed(std::istream& stream, int* u, int* v) {
+    ReadPair op(stream, u, v);
+    scan_slice<height, width, depth>(op);
+  }
+
+  template <int height, int width, int depth>
+  int bits_fixed(const int* coeffs) {
+    Count op(coeffs);
+    scan_slice<height, width, depth>(op);
+    return op.count;
+  }
+
+  template <int height, int width, int depth>
+  int pair_bits_fixed(const int* u, const int* v) {
+    CountPair op(u, v);
+    scan_slice<height, width, depth>(op);
+    return op.count;
+  }
+
+  //**** Registry of specialised coders ****//
+
+  struct SliceCoder {
+    int height;
+    int width;
+    int depth;
+    void (*write)(std::ostream&, const int*);
+    void (*writePair)(std::ostream&, const int*, const int*);
+    void (*read)(std::istream&, int*);
+    void (*readPair)(std::istream&, int*, int*);
+    int (*bits)(const int*);
+    int (*pairBits)(const int*, const int*);
+  };
+
+  #define FIXED_CODER(h, w, d) \
+    {h, w, d, write_fixed<h, w, d>, write_pair_fixed<h, w, d>, \
+     read_fixed<h, w, d>, read_pair_fixed<h, w, d>, \
+     bits_fixed<h, w, d>, pair_bits_fixed<h, w, d>}
+
+  // Luma and chroma slice shapes used for HD (depth 3) and UHD (depth 4)
+  const SliceCoder registry[] = {
+    FIXED_CODER(8, 8, 3),   FIXED_CODER(8, 16, 3),   FIXED_CODER(8, 32, 3),
+    FIXED_CODER(8, 64, 3),  FIXED_CODER(8, 128, 3),
+    FIXED_CODER(16, 8, 3),  FIXED_CODER(16, 16, 3),  FIXED_CODER(16, 32, 3),
+    FIXED_CODER(16, 64, 3), FIXED_CODER(16, 128, 3),
+    FIXED_CODER(16, 16, 4), FIXED_CODER(16, 32, 4),  FIXED_CODER(16, 64, 4),
+    FIXED_CODER(16, 128, 4),
+    FIXED_CODER(32, 16, 4), FIXED_CODER(32, 32, 4),  FIXED_CODER(32, 64, 4),
+    FIXED_CODER(32, 128, 4)
+  };
+
+  #undef FIXED_CODER
+
+  // Returns the specialised coder for a slice geometry, or 0 if there is none
+  const SliceCoder* find_coder(int height, int width, int depth, int depthHo) {
+    if (depthHo!=0) return 0;
+    const int entries = sizeof(registry)/sizeof(registry[0]);
+    for (int i=0; i<entries; ++i) {
+      const SliceCoder& coder = registry[i];
+      if ((coder.height==height) && (coder.width==width) && (coder.depth==depth))
+        return &coder;
+    }
+    return 0;
+  }
+
+  const SliceCoder* find_coder(const Array2D& slice, int depth, int depthHo) {
+    return find_coder(slice.shape()[0], slice.shape()[1], depth, depthHo);
+  }
+
+} // End unnamed namespace
+
+void slicecoder::write(std::ostream& stream, const Array2D& slice, int depth, int depthHo) {
+  const SliceCoder* coder = find_coder(slice, depth, depthHo);
+  if (coder) coder->write(stream, slice.data());
+  else {
+    Write op(stream, slice.data());
+    scan_slice(op, slice.shape()[0], slice.shape()[1], depth, depthHo);
+  }
+}
+
+void slicecoder::write(std::ostream& stream, const Array2D& u, const Array2D& v, int depth, int depthHo) {
+  if ((u.shape()[0]!=v.shape()[0]) || (u.shape()[1]!=v.shape()[1]))
+    throw std::logic_error("slicecoder::write: component slices differ in shape");
+  const SliceCoder* coder = find_coder(u, depth, depthHo);
+  if (coder) coder->writePair(stream, u.data(), v.data());
+  else {
+    WritePair op(stream, u.data(), v.data());
+    scan_slice(op, u.shape()[0], u.shape()[1], depth, depthHo);
+  }
+}
+
+void slicecoder::read(std::istream& stream, Array2D& slice, int depth, int depthHo) {
+  const SliceCoder* coder = find_coder(slice, depth, depthHo);
+  if (coder) coder->read(stream, slice.data());
+  else {
+    Read op(stream, slice.data());
+    scan_slice(op, slice.shape()[0], slice.shape()[1], depth, depthHo);
+  }
+}
+
+void slicecoder::read(std::istream& stream, Array2D& u, Array2D& v, int depth, int depthHo) {
+  if ((u.shape()[0]!=v.shape()[0]) || (u.shape()[1]!=v.shape()[1]))
+    throw std::logic_error("slicecoder::read: component slices differ in shape");
+  const SliceCoder* coder = find_coder(u, depth, depthHo);
+  if (coder) coder->readPair(stream, u.data(), v.data());
+  else {
+    ReadPair op(stream, u.data(), v.data());
+    scan_slice(op, u.shape()[0], u.shape()[1], depth, depthHo);
+  }
+}
+
+const int slicecoder::bits(const Array2D& slice, int depth, int depthHo) {
+  const SliceCoder* coder = find_coder(slice, depth, depthHo);
+  if (coder) return coder->bits(slice.data());
+  Count op(slice.data());
+  scan_slice(op, slice.shape()[0], slice.shape()[1], depth, depthHo);
+  return op.count;
+}
+
+const int slicecoder::bits(const Array2D& u, const Array2D& v, int depth, int depthHo) {
+  if ((u.shape()[0]!=v.shape()[0]) || (u.shape()[1]!=v.shape()[1]))
+    throw std::logic_error("slicecoder::bits: component slices differ in shape");
+  const SliceCoder* coder = find_coder(u, depth, depthHo);
+  if (coder) return coder->pairBits(u.data(), v.data());
+  CountPair op(u.data(), v.data());
+  scan_slice(op, u.shape()[0], u.shape()[1], depth, depthHo);
+  return op.count;
+}
+
+const bool slicecoder::specialised(int height, int width, int depth, int depthHo) {
+  return (find_coder(height, width, depth, depthHo)!=0);
+}
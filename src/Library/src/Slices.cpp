@@ -10,6 +10,7 @@
 #include <iostream> //For cin, cout, cerr
 
 #include "Slices.h"
+#include "SliceCoders.h"
 #include "WaveletTransform.h"
 #include "VLC.h"
 #include "Utils.h"
@@ -47,75 +48,23 @@ const Array2D slice_bytes(const int ySlices, const int xSlices, const int totalB
   return bytes;
 }
 
-const int luma_slice_bits(const Array2D& lumaSlice, const char waveletDepth) {
-  const int numberOfSubbands = 3*waveletDepth+1;
-  const BlockVector subbands = split_into_subbands(lumaSlice, waveletDepth);
-  int count = 0;
-  int gross = 0;
-  for (int band=0; band<numberOfSubbands; ++band) {
-    const Array2D& subband = subbands[band];
-    const int height = subband.shape()[0];
-    const int width = subband.shape()[1];
-    for (int y=0; y<height; ++y) {
-      for (int x=0; x<width; ++x) {
-        const int numBits = SignedVLC(subband[y][x]).numOfBits();
-        gross += numBits;
-        if (numBits>1) count=gross;
-      }
-    }
-  }
-  return count;
+const int luma_slice_bits(const Array2D& lumaSlice, const char waveletDepth, const char waveletDepthHo) {
+  return slicecoder::bits(lumaSlice, waveletDepth, waveletDepthHo);
 }
 
-const int chroma_slice_bits(const Array2D& uSlice, const Array2D& vSlice, const char waveletDepth) {
-  const int numberOfSubbands = 3*waveletDepth+1;
-  const BlockVector uSubbands = split_into_subbands(uSlice, waveletDepth);
-  const BlockVector vSubbands = split_into_subbands(vSlice, waveletDepth);
-  int count = 0;
-  int gross = 0;
-  for (int band=0; band<numberOfSubbands; ++band) {
-    const Array2D& uSubband = uSubbands[band];
-    const Array2D& vSubband = vSubbands[band];
-    // TO DO: Check uSubband & vSubband have the same shape?
-    const int height = uSubband.shape()[0];
-    const int width = uSubband.shape()[1];
-    for (int y=0; y<height; ++y) {
-      for (int x=0; x<width; ++x) {
-        int numBits = SignedVLC(uSubband[y][x]).numOfBits();
-        gross += numBits;
-        if (numBits>1) count=gross;
-        numBits = SignedVLC(vSubband[y][x]).numOfBits();
-        gross += numBits;
-        if (numBits>1) count=gross;
-      }
-    }
-  }
-  return count;
+const int chroma_slice_bits(const Array2D& uSlice, const Array2D& vSlice, const char waveletDepth, const char waveletDepthHo) {
+  return slicecoder::bits(uSlice, vSlice, waveletDepth, waveletDepthHo);
 }
 
-const int component_slice_bytes(const Array2D& slice, const char waveletDepth, const int scalar) {
-  const int numberOfSubbands = 3*waveletDepth+1;
-  const BlockVector subbands = split_into_subbands(slice, waveletDepth);
-  int count = 0;
-  int gross = 0;
-  for (int band=0; band<numberOfSubbands; ++band) {
-    const Array2D& subband = subbands[band];
-    const int height = subband.shape()[0];
-    const int width = subband.shape()[1];
-    for (int y=0; y<height; ++y) {
-      for (int x=0; x<width; ++x) {
-        const int numBits = SignedVLC(subband[y][x]).numOfBits();
-        gross += numBits;
-        if (numBits>1) count=gross;
-      }
-    }
-  }
+const int component_slice_bytes(const Array2D& slice, const char waveletDepth, const int scalar, const char waveletDepthHo) {
+  const int count = slicecoder::bits(slice, waveletDepth, waveletDepthHo);
   return (((count+7)/8 + scalar - 1)/scalar)*scalar; // return whole number of scalar byte units
 }
 
 SliceQuantiser::SliceQuantiser(const Array2D& coefficients,
                                int vSlices, int hSlices,
-                               const Array1D& quantMatrix):
+                               const Array1D& quantMatrix,
+                               int depthHo):
   ySlices(vSlices),
   xSlices(hSlices),
   coeffsHeight(coefficients.shape()[0]),
@@ -123,8 +72,10 @@ SliceQuantiser::SliceQuantiser(const Array2D& coefficients,
   sliceHeight(coeffsHeight/vSlices),
   sliceWidth(coeffsWidth/hSlices),
   numberOfSubbands(quantMatrix.size()),
-  waveletDepth((numberOfSubbands-1)/3),
+  waveletDepthHo(depthHo),
+  waveletDepth((numberOfSubbands-waveletDepthHo-1)/3),
   transformSize(utils::pow(2, waveletDepth)),
+  transformWidth(utils::pow(2, waveletDepth+waveletDepthHo)),
   v(0), h(0)
 {
   qSlice.resize(extents[sliceHeight][sliceWidth]);
@@ -144,12 +95,13 @@ const bool SliceQuantiser::next_slice() {
 //**** IO functions ****//
 
 struct Slice {
-    Slice(const Picture& p, int d, int i):
-      yuvSlice(p), waveletDepth(d), qIndex(i) {};
-    Slice(const PictureFormat& f, int d):
-      yuvSlice(f), waveletDepth(d) {};
+    Slice(const Picture& p, int d, int ho, int i):
+      yuvSlice(p), waveletDepth(d), waveletDepthHo(ho), qIndex(i) {};
+    Slice(const PictureFormat& f, int d, int ho):
+      yuvSlice(f), waveletDepth(d), waveletDepthHo(ho) {};
     Picture yuvSlice;
     const int waveletDepth;
+    const int waveletDepthHo;
     int qIndex;
 };
 
@@ -196,48 +148,29 @@ namespace {
       return stream.iword(i);
   }
 
+  // Pointer to samples for slice coding times (zero if not timing)
+  long& slice_times(std::ios_base& stream) {
+      static const int i = std::ios_base::xalloc();
+      return stream.iword(i);
+  }
+
   std::ostream& LDSliceIO(std::ostream& stream, const Slice& s) {
     //Get slice size from the stream
     const int sliceSize = static_cast<int>(single_slice_size(stream));
 
-    const BlockVector ySliceSubbands = split_into_subbands(s.yuvSlice.y(), s.waveletDepth);
-    const BlockVector uSliceSubbands = split_into_subbands(s.yuvSlice.c1(), s.waveletDepth);
-    const BlockVector vSliceSubbands = split_into_subbands(s.yuvSlice.c2(), s.waveletDepth);
-
     stream << Bits(7, s.qIndex);
 
-    const int yBits = luma_slice_bits(s.yuvSlice.y(), s.waveletDepth);
+    const int yBits = luma_slice_bits(s.yuvSlice.y(), s.waveletDepth, s.waveletDepthHo);
     const int uvSplitBits = utils::intlog2(8*sliceSize-7);
     const int uvBits = 8*sliceSize - 7 - uvSplitBits - yBits;
     stream << Bits(uvSplitBits, yBits);
 
-    const int numberOfSubbands = 3*s.waveletDepth+1;
     stream << vlc::bounded(yBits);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      const Array2D& ySubband = ySliceSubbands[band];
-      const int height = ySubband.shape()[0];
-      const int width = ySubband.shape()[1];
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream << SignedVLC(ySubband[y][x]);
-        }
-      }
-    }
+    slicecoder::write(stream, s.yuvSlice.y(), s.waveletDepth, s.waveletDepthHo);
     stream << vlc::flush;
 
     stream << vlc::bounded(uvBits);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      const Array2D& uSubband = uSliceSubbands[band];
-      const Array2D& vSubband = vSliceSubbands[band];
-      const int height = uSubband.shape()[0];
-      const int width = uSubband.shape()[1];
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream << SignedVLC(uSubband[y][x]);
-          stream << SignedVLC(vSubband[y][x]);
-        }
-      }
-    }
+    slicecoder::write(stream, s.yuvSlice.c1(), s.yuvSlice.c2(), s.waveletDepth, s.waveletDepthHo);
     stream << vlc::flush << vlc::align;
     return stream;
   }
@@ -245,9 +178,9 @@ namespace {
   std::istream& LDSliceIO(std::istream& stream, Slice& s) {
     const int sliceSize = static_cast<int>(single_slice_size(stream));
 
-    BlockVector ySliceSubbands = split_into_subbands(s.yuvSlice.y(), s.waveletDepth);
-    BlockVector uSliceSubbands = split_into_subbands(s.yuvSlice.c1(), s.waveletDepth);
-    BlockVector vSliceSubbands = split_into_subbands(s.yuvSlice.c2(), s.waveletDepth);
+    Array2D ySlice(s.yuvSlice.format().lumaShape());
+    Array2D uSlice(s.yuvSlice.format().chromaShape());
+    Array2D vSlice(s.yuvSlice.format().chromaShape());
 
     Bits q(7);
     stream >> q;
@@ -259,109 +192,51 @@ namespace {
     yBits = yb;
     const int uvBits = 8*sliceSize - 7 - uvSplitBits - yBits;
 
-    const int numberOfSubbands = 3*s.waveletDepth+1;
     stream >> vlc::bounded(yBits);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      Array2D& ySubband = ySliceSubbands[band];
-      const int height = ySubband.shape()[0];
-      const int width = ySubband.shape()[1];
-      SignedVLC inVLC;
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream >> inVLC;
-          ySubband[y][x] = inVLC;
-        }
-      }
-    }
+    slicecoder::read(stream, ySlice, s.waveletDepth, s.waveletDepthHo);
     stream >> vlc::flush;
 
     stream >> vlc::bounded(uvBits);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      Array2D& uSubband = uSliceSubbands[band];
-      Array2D& vSubband = vSliceSubbands[band];
-      const int height = uSubband.shape()[0];
-      const int width = uSubband.shape()[1];
-      // TO DO: Check u and v subbands have the same shape?
-      SignedVLC inVLC;
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream >> inVLC;
-          uSubband[y][x] = inVLC;
-          stream >> inVLC;
-          vSubband[y][x] = inVLC;
-        }
-      }
-    }
+    if (uSlice.num_elements()) // Chroma is skipped for luma only slices
+      slicecoder::read(stream, uSlice, vSlice, s.waveletDepth, s.waveletDepthHo);
     stream >> vlc::flush >> vlc::align;
 
-    s.yuvSlice.y(merge_subbands(ySliceSubbands));
-    s.yuvSlice.c1(merge_subbands(uSliceSubbands));
-    s.yuvSlice.c2(merge_subbands(vSliceSubbands));
+    s.yuvSlice.y(ySlice);
+    s.yuvSlice.c1(uSlice);
+    s.yuvSlice.c2(vSlice);
 
     return stream;
   }
 
   std::ostream& HQSliceIO_CBR(std::ostream& stream, const Slice& s) {
     const int sliceSize = static_cast<int>(single_slice_size(stream));
-
-    const BlockVector ySliceSubbands = split_into_subbands(s.yuvSlice.y(), s.waveletDepth);
-    const BlockVector uSliceSubbands = split_into_subbands(s.yuvSlice.c1(), s.waveletDepth);
-    const BlockVector vSliceSubbands = split_into_subbands(s.yuvSlice.c2(), s.waveletDepth);
-    const int numberOfSubbands = 3*s.waveletDepth+1;
     const int scalar = slice_scalar(stream);
 
     stream << Bytes(1, s.qIndex);
 
     // Output first (y/luma) component
-    const int yBytes = component_slice_bytes(s.yuvSlice.y(), s.waveletDepth, scalar);
+    const int yBytes = component_slice_bytes(s.yuvSlice.y(), s.waveletDepth, scalar, s.waveletDepthHo);
     stream << Bytes(1, yBytes/scalar);
     stream << vlc::bounded(8*yBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      const Array2D& subband = ySliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream << SignedVLC(subband[y][x]);
-        }
-      }
-    }
+    slicecoder::write(stream, s.yuvSlice.y(), s.waveletDepth, s.waveletDepthHo);
     stream << vlc::flush << vlc::align;
 
     // Output secomd (u/c1/chroma) component
-    const int uBytes = component_slice_bytes(s.yuvSlice.c1(), s.waveletDepth, scalar);
+    const int uBytes = component_slice_bytes(s.yuvSlice.c1(), s.waveletDepth, scalar, s.waveletDepthHo);
     stream << Bytes(1, uBytes/scalar);
     stream << vlc::bounded(8*uBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      const Array2D& subband = uSliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream << SignedVLC(subband[y][x]);
-        }
-      }
-    }
+    slicecoder::write(stream, s.yuvSlice.c1(), s.waveletDepth, s.waveletDepthHo);
     stream << vlc::flush << vlc::align;
     
     // Output third (v/c2/chroma) component
     // Calculate bytes left for u, and throw if too few bytes avaiable
     const int vBytes = sliceSize - 4 - yBytes - uBytes;
-    if (vBytes < component_slice_bytes(s.yuvSlice.c2(), s.waveletDepth, scalar) ) {
+    if (vBytes < component_slice_bytes(s.yuvSlice.c2(), s.waveletDepth, scalar, s.waveletDepthHo) ) {
       throw std::logic_error("SliceIO, HQ CBR mode: Too many bytes for the slice");
     }
     stream << Bytes(1, vBytes/scalar);
     stream << vlc::bounded(8*vBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      const Array2D& subband = vSliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream << SignedVLC(subband[y][x]);
-        }
-      }
-    }
+    slicecoder::write(stream, s.yuvSlice.c2(), s.waveletDepth, s.waveletDepthHo);
     stream << vlc::flush << vlc::align;
 
     return stream;
@@ -369,13 +244,12 @@ namespace {
 
   std::istream& HQSliceIO_CBR(std::istream& stream, Slice& s) {
     const int sliceSize = static_cast<int>(single_slice_size(stream));
-
-    BlockVector ySliceSubbands = split_into_subbands(s.yuvSlice.y(), s.waveletDepth);
-    BlockVector uSliceSubbands = split_into_subbands(s.yuvSlice.c1(), s.waveletDepth);
-    BlockVector vSliceSubbands = split_into_subbands(s.yuvSlice.c2(), s.waveletDepth);
-    const int numberOfSubbands = 3*s.waveletDepth+1;
     const int scalar = slice_scalar(stream);
 
+    Array2D ySlice(s.yuvSlice.format().lumaShape());
+    Array2D uSlice(s.yuvSlice.format().chromaShape());
+    Array2D vSlice(s.yuvSlice.format().chromaShape());
+
     Bytes bytes(1);
 
     Bytes q(1);
@@ -386,36 +260,15 @@ namespace {
     stream >> bytes;
     const int yBytes = ((int)bytes)*scalar;
     stream >> vlc::bounded(8*yBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      Array2D& subband = ySliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      SignedVLC inVLC;
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream >> inVLC;
-          subband[y][x] = inVLC;
-        }
-      }
-    }
+    slicecoder::read(stream, ySlice, s.waveletDepth, s.waveletDepthHo);
     stream >> vlc::flush >> vlc::align;
 
     // Input second (u/c1/chroma) component
     stream >> bytes;
     const int uBytes = ((int)bytes)*scalar;
     stream >> vlc::bounded(8*uBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      Array2D& subband = uSliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      SignedVLC inVLC;
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream >> inVLC;
-          subband[y][x] = inVLC;
-        }
-      }
-    }
+    if (uSlice.num_elements()) // Chroma is skipped for luma only slices
+      slicecoder::read(stream, uSlice, s.waveletDepth, s.waveletDepthHo);
     stream >> vlc::flush >> vlc::align;
     
     // Input third (v/c2/chroma) component
@@ -425,94 +278,53 @@ namespace {
     if (vBytes != static_cast<const int>(bytes) )
       throw std::logic_error("SliceIO, HQ CBR mode: Wrong number of bytes for a slice");
     stream >> vlc::bounded(8*vBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      Array2D& subband = vSliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      SignedVLC inVLC;
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream >> inVLC;
-          subband[y][x] = inVLC;
-        }
-      }
-    }
+    if (vSlice.num_elements())
+      slicecoder::read(stream, vSlice, s.waveletDepth, s.waveletDepthHo);
     stream >> vlc::flush >> vlc::align;
 
-    s.yuvSlice.y(merge_subbands(ySliceSubbands));
-    s.yuvSlice.c1(merge_subbands(uSliceSubbands));
-    s.yuvSlice.c2(merge_subbands(vSliceSubbands));
+    s.yuvSlice.y(ySlice);
+    s.yuvSlice.c1(uSlice);
+    s.yuvSlice.c2(vSlice);
 
     return stream;
   }
 
   std::ostream& HQSliceIO_VBR(std::ostream& stream, const Slice& s) {
-    const BlockVector ySliceSubbands = split_into_subbands(s.yuvSlice.y(), s.waveletDepth);
-    const BlockVector uSliceSubbands = split_into_subbands(s.yuvSlice.c1(), s.waveletDepth);
-    const BlockVector vSliceSubbands = split_into_subbands(s.yuvSlice.c2(), s.waveletDepth);
-    const int numberOfSubbands = 3*s.waveletDepth+1;
-
     const int scalar = slice_scalar(stream);
 
     stream << Bytes(1, s.qIndex);
 
     // Output first (y/luma) component
-    const int yBytes = component_slice_bytes(s.yuvSlice.y(), s.waveletDepth, scalar);
+    const int yBytes = component_slice_bytes(s.yuvSlice.y(), s.waveletDepth, scalar, s.waveletDepthHo);
     stream << Bytes(1, yBytes/scalar);
     stream << vlc::bounded(8*yBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      const Array2D& subband = ySliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream << SignedVLC(subband[y][x]);
-        }
-      }
-    }
+    slicecoder::write(stream, s.yuvSlice.y(), s.waveletDepth, s.waveletDepthHo);
     stream << vlc::flush << vlc::align;
 
     // Output secomd (u/c1/chroma) component
-    const int uBytes = component_slice_bytes(s.yuvSlice.c1(), s.waveletDepth, scalar);
+    const int uBytes = component_slice_bytes(s.yuvSlice.c1(), s.waveletDepth, scalar, s.waveletDepthHo);
     stream << Bytes(1, uBytes/scalar);
     stream << vlc::bounded(8*uBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      const Array2D& subband = uSliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream << SignedVLC(subband[y][x]);
-        }
-      }
-    }
+    slicecoder::write(stream, s.yuvSlice.c1(), s.waveletDepth, s.waveletDepthHo);
     stream << vlc::flush << vlc::align;
     
     // Output third (v/c2/chroma) component
-    const int vBytes = component_slice_bytes(s.yuvSlice.c2(), s.waveletDepth, scalar);
+    const int vBytes = component_slice_bytes(s.yuvSlice.c2(), s.waveletDepth, scalar, s.waveletDepthHo);
     stream << Bytes(1, vBytes/scalar);
     stream << vlc::bounded(8*vBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      const Array2D& subband = vSliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream << SignedVLC(subband[y][x]);
-        }
-      }
-    }
+    slicecoder::write(stream, s.yuvSlice.c2(), s.waveletDepth, s.waveletDepthHo);
     stream << vlc::flush << vlc::align;
 
     return stream;
   }
 
   std::istream& HQSliceIO_VBR(std::istream& stream, Slice& s) {
-    BlockVector ySliceSubbands = split_into_subbands(s.yuvSlice.y(), s.waveletDepth);
-    BlockVector uSliceSubbands = split_into_subbands(s.yuvSlice.c1(), s.waveletDepth);
-    BlockVector vSliceSubbands = split_into_subbands(s.yuvSlice.c2(), s.waveletDepth);
-    const int numberOfSubbands = 3*s.waveletDepth+1;
     const int scalar = slice_scalar(stream);
+
+    Array2D ySlice(s.yuvSlice.format().lumaShape());
+    Array2D uSlice(s.yuvSlice.format().chromaShape());
+    Array2D vSlice(s.yuvSlice.format().chromaShape());
+
     Bytes bytes(1);
 
     Bytes q(1);
@@ -523,59 +335,28 @@ namespace {
     stream >> bytes;
     const int yBytes = ((int)bytes)*scalar;
     stream >> vlc::bounded(8*yBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      Array2D& subband = ySliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      SignedVLC inVLC;
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream >> inVLC;
-          subband[y][x] = inVLC;
-        }
-      }
-    }
+    slicecoder::read(stream, ySlice, s.waveletDepth, s.waveletDepthHo);
     stream >> vlc::flush >> vlc::align;
 
     // Input second (u/c1/chroma) component
     stream >> bytes;
     const int uBytes = ((int)bytes)*scalar;
     stream >> vlc::bounded(8*uBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      Array2D& subband = uSliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      SignedVLC inVLC;
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream >> inVLC;
-          subband[y][x] = inVLC;
-        }
-      }
-    }
+    if (uSlice.num_elements()) // Chroma is skipped for luma only slices
+      slicecoder::read(stream, uSlice, s.waveletDepth, s.waveletDepthHo);
     stream >> vlc::flush >> vlc::align;
     
     // Input third (v/c2/chroma) component
     stream >> bytes;
     const int vBytes = ((int)bytes)*scalar;
     stream >> vlc::bounded(8*vBytes);
-    for (int band=0; band<numberOfSubbands; ++band) {
-      Array2D& subband = vSliceSubbands[band];
-      const int height = subband.shape()[0];
-      const int width = subband.shape()[1];
-      SignedVLC inVLC;
-      for (int y=0; y<height; ++y) {
-        for (int x=0; x<width; ++x) {
-          stream >> inVLC;
-          subband[y][x] = inVLC;
-        }
-      }
-    }
+    if (vSlice.num_elements())
+      slicecoder::read(stream, vSlice, s.waveletDepth, s.waveletDepthHo);
     stream >> vlc::flush >> vlc::align;
 
-    s.yuvSlice.y(merge_subbands(ySliceSubbands));
-    s.yuvSlice.c1(merge_subbands(uSliceSubbands));
-    s.yuvSlice.c2(merge_subbands(vSliceSubbands));
+    s.yuvSlice.y(ySlice);
+    s.yuvSlice.c1(uSlice);
+    s.yuvSlice.c2(vSlice);
 
     return stream;
   }
@@ -586,12 +367,12 @@ sliceio::SliceIOMode &sliceio::sliceIOMode(std::ios_base& stream) {
   return reinterpret_cast<sliceio::SliceIOMode &>(slice_IO_format(stream));
 }
 
-Slices::Slices(const PictureArray& s, const int d, const Array2D& i):
-  yuvSlices(s), waveletDepth(d), qIndices(i) {
+Slices::Slices(const PictureArray& s, const int d, const Array2D& i, const int ho):
+  yuvSlices(s), waveletDepth(d), waveletDepthHo(ho), qIndices(i) {
 };
 
-Slices::Slices(const PictureFormat& picFormat, int d,int ySlices, int xSlices):
-    waveletDepth(d) {
+Slices::Slices(const PictureFormat& picFormat, int d,int ySlices, int xSlices, int ho):
+    waveletDepth(d), waveletDepthHo(ho) {
   const int lumaSliceHeight = picFormat.lumaHeight()/ySlices;
   const int lumaSliceWidth = picFormat.lumaWidth()/xSlices;
   const int chromaSliceHeight = picFormat.chromaHeight()/ySlices;
@@ -617,12 +398,16 @@ std::ostream& operator << (std::ostream& stream, const Slices& s) {
   const PictureArray& yuvSlices = s.yuvSlices;
   const Array2D& qIndices = s.qIndices;
   const int waveletDepth = s.waveletDepth;
+  const int waveletDepthHo = s.waveletDepthHo;
   const int ySlices = yuvSlices.shape()[0];
   const int xSlices = yuvSlices.shape()[1];
+  timing::Samples* const times = reinterpret_cast<timing::Samples *>(slice_times(stream));
   for (int v=0; v<ySlices; ++v) {
     for (int h=0; h<xSlices; ++h) {
+      const double start = (times ? timing::now() : 0.0);
       if (bytes_valid) stream << setBytes(bytes[v][h]);
-      stream << Slice(yuvSlices[v][h], waveletDepth, qIndices[v][h]);
+      stream << Slice(yuvSlices[v][h], waveletDepth, waveletDepthHo, qIndices[v][h]);
+      if (times) times->add(timing::now()-start);
     }
   }
   return stream;
@@ -634,17 +419,21 @@ std::istream& operator >> (std::istream& stream, Slices& s) {
   PictureArray& yuvSlices = s.yuvSlices;
   Array2D& qIndices = s.qIndices;
   const int waveletDepth = s.waveletDepth;
+  const int waveletDepthHo = s.waveletDepthHo;
   const int ySlices = yuvSlices.shape()[0];
   const int xSlices = yuvSlices.shape()[1];
+  timing::Samples* const times = reinterpret_cast<timing::Samples *>(slice_times(stream));
   for (int v=0; v<ySlices; ++v) {
     for (int h=0; h<xSlices; ++h) {
-      Slice inSlice(yuvSlices[v][h].format(), waveletDepth);
+      const double start = (times ? timing::now() : 0.0);
+      Slice inSlice(yuvSlices[v][h].format(), waveletDepth, waveletDepthHo);
       if (bytes_valid) stream >> setBytes(bytes[v][h]);
       stream >> inSlice;
       yuvSlices[v][h].y(inSlice.yuvSlice.y());
       yuvSlices[v][h].c1(inSlice.yuvSlice.c1());
       yuvSlices[v][h].c2(inSlice.yuvSlice.c2());
       qIndices[v][h] = inSlice.qIndex;
+      if (times) times->add(timing::now()-start);
     }
   }
   return stream;
@@ -741,6 +530,23 @@ std::istream& operator >> (std::istream& stream, sliceio::highQualityVBR arg) {
   return stream;
 }
 
+// IO format manipulator to time the coding of each slice
+void sliceio::timeSlices::operator()(std::ios_base& stream) const {
+  slice_times(stream) = reinterpret_cast<long>(&times);
+}
+
+// ostream slice timing manipulator
+std::ostream& operator << (std::ostream& stream, sliceio::timeSlices arg) {
+  arg(stream);
+  return stream;
+}
+
+// istream slice timing manipulator
+std::istream& operator >> (std::istream& stream, sliceio::timeSlices arg) {
+  arg(stream);
+  return stream;
+}
+
 // IO format manipulator to set the size of a single slice
 void setBytes::operator()(std::ios_base& stream) const {
   single_slice_size(stream) = bytes;
@@ -0,0 +1,197 @@
+/*********************************************************************/
+/* TaskGraph.cpp                                                     */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines a dependency driven task scheduler.                       */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include <stdexcept>
+
+#include <boost/bind/bind.hpp>
+
+#include "TaskGraph.h"
+
+TaskGraph::TaskGraph(int threads):
+  threadCount(threads>0 ? threads : boost::thread::hardware_concurrency()),
+  groupCount(1),
+  nextTask(0),
+  nextQueue(0),
+  stopping(false) {
+  initialise(Start());
+}
+
+TaskGraph::TaskGraph(int threads, int groups, const Start& start):
+  threadCount(threads>0 ? threads : boost::thread::hardware_concurrency()),
+  groupCount(groups),
+  nextTask(0),
+  nextQueue(0),
+  stopping(false) {
+  initialise(start);
+}
+
+void TaskGraph::initialise(const Start& start) {
+  if (threadCount<1) threadCount = 1; // hardware_concurrency may return 0
+  if (groupCount<1) groupCount = 1;
+  if (groupCount>threadCount) groupCount = threadCount;
+  ready.resize(threadCount);
+  workerGroup.resize(threadCount);
+  groupWorkers.resize(groupCount);
+  nextWorker.resize(groupCount, 0);
+  for (int t=0; t<threadCount; ++t) {
+    workerGroup[t] = (t*groupCount)/threadCount;
+    groupWorkers[workerGroup[t]].push_back(t);
+  }
+  for (int t=0; t<threadCount; ++t) {
+    workers.create_thread(boost::bind(&TaskGraph::worker, this, t, start));
+  }
+}
+
+TaskGraph::~TaskGraph() {
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    while (!nodes.empty()) taskFinished.wait(lock);
+    stopping = true;
+  }
+  workReady.notify_all();
+  workers.join_all();
+}
+
+const TaskGraph::Task TaskGraph::add(const Work& work) {
+  return add(work, Tasks());
+}
+
+const TaskGraph::Task TaskGraph::add(const Work& work, const Task predecessor) {
+  return add(work, Tasks(1, predecessor));
+}
+
+const TaskGraph::Task TaskGraph::add(const Work& work, const Tasks& predecessors) {
+  return add(work, predecessors, -1);
+}
+
+const TaskGraph::Task TaskGraph::add(const Work& work, const Tasks& predecessors, const int group) {
+  boost::mutex::scoped_lock lock(mutex);
+  for (Tasks::const_iterator p=predecessors.begin(); p!=predecessors.end(); ++p) {
+    if ((*p<0) || (*p>=nextTask)) throw std::logic_error("TaskGraph: unknown predecessor");
+  }
+  const Task task = nextTask++;
+  Node& node = nodes[task];
+  node.work = work;
+  node.pending = 0;
+  node.group = ((0<=group) && (group<groupCount)) ? group : -1;
+  for (Tasks::const_iterator p=predecessors.begin(); p!=predecessors.end(); ++p) {
+    // Predecessors no longer in the graph have already finished
+    std::map<Task, Node>::iterator predecessor = nodes.find(*p);
+    if (predecessor==nodes.end()) continue;
+    predecessor->second.successors.push_back(task);
+    ++node.pending;
+  }
+  if (node.pending==0) queue(task, node.group, -1);
+  return task;
+}
+
+void TaskGraph::wait(const Task task) {
+  boost::mutex::scoped_lock lock(mutex);
+  while (nodes.count(task)) taskFinished.wait(lock);
+  if (error) boost::rethrow_exception(error);
+}
+
+void TaskGraph::wait() {
+  boost::mutex::scoped_lock lock(mutex);
+  while (!nodes.empty()) taskFinished.wait(lock);
+  if (error) boost::rethrow_exception(error);
+}
+
+int TaskGraph::size() const {
+  return threadCount;
+}
+
+int TaskGraph::groups() const {
+  return groupCount;
+}
+
+// Queues a ready task, readied by "worker" (-1 if added from outside the
+// workers), for its preferred group. A worker keeps tasks it readied itself
+// unless they prefer another group. Others are shared out in turn.
+// Call with the mutex locked.
+void TaskGraph::queue(const Task task, const int group, const int worker) {
+  if ((worker>=0) && ((group<0) || (group==workerGroup[worker]))) {
+    ready[worker].push_back(task);
+  }
+  else if (group<0) {
+    ready[nextQueue].push_back(task);
+    nextQueue = (nextQueue+1)%threadCount;
+  }
+  else {
+    const std::vector<int>& members = groupWorkers[group];
+    ready[members[nextWorker[group]]].push_back(task);
+    nextWorker[group] = (nextWorker[group]+1)%members.size();
+  }
+  workReady.notify_one();
+}
+
+// Takes the most recently readied task from a worker's own queue, otherwise
+// steals the oldest task from another worker, trying workers in the same group
+// first. Call with the mutex locked.
+bool TaskGraph::take(const int id, Task& task) {
+  if (!ready[id].empty()) {
+    task = ready[id].back();
+    ready[id].pop_back();
+    return true;
+  }
+  for (int pass=0; pass<2; ++pass) {
+    for (int t=1; t<threadCount; ++t) {
+      const int victim = (id+t)%threadCount;
+      const bool sameGroup = (workerGroup[victim]==workerGroup[id]);
+      if ((pass==0)!=sameGroup) continue;
+      if (!ready[victim].empty()) {
+        task = ready[victim].front();
+        ready[victim].pop_front();
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Removes a finished task, queuing any successors it makes ready.
+// Call with the mutex locked.
+void TaskGraph::finish(const Task task, const int id) {
+  std::map<Task, Node>::iterator node = nodes.find(task);
+  const Tasks& successors = node->second.successors;
+  for (Tasks::const_iterator s=successors.begin(); s!=successors.end(); ++s) {
+    Node& successor = nodes[*s];
+    if (--successor.pending==0) queue(*s, successor.group, id);
+  }
+  nodes.erase(node);
+  taskFinished.notify_all();
+}
+
+void TaskGraph::worker(const int id, const Start start) {
+  if (start) start(workerGroup[id]);
+  boost::mutex::scoped_lock lock(mutex);
+  while (true) {
+    Task task;
+    if (!take(id, task)) {
+      if (stopping) return;
+      workReady.wait(lock);
+      continue;
+    }
+    Work work;
+    work.swap(nodes[task].work);
+    const bool skip = error;
+    lock.unlock();
+    boost::exception_ptr failure;
+    try {
+      if (!skip) work();
+    }
+    catch (...) {
+      failure = boost::current_exception();
+    }
+    work.clear(); // Release anything the task holds before it is seen to finish
+    lock.lock();
+    if (failure && !error) error = failure;
+    finish(task, id);
+  }
+}
@@ -0,0 +1,85 @@
+/*********************************************************************/
+/* ThreadPool.cpp                                                    */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines a fixed size pool of worker threads.                      */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include <iostream> // For cerr
+#include <stdexcept>
+#include <limits>
+
+#include <boost/bind/bind.hpp>
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int threads):
+  threadCount(threads>0 ? threads : boost::thread::hardware_concurrency()),
+  submitted(0),
+  busy(0),
+  stopping(false) {
+  if (threadCount<1) threadCount = 1; // hardware_concurrency may return 0
+  for (int t=0; t<threadCount; ++t) {
+    workers.create_thread(boost::bind(&ThreadPool::worker, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    stopping = true;
+  }
+  taskReady.notify_all();
+  workers.join_all();
+}
+
+void ThreadPool::submit(const Task& task) {
+  submit(task, std::numeric_limits<double>::infinity());
+}
+
+void ThreadPool::submit(const Task& task, double deadline) {
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    if (stopping) throw std::logic_error("ThreadPool: task submitted during shutdown");
+    const Queued queued = {task, deadline, submitted++};
+    tasks.push(queued);
+  }
+  taskReady.notify_one();
+}
+
+void ThreadPool::wait() {
+  boost::mutex::scoped_lock lock(mutex);
+  while (!tasks.empty() || busy>0) idle.wait(lock);
+}
+
+int ThreadPool::size() const {
+  return threadCount;
+}
+
+void ThreadPool::worker() {
+  while (true) {
+    Task task;
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      while (tasks.empty() && !stopping) taskReady.wait(lock);
+      // Queued tasks are completed even when stopping
+      if (tasks.empty()) return;
+      task = tasks.top().task;
+      tasks.pop();
+      ++busy;
+    }
+    try {
+      task();
+    }
+    catch (const std::exception& ex) {
+      std::cerr << "ThreadPool: task failed: " << ex.what() << std::endl;
+    }
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      --busy;
+      if (tasks.empty() && busy==0) idle.notify_all();
+    }
+  }
+}
@@ -0,0 +1,95 @@
+/*********************************************************************/
+/* Timing.cpp                                                        */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines a monotonic clock and timing sample statistics.           */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include <algorithm>
+#include <numeric>
+#include <iomanip>
+
+#ifdef _WIN32
+#include <windows.h> // For QueryPerformanceCounter
+#else
+#include <time.h> // For clock_gettime
+#endif
+
+#include "Timing.h"
+
+#ifdef _WIN32
+
+const double timing::now() {
+  LARGE_INTEGER frequency, count;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&count);
+  return static_cast<double>(count.QuadPart)/static_cast<double>(frequency.QuadPart);
+}
+
+#else
+
+const double timing::now() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+#endif
+
+const int timing::Samples::worst() const {
+  if (samples.empty()) return -1;
+  return std::max_element(samples.begin(), samples.end()) - samples.begin();
+}
+
+const double timing::Samples::mean() const {
+  if (samples.empty()) return 0.0;
+  return std::accumulate(samples.begin(), samples.end(), 0.0)/samples.size();
+}
+
+// Nearest rank percentile, so the result is always one of the samples
+const double timing::Samples::percentile(double p) const {
+  if (samples.empty()) return 0.0;
+  std::vector<double> sorted(samples);
+  int rank = static_cast<int>(p*sorted.size() + 0.999999);
+  rank = std::min(std::max(rank, 1), static_cast<int>(sorted.size()));
+  std::nth_element(sorted.begin(), sorted.begin()+(rank-1), sorted.end());
+  return sorted[rank-1];
+}
+
+const int timing::Samples::late(double deadline) const {
+  int count = 0;
+  for (unsigned int i=0; i<samples.size(); ++i) {
+    if (samples[i]>deadline) ++count;
+  }
+  return count;
+}
+
+void timing::lap(Samples& samples, double& start) {
+  const double end = now();
+  samples.add(end-start);
+  start = end;
+}
+
+void timing::summarise(std::ostream& stream, const std::string& label,
+                       const Samples& samples, double scale, const std::string& units) {
+  const std::ios_base::fmtflags flags = stream.flags();
+  const std::streamsize precision = stream.precision();
+  stream << label << " (" << units << "): ";
+  if (samples.count()==0) {
+    stream << "none" << std::endl;
+    return;
+  }
+  stream << std::fixed << std::setprecision(3);
+  stream << "count " << samples.count()
+         << ", mean " << scale*samples.mean()
+         << ", 50% " << scale*samples.percentile(0.5)
+         << ", 90% " << scale*samples.percentile(0.9)
+         << ", 99% " << scale*samples.percentile(0.99)
+         << ", 99.9% " << scale*samples.percentile(0.999)
+         << ", max " << scale*samples[samples.worst()]
+         << " (number " << samples.worst() << ")" << std::endl;
+  stream.flags(flags);
+  stream.precision(precision);
+}
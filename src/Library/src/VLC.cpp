@@ -13,6 +13,7 @@
 #include <istream>
 #include <stdexcept>
 #include <cstdlib> // for abs()
+#include <stdexcept> // for logic_error
 
 #include "VLC.h"
 
@@ -26,6 +27,8 @@ namespace {
       bits = 1;
     }
     else {
+      // Codes are held in 32 bits (with a sign bit for signed values)
+      if (value>65534) throw std::logic_error("VLC: value too large to code");
       value += 1;
 
       //Find top_bit
@@ -235,8 +238,15 @@ std::ostream& vlc::flush(std::ostream& stream) {
 
 // istream flush moves read pointer to end of bounded stream
 // Note: end of bounded stream may not be byte aligned
+// Whole bytes are skipped without reading them bit by bit
 std::istream& vlc::flush(std::istream& stream) {
   if (isBounded(stream)) {
+    while ((bitsLeft(stream)>0) && cachedBits(stream)) getBit(stream);
+    const long bytes = bitsLeft(stream)/8;
+    if (bytes>0) {
+      stream.ignore(bytes);
+      bitsLeft(stream) -= 8*bytes;
+    }
     while (bitsLeft(stream)>0) getBit(stream);
   }
   return stream;
@@ -16,6 +16,10 @@
 #include <string>
 #include <stdexcept> // For invalid_argument
 #include <cfloat> // For FLT_MAX in quantMatrix
+#include <cmath> // For pow and floor
+#include <vector>
+#include <algorithm> // For min, max, fill & reverse
+#include <boost/bind/bind.hpp>
 
 std::ostream& operator<<(std::ostream& os, WaveletKernel kernel) {
   const char* s;
@@ -73,11 +77,11 @@ const int paddedSize(int size, int depth) {
   return cell*((size+cell-1)/cell);
 }
 
-const Array2D waveletPad(const Array2D& picture, int depth) {
+const Array2D waveletPad(const Array2D& picture, int depth, int depthHo) {
   const Index pictureHeight = picture.shape()[0];
   const Index pictureWidth = picture.shape()[1];
   const Index paddedHeight = paddedSize(pictureHeight, depth);
-  const Index paddedWidth = paddedSize(pictureWidth, depth);
+  const Index paddedWidth = paddedSize(pictureWidth, depth+depthHo);
   const Shape2D paddedShape = {{paddedHeight, paddedWidth}};
   Array2D padded(paddedShape);
   for (int line=0; line<paddedHeight; ++line) {
@@ -90,61 +94,273 @@ const Array2D waveletPad(const Array2D& picture, int depth) {
   return padded;
 }
 
-// Forward declarations of functions to implement a single wavelet level
-void waveletLevelDD97(View2D&, unsigned int shift);
-void inverseWaveletLevelDD97(View2D&, unsigned int shift);
-void waveletLevelLeGall(View2D&, unsigned int shift);
-void inverseWaveletLevelLeGall(View2D&, unsigned int shift);
-void waveletLevelDD137(View2D&, unsigned int shift);
-void inverseWaveletLevelDD137(View2D&, unsigned int shift);
-void waveletLevelHaar(View2D&, unsigned int shift);
-void inverseWaveletLevelHaar(View2D&, unsigned int shift);
-void waveletLevelFidelity(View2D&, unsigned int shift);
-void inverseWaveletLevelFidelity(View2D&, unsigned int shift);
-void waveletLevelDaub97(View2D&, unsigned int shift);
-void inverseWaveletLevelDaub97(View2D&, unsigned int shift);
+// Each wavelet kernel is described by a table of lifting steps, which are
+// applied by a single lifting engine, below. Each step lifts either the even
+// or the odd samples (the "target") of a line or column using a weighted sum
+// of the samples of the other parity. Taps are 2 samples apart and, at the
+// edges of the picture, are clamped to the nearest sample of the right parity.
+
+namespace {
+
+  typedef View2D::element Sample;
+
+  struct LiftingStep {
+    int target;     // Samples lifted: 0 for even samples, 1 for odd samples
+    int sign;       // +1 to add, -1 to subtract, the filtered value
+    int firstTap;   // Offset of first tap from the even sample of each pair
+    int taps;       // Number of taps
+    int weights[8];
+    int shift;      // Filtered value is (weighted sum + rounding) >> shift
+  };
+
+  // Forward lifting steps of each kernel (in the order they are applied)
+  const LiftingStep dd97Steps[] = {
+    {1, -1, -2, 4, {-1, 9, 9, -1}, 4}, // Predict
+    {0, +1, -1, 2, {1, 1}, 2}          // Update
+  };
+
+  const LiftingStep leGallSteps[] = {
+    {1, -1, 0, 2, {1, 1}, 1},  // Predict
+    {0, +1, -1, 2, {1, 1}, 2}  // Update
+  };
+
+  const LiftingStep dd137Steps[] = {
+    {1, -1, -2, 4, {-1, 9, 9, -1}, 4}, // Predict
+    {0, +1, -3, 4, {-1, 9, 9, -1}, 5}  // Update
+  };
+
+  const LiftingStep haarSteps[] = {
+    {1, -1, 0, 1, {1}, 0}, // Predict
+    {0, +1, 1, 1, {1}, 1}  // Update
+  };
+
+  const LiftingStep fidelitySteps[] = {
+    {0, +1, -7, 8, {-8, 21, -46, 161, 161, -46, 21, -8}, 8}, // Type 1
+    {1, -1, -6, 8, {-2, 10, -25, 81, 81, -25, 10, -2}, 8}    // Type 4
+  };
+
+  const LiftingStep daub97Steps[] = {
+    {1, -1, 0, 2, {6497, 6497}, 12},  // Type 4
+    {0, -1, -1, 2, {217, 217}, 12},   // Type 2
+    {1, +1, 0, 2, {3616, 3616}, 12},  // Type 3
+    {0, +1, -1, 2, {1817, 1817}, 12}  // Type 1
+  };
+
+  struct LiftingKernel {
+    LiftingKernel(const LiftingStep* first, const LiftingStep* last,
+                  unsigned int s):
+      steps(first, last), shift(s) {};
+    std::vector<LiftingStep> steps;
+    unsigned int shift; // Accuracy bits
+  };
+
+  template <size_t N>
+  const LiftingKernel kernelSteps(const LiftingStep (&steps)[N], unsigned int shift) {
+    return LiftingKernel(steps, steps+N, shift);
+  }
+
+  const LiftingKernel liftingKernel(WaveletKernel kernel) {
+    switch(kernel) {
+      case DD97:
+        // DD97 uses 1 accuracy bit (shift=1)
+        return kernelSteps(dd97Steps, 1);
+      case LeGall:
+        // LeGall uses 1 accuracy bit (shift=1)
+        return kernelSteps(leGallSteps, 1);
+      case DD137:
+        // DD137 uses 1 accuracy bit (shift=1)
+        return kernelSteps(dd137Steps, 1);
+      case Haar0:
+        // Haar0 uses no accuracy bit (shift=0)
+        return kernelSteps(haarSteps, 0);
+      case Haar1:
+        // Haar1 uses 1 accuracy bit (shift=1)
+        return kernelSteps(haarSteps, 1);
+      case Fidelity:
+        // Fidelity uses 1 accuracy bit (shift=0)
+        return kernelSteps(fidelitySteps, 0);
+      case Daub97:
+        // Daub97 uses 1 accuracy bit (shift=1)
+        return kernelSteps(daub97Steps, 1);
+      case NullKernel:
+        // Null Kernel does nothing (for testing)
+        return LiftingKernel(0, 0, 0);
+      default:
+        throw std::invalid_argument("invalid wavelet kernel");
+    }
+  }
+
+  // The inverse undoes the forward steps, in reverse order
+  const LiftingKernel inverseLiftingKernel(WaveletKernel kernel) {
+    LiftingKernel inverse = liftingKernel(kernel);
+    std::reverse(inverse.steps.begin(), inverse.steps.end());
+    for (std::vector<LiftingStep>::iterator step = inverse.steps.begin();
+         step != inverse.steps.end(); ++step) {
+      step->sign = -step->sign;
+    }
+    return inverse;
+  }
+
+  // Index of the first tap of a step, relative to the target, when the even
+  // and odd samples are indexed separately (i.e. in pairs of samples)
+  const Index pairOffset(const LiftingStep& step) {
+    return (step.firstTap-(1-step.target))/2;
+  }
+
+  const Sample rounding(const LiftingStep& step) {
+    return step.shift ? (1<<(step.shift-1)) : 0;
+  }
+
+  // Lifts "size" target samples, "stride" apart, using filtered values in acc
+  void lift(Sample* target, Index stride, const Sample* acc, Index size,
+            const LiftingStep& step) {
+    if (step.sign>0) {
+      for (Index i=0; i<size; ++i) target[i*stride] += (acc[i]>>step.shift);
+    }
+    else {
+      for (Index i=0; i<size; ++i) target[i*stride] -= (acc[i]>>step.shift);
+    }
+  }
+
+  // Applies a lifting step to "pairs" pairs of contiguous even/odd samples.
+  // The loop over the interior, where no taps need clamping, is kept simple
+  // so that the compiler can vectorise it.
+  void liftPairs(std::vector<Sample>& even, std::vector<Sample>& odd,
+                 std::vector<Sample>& acc, Index pairs,
+                 const LiftingStep& step) {
+    std::vector<Sample>& target = step.target ? odd : even;
+    const Sample* source = step.target ? &even[0] : &odd[0];
+    const Index offset = pairOffset(step);
+    const Index first = std::min(pairs, std::max<Index>(0, -offset));
+    const Index last = std::max(first, pairs-std::max<Index>(0, offset+step.taps-1));
+    std::fill(acc.begin(), acc.begin()+pairs, rounding(step));
+    for (int tap=0; tap<step.taps; ++tap) {
+      const Sample weight = step.weights[tap];
+      const Index tapOffset = offset+tap;
+      for (Index i=first; i<last; ++i) acc[i] += weight*source[i+tapOffset];
+      // Taps clamped at the edges
+      for (Index i=0; i<first; ++i) {
+        acc[i] += weight*source[std::min(pairs-1, std::max<Index>(0, i+tapOffset))];
+      }
+      for (Index i=last; i<pairs; ++i) {
+        acc[i] += weight*source[std::min(pairs-1, std::max<Index>(0, i+tapOffset))];
+      }
+    }
+    lift(&target[0], 1, &acc[0], pairs, step);
+  }
+
+  // Horizontal lifting steps for one level. Each line is split into its even
+  // and odd samples, all steps are applied, then the line is recombined.
+  // Forward transforms shift left, to add accuracy bits, as a line is split;
+  // inverse transforms round and shift right as it is recombined.
+  void horizontalLifting(View2D& p, const std::vector<LiftingStep>& steps,
+                         unsigned int shiftIn, unsigned int shiftOut) {
+    const Index height = p.shape()[0];
+    const Index width = p.shape()[1];
+    const Index stride = p.strides()[1];
+    const Index pairs = width/2;
+    const Sample offset = shiftOut ? utils::pow(2, shiftOut-1) : 0;
+    std::vector<Sample> even(pairs), odd(pairs), acc(pairs);
+    for (Index line=0; line<height; ++line) {
+      Sample* samples = &p[line][0];
+      for (Index i=0; i<pairs; ++i) {
+        even[i] = samples[(2*i)*stride] << shiftIn;
+        odd[i] = samples[(2*i+1)*stride] << shiftIn;
+      }
+      for (std::vector<LiftingStep>::const_iterator step = steps.begin();
+           step != steps.end(); ++step) {
+        liftPairs(even, odd, acc, pairs, *step);
+      }
+      for (Index i=0; i<pairs; ++i) {
+        samples[(2*i)*stride] = (even[i]+offset) >> shiftOut;
+        samples[(2*i+1)*stride] = (odd[i]+offset) >> shiftOut;
+      }
+    }
+  }
 
-void waveletLevel(View2D& p, WaveletKernel kernel) {
-  switch(kernel) {
-    case DD97:
-      // DD97 uses 1 accuracy bit (shift=1)
-      waveletLevelDD97(p, 1);
-      break;
-    case LeGall:
-      // LeGall uses 1 accuracy bit (shift=1)
-      waveletLevelLeGall(p, 1);
-      break;
-    case DD137:
-      // DD137 uses 1 accuracy bit (shift=1)
-      waveletLevelDD137(p, 1);
-      break;
-    case Haar0:
-      // Haar0 uses no accuracy bit (shift=0)
-      waveletLevelHaar(p, 0);
-      break;
-    case Haar1:
-      // Haar1 uses 1 accuracy bit (shift=1)
-      waveletLevelHaar(p, 1);
-      break;
-    case Fidelity:
-      // Fidelity uses 1 accuracy bit (shift=0)
-      waveletLevelFidelity(p, 0);
-      break;
-    case Daub97:
-      // Daub97 uses 1 accuracy bit (shift=1)
-      waveletLevelDaub97(p, 1);
-      break;
-    case NullKernel:
-      // Null Kernel does nothing (for testing)
-      break;
-    default:
-      throw std::invalid_argument("invalid wavelet kernel");
+  // Vertical lifting steps for one level. The steps are pipelined down the
+  // picture, each lagging the step before by just enough pairs of lines that
+  // it only reads lines the earlier step has finished with, and only modifies
+  // lines the earlier step no longer reads. The lags follow from the taps.
+  void verticalLifting(View2D& p, const std::vector<LiftingStep>& steps) {
+    const Index height = p.shape()[0];
+    const Index width = p.shape()[1];
+    const Index stride = p.strides()[1];
+    const Index pairs = height/2;
+    const int count = steps.size();
+    std::vector<Index> lag(count, 0);
+    for (int s=1; s<count; ++s) {
+      const Index ahead = pairOffset(steps[s])+steps[s].taps-1;
+      const Index behind = -pairOffset(steps[s-1]);
+      lag[s] = lag[s-1]+std::max<Index>(0, std::max(ahead, behind));
+    }
+    std::vector<Sample> acc(width);
+    for (Index row=0; row<(pairs+lag[count-1]); ++row) {
+      for (int s=0; s<count; ++s) {
+        const LiftingStep& step = steps[s];
+        const Index pair = row-lag[s];
+        if ((pair<0) || (pair>=pairs)) continue;
+        const Index offset = pairOffset(step);
+        std::fill(acc.begin(), acc.end(), rounding(step));
+        for (int tap=0; tap<step.taps; ++tap) {
+          const Index j = std::min(pairs-1, std::max<Index>(0, pair+offset+tap));
+          const Sample weight = step.weights[tap];
+          const Sample* source = &p[2*j+(1-step.target)][0];
+          if (stride==1) {
+            for (Index i=0; i<width; ++i) acc[i] += weight*source[i];
+          }
+          else {
+            for (Index i=0; i<width; ++i) acc[i] += weight*source[i*stride];
+          }
+        }
+        lift(&p[2*pair+step.target][0], stride, &acc[0], width, step);
+      }
+    }
   }
+
+  // Horizontal lifting steps only combine samples in the same row, and
+  // vertical steps only samples in the same column. So the vertical steps
+  // are applied to stripes of columns, small enough that the lines spanned
+  // by the pipelined steps stay in cache. Results are identical to processing
+  // the whole level at once. (Horizontal steps work a line at a time anyway.)
+
+  // Approximate amount of cache used by a stripe
+  const Index cacheBlockBytes = 256*1024;
+  const Index cacheLineBytes = 64;
+  const Index cacheLineSamples = cacheLineBytes/sizeof(Sample);
+
+  void verticalStripes(View2D& p, const std::vector<LiftingStep>& steps) {
+    const Index height = p.shape()[0];
+    const Index width = p.shape()[1];
+    const Index stride = p.strides()[1];
+    // Stripes are a whole number of cache lines wide
+    const Index lineWidth = (stride>=cacheLineSamples) ? 1 : cacheLineSamples/stride;
+    const Index stripeLines = std::max<Index>(1, cacheBlockBytes/(cacheLineBytes*height));
+    const Index stripeWidth = lineWidth*stripeLines;
+    for (Index left=0; left<width; left+=stripeWidth) {
+      View2D stripe = p[indices[Range(0, height)][Range(left, std::min(left+stripeWidth, width))]];
+      verticalLifting(stripe, steps);
+    }
+  }
+
+} // end unnamed namespace
+
+void waveletLevel(View2D& p, WaveletKernel kernel) {
+  const LiftingKernel lifting = liftingKernel(kernel);
+  if (lifting.steps.empty()) return; // Null kernel
+  horizontalLifting(p, lifting.steps, lifting.shift, 0);
+  verticalStripes(p, lifting.steps);
+}
+
+void horizontalWaveletLevel(View2D& p, WaveletKernel kernel) {
+  const LiftingKernel lifting = liftingKernel(kernel);
+  if (lifting.steps.empty()) return; // Null kernel
+  horizontalLifting(p, lifting.steps, lifting.shift, 0);
 }
 
-const Array2D waveletTransform(const Array2D& picture, WaveletKernel kernel, int depth) {
+const Array2D waveletTransform(const Array2D& picture, WaveletKernel kernel, int depth, int depthHo) {
 
-  Array2D transform = waveletPad(picture, depth);
+  Array2D transform = waveletPad(picture, depth, depthHo);
 
   // Iterate over levels
   // Note: Level numbers go from zero for high frequencies to depth for
@@ -160,52 +376,49 @@ const Array2D waveletTransform(const Array2D& picture, WaveletKernel kernel, int
     // Do one level of in place wavelet transform
     waveletLevel(view, kernel);
   }
+  // Then any horizontal only levels, which further split the lowest
+  // frequencies horizontally
+  for (int level=depth; level<depth+depthHo; ++level) {
+    const Index height = transform.shape()[0];
+    const Index width = transform.shape()[1];
+    const Index yStride = utils::pow(2, depth);
+    const Index xStride = utils::pow(2, level);
+    View2D view =
+      transform[indices[Range(0,height,yStride)][Range(0,width,xStride)]];
+    horizontalWaveletLevel(view, kernel);
+  }
   return transform;
 }
 
 void inverseWaveletLevel(View2D& p, WaveletKernel kernel) {
-  switch(kernel) {
-    case DD97:
-      // DD97 uses 1 accuracy bit (shift=1)
-      inverseWaveletLevelDD97(p, 1);
-      break;
-    case LeGall:
-      // LeGall uses 1 accuracy bit (shift=1)
-      inverseWaveletLevelLeGall(p, 1);
-      break;
-    case DD137:
-      // DD137 uses 1 accuracy bit (shift=1)
-      inverseWaveletLevelDD137(p, 1);
-      break;
-    case Haar0:
-      // Haar0 uses no accuracy bit (shift=0)
-      inverseWaveletLevelHaar(p, 0);
-      break;
-    case Haar1:
-      // Haar1 uses 1 accuracy bit (shift=1)
-      inverseWaveletLevelHaar(p, 1);
-      break;
-    case Fidelity:
-      // Fidelity uses 1 accuracy bit (shift=0)
-      inverseWaveletLevelFidelity(p, 0);
-      break;
-    case Daub97:
-      // Daub97 uses 1 accuracy bit (shift=1)
-      inverseWaveletLevelDaub97(p, 1);
-      break;
-    case NullKernel:
-      // Null Kernel does nothing (for testing)
-      break;
-    default:
-      throw std::invalid_argument("invalid wavelet kernel");
-  }
+  const LiftingKernel lifting = inverseLiftingKernel(kernel);
+  if (lifting.steps.empty()) return; // Null kernel
+  verticalStripes(p, lifting.steps);
+  horizontalLifting(p, lifting.steps, 0, lifting.shift);
+}
+
+void inverseHorizontalWaveletLevel(View2D& p, WaveletKernel kernel) {
+  const LiftingKernel lifting = inverseLiftingKernel(kernel);
+  if (lifting.steps.empty()) return; // Null kernel
+  horizontalLifting(p, lifting.steps, 0, lifting.shift);
 }
 
 const Array2D inverseWaveletTransform(const Array2D& transform,
                                       WaveletKernel kernel,
                                       int depth,
-                                      Shape2D shape) {
+                                      Shape2D shape,
+                                      int depthHo) {
   Array2D picture = transform;
+  // Undo any horizontal only levels first
+  for (int level=depth+depthHo-1; level>=depth; --level) {
+    const Index height = picture.shape()[0];
+    const Index width = picture.shape()[1];
+    const Index yStride = utils::pow(2, depth);
+    const Index xStride = utils::pow(2, level);
+    View2D view =
+      picture[indices[Range(0,height,yStride)][Range(0,width,xStride)]];
+    inverseHorizontalWaveletLevel(view, kernel);
+  }
   // Iterate over levels
   // Note: Level numbers go from zero for high frequencies to depth-1 for
   // the lowest frequencies. This is the opposite way round to the level 
@@ -224,62 +437,611 @@ const Array2D inverseWaveletTransform(const Array2D& transform,
   return picture;
 }
 
+// Profiling applies each lifting step to every line (or column) of a level
+// in turn, which gives the same results as the pipelined engine above, and
+// records the range of the values of each step.
+namespace {
+
+  void addRange(const View2D& p, ValueRange& range) {
+    const Index height = p.shape()[0];
+    const Index width = p.shape()[1];
+    for (Index y=0; y<height; ++y) {
+      for (Index x=0; x<width; ++x) range.add(p[y][x]);
+    }
+  }
+
+  // Add accuracy bits (forward) or round and remove them (inverse)
+  void profileShift(View2D& p, unsigned int shiftIn, unsigned int shiftOut, ValueRange& range) {
+    const Index height = p.shape()[0];
+    const Index width = p.shape()[1];
+    const Sample offset = shiftOut ? utils::pow(2, shiftOut-1) : 0;
+    for (Index y=0; y<height; ++y) {
+      for (Index x=0; x<width; ++x) p[y][x] = ((p[y][x]<<shiftIn)+offset)>>shiftOut;
+    }
+    addRange(p, range);
+  }
+
+  void profileStep(View2D& p, const LiftingStep& step, bool vertical, StepRanges& ranges) {
+    const Index lines = p.shape()[vertical ? 1 : 0];
+    const Index length = p.shape()[vertical ? 0 : 1];
+    const Index pairs = length/2;
+    const Index offset = pairOffset(step);
+    std::vector<Sample> samples(length);
+    for (Index line=0; line<lines; ++line) {
+      for (Index i=0; i<length; ++i) samples[i] = (vertical ? p[i][line] : p[line][i]);
+      for (Index pair=0; pair<pairs; ++pair) {
+        Sample acc = rounding(step);
+        for (int tap=0; tap<step.taps; ++tap) {
+          const Index j = std::min(pairs-1, std::max<Index>(0, pair+offset+tap));
+          acc += step.weights[tap]*samples[2*j+(1-step.target)];
+        }
+        ranges.filter.add(acc);
+        Sample& target = samples[2*pair+step.target];
+        if (step.sign>0) target += (acc>>step.shift);
+        else target -= (acc>>step.shift);
+        ranges.samples.add(target);
+      }
+      for (Index i=0; i<length; ++i) (vertical ? p[i][line] : p[line][i]) = samples[i];
+    }
+  }
+
+  // One level, 2D or horizontal only, of the forward or inverse transform
+  void profileLevel(View2D& p, const LiftingKernel& lifting, bool vertical,
+                    bool inverse, LevelRanges& ranges) {
+    const std::vector<LiftingStep>& steps = lifting.steps;
+    if (ranges.horizontal.size()<steps.size()) ranges.horizontal.resize(steps.size());
+    if (vertical && (ranges.vertical.size()<steps.size())) ranges.vertical.resize(steps.size());
+    if (!inverse) {
+      profileShift(p, lifting.shift, 0, ranges.input);
+      for (unsigned int s=0; s<steps.size(); ++s) profileStep(p, steps[s], false, ranges.horizontal[s]);
+      if (vertical) {
+        for (unsigned int s=0; s<steps.size(); ++s) profileStep(p, steps[s], true, ranges.vertical[s]);
+      }
+      addRange(p, ranges.output);
+    }
+    else {
+      addRange(p, ranges.input);
+      if (vertical) {
+        for (unsigned int s=0; s<steps.size(); ++s) profileStep(p, steps[s], true, ranges.vertical[s]);
+      }
+      for (unsigned int s=0; s<steps.size(); ++s) profileStep(p, steps[s], false, ranges.horizontal[s]);
+      profileShift(p, 0, lifting.shift, ranges.output);
+    }
+  }
+
+} // end unnamed namespace
+
+const Array2D profileWaveletTransform(const Array2D& picture, WaveletKernel kernel,
+                                      int depth, int depthHo, TransformRanges& ranges) {
+  TransformRanges profile(depth, depthHo);
+  profile.forward.resize(depth+depthHo);
+  Array2D transform = waveletPad(picture, depth, depthHo);
+  const LiftingKernel lifting = liftingKernel(kernel);
+  const Index height = transform.shape()[0];
+  const Index width = transform.shape()[1];
+  if (!lifting.steps.empty()) { // Null kernel does nothing
+    for (int level=0; level<depth+depthHo; ++level) {
+      const Index yStride = utils::pow(2, std::min(level, depth));
+      const Index xStride = utils::pow(2, level);
+      View2D view = transform[indices[Range(0,height,yStride)][Range(0,width,xStride)]];
+      profileLevel(view, lifting, (level<depth), false, profile.forward[level]);
+    }
+  }
+  profile.addSubbands(transform);
+  ranges.add(profile);
+  return transform;
+}
+
+const Array2D profileInverseWaveletTransform(const Array2D& transform,
+                                             WaveletKernel kernel,
+                                             int depth,
+                                             Shape2D shape,
+                                             int depthHo,
+                                             TransformRanges& ranges) {
+  TransformRanges profile(depth, depthHo);
+  profile.inverse.resize(depth+depthHo);
+  Array2D picture = transform;
+  const LiftingKernel lifting = inverseLiftingKernel(kernel);
+  const Index height = picture.shape()[0];
+  const Index width = picture.shape()[1];
+  if (!lifting.steps.empty()) { // Null kernel does nothing
+    for (int level=depth+depthHo-1; level>=0; --level) {
+      const Index yStride = utils::pow(2, std::min(level, depth));
+      const Index xStride = utils::pow(2, level);
+      View2D view = picture[indices[Range(0,height,yStride)][Range(0,width,xStride)]];
+      profileLevel(view, lifting, (level<depth), true, profile.inverse[depth+depthHo-1-level]);
+    }
+  }
+  ranges.add(profile);
+  picture.resize(shape); // remove wavelet padding
+  return picture;
+}
+
+// Worst case ranges follow from the filter taps. Each value of the
+// transform is a linear function of the input samples, plus the error from
+// rounding each filtered value. Its greatest value is the sum of its
+// positive weights times the greatest input, plus the sum of the magnitudes
+// of its negative weights times the magnitude of the least input, plus the
+// bound of its error (and likewise for its least value). The 2D transform is
+// separable, so its weights are products of the weights of a line (row) and
+// of a column.
+namespace {
+
+  // A sample of a line, as a linear combination of the input samples (the
+  // weights of the input samples from "first" on)
+  struct Response {
+    Index first;
+    std::vector<double> weights;
+    void swap(Response& response) {
+      std::swap(first, response.first);
+      weights.swap(response.weights);
+    }
+  };
+
+  // Add a multiple of one response to another
+  void addResponse(Response& to, const Response& from, double scale) {
+    if (from.weights.empty()) return;
+    if (to.weights.empty()) {
+      to.first = from.first;
+      to.weights.assign(from.weights.size(), 0.0);
+    }
+    const Index first = std::min(to.first, from.first);
+    const Index last = std::max<Index>(to.first+to.weights.size(), from.first+from.weights.size());
+    if ((first<to.first) || (last>to.first+static_cast<Index>(to.weights.size()))) {
+      std::vector<double> weights(last-first, 0.0);
+      std::copy(to.weights.begin(), to.weights.end(), weights.begin()+(to.first-first));
+      to.weights.swap(weights);
+      to.first = first;
+    }
+    for (unsigned int i=0; i<from.weights.size(); ++i) to.weights[from.first-to.first+i] += scale*from.weights[i];
+  }
+
+  // The sum of the positive weights of a value, and the sum of the magnitudes
+  // of its negative weights
+  struct Gain {
+    double positive;
+    double negative;
+  };
+
+  // Gains of the values at all positions, omitting any gain exceeded (in
+  // both sums) by another, since it can't give the greatest or least value
+  typedef std::vector<Gain> Gains;
+
+  void addGain(Gains& gains, const Gain& gain) {
+    for (Gains::const_iterator g = gains.begin(); g != gains.end(); ++g) {
+      if ((g->positive>=gain.positive) && (g->negative>=gain.negative)) return;
+    }
+    Gains kept(1, gain);
+    for (Gains::const_iterator g = gains.begin(); g != gains.end(); ++g) {
+      if ((g->positive>gain.positive) || (g->negative>gain.negative)) kept.push_back(*g);
+    }
+    gains.swap(kept);
+  }
+
+  const Gain gainOf(const Response& response) {
+    Gain gain = {0.0, 0.0};
+    for (unsigned int i=0; i<response.weights.size(); ++i) {
+      if (response.weights[i]>0.0) gain.positive += response.weights[i];
+      else gain.negative -= response.weights[i];
+    }
+    return gain;
+  }
+
+  const Gains gainsOf(const std::vector<Response>& line, Index first, Index stride) {
+    Gains gains;
+    for (Index i=first; i<static_cast<Index>(line.size()); i+=stride) addGain(gains, gainOf(line[i]));
+    return gains;
+  }
+
+  // Gains of the 2D values with the weights of a row times those of a column
+  const Gains product(const Gains& rows, const Gains& columns) {
+    Gains gains;
+    for (Gains::const_iterator r = rows.begin(); r != rows.end(); ++r) {
+      for (Gains::const_iterator c = columns.begin(); c != columns.end(); ++c) {
+        const Gain gain = {r->positive*c->positive + r->negative*c->negative,
+                           r->positive*c->negative + r->negative*c->positive};
+        addGain(gains, gain);
+      }
+    }
+    return gains;
+  }
+
+  const Gains merge(const Gains& first, const Gains& second) {
+    Gains gains(first);
+    for (Gains::const_iterator g = second.begin(); g != second.end(); ++g) addGain(gains, *g);
+    return gains;
+  }
+
+  // Gains of the values of one level of the transform of a line, relative
+  // to the input of the first level (ignoring its accuracy bits)
+  struct LineGains {
+    Gains input;
+    std::vector<Gains> filter;
+    std::vector<Gains> samples;
+    Gains low;
+    Gains high;
+  };
+
+  // Transforms a line long enough that the deepest level has both edges
+  // and an interior, clamping the taps at the edges as the transform does
+  const std::vector<LineGains> lineGains(const LiftingKernel& lifting, int levels) {
+    std::vector<Response> line(16*utils::pow(2, levels));
+    for (unsigned int i=0; i<line.size(); ++i) {
+      line[i].first = i;
+      line[i].weights.assign(1, 1.0);
+    }
+    std::vector<LineGains> gains(levels);
+    for (int level=0; level<levels; ++level) {
+      const Index pairs = line.size()/2;
+      gains[level].input = gainsOf(line, 0, 1);
+      for (std::vector<LiftingStep>::const_iterator step = lifting.steps.begin();
+           step != lifting.steps.end(); ++step) {
+        const Index offset = pairOffset(*step);
+        const double scale = step->sign/std::pow(2.0, step->shift);
+        Gains filter;
+        std::vector<Response> lifted(pairs);
+        for (Index pair=0; pair<pairs; ++pair) {
+          Response acc = {0, std::vector<double>()};
+          for (int tap=0; tap<step->taps; ++tap) {
+            const Index j = std::min(pairs-1, std::max<Index>(0, pair+offset+tap));
+            addResponse(acc, line[2*j+(1-step->target)], step->weights[tap]);
+          }
+          addGain(filter, gainOf(acc));
+          lifted[pair] = line[2*pair+step->target];
+          addResponse(lifted[pair], acc, scale);
+        }
+        for (Index pair=0; pair<pairs; ++pair) line[2*pair+step->target].swap(lifted[pair]);
+        gains[level].filter.push_back(filter);
+        gains[level].samples.push_back(gainsOf(line, step->target, 2));
+      }
+      gains[level].low = gainsOf(line, 0, 2);
+      gains[level].high = gainsOf(line, 1, 2);
+      std::vector<Response> low(pairs);
+      for (Index pair=0; pair<pairs; ++pair) low[pair].swap(line[2*pair]);
+      line.swap(low);
+    }
+    return gains;
+  }
+
+  // Bounds of the errors of the values of one level of the transform of a
+  // line, from rounding the filtered values: for input samples in error by at
+  // most e, the error of a value is at most input*e + rounding
+  struct ErrorGains {
+    double input;
+    double rounding;
+  };
+
+  struct LineErrors {
+    std::vector<ErrorGains> filter;
+    std::vector<ErrorGains> samples;
+    ErrorGains low;
+    ErrorGains high;
+  };
+
+  const double sum(const Response& response) {
+    const Gain gain = gainOf(response);
+    return gain.positive+gain.negative;
+  }
+
+  // A sample, as a linear combination of the input samples (of the level)
+  // and of the errors from rounding each filtered value
+  struct ErrorResponse {
+    Response input;
+    Response rounding;
+  };
+
+  void addErrors(ErrorGains& errors, const ErrorResponse& response) {
+    errors.input = std::max(errors.input, sum(response.input));
+    errors.rounding = std::max(errors.rounding, sum(response.rounding));
+  }
+
+  // Transforms a line of one level, with taps clamped as by the transform.
+  // Rounding to nearest (with the rounding offset) is in error by at most
+  // half, or not at all if there is no shift.
+  const LineErrors lineErrors(const std::vector<LiftingStep>& steps) {
+    const Index pairs = 32;
+    std::vector<ErrorResponse> line(2*pairs);
+    for (unsigned int i=0; i<line.size(); ++i) {
+      line[i].input.first = i;
+      line[i].input.weights.assign(1, 1.0);
+      line[i].rounding.first = 0;
+    }
+    const ErrorGains none = {0.0, 0.0};
+    LineErrors errors;
+    errors.low = errors.high = none;
+    Index error = 0; // Index of the error of each rounding
+    for (std::vector<LiftingStep>::const_iterator step = steps.begin(); step != steps.end(); ++step) {
+      const Index offset = pairOffset(*step);
+      const double scale = step->sign/std::pow(2.0, step->shift);
+      const Response rounded = {0, std::vector<double>(1, step->shift>0 ? 0.5 : 0.0)};
+      ErrorGains filter = none;
+      std::vector<ErrorResponse> lifted(pairs);
+      for (Index pair=0; pair<pairs; ++pair) {
+        ErrorResponse acc;
+        for (int tap=0; tap<step->taps; ++tap) {
+          const Index j = std::min(pairs-1, std::max<Index>(0, pair+offset+tap));
+          addResponse(acc.input, line[2*j+(1-step->target)].input, step->weights[tap]);
+          addResponse(acc.rounding, line[2*j+(1-step->target)].rounding, step->weights[tap]);
+        }
+        addErrors(filter, acc);
+        lifted[pair] = line[2*pair+step->target];
+        addResponse(lifted[pair].input, acc.input, scale);
+        addResponse(lifted[pair].rounding, acc.rounding, scale);
+        Response own(rounded);
+        own.first = error++;
+        addResponse(lifted[pair].rounding, own, 1.0);
+      }
+      // The constant rounding offset is an error of the filtered value
+      filter.rounding += rounding(*step);
+      ErrorGains samples = none;
+      for (Index pair=0; pair<pairs; ++pair) {
+        line[2*pair+step->target] = lifted[pair];
+        addErrors(samples, lifted[pair]);
+      }
+      errors.filter.push_back(filter);
+      errors.samples.push_back(samples);
+    }
+    for (Index pair=0; pair<pairs; ++pair) {
+      addErrors(errors.low, line[2*pair]);
+      addErrors(errors.high, line[2*pair+1]);
+    }
+    return errors;
+  }
+
+  const double errorOf(const ErrorGains& errors, double inputError) {
+    return errors.input*inputError + errors.rounding;
+  }
+
+  // Range of values with the given gains, for input in the given range
+  const ValueRange bound(const Gains& gains, const ValueRange& input, double error) {
+    double min = 0.0;
+    double max = 0.0;
+    for (Gains::const_iterator g = gains.begin(); g != gains.end(); ++g) {
+      min = std::min(min, g->positive*input.min() - g->negative*input.max());
+      max = std::max(max, g->positive*input.max() - g->negative*input.min());
+    }
+    return ValueRange(static_cast<long long>(std::ceil(min-error)),
+                      static_cast<long long>(std::floor(max+error)));
+  }
+
+} // end unnamed namespace
+
+const TransformRanges transformBounds(WaveletKernel kernel, int depth, int depthHo, int bitDepth) {
+  if ((bitDepth<1) || (bitDepth>32)) throw std::invalid_argument("bit depth must be from 1 to 32");
+  TransformRanges bounds(depth, depthHo);
+  bounds.forward.resize(depth+depthHo);
+  bounds.subbands.resize(3*depth+depthHo+1);
+  const LiftingKernel lifting = liftingKernel(kernel);
+  const std::vector<LiftingStep>& steps = lifting.steps;
+  const std::vector<LineGains> gains = lineGains(lifting, depth+depthHo);
+  const LineErrors errors = lineErrors(steps);
+  // Range of the input samples, scaled by the accuracy bits of each level
+  ValueRange input(-(1LL<<(bitDepth-1)), (1LL<<(bitDepth-1))-1);
+  double error = 0.0; // Of the input of each level
+  ValueRange low = input;
+  for (int level=0; level<depth+depthHo; ++level) {
+    const long long scale = utils::pow(2, lifting.shift);
+    input = ValueRange(input.min()*scale, input.max()*scale);
+    error *= scale;
+    LevelRanges& ranges = bounds.forward[level];
+    const LineGains& row = gains[level];
+    const Gains& column = gains[std::min(level, depth)].input; // Low pass columns
+    ranges.input = bound(product(row.input, column), input, error);
+    ranges.horizontal.resize(steps.size());
+    for (unsigned int s=0; s<steps.size(); ++s) {
+      ranges.horizontal[s].filter = bound(product(row.filter[s], column), input, errorOf(errors.filter[s], error));
+      ranges.horizontal[s].samples = bound(product(row.samples[s], column), input, errorOf(errors.samples[s], error));
+    }
+    const double rowError = std::max(errorOf(errors.low, error), errorOf(errors.high, error));
+    if (level<depth) {
+      // Columns are transformed as the rows, whether of low or high pass samples
+      const Gains across = merge(row.low, row.high);
+      ranges.vertical.resize(steps.size());
+      for (unsigned int s=0; s<steps.size(); ++s) {
+        ranges.vertical[s].filter = bound(product(across, row.filter[s]), input, errorOf(errors.filter[s], rowError));
+        ranges.vertical[s].samples = bound(product(across, row.samples[s]), input, errorOf(errors.samples[s], rowError));
+      }
+      const double lowError = errorOf(errors.low, rowError);
+      const double highError = errorOf(errors.high, rowError);
+      low = bound(product(row.low, row.low), input, lowError);
+      const int band = 1+depthHo+3*(depth-1-level);
+      bounds.subbands[band] = bound(product(row.high, row.low), input, lowError);
+      bounds.subbands[band+1] = bound(product(row.low, row.high), input, highError);
+      bounds.subbands[band+2] = bound(product(row.high, row.high), input, highError);
+      ranges.output.add(bounds.subbands[band]);
+      ranges.output.add(bounds.subbands[band+1]);
+      ranges.output.add(bounds.subbands[band+2]);
+      error = lowError;
+    }
+    else {
+      low = bound(product(row.low, column), input, errorOf(errors.low, error));
+      bounds.subbands[depth+depthHo-level] = bound(product(row.high, column), input, errorOf(errors.high, error));
+      ranges.output.add(bounds.subbands[depth+depthHo-level]);
+      error = errorOf(errors.low, error);
+    }
+    ranges.output.add(low);
+  }
+  bounds.subbands[0] = low;
+  // Quantisation never increases the magnitude of a coefficient
+  bounds.quantised = bounds.subbands;
+  return bounds;
+}
+
+// Vertical reach of one level of the lifting steps, for line based
+// processing. For the even and odd samples of each pair, forward[p] is the
+// offset (in samples, from the even sample) of the last input sample used to
+// compute it. For the inverse, inverse[p] is the offset (in pairs) of the
+// last pair of subband samples needed to reconstruct it.
+namespace {
+
+  struct LiftingReach {
+    int forward[2];
+    int inverse[2];
+  };
+
+  const LiftingReach liftingReach(WaveletKernel kernel) {
+    const LiftingKernel lifting = liftingKernel(kernel);
+    LiftingReach reach = {{0, 1}, {0, 0}};
+    for (std::vector<LiftingStep>::const_iterator step = lifting.steps.begin();
+         step != lifting.steps.end(); ++step) {
+      if (step->taps==0) continue;
+      const int source = 1-step->target;
+      const int lastTap = step->firstTap + 2*(step->taps-1) - source;
+      reach.forward[step->target] =
+        std::max(reach.forward[step->target], lastTap + reach.forward[source]);
+    }
+    for (std::vector<LiftingStep>::const_reverse_iterator step = lifting.steps.rbegin();
+         step != lifting.steps.rend(); ++step) {
+      if (step->taps==0) continue;
+      const int source = 1-step->target;
+      const int lastTap = step->firstTap + 2*(step->taps-1) - source;
+      reach.inverse[step->target] =
+        std::max(reach.inverse[step->target], lastTap/2 + reach.inverse[source]);
+    }
+    return reach;
+  }
+
+} // end unnamed namespace
+
+const int last_input_line(WaveletKernel kernel, int depth, int sliceLines, int row) {
+  const LiftingReach reach = liftingReach(kernel);
+  const int lastLine = (row+1)*sliceLines - 1;
+  int last = lastLine;
+  int lowReach = 0; // Reach of the low pass samples of the previous level
+  for (int level=1; level<=depth; ++level) {
+    const int scale = utils::pow(2, level-1);
+    const int highReach = scale*reach.forward[1] + lowReach;
+    lowReach = scale*reach.forward[0] + lowReach;
+    // Last sample of the subbands of this level within the row of slices
+    last = std::max(last, lastLine + 1 - 2*scale + highReach);
+    if (level==depth) last = std::max(last, lastLine + 1 - 2*scale + lowReach);
+  }
+  return last;
+}
+
+const int last_slice_row(WaveletKernel kernel, int depth, int sliceLines, int height, int line) {
+  const LiftingReach reach = liftingReach(kernel);
+  int lastRow = line/sliceLines;
+  int needed = line; // Last line needed at the previous (higher resolution) level
+  for (int level=1; level<=depth; ++level) {
+    int next = (needed>>1) + reach.inverse[needed&1];
+    if (needed>0) next = std::max(next, ((needed-1)>>1) + reach.inverse[(needed-1)&1]);
+    needed = std::min(next, (height>>level)-1);
+    lastRow = std::max(lastRow, needed/(sliceLines>>level));
+  }
+  return lastRow;
+}
+
+// The gains of a wavelet kernel, used to weight its subbands (in quantMatrix
+// and subband_gains). alpha and beta are the gains (L2 norms) of the low and
+// high pass synthesis filters, and shift is the number of bits by which each
+// level of the inverse transform scales down its output. dc is the gain of
+// the LL subband of each 2D level for a constant picture (as measured from
+// the integer transform).
+namespace {
+
+  struct KernelGains {
+    float alpha;
+    float beta;
+    int shift;
+    float dc;
+  };
+
+  const KernelGains kernelGains(WaveletKernel kernel) {
+    KernelGains gains;
+    switch(kernel) {
+      case DD97:
+        gains.alpha = 1.280868846f;
+        gains.beta = 0.820572875f;
+        gains.shift = 1;
+        gains.dc = 2.0f;
+        break;
+      case LeGall:
+        gains.alpha = 1.224744871f;
+        gains.beta = 0.847791248f;
+        gains.shift = 1;
+        gains.dc = 2.0f;
+        break;
+      case DD137:
+        gains.alpha = 1.280868846f;
+        gains.beta = 0.809253958f;
+        gains.shift = 1;
+        gains.dc = 2.0f;
+        break;
+      case Haar0:
+        gains.alpha = 1.414213562f;
+        gains.beta = 0.707106871f;
+        gains.shift = 0;
+        gains.dc = 1.0f;
+        break;
+      case Haar1:
+        gains.alpha = 1.414213562f;
+        gains.beta = 0.707106871f;
+        gains.shift = 1;
+        gains.dc = 2.0f;
+        break;
+      case Fidelity:
+        gains.alpha = 0.682408629f;
+        gains.beta = 1.367856979f;
+        gains.shift = 0;
+        gains.dc = 4.0f;
+        break;
+      case Daub97:
+        gains.alpha = 1.139917028f;
+        gains.beta = 0.887168005f;
+        gains.shift = 1;
+        gains.dc = 3.025253f;
+        break;
+      case NullKernel: // Null Kernel does nothing (for testing)
+        gains.alpha = 1.0f;
+        gains.beta = 1.0f;
+        gains.shift = 0;
+        gains.dc = 1.0f;
+        break;
+      default:
+        throw std::invalid_argument("invalid wavelet kernel");
+    }
+    return gains;
+  }
+
+} // end unnamed namespace
+
 // Return the quantisation matrix for a given wavelet kernel and depth
-const Array1D quantMatrix(WaveletKernel kernel, int depth) {
+const Array1D quantMatrix(WaveletKernel kernel, int depth, int depthHo) {
   using std::vector;
   using std::min;
   if (depth < 0) throw std::domain_error("wavelet depth may not be < 0");
-  Array1D qMatrix(extents[3*depth+1]);
-  if (depth == 0) return (qMatrix[0]=0, qMatrix);
-  float alpha, beta;
-  int shift;
-  switch(kernel) {
-    case DD97:
-      alpha = 1.280868846f;
-      beta = 0.820572875f;
-      shift = 1;
-      break;
-    case LeGall:
-      alpha = 1.224744871f;
-      beta = 0.847791248f;
-      shift = 1;
-      break;
-    case DD137:
-      alpha = 1.280868846f;
-      beta = 0.809253958f;
-      shift = 1;
-      break;
-    case Haar0:
-      alpha = 1.414213562f;
-      beta = 0.707106871f;
-      shift = 0;
-      break;
-    case Haar1:
-      alpha = 1.414213562f;
-      beta = 0.707106871f;
-      shift = 1;
-      break;
-    case Fidelity:
-      alpha = 0.682408629f;
-      beta = 1.367856979f;
-      shift = 0;
-      break;
-    case Daub97:
-      alpha = 1.139917028f;
-      beta = 0.887168005f;
-      shift = 1;
-      break;
-    case NullKernel: // Null Kernel does nothing (for testing)
-      alpha = 1.0f;
-      beta = 1.0f;
-      shift = 0;
-      break;
-    default:
-      throw std::invalid_argument("invalid wavelet kernel");
-  }
+  if (depthHo < 0) throw std::domain_error("horizontal only wavelet depth may not be < 0");
+  Array1D qMatrix(extents[3*depth+depthHo+1]);
+  if ((depth == 0) && (depthHo == 0)) return (qMatrix[0]=0, qMatrix);
+  const KernelGains filterGains = kernelGains(kernel);
+  const float alpha = filterGains.alpha;
+  const float beta = filterGains.beta;
+  const int shift = filterGains.shift;
   const float a2 = alpha*alpha;
   const float ab = alpha*beta;
   const float b2 = beta*beta;
+  if (depthHo > 0) {
+    // Horizontal only levels are applied after the 2D levels, so their
+    // subbands are also filtered by the low pass filters of every 2D level
+    vector<float> gains;
+    for (int level=1; level<=depthHo; ++level) {
+      const float scale = pow(alpha, depthHo-level)*pow(a2, depth)/pow(2.0f, shift*(depth+depthHo-level+1));
+      if (level == 1) gains.push_back(scale*alpha); // L ("DC") subband
+      gains.push_back(scale*beta); // H subband
+    }
+    for (int level=1; level<=depth; ++level) {
+      const float scale = pow(a2, depth-level)/pow(2.0f, shift*(depth-level+1));
+      gains.push_back(scale*ab); // HL subband
+      gains.push_back(scale*ab); // LH subband
+      gains.push_back(scale*b2); // HH subband
+    }
+    const float minGain = *std::min_element(gains.begin(), gains.end());
+    for (unsigned int band=0; band<gains.size(); ++band) {
+      qMatrix[band] = static_cast<int>(floor(4.0f*log(gains[band]/minGain)/log(2.0f)+0.5f));
+    }
+    return qMatrix;
+  }
   vector<float> LLGain(depth+1), LHGain(depth+1), HHGain(depth+1); //Allow space for (unused) zero level
   float minGain = FLT_MAX;
   for (int level=depth; level>0; --level) {
@@ -303,873 +1065,171 @@ const Array1D quantMatrix(WaveletKernel kernel, int depth) {
     qMatrix[index++] = HHQuant[level];
   }
   return qMatrix;
+}
+
+// Return the synthesis gain of each subband, in subband order
+const std::vector<float> subband_gains(WaveletKernel kernel, int depth, int depthHo) {
+  if (depth < 0) throw std::domain_error("wavelet depth may not be < 0");
+  if (depthHo < 0) throw std::domain_error("horizontal only wavelet depth may not be < 0");
+  const KernelGains filterGains = kernelGains(kernel);
+  const float alpha = filterGains.alpha;
+  const float beta = filterGains.beta;
+  const int shift = filterGains.shift;
+  const float a2 = alpha*alpha;
+  std::vector<float> gains;
+  // The L (or LL) subband is low pass filtered by every level
+  gains.push_back(pow(alpha, depthHo)*pow(a2, depth)/pow(2.0f, shift*(depth+depthHo)));
+  for (int level=1; level<=depthHo; ++level) {
+    const float scale = pow(alpha, depthHo-level)*pow(a2, depth)/pow(2.0f, shift*(depth+depthHo-level+1));
+    gains.push_back(scale*beta); // H subband
+  }
+  for (int level=1; level<=depth; ++level) {
+    const float scale = pow(a2, depth-level)/pow(2.0f, shift*(depth-level+1));
+    gains.push_back(scale*alpha*beta); // HL subband
+    gains.push_back(scale*alpha*beta); // LH subband
+    gains.push_back(scale*beta*beta); // HH subband
+  }
+  return gains;
 }
 
 using utils::pow;
 
-// Convert a Array2D containing an in place wavelet transform into a 1D array of subbands
-const BlockVector split_into_subbands(const Array2D& picture, const char waveletDepth) {
-  const Index pictureHeight = picture.shape()[0];
-  const Index pictureWidth = picture.shape()[1];
-  const int numberOfSubbands = 3*waveletDepth+1;
-  // Define a 1D array of subbands, each subband is a Array2D
-  BlockVector subbands(extents[numberOfSubbands]);
+// Return the indices of each subband, in the order they are coded, within an
+// in place transform. Level 0 is the lowest ("DC") frequency subband, followed
+// by the H subbands of any horizontal only levels, then HL, LH & HH subbands
+// for each 2D level. This corresponds to the VC-2 specification.
+const std::vector<ArrayIndices2D> subband_indices(Index height, Index width, int depth, int depthHo) {
+  std::vector<ArrayIndices2D> bands;
   Index stride, offset; // stride is subsampling factor, offset is subsampling phase
-  stride = pow(2, waveletDepth);
-  subbands[0] = // LL (Low horizontal, Low vertical) "DC" subband
-    picture[indices[Range(0,pictureHeight,stride)][Range(0,pictureWidth,stride)]];
-  for (char level=1, band=1; level<=waveletDepth; ++level) {
-    stride = pow(2, waveletDepth+1-level);
+  const Index yStride = pow(2, depth);
+  stride = pow(2, depth+depthHo);
+  bands.push_back( // LL (or L if there are horizontal only levels) "DC" subband
+    indices[Range(0,height,yStride)][Range(0,width,stride)]);
+  for (int level=1; level<=depthHo; ++level) {
+    stride = pow(2, depth+depthHo+1-level);
     offset = stride/2;
-    // Each subband is copied from a view ((i.e. subsampled version) of the whole picture.
-    subbands[band++] = //HL subband (Hight horizontal, Low vertical)
-      picture[indices[Range(0,pictureHeight,stride)][Range(offset,pictureWidth,stride)]];
-    subbands[band++] = //LH subband (Low horizontal, High vertical)
-      picture[indices[Range(offset,pictureHeight,stride)][Range(0,pictureWidth,stride)]];
-    subbands[band++] = //HH subband (Hight horizontal, High vertical)
-      picture[indices[Range(offset,pictureHeight,stride)][Range(offset,pictureWidth,stride)]];
+    bands.push_back( //H subband (High horizontal, Low vertical)
+      indices[Range(0,height,yStride)][Range(offset,width,stride)]);
+  }
+  for (int level=1; level<=depth; ++level) {
+    stride = pow(2, depth+1-level);
+    offset = stride/2;
+    bands.push_back( //HL subband (High horizontal, Low vertical)
+      indices[Range(0,height,stride)][Range(offset,width,stride)]);
+    bands.push_back( //LH subband (Low horizontal, High vertical)
+      indices[Range(offset,height,stride)][Range(0,width,stride)]);
+    bands.push_back( //HH subband (High horizontal, High vertical)
+      indices[Range(offset,height,stride)][Range(offset,width,stride)]);
+  }
+  return bands;
+}
+
+// Convert a Array2D containing an in place wavelet transform into a 1D array of subbands
+const BlockVector split_into_subbands(const Array2D& picture, const char waveletDepth, const char waveletDepthHo) {
+  const std::vector<ArrayIndices2D> bands =
+    subband_indices(picture.shape()[0], picture.shape()[1], waveletDepth, waveletDepthHo);
+  // Define a 1D array of subbands, each subband is a Array2D
+  BlockVector subbands(extents[bands.size()]);
+  // Each subband is copied from a view ((i.e. subsampled version) of the whole picture.
+  for (unsigned int band=0; band<bands.size(); ++band) {
+    subbands[band] = picture[bands[band]];
   }
   return subbands;
 }
 
 // Converts a 1D array of subbands back to a single single Array2D corresponding
 // to an in-place wavelet transform
-const Array2D merge_subbands(const BlockVector& subbands) {
-  // TO DO: Check numberOfSubbands==3*n+1
+const Array2D merge_subbands(const BlockVector& subbands, const char waveletDepthHo) {
+  // TO DO: Check numberOfSubbands==3*n+waveletDepthHo+1
   const int numberOfSubbands = subbands.size();
-  const char waveletDepth = (numberOfSubbands-1)/3;
+  const char waveletDepth = (numberOfSubbands-waveletDepthHo-1)/3;
   const Index pictureHeight = subbands[0].shape()[0]*pow(2, waveletDepth);
-  const Index pictureWidth = subbands[0].shape()[1]*pow(2, waveletDepth);
+  const Index pictureWidth = subbands[0].shape()[1]*pow(2, waveletDepth+waveletDepthHo);
   Array2D picture(extents[pictureHeight][pictureWidth]);
-  Index stride, offset;
-  stride = pow(2, waveletDepth);
-  picture[indices[Range(0,pictureHeight,stride)][Range(0,pictureWidth,stride)]] =
-    subbands[0]; // LL (Low horizontal, Low vertical) "DC" subband
-  for (char level=1, band=1; level<=waveletDepth; ++level) {
-    stride = pow(2, waveletDepth+1-level);
-    offset = stride/2;
-    picture[indices[Range(0,pictureHeight,stride)][Range(offset,pictureWidth,stride)]] =
-      subbands[band++]; //HL subband (High horizontal, Low vertical);
-    picture[indices[Range(offset,pictureHeight,stride)][Range(0,pictureWidth,stride)]] =
-      subbands[band++]; //LH subband (Low horizontal, High vertical);
-    picture[indices[Range(offset,pictureHeight,stride)][Range(offset,pictureWidth,stride)]] =
-      subbands[band++]; //HH subband (High horizontal, High vertical);
+  const std::vector<ArrayIndices2D> bands =
+    subband_indices(pictureHeight, pictureWidth, waveletDepth, waveletDepthHo);
+  for (int band=0; band<numberOfSubbands; ++band) {
+    picture[bands[band]] = subbands[band];
   }
   return picture;
 }
 
-void waveletLevelDD97(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // Do shift to introduce accuracy bits
-  if (shift) {
-    for (int line=0; line<height; ++line) {
-      for (int pixel=0; pixel<width; ++pixel) {
-	    p[line][pixel] <<= shift;
-      }
-    }
-  }
-
-  // horizontal predict
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-2)>=0) ? (pixel-2) : 0;
-      const int tap1 = pixel;
-      const int tap2 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      const int tap3 = ((pixel+4)<width) ? (pixel+4) : (width-2);
-      p[line][pixel+1] -=
-        (-p[line][tap0]+9*p[line][tap1]+9*p[line][tap2]-p[line][tap3]+8)>>4;
-    }
-  }
-
-  // horizontal update
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-1)>=0) ? (pixel-1) : 1 ;
-      const int tap1 = pixel+1;
-      p[line][pixel] += (p[line][tap0]+p[line][tap1] + 2)>>2;
-    }
-  }
-
-  // vertical predict
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-2)>=0) ? (line-2) : 0;
-    const int tap1 = line;
-    const int tap2 = ((line+2)<height) ? (line+2) : (height-2);
-    const int tap3 = ((line+4)<height) ? (line+4) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] -=
-        (-p[tap0][pixel]+9*p[tap1][pixel]+9*p[tap2][pixel]-p[tap3][pixel]+8)>>4;
-    }
-  }
-
-  // vertical update
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-1)>=0) ? (line-1) : 1 ;
-    const int tap1 = line+1;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] += (p[tap0][pixel]+p[tap1][pixel] + 2)>>2;
-    }
-  }
-}
-
-
-void inverseWaveletLevelDD97(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // vertical inverse update
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-1)>=0) ? (line-1) : 1 ;
-    const int tap1 = line+1;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] -= (p[tap0][pixel]+p[tap1][pixel] + 2)>>2;
-    }
-  }
-
-  // vertical inverse predict
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-2)>=0) ? (line-2) : 0;
-    const int tap1 = line;
-    const int tap2 = ((line+2)<height) ? (line+2) : (height-2);
-    const int tap3 = ((line+4)<height) ? (line+4) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] +=
-        (-p[tap0][pixel]+9*p[tap1][pixel]+9*p[tap2][pixel]-p[tap3][pixel]+8)>>4;
-    }
-  }
-
-  // horizontal inverse update
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-1)>=0) ? (pixel-1) : 1 ;
-      const int tap1 = pixel+1;
-      p[line][pixel] -= (p[line][tap0]+p[line][tap1] + 2)>>2;
-    }
-  }
-
-  // horizontal inverse predict
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-2)>=0) ? (pixel-2) : 0;
-      const int tap1 = pixel;
-      const int tap2 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      const int tap3 = ((pixel+4)<width) ? (pixel+4) : (width-2);
-      p[line][pixel+1] +=
-        (-p[line][tap0]+9*p[line][tap1]+9*p[line][tap2]-p[line][tap3]+8)>>4;
-    }
-  }
-
-  // Round & shift right "shift" bits (with rounding)
-  if (shift) {
-    View2D::element offset = utils::pow(2, shift-1);
-    for (int pixel=0; pixel<width; ++pixel) {
-      for (int line=0; line<height; ++line) {
-		    p[line][pixel] += offset;
-		    p[line][pixel] >>= shift;
-      }
-    }
-  }
-}
-
-void waveletLevelLeGall(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // Do shift to introduce accuracy bits
-  if (shift) {
-    for (int line=0; line<height; ++line) {
-      for (int pixel=0; pixel<width; ++pixel) {
-	    p[line][pixel] <<= shift;
-      }
-    }
-  }
-
-  // horizontal LeGall (5,3): Predict
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = pixel;
-      const int tap1 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      p[line][pixel+1] -= (p[line][tap0]+p[line][tap1]+1)>>1;
-    }
-  }
-
-  // horizontal LeGall (5,3): Update
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-1)>=0) ? (pixel-1) : 1 ;
-      const int tap1 = pixel+1;
-      p[line][pixel] += (p[line][tap0]+p[line][tap1] + 2)>>2;
-    }
-  }
-
-  // vertical LeGall (5,3): Predict
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = line;
-    const int tap1 = ((line+2)<height) ? (line+2) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] -= (p[tap0][pixel]+p[tap1][pixel]+1)>>1;
-    }
-  }
-
-  // vertical LeGall (5,3): Update
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-1)>=0) ? (line-1) : 1 ;
-    const int tap1 = line+1;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] += (p[tap0][pixel]+p[tap1][pixel] + 2)>>2;
-    }
-  }
-}
-
-
-void inverseWaveletLevelLeGall(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // vertical LeGall (5,3): Inverse Update
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-1)>=0) ? (line-1) : 1 ;
-    const int tap1 = line+1;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] -= (p[tap0][pixel]+p[tap1][pixel] + 2)>>2;
-    }
-  }
-
-  // vertical LeGall (5,3): Inverse Predict
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = line;
-    const int tap1 = ((line+2)<height) ? (line+2) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] += (p[tap0][pixel]+p[tap1][pixel]+1)>>1;
-    }
-  }
-
-  // horizontal LeGall (5,3): Inverse Update
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-1)>=0) ? (pixel-1) : 1 ;
-      const int tap1 = pixel+1;
-      p[line][pixel] -= (p[line][tap0]+p[line][tap1] + 2)>>2;
-    }
-  }
-
-  // horizontal LeGall (5,3): Inverse Predict
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = pixel;
-      const int tap1 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      p[line][pixel+1] += (p[line][tap0]+p[line][tap1]+1)>>1;
-    }
-  }
-
-  // Round & shift right "shift" bits (with rounding)
-  if (shift) {
-    View2D::element offset = utils::pow(2, shift-1);
-    for (int pixel=0; pixel<width; ++pixel) {
-      for (int line=0; line<height; ++line) {
-		    p[line][pixel] += offset;
-		    p[line][pixel] >>= shift;
-      }
-    }
-  }
-}
-
-void waveletLevelDD137(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // Do shift to introduce accuracy bits
-  if (shift) {
-    for (int line=0; line<height; ++line) {
-      for (int pixel=0; pixel<width; ++pixel) {
-	    p[line][pixel] <<= shift;
-      }
-    }
-  }
-
-  // horizontal predict
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-2)>=0) ? (pixel-2) : 0;
-      const int tap1 = pixel;
-      const int tap2 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      const int tap3 = ((pixel+4)<width) ? (pixel+4) : (width-2);
-      p[line][pixel+1] -=
-        (-p[line][tap0]+9*p[line][tap1]+9*p[line][tap2]-p[line][tap3]+8)>>4;
-    }
-  }
-
-  // horizontal update
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-3)>=0) ? (pixel-3) : 1 ;
-      const int tap1 = ((pixel-1)>=0) ? (pixel-1) : 1 ;
-      const int tap2 = pixel+1;
-      const int tap3 = ((pixel+3)<width) ? (pixel+3) : (width-1) ;
-      p[line][pixel] +=
-        (-p[line][tap0]+9*p[line][tap1]+9*p[line][tap2]-p[line][tap3]+16)>>5;
-    }
-  }
-
-  // vertical predict
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-2)>=0) ? (line-2) : 0;
-    const int tap1 = line;
-    const int tap2 = ((line+2)<height) ? (line+2) : (height-2);
-    const int tap3 = ((line+4)<height) ? (line+4) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] -=
-        (-p[tap0][pixel]+9*p[tap1][pixel]+9*p[tap2][pixel]-p[tap3][pixel]+8)>>4;
-    }
-  }
-
-  // vertical update
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-3)>=0) ? (line-3) : 1 ;
-    const int tap1 = ((line-1)>=0) ? (line-1) : 1 ;
-    const int tap2 = line+1;
-    const int tap3 = ((line+3)<height) ? (line+3) : (height-1) ;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] +=
-        (-p[tap0][pixel]+9*p[tap1][pixel]+9*p[tap2][pixel]-p[tap3][pixel]+16)>>5;
-    }
-  }
-}
-
-
-void inverseWaveletLevelDD137(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // vertical inverse update
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-3)>=0) ? (line-3) : 1 ;
-    const int tap1 = ((line-1)>=0) ? (line-1) : 1 ;
-    const int tap2 = line+1;
-    const int tap3 = ((line+3)<height) ? (line+3) : (height-1) ;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] -=
-        (-p[tap0][pixel]+9*p[tap1][pixel]+9*p[tap2][pixel]-p[tap3][pixel]+16)>>5;
-    }
-  }
-
-  // vertical inverse predict
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-2)>=0) ? (line-2) : 0;
-    const int tap1 = line;
-    const int tap2 = ((line+2)<height) ? (line+2) : (height-2);
-    const int tap3 = ((line+4)<height) ? (line+4) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] +=
-        (-p[tap0][pixel]+9*p[tap1][pixel]+9*p[tap2][pixel]-p[tap3][pixel]+8)>>4;
-    }
-  }
-
-  // horizontal inverse update
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-3)>=0) ? (pixel-3) : 1 ;
-      const int tap1 = ((pixel-1)>=0) ? (pixel-1) : 1 ;
-      const int tap2 = pixel+1;
-      const int tap3 = ((pixel+3)<width) ? (pixel+3) : (width-1) ;
-      p[line][pixel] -=
-        (-p[line][tap0]+9*p[line][tap1]+9*p[line][tap2]-p[line][tap3]+16)>>5;
-    }
-  }
-
-  // horizontal inverse predict
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-2)>=0) ? (pixel-2) : 0;
-      const int tap1 = pixel;
-      const int tap2 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      const int tap3 = ((pixel+4)<width) ? (pixel+4) : (width-2);
-      p[line][pixel+1] +=
-        (-p[line][tap0]+9*p[line][tap1]+9*p[line][tap2]-p[line][tap3]+8)>>4;
-    }
-  }
-
-  // Round & shift right "shift" bits (with rounding)
-  if (shift) {
-    View2D::element offset = utils::pow(2, shift-1);
-    for (int pixel=0; pixel<width; ++pixel) {
-      for (int line=0; line<height; ++line) {
-		    p[line][pixel] += offset;
-		    p[line][pixel] >>= shift;
-      }
-    }
-  }
-}
-
-void waveletLevelHaar(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // Do shift to introduce accuracy bits
-  if (shift) {
-    for (int line=0; line<height; ++line) {
-      for (int pixel=0; pixel<width; ++pixel) {
-	    p[line][pixel] <<= shift;
-      }
-    }
-  }
-
-  // horizontal predict
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      p[line][pixel+1] -= p[line][pixel];
-    }
-  }
-
-  // horizontal update
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      p[line][pixel] += ((p[line][pixel+1] + 1)>>1);
-    }
-  }
-
-  // vertical predict
-  for (int pixel=0; pixel<width; ++pixel) {
-    for (int line=0; line<height; line+=2) {
-      p[line+1][pixel] -= p[line][pixel];
-    }
-  }
-
-  // vertical update
-  for (int pixel=0; pixel<width; ++pixel) {
-    for (int line=0; line<height; line+=2) {
-      p[line][pixel] += ((p[line+1][pixel] + 1)>>1);
-    }
-  }
-
-}
-
-
-void inverseWaveletLevelHaar(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // vertical Haar: Inverse Update
-  for (int line=0; line<height; line+=2) {
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] -= ((p[line+1][pixel] + 1)>>1);
-    }
-  }
-
-  // vertical Haar: Inverse Predict
-  for (int line=0; line<height; line+=2) {
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] += p[line][pixel];
-    }
-  }
-
-  // horizontal Haar: Inverse Update
-  for (int pixel=0; pixel<width; pixel+=2) {
-    for (int line=0; line<height; ++line) {
-      p[line][pixel] -= ((p[line][pixel+1] + 1)>>1);
-    }
-  }
-
-  // horizontal Haar: Inverse Predict
-  for (int pixel=0; pixel<width; pixel+=2) {
-    for (int line=0; line<height; ++line) {
-      p[line][pixel+1] += p[line][pixel];
-	  }
-  }
-
-  // Round & shift right "shift" bits (with rounding)
-  if (shift) {
-    View2D::element offset = utils::pow(2, shift-1);
-    for (int pixel=0; pixel<width; ++pixel) {
-      for (int line=0; line<height; ++line) {
-		    p[line][pixel] += offset;
-		    p[line][pixel] >>= shift;
-      }
-    }
-  }
-}
-
-void waveletLevelFidelity(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // Do shift to introduce accuracy bits
-  if (shift) {
-    for (int line=0; line<height; ++line) {
-      for (int pixel=0; pixel<width; ++pixel) {
-	    p[line][pixel] <<= shift;
-      }
-    }
-  }
-
-  // horizontal type 1
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-7)>=0) ? (pixel-7) : 1;
-      const int tap1 = ((pixel-5)>=0) ? (pixel-5) : 1;
-      const int tap2 = ((pixel-3)>=0) ? (pixel-3) : 1;
-      const int tap3 = ((pixel-1)>=0) ? (pixel-1) : 1;
-      const int tap4 = pixel+1;
-      const int tap5 = ((pixel+3)<width) ? (pixel+3) : (width-1);
-      const int tap6 = ((pixel+5)<width) ? (pixel+5) : (width-1);
-      const int tap7 = ((pixel+7)<width) ? (pixel+7) : (width-1);
-      p[line][pixel] +=
-        (-8*p[line][tap0]+21*p[line][tap1]-46*p[line][tap2]+161*p[line][tap3]
-         +161*p[line][tap4]-46*p[line][tap5]+21*p[line][tap6]-8*p[line][tap7]+128)>>8;
-    }
-  }
-
-  // horizontal type 4
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-6)>=0) ? (pixel-6) : 0;
-      const int tap1 = ((pixel-4)>=0) ? (pixel-4) : 0;
-      const int tap2 = ((pixel-2)>=0) ? (pixel-2) : 0;
-      const int tap3 = pixel;
-      const int tap4 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      const int tap5 = ((pixel+4)<width) ? (pixel+4) : (width-2);
-      const int tap6 = ((pixel+6)<width) ? (pixel+6) : (width-2);
-      const int tap7 = ((pixel+8)<width) ? (pixel+8) : (width-2);
-      p[line][pixel+1] -=
-        (-2*p[line][tap0]+10*p[line][tap1]-25*p[line][tap2]+81*p[line][tap3]
-         +81*p[line][tap4]-25*p[line][tap5]+10*p[line][tap6]-2*p[line][tap7]+128)>>8;
-    }
-  }
-
-  // vertical type 1
-  for (int line=0; line<height; line+=2) {    
-    const int tap0 = ((line-7)>=0) ? (line-7) : 1;
-    const int tap1 = ((line-5)>=0) ? (line-5) : 1;
-    const int tap2 = ((line-3)>=0) ? (line-3) : 1;
-    const int tap3 = ((line-1)>=0) ? (line-1) : 1;
-    const int tap4 = line+1;
-    const int tap5 = ((line+3)<height) ? (line+3) : (height-1);
-    const int tap6 = ((line+5)<height) ? (line+5) : (height-1);
-    const int tap7 = ((line+7)<height) ? (line+7) : (height-1);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] +=
-        (-8*p[tap0][pixel]+21*p[tap1][pixel]-46*p[tap2][pixel]+161*p[tap3][pixel]
-         +161*p[tap4][pixel]-46*p[tap5][pixel]+21*p[tap6][pixel]-8*p[tap7][pixel]+128)>>8;
-    }
-  }
-
-  // vertical type 4
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-6)>=0) ? (line-6) : 0;
-    const int tap1 = ((line-4)>=0) ? (line-4) : 0;
-    const int tap2 = ((line-2)>=0) ? (line-2) : 0;
-    const int tap3 = line;
-    const int tap4 = ((line+2)<height) ? (line+2) : (height-2);
-    const int tap5 = ((line+4)<height) ? (line+4) : (height-2);
-    const int tap6 = ((line+6)<height) ? (line+6) : (height-2);
-    const int tap7 = ((line+8)<height) ? (line+8) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] -=
-        (-2*p[tap0][pixel]+10*p[tap1][pixel]-25*p[tap2][pixel]+81*p[tap3][pixel]
-         +81*p[tap4][pixel]-25*p[tap5][pixel]+10*p[tap6][pixel]-2*p[tap7][pixel]+128)>>8;
-    }
-  }
-
-}
-
-
-void inverseWaveletLevelFidelity(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // vertical type 3
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-6)>=0) ? (line-6) : 0;
-    const int tap1 = ((line-4)>=0) ? (line-4) : 0;
-    const int tap2 = ((line-2)>=0) ? (line-2) : 0;
-    const int tap3 = line;
-    const int tap4 = ((line+2)<height) ? (line+2) : (height-2);
-    const int tap5 = ((line+4)<height) ? (line+4) : (height-2);
-    const int tap6 = ((line+6)<height) ? (line+6) : (height-2);
-    const int tap7 = ((line+8)<height) ? (line+8) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] +=
-        (-2*p[tap0][pixel]+10*p[tap1][pixel]-25*p[tap2][pixel]+81*p[tap3][pixel]
-         +81*p[tap4][pixel]-25*p[tap5][pixel]+10*p[tap6][pixel]-2*p[tap7][pixel]+128)>>8;
-    }
-  }
-
-  // vertical type 2
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-7)>=0) ? (line-7) : 1;
-    const int tap1 = ((line-5)>=0) ? (line-5) : 1;
-    const int tap2 = ((line-3)>=0) ? (line-3) : 1;
-    const int tap3 = ((line-1)>=0) ? (line-1) : 1;
-    const int tap4 = line+1;
-    const int tap5 = ((line+3)<height) ? (line+3) : (height-1);
-    const int tap6 = ((line+5)<height) ? (line+5) : (height-1);
-    const int tap7 = ((line+7)<height) ? (line+7) : (height-1);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] -=
-        (-8*p[tap0][pixel]+21*p[tap1][pixel]-46*p[tap2][pixel]+161*p[tap3][pixel]
-         +161*p[tap4][pixel]-46*p[tap5][pixel]+21*p[tap6][pixel]-8*p[tap7][pixel]+128)>>8;
-    }
-  }
-
-  // horizontal type 3
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-6)>=0) ? (pixel-6) : 0;
-      const int tap1 = ((pixel-4)>=0) ? (pixel-4) : 0;
-      const int tap2 = ((pixel-2)>=0) ? (pixel-2) : 0;
-      const int tap3 = pixel;
-      const int tap4 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      const int tap5 = ((pixel+4)<width) ? (pixel+4) : (width-2);
-      const int tap6 = ((pixel+6)<width) ? (pixel+6) : (width-2);
-      const int tap7 = ((pixel+8)<width) ? (pixel+8) : (width-2);
-      p[line][pixel+1] +=
-        (-2*p[line][tap0]+10*p[line][tap1]-25*p[line][tap2]+81*p[line][tap3]
-         +81*p[line][tap4]-25*p[line][tap5]+10*p[line][tap6]-2*p[line][tap7]+128)>>8;
-
-    }
-  }
-
-  // horizontal type 2
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-7)>=0) ? (pixel-7) : 1;
-      const int tap1 = ((pixel-5)>=0) ? (pixel-5) : 1;
-      const int tap2 = ((pixel-3)>=0) ? (pixel-3) : 1;
-      const int tap3 = ((pixel-1)>=0) ? (pixel-1) : 1;
-      const int tap4 = pixel+1;
-      const int tap5 = ((pixel+3)<width) ? (pixel+3) : (width-1);
-      const int tap6 = ((pixel+5)<width) ? (pixel+5) : (width-1);
-      const int tap7 = ((pixel+7)<width) ? (pixel+7) : (width-1);
-      p[line][pixel] -=
-        (-8*p[line][tap0]+21*p[line][tap1]-46*p[line][tap2]+161*p[line][tap3]
-         +161*p[line][tap4]-46*p[line][tap5]+21*p[line][tap6]-8*p[line][tap7]+128)>>8;
-    }
-  }
-
-  // Round & shift right "shift" bits (with rounding)
-  if (shift) {
-    View2D::element offset = utils::pow(2, shift-1);
-    for (int pixel=0; pixel<width; ++pixel) {
-      for (int line=0; line<height; ++line) {
-		    p[line][pixel] += offset;
-		    p[line][pixel] >>= shift;
-      }
-    }
-  }
-}
-
-void waveletLevelDaub97(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // Do shift to introduce accuracy bits
-  if (shift) {
-    for (int line=0; line<height; ++line) {
-      for (int pixel=0; pixel<width; ++pixel) {
-	    p[line][pixel] <<= shift;
-      }
-    }
-  }
-
-  // horizontal type 4
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = pixel;
-      const int tap1 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      p[line][pixel+1] -= (6497*p[line][tap0]+6497*p[line][tap1]+2048)>>12;
-    }
-  }
-
-  // horizontal type 2
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-1)>=0) ? (pixel-1) : 1;
-      const int tap1 = pixel+1;
-      p[line][pixel] -= (217*p[line][tap0]+217*p[line][tap1]+2048)>>12;
-    }
-  }
-
-  // horizontal type 3
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = pixel;
-      const int tap1 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      p[line][pixel+1] += (3616*p[line][tap0]+3616*p[line][tap1]+2048)>>12;
-    }
-  }
-
-  // horizontal type 1
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-1)>=0) ? (pixel-1) : 1;
-      const int tap1 = pixel+1;
-      p[line][pixel] += (1817*p[line][tap0]+1817*p[line][tap1]+2048)>>12;
-    }
-  }
-
-  // vertical type 4
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = line;
-    const int tap1 = ((line+2)<height) ? (line+2) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] -= (6497*p[tap0][pixel]+6497*p[tap1][pixel]+2048)>>12;
-    }
-  }
-
-  // vertical type 2
-  for (int line=0; line<height; line+=2) { 
-    const int tap0 = ((line-1)>=0) ? (line-1) : 1;
-    const int tap1 = line+1;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] -= (217*p[tap0][pixel]+217*p[tap1][pixel]+2048)>>12;
-    }
-  }
-
-  // vertical type 3
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = line;
-    const int tap1 = ((line+2)<height) ? (line+2) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] += (3616*p[tap0][pixel]+3616*p[tap1][pixel]+2048)>>12;
-    }
-  }
-
-  // vertical type 1
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-1)>=0) ? (line-1) : 1;
-    const int tap1 = line+1;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] += (1817*p[tap0][pixel]+1817*p[tap1][pixel]+2048)>>12;
-    }
-  }
-}
-
-
-void inverseWaveletLevelDaub97(View2D& p, unsigned int shift) {
-
-  const Index height = p.shape()[0];
-  const Index width = p.shape()[1];
-
-  // vertical type 2
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = ((line-1)>=0) ? (line-1) : 1;
-    const int tap1 = line+1;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] -= (1817*p[tap0][pixel]+1817*p[tap1][pixel]+2048)>>12;
-    }
-  }
-
-  // vertical type 4
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = line;
-    const int tap1 = ((line+2)<height) ? (line+2) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] -= (3616*p[tap0][pixel]+3616*p[tap1][pixel]+2048)>>12;
-    }
-  }
-
-  // vertical type 1
-  for (int line=0; line<height; line+=2) { 
-    const int tap0 = ((line-1)>=0) ? (line-1) : 1;
-    const int tap1 = line+1;
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line][pixel] += (217*p[tap0][pixel]+217*p[tap1][pixel]+2048)>>12;
-    }
-  }
-
-  // vertical type 3
-  for (int line=0; line<height; line+=2) {
-    const int tap0 = line;
-    const int tap1 = ((line+2)<height) ? (line+2) : (height-2);
-    for (int pixel=0; pixel<width; ++pixel) {
-      p[line+1][pixel] += (6497*p[tap0][pixel]+6497*p[tap1][pixel]+2048)>>12;
-    }
-  }
-
-  // horizontal type 2
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-1)>=0) ? (pixel-1) : 1;
-      const int tap1 = pixel+1;
-      p[line][pixel] -= (1817*p[line][tap0]+1817*p[line][tap1]+2048)>>12;
-    }
-  }
-
-  // horizontal type 4
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = pixel;
-      const int tap1 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      p[line][pixel+1] -= (3616*p[line][tap0]+3616*p[line][tap1]+2048)>>12;
-    }
-  }
-
-  // horizontal type 1
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = ((pixel-1)>=0) ? (pixel-1) : 1;
-      const int tap1 = pixel+1;
-      p[line][pixel] += (217*p[line][tap0]+217*p[line][tap1]+2048)>>12;
-    }
-  }
-
-  // horizontal type 3
-  for (int line=0; line<height; ++line) {
-    for (int pixel=0; pixel<width; pixel+=2) {
-      const int tap0 = pixel;
-      const int tap1 = ((pixel+2)<width) ? (pixel+2) : (width-2);
-      p[line][pixel+1] += (6497*p[line][tap0]+6497*p[line][tap1]+2048)>>12;
-    }
-  }
-
-  // Round & shift right "shift" bits (with rounding)
-  if (shift) {
-    View2D::element offset = utils::pow(2, shift-1);
-    for (int pixel=0; pixel<width; ++pixel) {
-      for (int line=0; line<height; ++line) {
-		    p[line][pixel] += offset;
-		    p[line][pixel] >>= shift;
-      }
-    }
-  }
-}
-
-const Picture waveletTransform(const Picture& input, WaveletKernel kernel, int waveletDepth) {
+const Picture waveletTransform(const Picture& input, WaveletKernel kernel, int waveletDepth, int depthHo) {
   const int lumaHeight = paddedSize(input.format().lumaHeight(), waveletDepth);
-  const int lumaWidth = paddedSize(input.format().lumaWidth(), waveletDepth);
+  const int lumaWidth = paddedSize(input.format().lumaWidth(), waveletDepth+depthHo);
   const int chromaHeight = paddedSize(input.format().chromaHeight(), waveletDepth);
-  const int chromaWidth = paddedSize(input.format().chromaWidth(), waveletDepth);
+  const int chromaWidth = paddedSize(input.format().chromaWidth(), waveletDepth+depthHo);
   const ColourFormat uvFormat = input.format().chromaFormat();
   PictureFormat const transformFormat(lumaHeight, lumaWidth, chromaHeight, chromaWidth, uvFormat);
-  Picture transform(transformFormat);
-  transform.y(waveletTransform(input.y(), kernel, waveletDepth));
-  transform.c1(waveletTransform(input.c1(), kernel, waveletDepth));
-  transform.c2(waveletTransform(input.c2(), kernel, waveletDepth));
-  return transform;
+  typedef const Array2D (*Transform)(const Array2D&, WaveletKernel, int, int);
+  const Transform transform = waveletTransform;
+  return concurrent_components(transformFormat,
+                               boost::bind(transform, boost::cref(input.y()), kernel, waveletDepth, depthHo),
+                               boost::bind(transform, boost::cref(input.c1()), kernel, waveletDepth, depthHo),
+                               boost::bind(transform, boost::cref(input.c2()), kernel, waveletDepth, depthHo));
 }
 
 const Picture inverseWaveletTransform(const Picture& transform,
                                       WaveletKernel kernel,
                                       int depth,
-                                      PictureFormat format) {
-  Picture picture(format);
+                                      PictureFormat format,
+                                      int depthHo) {
   const Shape2D lumaShape(format.lumaShape());
   const Shape2D chromaShape(format.chromaShape());
-  picture.y(inverseWaveletTransform(transform.y(), kernel, depth, lumaShape));
-  picture.c1(inverseWaveletTransform(transform.c1(), kernel, depth, chromaShape));
-  picture.c2(inverseWaveletTransform(transform.c2(), kernel, depth, chromaShape));
-  return picture;
+  typedef const Array2D (*Inverse)(const Array2D&, WaveletKernel, int, Shape2D, int);
+  const Inverse inverse = inverseWaveletTransform;
+  return concurrent_components(format,
+                               boost::bind(inverse, boost::cref(transform.y()), kernel, depth, lumaShape, depthHo),
+                               boost::bind(inverse, boost::cref(transform.c1()), kernel, depth, chromaShape, depthHo),
+                               boost::bind(inverse, boost::cref(transform.c2()), kernel, depth, chromaShape, depthHo));
+}
+
+const PictureFormat proxyFormat(const PictureFormat& format, int level) {
+  const int scale = utils::pow(2, level);
+  return PictureFormat((format.lumaHeight()+scale-1)/scale,
+                       (format.lumaWidth()+scale-1)/scale,
+                       (format.chromaHeight()+scale-1)/scale,
+                       (format.chromaWidth()+scale-1)/scale,
+                       format.chromaFormat());
+}
+
+namespace {
+
+  // Samples at multiples of 2**level in an in place transform are the in
+  // place transform, with "level" fewer 2D levels, of the LL subband of that
+  // level. So inverting them gives the LL subband, scaled by its gain.
+  const Array2D inverseProxy(const Array2D& transform, WaveletKernel kernel,
+                             int depth, Shape2D shape, int level, int depthHo) {
+    const Index stride = utils::pow(2, level);
+    const Index height = transform.shape()[0];
+    const Index width = transform.shape()[1];
+    Array2D lowPass(extents[height/stride][width/stride]);
+    lowPass = transform[indices[Range(0,height,stride)][Range(0,width,stride)]];
+    Array2D proxy = inverseWaveletTransform(lowPass, kernel, depth-level, shape, depthHo);
+    const double gain = std::pow(static_cast<double>(kernelGains(kernel).dc), level);
+    if (gain!=1.0) {
+      for (int* sample=proxy.data(); sample!=proxy.data()+proxy.num_elements(); ++sample) {
+        *sample = static_cast<int>(std::floor(*sample/gain+0.5));
+      }
+    }
+    return proxy;
+  }
+
+} // end unnamed namespace
+
+const Picture inverseWaveletProxy(const Picture& transform,
+                                  WaveletKernel kernel,
+                                  int depth,
+                                  PictureFormat format,
+                                  int level,
+                                  int depthHo) {
+  if ((level<1) || (level>depth))
+    throw std::invalid_argument("proxy level must be from 1 to the wavelet depth");
+  const PictureFormat proxy = proxyFormat(format, level);
+  const Shape2D lumaShape(proxy.lumaShape());
+  const Shape2D chromaShape(proxy.chromaShape());
+  return concurrent_components(proxy,
+                               boost::bind(inverseProxy, boost::cref(transform.y()), kernel, depth, lumaShape, level, depthHo),
+                               boost::bind(inverseProxy, boost::cref(transform.c1()), kernel, depth, chromaShape, level, depthHo),
+                               boost::bind(inverseProxy, boost::cref(transform.c2()), kernel, depth, chromaShape, level, depthHo));
 }
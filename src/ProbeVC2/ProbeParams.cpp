@@ -0,0 +1,85 @@
+/*********************************************************************/
+/* ProbeParams.cpp                                                   */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines getting program parameters from command line.             */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include "ProbeParams.h"
+
+#include <cstdlib> // For exit
+#include <iostream> //For cin, cout, cerr
+#include <stdexcept> // For invalid_argument
+#include <string>
+
+using std::clog;
+using std::endl;
+using std::string;
+using std::invalid_argument;
+
+#include <tclap/CmdLine.h>
+
+using TCLAP::CmdLine;
+using TCLAP::SwitchArg;
+using TCLAP::UnlabeledValueArg;
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]) {
+
+  const char * const version = details[0];
+  const char * const summary = details[1];
+  const char * const description = details[2];
+
+  if (argc<2) {
+    clog << "Version: " << version << endl;
+    clog << description << endl;
+    clog << "\nFor more details and useage use -h or --help" << endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  ProgramParams params;
+
+  try {
+
+    // Define tclap command line object
+    CmdLine cmd(summary, ' ', version);
+
+    // Define tclap command line parameters (and add them to tclap command line)
+    UnlabeledValueArg<string> inFile("inFile", "Input file name (use \"-\" for standard input)", true, "-", "string", cmd);
+    UnlabeledValueArg<string> outFile("outFile", "Report file name (defaults to standard output)", false, "-", "string", cmd);
+    SwitchArg verbosity("v", "verbose", "Report every data unit and picture header", cmd);
+    // "cla" prefix == command line argument
+    SwitchArg cla_quiet("q", "quiet", "Report only errors and the summary", cmd);
+
+    // Parse the argv array
+    cmd.parse(argc, argv);
+
+    // Initialise program parameters
+    const string inFileName = inFile.getValue();
+    const string outFileName = outFile.getValue();
+    const bool verbose = verbosity.getValue();
+    const bool quiet = cla_quiet.getValue();
+
+    // Check for valid combinations of parameters and options
+    if (verbose && quiet)
+      throw invalid_argument("can't be both verbose and quiet: specify one or the other");
+
+    params.inFileName = inFileName;
+    params.outFileName = outFileName;
+    params.verbose = verbose;
+    params.quiet = quiet;
+  }
+
+  // catch any TCLAP exceptions
+  catch (TCLAP::ArgException &e) {
+    params.error = string("Command line error: ") + e.error() + " for arg " + e.argId();
+  }
+
+  // catch other exceptions
+  catch(const std::exception& ex) {
+    params.error = string(ex.what());
+  }
+
+  return params;
+}
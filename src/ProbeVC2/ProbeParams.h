@@ -0,0 +1,25 @@
+/*********************************************************************/
+/* ProbeParams.h                                                     */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares getting program parameters from command line.            */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef PROBEPARAMS_18OCT26
+#define PROBEPARAMS_18OCT26
+
+#include <string>
+
+struct ProgramParams {
+  std::string inFileName;
+  std::string outFileName;
+  bool verbose;
+  bool quiet; // Report only errors and the summary, not each picture
+  std::string error;
+};
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]);
+
+#endif // PROBEPARAMS_18OCT26
@@ -0,0 +1,491 @@
+/*********************************************************************/
+/* ProbeVC2.cpp                                                      */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Validates the structure of a VC-2 stream and reports statistics,  */
+/* parsing headers and slice lengths only (no coefficient decoding). */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+const char version[] = __DATE__ " @ " __TIME__ ;
+const char summary[] = "Validates a VC-2 LD or HQ stream and reports its statistics without decoding it";
+const char description[] = "\
+This program checks the structure of a VC-2 stream (LD or HQ profile) at disk speed.\n\
+Only the parse info, sequence and picture headers and the slice lengths are parsed,\n\
+no coefficients are decoded. LD slice sizes are calculated from the picture header,\n\
+HQ slices are walked using their length bytes and the slice size scalar.\n\
+It checks:\n\
+  the parse offset chain (next and previous parse offsets and parse info prefixes)\n\
+  that sequence headers are consistent and precede the pictures\n\
+  that picture types match the profile and pictures are numbered consecutively\n\
+  that the slices exactly fill each picture data unit\n\
+For each picture it reports the size, quantisation index range and padding.\n\
+Padding is counted as the trailing one bits of each component of each slice, which\n\
+includes trailing zero coefficients. A summary, including the quantisation index\n\
+distribution, is reported at the end. The exit status is non zero if there are errors.\n\
+Pictures that are not numbered consecutively are reported as warnings.\n\
+\n\
+Example: ProbeVC2 -q inFileName";
+const char* details[] = {version, summary, description};
+
+#include <cstdlib> //for EXIT_SUCCESS, EXIT_FAILURE, atoi
+#include <stdexcept> //For standard logic errors
+#include <iostream> //For cin, cout, cerr
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio> // for perror
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+#include "ProbeParams.h"
+#include "Picture.h"
+#include "WaveletTransform.h"
+#include "Slices.h"
+#include "Utils.h"
+#include "DataUnit.h"
+
+using std::cout;
+using std::cin;
+using std::cerr;
+using std::clog;
+using std::endl;
+using std::string;
+using std::filebuf;
+using std::streambuf;
+using std::ios_base;
+using std::istream;
+using std::ostream;
+
+// Statistics of the slices of one picture
+struct SliceStats {
+  SliceStats(): slices(0), bytes(0), paddingBits(0), qMin(255), qMax(0), qSum(0) {}
+  int slices;
+  long long bytes;
+  long long paddingBits;
+  int qMin;
+  int qMax;
+  long long qSum;
+  void add(int q) {
+    ++slices;
+    qMin = std::min(qMin, q);
+    qMax = std::max(qMax, q);
+    qSum += q;
+  }
+};
+
+namespace {
+
+  // Bit i (counting from the MSB of the first byte) of a buffer
+  inline int bit(const unsigned char* data, long long i) {
+    return (data[i>>3] >> (7-(i&7))) & 1;
+  }
+
+  // Number of one bits at the end of the bits [first, last)
+  const long long trailing_ones(const unsigned char* data, long long first, long long last) {
+    long long i = last;
+    while ((i>first) && (i&7)) { // Up to a byte boundary
+      if (!bit(data, i-1)) return last-i;
+      --i;
+    }
+    while ((i-8>=first) && (data[(i>>3)-1]==0xFF)) i -= 8;
+    while ((i>first) && bit(data, i-1)) --i;
+    return last-i;
+  }
+
+  // Walks the fixed size slices of an LD picture, returns an error message (empty if OK)
+  const string walk_ld_slices(const string& picture, const PicturePreamble& preamble,
+                              SliceStats& stats, std::vector<long long>& qCounts) {
+    const unsigned char* const data = reinterpret_cast<const unsigned char*>(picture.data());
+    const long long size = picture.size();
+    long long pos = 0;
+    for (int v=0; v<preamble.slices_y; ++v) {
+      for (int h=0; h<preamble.slices_x; ++h) {
+        const int bytes = slice_bytes(v, h, preamble.slices_y, preamble.slices_x,
+                                      preamble.slice_bytes.numerator, preamble.slice_bytes.denominator);
+        std::ostringstream error;
+        if (bytes<2) {
+          error << "slice (" << v << ", " << h << ") has only " << bytes << " bytes";
+          return error.str();
+        }
+        if (pos+bytes>size) {
+          error << "slice (" << v << ", " << h << ") overruns the picture data unit ("
+                << pos+bytes << " bytes needed, " << size << " available)";
+          return error.str();
+        }
+        const unsigned char* const slice = data+pos;
+        const int q = slice[0]>>1;
+        const int lengthBits = utils::intlog2(8*bytes-7);
+        long long lumaBits = 0;
+        for (int i=0; i<lengthBits; ++i) lumaBits = (lumaBits<<1) | bit(slice, 7+i);
+        const long long first = 7+lengthBits;
+        const long long last = 8LL*bytes;
+        if (first+lumaBits>last) {
+          error << "slice (" << v << ", " << h << ") luma length of " << lumaBits
+                << " bits exceeds the " << last-first << " bits available";
+          return error.str();
+        }
+        stats.add(q);
+        ++qCounts[q];
+        stats.paddingBits += trailing_ones(slice, first, first+lumaBits);
+        stats.paddingBits += trailing_ones(slice, first+lumaBits, last);
+        pos += bytes;
+      }
+    }
+    stats.bytes = pos;
+    if (pos!=size) {
+      std::ostringstream error;
+      error << "slices total " << pos << " bytes but the picture data unit has " << size;
+      return error.str();
+    }
+    return string();
+  }
+
+  // Walks the variable size slices of an HQ picture, returns an error message (empty if OK)
+  const string walk_hq_slices(const string& picture, const PicturePreamble& preamble,
+                              SliceStats& stats, std::vector<long long>& qCounts) {
+    const unsigned char* const data = reinterpret_cast<const unsigned char*>(picture.data());
+    const long long size = picture.size();
+    const int scalar = preamble.slice_size_scalar;
+    long long pos = 0;
+    for (int v=0; v<preamble.slices_y; ++v) {
+      for (int h=0; h<preamble.slices_x; ++h) {
+        std::ostringstream error;
+        pos += preamble.slice_prefix;
+        if (pos>=size) {
+          error << "slice (" << v << ", " << h << ") starts beyond the end of the picture data unit";
+          return error.str();
+        }
+        const int q = data[pos++];
+        for (int component=0; component<3; ++component) {
+          if (pos>=size) {
+            error << "slice (" << v << ", " << h << ") length byte is beyond the end of the picture data unit";
+            return error.str();
+          }
+          const long long length = static_cast<long long>(data[pos++])*scalar;
+          if (pos+length>size) {
+            error << "slice (" << v << ", " << h << ") component " << component
+                  << " overruns the picture data unit (" << pos+length << " bytes needed, "
+                  << size << " available)";
+            return error.str();
+          }
+          stats.paddingBits += trailing_ones(data+pos, 0, 8*length);
+          pos += length;
+        }
+        stats.add(q);
+        ++qCounts[q];
+      }
+    }
+    stats.bytes = pos;
+    if (pos!=size) {
+      std::ostringstream error;
+      error << "slices total " << pos << " bytes but the picture data unit has " << size;
+      return error.str();
+    }
+    return string();
+  }
+
+  const bool same_sequence(const SequenceHeader& a, const SequenceHeader& b) {
+    return (a.major_version==b.major_version) && (a.minor_version==b.minor_version) &&
+           (a.profile==b.profile) && (a.width==b.width) && (a.height==b.height) &&
+           (a.chromaFormat==b.chromaFormat) && (a.interlace==b.interlace) &&
+           (a.frameRate==b.frameRate) && (a.topFieldFirst==b.topFieldFirst) &&
+           (a.bitdepth==b.bitdepth);
+  }
+
+  // Remaining bytes of a data unit (whose size is known)
+  const string remainder(istream& stream, long long size) {
+    const long long position = stream.tellg();
+    string bytes(std::max(size-position, 0LL), '\0');
+    if (!bytes.empty()) stream.read(&bytes[0], bytes.size());
+    return bytes;
+  }
+
+} // end unnamed namespace
+
+int main(int argc, char * argv[]) {
+
+try { //Giant try block around all code to get error messages
+
+  ProgramParams params = getCommandLineParams(argc, argv, details);
+  if (!params.error.empty()) {
+    cerr << "Command line error: " << params.error << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Create convenient aliases for program parameters
+  const string inFileName = params.inFileName;
+  const string outFileName = params.outFileName;
+  const bool verbose = params.verbose;
+  const bool quiet = params.quiet;
+
+  // Open input file or use standard input
+  // Input stream is read only binary mode.
+  // No point in continuing if can't open input file.
+  filebuf inFileBuffer; // For file input. Needs to be defined here to remain in scope
+  streambuf *pInBuffer; // Either standard input buffer or a file buffer
+  if (inFileName=="-") { // Use standard in
+    //Set standard input to binary mode.
+    //Only relevant for Windows (*nix is always binary)
+    if ( utils::setstdinmode(std::ios_base::binary) == -1 ) {
+        cerr << "Error: could not set standard input to binary mode" << endl;
+        return EXIT_FAILURE;
+    }
+    pInBuffer = cin.rdbuf();
+  }
+  else { // Open file inFileName and use it for input
+    pInBuffer = inFileBuffer.open(inFileName.c_str(), ios_base::in|ios_base::binary);
+    if (!pInBuffer) {
+      perror((string("Failed to open input file \"")+inFileName+"\"").c_str());
+      return EXIT_FAILURE;
+    }
+  }
+  istream inStream(pInBuffer);
+
+  // Open report file or use standard output.
+  filebuf outFileBuffer; // For file output. Needs to be defined here to remain in scope
+  streambuf *pOutBuffer; // Either standard output buffer or a file buffer
+  if (outFileName=="-") { // Use standard out
+    pOutBuffer = cout.rdbuf();
+  }
+  else { // Open file outFileName and use it for output
+    pOutBuffer = outFileBuffer.open(outFileName.c_str(), ios_base::out);
+    if (!pOutBuffer) {
+      perror((string("Failed to open output file \"")+outFileName+"\"").c_str());
+      return EXIT_FAILURE;
+    }
+  }
+  ostream report(pOutBuffer);
+
+  // Stream state
+  SequenceHeader sequence;
+  bool haveSequence = false;
+  bool havePicture = false;
+  unsigned long lastPictureNumber = 0;
+  unsigned long lastNextOffset = 0; // Next parse offset of the previous data unit
+  bool endOfSequence = false;
+
+  // Statistics
+  long long offset = 0; // Of the current data unit, from the first parse info
+  int dataUnits = 0;
+  int pictures = 0;
+  long long pictureBytes = 0;
+  long long otherBytes = 0; // Sequence headers, auxiliary and padding data units etc.
+  long long paddingBits = 0;
+  std::vector<long long> qCounts(256, 0);
+  int errors = 0;
+  int warnings = 0;
+
+  inStream >> dataunitio::synchronise;
+  if (!inStream) {
+    report << "Error: no parse info found" << endl;
+    return EXIT_FAILURE;
+  }
+
+  while (!endOfSequence) {
+    DataUnit du;
+    inStream >> du;
+    // Size of the data unit as read (may be truncated)
+    du.stream().seekg(0, ios_base::end);
+    const long long payload = du.stream().tellg();
+    du.stream().seekg(0, ios_base::beg);
+    const long long unitBytes = 13 + payload;
+    ++dataUnits;
+
+    // Errors are reported with the data unit number and byte offset
+    std::ostringstream where;
+    where << "data unit " << dataUnits-1 << " (" << du.type << ") at byte " << offset;
+    #define PROBE_ERROR(message) \
+      do { report << "Error: " << where.str() << ": " << message << endl; ++errors; } while (0)
+    #define PROBE_WARNING(message) \
+      do { report << "Warning: " << where.str() << ": " << message << endl; ++warnings; } while (0)
+
+    if (verbose) {
+      report << "Data unit " << dataUnits-1 << " at byte " << offset << ": " << du.type
+             << ", next parse offset " << du.next_parse_offset
+             << ", previous parse offset " << du.prev_parse_offset << endl;
+    }
+
+    // Check the parse offset chain
+    if (du.prev_parse_offset!=lastNextOffset)
+      PROBE_ERROR("previous parse offset is " << du.prev_parse_offset << " but the previous data unit was " << lastNextOffset << " bytes");
+    if (du.next_parse_offset==0) {
+      if (du.type!=END_OF_SEQUENCE) PROBE_ERROR("next parse offset of zero is only allowed for the end of sequence");
+    }
+    else if (du.next_parse_offset<13)
+      PROBE_ERROR("next parse offset " << du.next_parse_offset << " is shorter than the parse info");
+    else if (static_cast<unsigned long>(unitBytes)!=du.next_parse_offset)
+      PROBE_ERROR("stream is truncated (" << unitBytes << " of " << du.next_parse_offset << " bytes)");
+    lastNextOffset = unitBytes;
+
+    switch (du.type) {
+    case SEQUENCE_HEADER:
+      {
+        SequenceHeader header;
+        du.stream() >> header;
+        otherBytes += unitBytes;
+        if (!du.stream()) {
+          PROBE_ERROR("failed to parse sequence header");
+          break;
+        }
+        if (verbose || (!quiet && !haveSequence)) {
+          report << "Sequence header: version " << header.major_version << "." << header.minor_version
+                 << ", " << (header.profile==PROFILE_LD ? "LD" : header.profile==PROFILE_HQ ? "HQ" : "unknown")
+                 << " profile, " << header.width << "x" << header.height << " " << header.chromaFormat
+                 << (header.interlace ? " interlaced" : " progressive") << ", " << header.frameRate
+                 << ", " << header.bitdepth << " bits" << endl;
+        }
+        if ((header.profile!=PROFILE_LD) && (header.profile!=PROFILE_HQ))
+          PROBE_ERROR("profile is neither LD nor HQ");
+        if (haveSequence && !same_sequence(header, sequence))
+          PROBE_ERROR("sequence header differs from the first sequence header");
+        if (!haveSequence) sequence = header;
+        haveSequence = true;
+      }
+      break;
+    case END_OF_SEQUENCE:
+      otherBytes += unitBytes;
+      endOfSequence = true;
+      break;
+    case LD_PICTURE:
+    case HQ_PICTURE:
+      {
+        const bool ld = (du.type==LD_PICTURE);
+        pictureBytes += unitBytes;
+        ++pictures;
+        if (!haveSequence) {
+          PROBE_ERROR("picture before the first sequence header");
+          break;
+        }
+        if ((ld && (sequence.profile!=PROFILE_LD)) || (!ld && (sequence.profile!=PROFILE_HQ)))
+          PROBE_ERROR("picture type does not match the sequence profile");
+
+        PicturePreamble preamble;
+        if (ld) du.stream() >> dataunitio::lowDelay;
+        else du.stream() >> dataunitio::highQualityVBR(1);
+        du.stream() >> dataunitio::majorVersion(sequence.major_version) >> preamble;
+        if (!du.stream()) {
+          PROBE_ERROR("failed to parse picture header");
+          break;
+        }
+
+        if (havePicture && (preamble.picture_number!=((lastPictureNumber+1)&0xFFFFFFFFUL)))
+          PROBE_WARNING("picture number " << preamble.picture_number << " follows " << lastPictureNumber);
+        havePicture = true;
+        lastPictureNumber = preamble.picture_number;
+
+        if (verbose) {
+          report << "Picture " << preamble.picture_number << ": kernel " << preamble.wavelet_kernel
+                 << ", depth " << preamble.depth << ", horizontal only depth " << preamble.depth_ho
+                 << ", " << preamble.slices_x << "x" << preamble.slices_y << " slices";
+          if (ld) report << ", slice bytes " << preamble.slice_bytes.numerator << "/" << preamble.slice_bytes.denominator;
+          else report << ", slice prefix " << preamble.slice_prefix << ", slice size scalar " << preamble.slice_size_scalar;
+          report << (preamble.quant_matrix.size()>0 ? ", custom quantisation matrix" : "") << endl;
+        }
+
+        // Check the picture header against the sequence
+        if (preamble.wavelet_kernel==NullKernel)
+          PROBE_ERROR("unknown wavelet kernel");
+        if ((preamble.slices_x<1) || (preamble.slices_y<1)) {
+          PROBE_ERROR("picture has no slices");
+          break;
+        }
+        if (ld && ((preamble.slice_bytes.numerator<1) || (preamble.slice_bytes.denominator<1))) {
+          PROBE_ERROR("invalid slice bytes " << preamble.slice_bytes.numerator << "/" << preamble.slice_bytes.denominator);
+          break;
+        }
+        if (!ld && (preamble.slice_size_scalar<1)) {
+          PROBE_ERROR("slice size scalar must be at least 1");
+          break;
+        }
+        {
+          const int pictureHeight = (sequence.interlace ? sequence.height/2 : sequence.height);
+          const int paddedHeight = paddedSize(pictureHeight, preamble.depth);
+          const int paddedWidth = paddedSize(sequence.width, preamble.depth+preamble.depth_ho);
+          if ((paddedHeight%(preamble.slices_y*utils::pow(2, preamble.depth))!=0) ||
+              (paddedWidth%(preamble.slices_x*utils::pow(2, preamble.depth+preamble.depth_ho))!=0))
+            PROBE_ERROR("slices do not evenly divide the padded picture");
+        }
+
+        // Walk the slices
+        SliceStats stats;
+        const string slices = remainder(du.stream(), payload);
+        const string error = (ld ? walk_ld_slices(slices, preamble, stats, qCounts)
+                                 : walk_hq_slices(slices, preamble, stats, qCounts));
+        if (!error.empty()) PROBE_ERROR(error);
+        paddingBits += stats.paddingBits;
+
+        if (!quiet) {
+          report << "Picture " << preamble.picture_number << ": " << (ld ? "LD" : "HQ")
+                 << ", " << unitBytes << " bytes, " << stats.slices << " slices";
+          if (stats.slices>0) {
+            report << std::fixed << std::setprecision(2)
+                   << ", q " << stats.qMin << " to " << stats.qMax
+                   << " (mean " << static_cast<double>(stats.qSum)/stats.slices << ")"
+                   << ", padding " << stats.paddingBits/8.0 << " bytes ("
+                   << (stats.bytes>0 ? 100.0*stats.paddingBits/(8*stats.bytes) : 0.0) << "%)";
+          }
+          report << endl;
+        }
+      }
+      break;
+    case AUXILIARY_DATA:
+    case PADDING_DATA:
+      otherBytes += unitBytes;
+      break;
+    default:
+      otherBytes += unitBytes;
+      PROBE_ERROR("unknown parse code");
+      break;
+    }
+
+    offset += unitBytes;
+    if (!endOfSequence && !du.prefix_follows) {
+      if (inStream.eof()) PROBE_ERROR("stream ends without an end of sequence");
+      else PROBE_ERROR("no parse info prefix follows");
+      break;
+    }
+    #undef PROBE_ERROR
+    #undef PROBE_WARNING
+  }
+
+  // Summary
+  report << endl << "Summary" << endl;
+  report << "Data units: " << dataUnits << ", " << offset << " bytes" << endl;
+  report << "Pictures: " << pictures << ", " << pictureBytes << " bytes";
+  if (pictures>0) report << " (mean " << pictureBytes/pictures << " per picture)";
+  report << endl;
+  report << "Other data units: " << otherBytes << " bytes" << endl;
+  if (haveSequence && sequence.interlace && (pictures%2!=0)) {
+    report << "Error: an interlaced sequence has an odd number of fields" << endl;
+    ++errors;
+  }
+  if (pictureBytes>0) {
+    report << std::fixed << std::setprecision(2)
+           << "Padding: " << paddingBits/8.0 << " bytes (" << 100.0*paddingBits/(8*pictureBytes)
+           << "% of picture bytes)" << endl;
+  }
+  report << "Quantisation index distribution (index: slices):";
+  for (unsigned int q=0; q<qCounts.size(); ++q) {
+    if (qCounts[q]>0) report << " " << q << ": " << qCounts[q];
+  }
+  report << endl;
+  report << "Warnings: " << warnings << endl;
+  report << "Errors: " << errors << endl;
+
+  if (inFileName!="-") inFileBuffer.close();
+  if (outFileName!="-") outFileBuffer.close();
+
+  return (errors==0 ? EXIT_SUCCESS : EXIT_FAILURE);
+
+} // end of try block
+
+// Report error messages from try block
+catch (const std::exception& ex) {
+    cout << "Error: " << ex.what() << endl;
+    return EXIT_FAILURE;
+}
+
+}
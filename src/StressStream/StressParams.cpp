@@ -0,0 +1,249 @@
+/*********************************************************************/
+/* StressParams.cpp                                                  */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines getting program parameters from command line.             */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include "StressParams.h"
+#include "Picture.h"
+#include "WaveletTransform.h"
+
+#include <iostream> //For cin, cout, cerr
+#include <stdexcept> // For invalid_argument
+#include <string>
+
+using std::clog;
+using std::endl;
+using std::string;
+using std::invalid_argument;
+
+#include <tclap/CmdLine.h>
+
+using TCLAP::CmdLine;
+using TCLAP::SwitchArg;
+using TCLAP::ValueArg;
+using TCLAP::UnlabeledValueArg;
+
+// Tell tclap that various enums are to be treated as tclap values
+namespace TCLAP {
+  template <>
+  struct ArgTraits<ColourFormat> { // Let TCLAP parse ColourFormat objects
+    typedef ValueLike ValueCategory;
+  };
+
+  template <>
+  struct ArgTraits<WaveletKernel> { // Let TCLAP parse WaveletKernel objects
+    typedef ValueLike ValueCategory;
+  };
+
+  template <>
+  struct ArgTraits<Profile> { // Let TCLAP parse Profile objects
+    typedef ValueLike ValueCategory;
+  };
+}
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char * details[]) {
+
+  const char * const version = details[0];
+  const char * const summary = details[1];
+  const char * const description = details[2];
+
+  if (argc<2) {
+    clog << "Version: " << version << endl;
+    clog << description << endl;
+    clog << "\nFor more details and useage use -h or --help" << endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  ProgramParams params;
+
+  try {
+
+    // Define tclap command line object
+    CmdLine cmd(summary, ' ', version);
+
+    // Define tclap command line parameters (and add them to tclap command line)
+    UnlabeledValueArg<string> outFile("outFile", "Output file name (use \"-\" for standard output)", true, "-", "string", cmd);
+    SwitchArg verbosity("v", "verbose", "Output extra information to standard log", cmd);
+    // "cla" prefix == command line argument
+    ValueArg<Profile> cla_profile("P", "profile", "VC-2 profile (LD or HQ)", true, PROFILE_UNKNOWN, "string", cmd);
+    ValueArg<int> cla_frames("N", "frames", "Number of frames to generate (default 1)", false, 1, "integer", cmd);
+    ValueArg<int> cla_magnitude("m", "magnitude", "Largest coefficient magnitude (defaults to 2**(bit depth + wavelet depths) - 1)", false, 0, "integer", cmd);
+    ValueArg<int> cla_sliceScalar("S", "scalar", "HQ slice size scalar (defaults to the smallest that fits every slice)", false, 0, "integer", cmd);
+    ValueArg<int> cla_compressedBytes("s", "compressedBytes", "LD compressed bytes per frame (defaults to enough for every coefficient at full magnitude)", false, 0, "integer", cmd);
+    ValueArg<int> cla_hSliceSize("a", "hSlice", "Horizontical slice size (in units of 2**(wavelet depth + horizontal only depth))", true, 0, "integer", cmd);
+    ValueArg<int> cla_vSliceSize("u", "vSlice", "Vertical slice size (in units of 2**(wavelet depth))", true, 0, "integer", cmd);
+    ValueArg<int> cla_waveletDepth("d", "waveletDepth", "Wavelet transform depth (defaults to the deepest the picture and slice size allow)", false, 0, "integer", cmd);
+    ValueArg<int> cla_waveletDepthHo("D", "waveletDepthHo", "Additional horizontal only wavelet transform depth (default 0)", false, 0, "integer", cmd);
+    ValueArg<WaveletKernel> cla_kernel("k", "kernel", "Wavelet kernel (DD97, LeGall, DD137, Haar0, Haar1, Fidelity, Daub97)", false, LeGall, "string", cmd);
+    SwitchArg cla_bottomFieldFirst("b", "bottomFieldFirst", "Bottom field is earliest (defaults to top field first))", cmd, false);
+    SwitchArg cla_topFieldFirst("t", "topFieldFirst", "Top field is earliest (defaults to top field first))", cmd, true);
+    SwitchArg cla_interlace("i", "interlace", "Use interlace coding (defaults to progressive coding))", cmd, false);
+    SwitchArg cla_progressive("p", "progressive", "Use progressive coding (defaults to progressive coding))", cmd, true);
+    ValueArg<int> cla_bitDepth("z", "bitDepth", "Bit depth for all components (default 10)", false, 10, "integer", cmd);
+    ValueArg<ColourFormat> cla_format("f", "format", "Colour format (4:4:4, 4:2:2, 4:2:0 or RGB)", true, UNKNOWN, "string", cmd);
+    ValueArg<int> cla_width("x", "width", "Picture width", true, 0, "integer", cmd);
+    ValueArg<int> cla_height("y", "height", "Picture height", true, 0, "integer", cmd);
+    ValueArg<int> cla_framerate("r", "framerate", "Frame Rate ( 1 = 24/1.001, 2 = 24, 3 = 25, 4 = 30/1.001, 5 = 30, 6 = 50, 7 = 60/1.001, 8 = 60, 9 = 15/1.001, 10 = 25/2, 11 = 48 (default 3)", false, 3, "integer", cmd);
+
+    // Parse the argv array
+    cmd.parse(argc, argv);
+
+    // Initialise program parameters
+    const string outFileName = outFile.getValue();
+    const bool verbose = verbosity.getValue();
+    const Profile profile = cla_profile.getValue();
+    const int height = cla_height.getValue();
+    const int width = cla_width.getValue();
+    const ColourFormat chromaFormat = cla_format.getValue();
+    const int bitDepth = cla_bitDepth.getValue();
+    bool interlaced = cla_interlace.isSet();
+    bool topFieldFirst = !cla_bottomFieldFirst.isSet();
+    const WaveletKernel kernel = cla_kernel.getValue();
+    const int waveletDepth = cla_waveletDepth.getValue();
+    const int waveletDepthHo = cla_waveletDepthHo.getValue();
+    const int ySize = cla_vSliceSize.getValue();
+    const int xSize = cla_hSliceSize.getValue();
+    const int compressedBytes = cla_compressedBytes.getValue();
+    const int sliceScalar = cla_sliceScalar.getValue();
+    const int magnitude = cla_magnitude.getValue();
+    const int frames = cla_frames.getValue();
+    const int frame_rate = cla_framerate.getValue();
+
+    // Check for valid combinations of parameters and options
+    if (cla_progressive.isSet() && cla_interlace.isSet())
+      throw invalid_argument("image can't be both interlaced and progressive: specify one or the other");
+    if (cla_progressive.isSet() && (cla_topFieldFirst.isSet() || cla_bottomFieldFirst.isSet()))
+      throw invalid_argument("field parity is incompatible with progressive image");
+    if (cla_topFieldFirst.isSet() && cla_bottomFieldFirst.isSet())
+      throw invalid_argument("image can't be both top field first and bottom field first: specify one or the other");
+    if ((profile==PROFILE_LD) && cla_sliceScalar.isSet())
+      throw invalid_argument("slice size scalar is only used by the HQ profile");
+    if ((profile==PROFILE_HQ) && cla_compressedBytes.isSet())
+      throw invalid_argument("compressed bytes are only used by the LD profile (HQ slices are as big as needed)");
+
+    // Check parameter values
+    if (profile==PROFILE_UNKNOWN)
+      throw invalid_argument("profile must be LD or HQ");
+    if (height<1) throw invalid_argument("picture height must be > 0");
+    if (width<1) throw invalid_argument("picture width must be > 0");
+    if (chromaFormat==UNKNOWN)
+      throw std::invalid_argument("unknown colour format");
+    if ((bitDepth!=8) && (bitDepth!=10) && (bitDepth!=12))
+      throw std::invalid_argument("bit depth must be 8, 10 or 12");
+    if (kernel==NullKernel)
+      throw std::invalid_argument("invalid wavelet kernel");
+    if (cla_waveletDepth.isSet() && (waveletDepth<1))
+      throw std::invalid_argument("wavelet depth must be 1 or more");
+    if (waveletDepthHo<0)
+      throw std::invalid_argument("horizontal only wavelet depth must be 0 or more");
+    if ((ySize<1) || (xSize<1))
+      throw std::invalid_argument("slice sizes must be 1 or more");
+    if (cla_compressedBytes.isSet() && (compressedBytes<1))
+      throw std::invalid_argument("number of compressed bytes must be >0");
+    if (cla_sliceScalar.isSet() && (sliceScalar<1))
+      throw std::invalid_argument("slice size scalar must be >0");
+    if (cla_magnitude.isSet() && (magnitude<1))
+      throw std::invalid_argument("coefficient magnitude must be >0");
+    if (frames<1)
+      throw std::invalid_argument("number of frames must be >0");
+
+    params.outFileName = outFileName;
+    params.verbose = verbose;
+    params.profile = profile;
+    params.height = height;
+    params.width = width;
+    params.chromaFormat = chromaFormat;
+    params.bitDepth = bitDepth;
+    params.interlaced = interlaced;
+    params.topFieldFirst = topFieldFirst;
+    params.kernel = kernel;
+    params.waveletDepth = waveletDepth;
+    params.waveletDepthHo = waveletDepthHo;
+    params.ySize = ySize;
+    params.xSize = xSize;
+    params.compressedBytes = compressedBytes;
+    params.slice_scalar = sliceScalar;
+    params.magnitude = magnitude;
+    params.frames = frames;
+
+    switch (frame_rate) {
+    case 1:
+      params.frame_rate = FR24000_1001;
+      break;
+    case 2:
+      params.frame_rate = FR24;
+      break;
+    case 3:
+      params.frame_rate = FR25;
+      break;
+    case 4:
+      params.frame_rate = FR30000_1001;
+      break;
+    case 5:
+      params.frame_rate = FR30;
+      break;
+    case 6:
+      params.frame_rate = FR50;
+      break;
+    case 7:
+      params.frame_rate = FR60000_1001;
+      break;
+    case 8:
+      params.frame_rate = FR60;
+      break;
+    case 9:
+      params.frame_rate = FR15000_1001;
+      break;
+    case 10:
+      params.frame_rate = FR25_2;
+      break;
+    case 11:
+      params.frame_rate = FR48;
+      break;
+    default:
+      params.frame_rate = FR0;
+      break;
+    }
+  }
+
+  // catch any TCLAP exceptions
+  catch (TCLAP::ArgException &e) {
+    params.error = string("Command line error: ") + e.error() + " for arg " + e.argId();
+  }
+
+  // catch other exceptions
+  catch(const std::exception& ex) {
+    params.error = string(ex.what());
+  }
+
+  return params;
+}
+
+std::ostream& operator<<(std::ostream& os, Profile profile) {
+  const char* s;
+  switch (profile) {
+    case PROFILE_LD:
+      s = "LD";
+      break;
+    case PROFILE_HQ:
+      s = "HQ";
+      break;
+    default:
+      s = "Unknown profile!";
+      break;
+  }
+  return os<<s;
+}
+
+std::istream& operator>>(std::istream& is, Profile& profile) {
+        std::string text;
+        is >> text;
+        if (text == "LD") profile = PROFILE_LD;
+        else if (text == "HQ") profile = PROFILE_HQ;
+        else is.setstate(std::ios_base::badbit|std::ios_base::failbit);
+        return is;
+}
@@ -0,0 +1,48 @@
+/*********************************************************************/
+/* StressParams.h                                                    */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares getting program parameters from command line.            */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef STRESSPARAMS_18OCT26
+#define STRESSPARAMS_18OCT26
+
+#include <string>
+
+#include "Picture.h"
+#include "WaveletTransform.h"
+#include "DataUnit.h"
+
+std::ostream& operator<<(std::ostream&, Profile value);
+
+std::istream& operator>>(std::istream&, Profile& value);
+
+struct ProgramParams {
+  std::string outFileName;
+  bool verbose;
+  Profile profile;
+  int height;
+  int width;
+  enum ColourFormat chromaFormat;
+  int bitDepth;
+  bool interlaced;
+  bool topFieldFirst;
+  enum WaveletKernel kernel;
+  int waveletDepth; // Zero for the deepest transform the slices allow
+  int waveletDepthHo;
+  int ySize;
+  int xSize;
+  int compressedBytes; // LD only, zero for enough bytes for every coefficient
+  int slice_scalar; // HQ only, zero for the smallest scalar that fits
+  int magnitude; // Zero for the largest a picture of bitDepth can produce
+  int frames;
+  FrameRate frame_rate;
+  std::string error;
+};
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]);
+
+#endif // STRESSPARAMS_18OCT26
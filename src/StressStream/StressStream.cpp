@@ -0,0 +1,375 @@
+/*********************************************************************/
+/* StressStream.cpp                                                  */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Generates valid VC-2 streams that are as slow as possible to      */
+/* decode, for measuring worst case decoder performance.             */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+const char version[] = __DATE__ " @ " __TIME__ ;
+const char summary[] = "Generates worst case VC-2 LD or HQ streams for decoder benchmarking";
+const char description[] = "\
+This program generates a VC-2 stream that is as costly as possible to decode.\n\
+Every slice has quantisation index zero and its coefficients have the largest\n\
+magnitude (and hence longest variable length codes) that fit in the slice.\n\
+For the HQ profile every coefficient has the largest magnitude and the slice size\n\
+scalar is the smallest that fits. For the LD profile every bit of every slice is\n\
+used, with the slice size set by the compressed bytes (by default large enough for\n\
+every coefficient at the largest magnitude).\n\
+By default the wavelet depth is the deepest that the picture and slice size allow\n\
+and the largest magnitude is that produced by transforming a picture of the bit depth.\n\
+The stream is written to the output file, for decoding with DecodeStream --benchmark.\n\
+\n\
+Example: StressStream -v -P HQ -x 1920 -y 1080 -f 4:2:2 -z 10 -i -u 1 -a 2 outFileName";
+const char* details[] = {version, summary, description};
+
+#include <cstdlib> //for EXIT_SUCCESS, EXIT_FAILURE, atoi
+#include <stdexcept> //For standard logic errors
+#include <iostream> //For cin, cout, cerr
+#include <string>
+#include <fstream>
+#include <cstdio> // for perror
+#include <algorithm>
+
+#include "StressParams.h"
+#include "Arrays.h"
+#include "Picture.h"
+#include "WaveletTransform.h"
+#include "Quantisation.h"
+#include "Slices.h"
+#include "VLC.h"
+#include "Utils.h"
+#include "DataUnit.h"
+
+using std::cout;
+using std::cerr;
+using std::clog;
+using std::endl;
+using std::string;
+using std::filebuf;
+using std::streambuf;
+using std::ios_base;
+using std::ostream;
+
+// Number of bits in the signed VLC for a value
+const int vlc_bits(int value) {
+  return SignedVLC(value).numOfBits();
+}
+
+// The largest magnitude, no larger than limit, with a code no longer than bits
+// (signed codes are 1 bit for zero then 4, 6, 8 ... bits)
+const int magnitude_for_bits(int bits, int limit) {
+  if (bits<4) return 0;
+  return std::min(utils::pow(2, (bits-2)/2+1)-2, limit);
+}
+
+// Fill a component slice with coefficients of alternating sign, whose codes
+// use as many bits as possible without exceeding the budget. Returns the bits used.
+const long long fill_coefficients(Array2D& coefficients, long long budget, int limit) {
+  const int count = coefficients.num_elements();
+  const int maxBits = vlc_bits(limit);
+  int baseBits = maxBits;
+  int nextBits = maxBits;
+  int upgrades = 0;
+  if (static_cast<long long>(count)*maxBits > budget) {
+    // All coefficients use baseBits, and some are upgraded to nextBits
+    baseBits = 1;
+    nextBits = 4;
+    while ((nextBits<maxBits) && (static_cast<long long>(count)*nextBits<=budget)) {
+      baseBits = nextBits;
+      nextBits += 2;
+    }
+    const long long spare = budget - static_cast<long long>(count)*baseBits;
+    upgrades = static_cast<int>(std::min(static_cast<long long>(count), spare/(nextBits-baseBits)));
+  }
+  const int baseMagnitude = (baseBits==maxBits ? limit : magnitude_for_bits(baseBits, limit));
+  const int nextMagnitude = (nextBits==maxBits ? limit : magnitude_for_bits(nextBits, limit));
+  int* const data = coefficients.data();
+  long long bits = 0;
+  for (int i=0; i<count; ++i) {
+    const int magnitude = (i<upgrades ? nextMagnitude : baseMagnitude);
+    data[i] = ((i%2) ? -magnitude : magnitude);
+    bits += vlc_bits(data[i]);
+  }
+  return bits;
+}
+
+// Depth at which the picture is padded to a whole number of slices, each no bigger than the picture
+const bool slices_fit(int height, int width, int depth, int depthHo, int ySize, int xSize) {
+  const int sliceHeight = ySize*utils::pow(2, depth);
+  const int sliceWidth = xSize*utils::pow(2, depth+depthHo);
+  return (sliceHeight<=height) && (sliceWidth<=width) &&
+         (paddedSize(height, depth)%sliceHeight==0) &&
+         (paddedSize(width, depth+depthHo)%sliceWidth==0);
+}
+
+int main(int argc, char * argv[]) {
+
+try { //Giant try block around all code to get error messages
+
+  // get command line parameters
+  ProgramParams params = getCommandLineParams(argc, argv, details);
+  if (!params.error.empty()) {
+    cerr << "Command line error: " << params.error << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Create convenient aliases for program parameters
+  const string outFileName = params.outFileName;
+  const bool verbose = params.verbose;
+  const Profile profile = params.profile;
+  const int height = params.height;
+  const int width = params.width;
+  const ColourFormat chromaFormat = params.chromaFormat;
+  const int bitDepth = params.bitDepth;
+  const bool interlaced = params.interlaced;
+  const bool topFieldFirst = params.topFieldFirst;
+  const WaveletKernel kernel = params.kernel;
+  const int waveletDepthHo = params.waveletDepthHo;
+  const int ySize = params.ySize;
+  const int xSize = params.xSize;
+  const int frames = params.frames;
+  const FrameRate frame_rate = params.frame_rate;
+
+  if (verbose) {
+    clog << endl;
+    for (int arg=0; arg<argc; ++arg) { //Output command line
+      if (arg) clog << " ";
+      clog << argv[arg];
+    }
+    clog << endl;
+    clog << "output file = " << outFileName << endl;
+  }
+
+  const int pictureHeight = ( (interlaced) ? height/2 : height);
+
+  // Use the deepest transform for which the picture divides into slices, unless specified
+  int waveletDepth = params.waveletDepth;
+  if (waveletDepth==0) {
+    for (int depth=1; utils::pow(2, depth)<=pictureHeight; ++depth) {
+      if (slices_fit(pictureHeight, width, depth, waveletDepthHo, ySize, xSize)) waveletDepth = depth;
+    }
+    if (waveletDepth==0)
+      throw std::logic_error("Picture is too small for a single slice of this size");
+  }
+
+  // Calculate number of slices per picture
+  const int yTransformSize = ySize*utils::pow(2,waveletDepth);
+  const int xTransformSize = xSize*utils::pow(2,waveletDepth+waveletDepthHo);
+  const int paddedPictureHeight = paddedSize(pictureHeight, waveletDepth);
+  const int paddedWidth = paddedSize(width, waveletDepth+waveletDepthHo);
+  const int ySlices = paddedPictureHeight/yTransformSize;
+  const int xSlices = paddedWidth/xTransformSize;
+  if (paddedPictureHeight != (ySlices*yTransformSize) ) {
+    throw std::logic_error("Padded picture height is not divisible by slice height");
+  }
+  if (paddedWidth != (xSlices*xTransformSize) ) {
+    throw std::logic_error("Padded width is not divisible by slice width");
+  }
+
+  // Each chroma slice must contain whole transform blocks, else some subbands are empty
+  const PictureFormat transformFormat(paddedPictureHeight, paddedWidth, chromaFormat);
+  Slices slices(transformFormat, waveletDepth, ySlices, xSlices, waveletDepthHo);
+  const PictureFormat sliceFormat = slices.yuvSlices[0][0].format();
+  if ((sliceFormat.chromaHeight()%utils::pow(2, waveletDepth)!=0) ||
+      (sliceFormat.chromaWidth()%utils::pow(2, waveletDepth+waveletDepthHo)!=0)) {
+    throw std::invalid_argument("slice size must be a multiple of the chroma subsampling");
+  }
+
+  // Largest coefficient magnitude (each 2D level may add a bit, each horizontal level half a bit),
+  // limited to the largest value whose code fits in 32 bits
+  const int maxCodable = 65534;
+  if (params.magnitude>maxCodable)
+    throw std::invalid_argument("coefficient magnitude is too large to code");
+  const int magnitude = (params.magnitude ? params.magnitude :
+                         std::min(utils::pow(2, bitDepth+waveletDepth+waveletDepthHo)-1, maxCodable));
+
+  // Default quantisation matrices are only defined up to depth 4
+  const Array1D customQMatrix = ((waveletDepth>4) || (waveletDepthHo>0) ?
+                                 quantMatrix(kernel, waveletDepth, waveletDepthHo) : Array1D());
+
+  const int lumaCount = sliceFormat.lumaHeight()*sliceFormat.lumaWidth();
+  const int chromaCount = sliceFormat.chromaHeight()*sliceFormat.chromaWidth();
+  const int maxBits = vlc_bits(magnitude);
+  const int framePics = (interlaced ? 2 : 1);
+
+  // LD pictures have a fixed number of bytes per slice. By default make them
+  // just big enough for every coefficient at the largest magnitude, within
+  // the largest slice size that the picture header can code.
+  int compressedBytes = params.compressedBytes;
+  if ((profile==PROFILE_LD) && (compressedBytes==0)) {
+    const long long coefficientBits = static_cast<long long>(lumaCount+2*chromaCount)*maxBits;
+    int sliceBytes = static_cast<int>((coefficientBits+7+7)/8);
+    for (int i=0; i<2; ++i) { // Allow for the bits coding the luma length (converges immediately)
+      sliceBytes = static_cast<int>((coefficientBits+7+utils::intlog2(8*sliceBytes-7)+7)/8);
+    }
+    sliceBytes = std::min(sliceBytes, maxCodable);
+    compressedBytes = framePics*ySlices*xSlices*sliceBytes;
+  }
+  const int pictureBytes = compressedBytes/framePics;
+  if ((profile==PROFILE_LD) &&
+      (utils::rationalise(pictureBytes, ySlices*xSlices).numerator>maxCodable))
+    throw std::invalid_argument("too many compressed bytes for the slice bytes to be coded");
+  const Array2D sliceBytes = slice_bytes(ySlices, xSlices, pictureBytes, 1);
+
+  if (verbose) {
+    clog << "profile = " << profile << endl;
+    clog << "bit depth = " << bitDepth << endl;
+    clog << "height = " << height << endl;
+    clog << "width = " << width << endl;
+    clog << "chroma format = " << chromaFormat << endl;
+    clog << "interlaced = " << std::boolalpha << interlaced << endl;
+    clog << "wavelet kernel = " << kernel << endl;
+    clog << "wavelet depth = " << waveletDepth << endl;
+    clog << "horizontal only wavelet depth = " << waveletDepthHo << endl;
+    clog << "Vertical slices per picture          = " << ySlices << endl;
+    clog << "Horizontal slices per picture        = " << xSlices << endl;
+    clog << "largest coefficient magnitude = " << magnitude << " (" << maxBits << " bit codes)" << endl;
+    if (profile==PROFILE_LD) clog << "compressed bytes per frame = " << compressedBytes << endl;
+  }
+
+  // Fill every slice with the longest codes that fit
+  long long codedBits = 0;
+  long long availableBits = 0;
+  int sliceScalar = params.slice_scalar;
+  for (int v=0; v<ySlices; ++v) {
+    for (int h=0; h<xSlices; ++h) {
+      Picture& slice = slices.yuvSlices[v][h];
+      Array2D y(sliceFormat.lumaShape());
+      Array2D u(sliceFormat.chromaShape());
+      Array2D w(sliceFormat.chromaShape());
+      if (profile==PROFILE_LD) {
+        const int bytes = sliceBytes[v][h];
+        const long long available = 8LL*bytes - 7 - utils::intlog2(8*bytes-7);
+        if (available<0) throw std::logic_error("Too few compressed bytes for a slice");
+        const long long total = static_cast<long long>(lumaCount+2*chromaCount);
+        const long long yBudget = (available>=total*maxBits ? lumaCount*maxBits : available*lumaCount/total);
+        fill_coefficients(y, yBudget, magnitude);
+        // Only the luma bits actually coded (up to the last non zero value) count
+        const long long uvBudget = available - luma_slice_bits(y, waveletDepth, waveletDepthHo);
+        const long long uBits = fill_coefficients(u, uvBudget/2, magnitude);
+        fill_coefficients(w, uvBudget-uBits, magnitude);
+        codedBits += luma_slice_bits(y, waveletDepth, waveletDepthHo) +
+                     chroma_slice_bits(u, w, waveletDepth, waveletDepthHo);
+        availableBits += available;
+      }
+      else {
+        const long long unlimited = static_cast<long long>(lumaCount)*maxBits;
+        codedBits += fill_coefficients(y, unlimited, magnitude);
+        codedBits += fill_coefficients(u, unlimited, magnitude);
+        codedBits += fill_coefficients(w, unlimited, magnitude);
+      }
+      slice.y(y);
+      slice.c1(u);
+      slice.c2(w);
+      slices.qIndices[v][h] = 0;
+    }
+  }
+
+  if (profile==PROFILE_HQ) {
+    // The length of each component is coded in one byte, in units of the scalar
+    int maxBytes = 0;
+    const Picture& slice = slices.yuvSlices[0][0];
+    maxBytes = std::max(maxBytes, component_slice_bytes(slice.y(), waveletDepth, 1, waveletDepthHo));
+    maxBytes = std::max(maxBytes, component_slice_bytes(slice.c1(), waveletDepth, 1, waveletDepthHo));
+    maxBytes = std::max(maxBytes, component_slice_bytes(slice.c2(), waveletDepth, 1, waveletDepthHo));
+    const int minScalar = std::max(1, (maxBytes+254)/255);
+    if (sliceScalar==0) sliceScalar = minScalar;
+    if (sliceScalar<minScalar)
+      throw std::invalid_argument("slice size scalar is too small for the slices");
+  }
+
+  if (verbose) {
+    if (profile==PROFILE_LD) {
+      clog << "Coefficient bits per picture = " << codedBits << " of " << availableBits << " available" << endl;
+    }
+    else {
+      clog << "Coefficient bits per picture = " << codedBits << endl;
+      clog << "slice size scalar = " << sliceScalar << endl;
+    }
+  }
+
+  // Open output file or use standard output.
+  // Output stream is write only binary mode
+  // No point in continuing if can't open output file.
+  filebuf outFileBuffer; // For file output. Needs to be defined here to remain in scope
+  streambuf *pOutBuffer; // Either standard output buffer or a file buffer
+  if (outFileName=="-") { // Use standard out
+    //Set standard input to binary mode.
+    //Only relevant for Windows (*nix is always binary)
+    if ( utils::setstdoutmode(std::ios_base::binary) == -1 ) {
+        cerr << "Error: could not set standard output to binary mode" << endl;
+        return EXIT_FAILURE;
+    }
+    pOutBuffer = cout.rdbuf();
+  }
+  else { // Open file outFileName and use it for output
+    pOutBuffer = outFileBuffer.open(outFileName.c_str(), ios_base::out|ios_base::binary);
+    if (!pOutBuffer) {
+      perror((string("Failed to open output file \"")+outFileName+"\"").c_str());
+      return EXIT_FAILURE;
+    }
+  }
+  ostream outStream(pOutBuffer);
+
+  if (verbose) clog << endl << "Writing Sequence Header" << endl;
+  outStream << dataunitio::start_sequence;
+  SequenceHeader sequence(profile, height, width, chromaFormat, interlaced, frame_rate, topFieldFirst, bitDepth);
+  if (waveletDepthHo>0) sequence.major_version = 3; // Asymmetric transforms need version 3
+  outStream << sequence;
+
+  const utils::Rational rationalBytes = utils::rationalise(pictureBytes, (ySlices*xSlices));
+  for (int frame=0; frame<frames; ++frame) {
+    if (verbose) clog << "Writing frame " << frame << endl;
+    for (int pic=0; pic<framePics; ++pic) {
+      const int pictureNumber = frame*framePics + pic;
+      if (profile==PROFILE_LD) {
+        const WrappedPicture outWrapped(pictureNumber,
+                                        kernel,
+                                        waveletDepth,
+                                        xSlices,
+                                        ySlices,
+                                        rationalBytes,
+                                        slices,
+                                        waveletDepthHo,
+                                        customQMatrix);
+        outStream << sliceio::lowDelay(sliceBytes); // Write output in Low Delay mode
+        outStream << outWrapped;
+      }
+      else {
+        const int slicePrefix = 0;
+        const WrappedPicture outWrapped(pictureNumber,
+                                        kernel,
+                                        waveletDepth,
+                                        xSlices,
+                                        ySlices,
+                                        slicePrefix,
+                                        sliceScalar,
+                                        slices,
+                                        waveletDepthHo,
+                                        customQMatrix);
+        outStream << dataunitio::highQualityVBR(sliceScalar); // Write output in HQ VBR mode
+        outStream << outWrapped;
+      }
+      if (!outStream) {
+        cerr << "Failed to write output file \"" << outFileName << "\"" << endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  outStream << dataunitio::end_sequence;
+
+  if (outFileName!="-") outFileBuffer.close();
+} // end of try block
+
+// Report error messages from try block
+catch (const std::exception& ex) {
+    cout << "Error: " << ex.what() << endl;
+    return EXIT_FAILURE;
+}
+
+  return EXIT_SUCCESS;
+}
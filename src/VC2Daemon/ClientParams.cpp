@@ -0,0 +1,94 @@
+/*********************************************************************/
+/* ClientParams.cpp                                                  */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines getting vc2c program parameters from command line.        */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include "ClientParams.h"
+#include "Protocol.h"
+
+#include <iostream> //For cin, cout, cerr
+#include <stdexcept> // For invalid_argument
+#include <string>
+#include <vector>
+
+using std::clog;
+using std::endl;
+using std::string;
+using std::vector;
+using std::invalid_argument;
+
+#include <tclap/CmdLine.h>
+
+using TCLAP::CmdLine;
+using TCLAP::SwitchArg;
+using TCLAP::ValueArg;
+using TCLAP::UnlabeledMultiArg;
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char * details[]) {
+
+  const char * const version = details[0];
+  const char * const summary = details[1];
+  const char * const description = details[2];
+
+  if (argc<2) {
+    clog << "Version: " << version << endl;
+    clog << description << endl;
+    clog << "\nFor more details and useage use -h or --help" << endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  ProgramParams params;
+
+  try {
+
+    // Define tclap command line object
+    CmdLine cmd(summary, ' ', version);
+
+    // Define tclap command line parameters (and add them to tclap command line)
+    UnlabeledMultiArg<string> cla_job("job", "Job name, input and output file names (use \"-\" for standard input/output) then job parameters as key=value", true, "string", cmd);
+    SwitchArg verbosity("v", "verbose", "Output extra information to standard log", cmd);
+    // "cla" prefix == command line argument
+    SwitchArg cla_paths("p", "paths", "Send file names for the service to open rather than open file descriptors", cmd, false);
+    ValueArg<string> cla_socket("s", "socket", string("Path of the vc2d socket (default ")+protocol::defaultSocket+")", false, protocol::defaultSocket, "string", cmd);
+
+    // Parse the argv array
+    cmd.parse(argc, argv);
+
+    const vector<string> job = cla_job.getValue();
+    params.socketPath = cla_socket.getValue();
+    params.verbose = verbosity.getValue();
+    params.sendPaths = cla_paths.getValue();
+    params.job = job[0];
+
+    // Shutdown is the only job without input and output files
+    vector<string>::const_iterator arg = job.begin()+1;
+    if (params.job!="shutdown") {
+      if (job.size()<3) throw invalid_argument("input and output file names are required");
+      params.inFileName = *arg++;
+      params.outFileName = *arg++;
+    }
+    for ( ; arg!=job.end(); ++arg) {
+      if (arg->find('=')==string::npos)
+        throw invalid_argument("job parameters must be of the form key=value, not \"" + *arg + "\"");
+      params.jobParams.push_back(*arg);
+    }
+    if (params.sendPaths && ((params.inFileName=="-") || (params.outFileName=="-")))
+      throw invalid_argument("standard input/output can't be sent as paths");
+  }
+
+  // catch any TCLAP exceptions
+  catch (TCLAP::ArgException &e) {
+    params.error = string("Command line error: ") + e.error() + " for arg " + e.argId();
+  }
+
+  // catch other exceptions
+  catch(const std::exception& ex) {
+    params.error = string(ex.what());
+  }
+
+  return params;
+}
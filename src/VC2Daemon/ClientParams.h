@@ -0,0 +1,29 @@
+/*********************************************************************/
+/* ClientParams.h                                                    */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares getting vc2c program parameters from command line.       */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef CLIENTPARAMS_18OCT26
+#define CLIENTPARAMS_18OCT26
+
+#include <string>
+#include <vector>
+
+struct ProgramParams {
+  std::string socketPath;
+  bool verbose;
+  bool sendPaths;
+  std::string job;
+  std::string inFileName;
+  std::string outFileName;
+  std::vector<std::string> jobParams; // "key=value" tokens
+  std::string error;
+};
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]);
+
+#endif // CLIENTPARAMS_18OCT26
@@ -0,0 +1,69 @@
+/*********************************************************************/
+/* DaemonParams.cpp                                                  */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines getting vc2d program parameters from command line.        */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include "DaemonParams.h"
+#include "Protocol.h"
+
+#include <iostream> //For cin, cout, cerr
+#include <stdexcept> // For invalid_argument
+#include <string>
+
+using std::string;
+using std::invalid_argument;
+
+#include <tclap/CmdLine.h>
+
+using TCLAP::CmdLine;
+using TCLAP::SwitchArg;
+using TCLAP::ValueArg;
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char * details[]) {
+
+  const char * const version = details[0];
+  const char * const summary = details[1];
+
+  ProgramParams params;
+
+  try {
+
+    // Define tclap command line object
+    CmdLine cmd(summary, ' ', version);
+
+    // Define tclap command line parameters (and add them to tclap command line)
+    SwitchArg verbosity("v", "verbose", "Output extra information to standard log", cmd);
+    // "cla" prefix == command line argument
+    ValueArg<int> cla_contexts("c", "contexts", "Maximum number of idle format contexts kept for reuse (default 16)", false, 16, "integer", cmd);
+    ValueArg<int> cla_threads("j", "threads", "Number of jobs run concurrently (default one per hardware thread)", false, 0, "integer", cmd);
+    ValueArg<string> cla_socket("s", "socket", string("Path of the Unix domain socket (default ")+protocol::defaultSocket+")", false, protocol::defaultSocket, "string", cmd);
+
+    // Parse the argv array
+    cmd.parse(argc, argv);
+
+    // Check parameter values
+    if (cla_threads.getValue()<0) throw invalid_argument("number of threads must be >= 0");
+    if (cla_contexts.getValue()<0) throw invalid_argument("number of contexts must be >= 0");
+
+    params.socketPath = cla_socket.getValue();
+    params.verbose = verbosity.getValue();
+    params.threads = cla_threads.getValue();
+    params.contexts = cla_contexts.getValue();
+  }
+
+  // catch any TCLAP exceptions
+  catch (TCLAP::ArgException &e) {
+    params.error = string("Command line error: ") + e.error() + " for arg " + e.argId();
+  }
+
+  // catch other exceptions
+  catch(const std::exception& ex) {
+    params.error = string(ex.what());
+  }
+
+  return params;
+}
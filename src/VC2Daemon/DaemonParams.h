@@ -0,0 +1,25 @@
+/*********************************************************************/
+/* DaemonParams.h                                                    */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares getting vc2d program parameters from command line.       */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef DAEMONPARAMS_18OCT26
+#define DAEMONPARAMS_18OCT26
+
+#include <string>
+
+struct ProgramParams {
+  std::string socketPath;
+  bool verbose;
+  int threads;
+  int contexts;
+  std::string error;
+};
+
+ProgramParams getCommandLineParams(int argc, char * argv[], const char* details[]);
+
+#endif // DAEMONPARAMS_18OCT26
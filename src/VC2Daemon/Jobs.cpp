@@ -0,0 +1,437 @@
+/*********************************************************************/
+/* Jobs.cpp                                                          */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines the encode and decode jobs run by the vc2d service.       */
+/* The processing follows EncodeHQ-CBR, EncodeHQ-ConstQ and          */
+/* DecodeStream, producing only the stream or decoded pictures.      */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include "Jobs.h"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#include "Utils.h"
+#include "Quantisation.h"
+
+using std::string;
+using std::vector;
+using std::istream;
+using std::ostream;
+using std::invalid_argument;
+
+namespace {
+
+  const string encodeHQCBR = "EncodeHQ-CBR";
+  const string encodeHQConstQ = "EncodeHQ-ConstQ";
+  const string decodeStream = "DecodeStream";
+
+  // As for the command line programs (1 = 24/1.001, 2 = 24, 3 = 25, ...)
+  const FrameRate frameRateFromIndex(int index) {
+    switch (index) {
+      case 1: return FR24000_1001;
+      case 2: return FR24;
+      case 3: return FR25;
+      case 4: return FR30000_1001;
+      case 5: return FR30;
+      case 6: return FR50;
+      case 7: return FR60000_1001;
+      case 8: return FR60;
+      case 9: return FR15000_1001;
+      case 10: return FR25_2;
+      case 11: return FR48;
+      default: throw invalid_argument("invalid frame rate");
+    }
+  }
+
+  // Calculate quantisation indices using a binary search (as EncodeHQ-CBR)
+  const Array2D quantIndices(const Picture& coefficients,
+                             const Array1D& qMatrix,
+                             const Array2D& sliceBytes,
+                             const int scalar) {
+    const int ySlices = sliceBytes.shape()[0];
+    const int xSlices = sliceBytes.shape()[1];
+    Array2D indices(extents[ySlices][xSlices]);
+    const int waveletDepth = (qMatrix.size()-1)/3;
+    const PictureArray slices = split_into_blocks(coefficients, ySlices, xSlices);
+    for (int row=0; row<ySlices; ++row) {
+      for (int column=0; column<xSlices; ++column) {
+        // Available bytes is the size of slice less 4 byte overhead
+        const int bytesAvailable = sliceBytes[row][column] - 4;
+        int trialQ = 63;
+        int q = 127;
+        int delta = 64;
+        while (delta>0) {
+          delta >>= 1;
+          const Picture trialSlice = quantise_transform_np(slices[row][column], trialQ, qMatrix);
+          int bytesRequired = component_slice_bytes(trialSlice.y(), waveletDepth, scalar);
+          bytesRequired += component_slice_bytes(trialSlice.c1(), waveletDepth, scalar);
+          bytesRequired += component_slice_bytes(trialSlice.c2(), waveletDepth, scalar);
+          if (bytesRequired <= bytesAvailable) {
+            if (trialQ<q) q=trialQ;
+            trialQ -= delta;
+          }
+          else {
+            trialQ +=delta;
+          }
+        }
+        indices[row][column] = q;
+      }
+    }
+    return indices;
+  }
+
+  // Holds a context for the duration of a job, returning it to the cache after
+  template <class Context>
+  class Lease {
+    public:
+      Lease(ContextCache<Context>& c): cache(c) {};
+      ~Lease() { cache.release(context); }
+      template <class Settings> Context& get(const Settings& settings) {
+        if (!context || context->key!=settings.key()) {
+          cache.release(context);
+          context.reset();
+          context = cache.acquire(settings);
+        }
+        return *context;
+      }
+    private:
+      ContextCache<Context>& cache;
+      typename ContextCache<Context>::Pointer context;
+  };
+
+  int encode(const EncodeSettings& settings,
+             istream& inStream,
+             ostream& outStream,
+             ContextCache<EncodeContext>& cache,
+             const Progress& progress) {
+    Lease<EncodeContext> lease(cache);
+    EncodeContext& context = lease.get(settings);
+    Frame& inFrame = context.inFrame;
+    const PictureFormat& format = context.format;
+
+    inStream >> pictureio::wordWidth(settings.bytes);
+    inStream >> pictureio::left_justified;
+    inStream >> pictureio::offset_binary;
+    inStream >> pictureio::bitDepth(settings.lumaDepth, settings.chromaDepth);
+
+    outStream << dataunitio::start_sequence;
+    outStream << SequenceHeader(PROFILE_HQ, format.lumaHeight(), format.lumaWidth(),
+                                format.chromaFormat(), settings.interlaced,
+                                settings.frameRate, settings.topFieldFirst,
+                                settings.lumaDepth);
+
+    const int framePics = (settings.interlaced ? 2 : 1);
+    const int slicePrefix = 0;
+    int frame = 0;
+    while (true) {
+      inStream >> inFrame;
+      if (!inStream) {
+        if (frame==0) throw std::runtime_error("failed to read first input frame");
+        break;
+      }
+      for (int pic=0; pic<framePics; ++pic) {
+        const Picture picture = (settings.interlaced ?
+                                 (pic==0 ? inFrame.firstField() : inFrame.secondField()) :
+                                 inFrame.frame());
+        const Picture transform = waveletTransform(picture, settings.kernel, settings.waveletDepth);
+        Array2D qIndices(extents[context.ySlices][context.xSlices]);
+        if (settings.constQ) {
+          std::fill(qIndices.data(), qIndices.data()+qIndices.num_elements(), settings.qIndex);
+        }
+        else {
+          qIndices = quantIndices(transform, context.qMatrix, context.sliceBytes, settings.sliceScalar);
+        }
+        const Picture quantised = quantise_transform_np(transform, qIndices, context.qMatrix);
+        const PictureArray slices = split_into_blocks(quantised, context.ySlices, context.xSlices);
+        const Slices outSlices(slices, settings.waveletDepth, qIndices);
+        // Picture numbering follows the corresponding command line encoder
+        const WrappedPicture outWrapped((settings.constQ ? pic : frame),
+                                        settings.kernel,
+                                        settings.waveletDepth,
+                                        context.xSlices,
+                                        context.ySlices,
+                                        slicePrefix,
+                                        (settings.constQ ? 1 : settings.sliceScalar),
+                                        outSlices);
+        if (settings.constQ) {
+          outStream << dataunitio::highQualityVBR(1);
+        }
+        else {
+          outStream << dataunitio::highQualityCBR(context.sliceBytes, settings.sliceScalar);
+        }
+        outStream << outWrapped;
+      }
+      if (!outStream) throw std::runtime_error("failed to write output");
+      ++frame;
+      progress(frame);
+    }
+    outStream << dataunitio::end_sequence;
+    outStream.flush();
+    if (!outStream) throw std::runtime_error("failed to write output");
+    return frame;
+  }
+
+  int decode(istream& inStream,
+             ostream& outStream,
+             ContextCache<DecodeContext>& cache,
+             const Progress& progress) {
+    Lease<DecodeContext> lease(cache);
+    SequenceHeader sequence;
+    bool haveSequence = false;
+    int frame = 0;
+    int pic = 0;
+    inStream >> dataunitio::synchronise;
+    while (inStream) {
+      DataUnit du;
+      inStream >> du;
+      if (du.type==SEQUENCE_HEADER) {
+        du.stream() >> sequence;
+        haveSequence = true;
+        continue;
+      }
+      if (du.type==END_OF_SEQUENCE) break;
+      if ((du.type!=LD_PICTURE) && (du.type!=HQ_PICTURE)) continue;
+      if (!haveSequence) throw std::runtime_error("picture before sequence header");
+
+      const bool lowDelay = (du.type==LD_PICTURE);
+      PicturePreamble preamble;
+      du.stream() >> dataunitio::majorVersion(sequence.major_version);
+      if (lowDelay) du.stream() >> dataunitio::lowDelay >> preamble;
+      else du.stream() >> dataunitio::highQualityVBR(1) >> preamble;
+      DecodeContext& context = lease.get(DecodeSettings(sequence, preamble, lowDelay));
+
+      if (lowDelay) du.stream() >> sliceio::lowDelay(context.sliceBytes);
+      else du.stream() >> sliceio::highQualityVBR(preamble.slice_size_scalar);
+      du.stream() >> context.inSlices;
+      if (!du.stream()) throw std::runtime_error("failed to read compressed picture");
+
+      const Picture yuvQCoeffs = merge_blocks(context.inSlices.yuvSlices);
+      const Picture yuvTransform = (lowDelay ?
+        inverse_quantise_transform(yuvQCoeffs, context.inSlices.qIndices, context.qMatrix, preamble.depth_ho) :
+        inverse_quantise_transform_np(yuvQCoeffs, context.inSlices.qIndices, context.qMatrix, preamble.depth_ho));
+      const Picture outPicture = inverseWaveletTransform(yuvTransform,
+                                                         preamble.wavelet_kernel,
+                                                         preamble.depth,
+                                                         context.picFormat,
+                                                         preamble.depth_ho);
+      Frame& outFrame = context.outFrame;
+      if (sequence.interlace) {
+        if (pic==0) {
+          outFrame.firstField(outPicture);
+          pic = 1;
+          continue;
+        }
+        outFrame.secondField(outPicture);
+        pic = 0;
+      }
+      else {
+        outFrame.frame(outPicture);
+      }
+
+      const int depth = sequence.bitdepth;
+      const int min = -utils::pow(2, depth-1);
+      const int max = utils::pow(2, depth-1)-1;
+      outFrame.frame(clip(outFrame, min, max, min, max));
+
+      outStream << pictureio::wordWidth((depth==8) ? 1 : 2);
+      outStream << pictureio::left_justified;
+      outStream << pictureio::offset_binary;
+      outStream << pictureio::bitDepth(depth, depth);
+      outStream << outFrame;
+      if (!outStream) throw std::runtime_error("failed to write output");
+      ++frame;
+      progress(frame);
+    }
+    outStream.flush();
+    if (!outStream) throw std::runtime_error("failed to write output");
+    return frame;
+  }
+
+} // end unnamed namespace
+
+JobParams::JobParams(const vector<string>& tokens) {
+  for (vector<string>::const_iterator t=tokens.begin(); t!=tokens.end(); ++t) {
+    const string::size_type equals = t->find('=');
+    if (equals==string::npos) values[*t] = "1"; // A switch
+    else values[t->substr(0, equals)] = t->substr(equals+1);
+  }
+}
+
+bool JobParams::has(const string& key) const {
+  return (values.find(key)!=values.end());
+}
+
+const vector<string> JobParams::unused() const {
+  vector<string> result;
+  for (std::map<string, string>::const_iterator p=values.begin(); p!=values.end(); ++p) {
+    if (!used[p->first]) result.push_back(p->first);
+  }
+  return result;
+}
+
+EncodeSettings::EncodeSettings(const string& job, const JobParams& params):
+  constQ(job==encodeHQConstQ),
+  height(params.value<int>("height")),
+  width(params.value<int>("width")),
+  chromaFormat(params.value<ColourFormat>("format")),
+  bytes(params.value<int>("bytes", 2)),
+  interlaced(params.value<bool>("interlace", false)),
+  topFieldFirst(!params.value<bool>("bottomFieldFirst", false)),
+  kernel(params.value<WaveletKernel>("kernel")),
+  waveletDepth(params.value<int>("waveletDepth")),
+  ySize(params.value<int>("vSlice")),
+  xSize(params.value<int>("hSlice")),
+  qIndex(constQ ? params.value<int>("quantIndex") : 0),
+  compressedBytes(constQ ? 0 : params.value<int>("compressedBytes")),
+  frameRate(frameRateFromIndex(params.value<int>("framerate", 3))),
+  sliceScalar(params.value<int>("scalar", 1)) {
+  const int bitDepth = params.value<int>("bitDepth", 8*bytes);
+  lumaDepth = params.value<int>("lumaDepth", bitDepth);
+  chromaDepth = params.value<int>("chromaDepth", lumaDepth);
+
+  if (height<1) throw invalid_argument("picture height must be > 0");
+  if (width<1) throw invalid_argument("picture width must be > 0");
+  if (chromaFormat==UNKNOWN) throw invalid_argument("unknown colour format");
+  if ((1>bytes) || (bytes>4)) throw invalid_argument("bytes must be in range 1 to 4");
+  if ((1>lumaDepth) || (lumaDepth>(8*bytes)) || (1>chromaDepth) || (chromaDepth>(8*bytes)))
+    throw invalid_argument("bit depth must be in range 1 to 8*(bytes per sample)");
+  if (kernel==NullKernel) throw invalid_argument("invalid wavelet kernel");
+  if (waveletDepth<1) throw invalid_argument("wavelet depth must be 1 or more");
+  if ((ySize<1) || (xSize<1)) throw invalid_argument("slice sizes must be > 0");
+  if (constQ && ((qIndex<0) || (qIndex>63)))
+    throw invalid_argument("quantisation index must be in range 0 to 63");
+  if (!constQ && (compressedBytes<1)) throw invalid_argument("number of compressed bytes must be >0");
+  if (sliceScalar<1) throw invalid_argument("slice scalar must be >0");
+}
+
+// Everything except the file names affects the context
+const string EncodeSettings::key() const {
+  std::ostringstream text;
+  text << constQ << ' ' << height << ' ' << width << ' ' << chromaFormat << ' '
+       << bytes << ' ' << lumaDepth << ' ' << chromaDepth << ' '
+       << interlaced << ' ' << topFieldFirst << ' ' << kernel << ' '
+       << waveletDepth << ' ' << ySize << ' ' << xSize << ' '
+       << qIndex << ' ' << compressedBytes << ' ' << frameRate << ' ' << sliceScalar;
+  return text.str();
+}
+
+namespace {
+
+  // Number of slices in one dimension of a picture
+  int sliceCount(int pictureSize, int sliceSize, int waveletDepth, const char* dimension) {
+    const int transformSize = sliceSize*utils::pow(2, waveletDepth);
+    const int paddedPictureSize = paddedSize(pictureSize, waveletDepth);
+    const int slices = paddedPictureSize/transformSize;
+    if (paddedPictureSize != (slices*transformSize))
+      throw std::logic_error(string("Padded picture ")+dimension+" is not divisible by slice "+dimension);
+    return slices;
+  }
+
+  // Bytes for each slice of a picture, for CBR coding only
+  const Array2D cbrSliceBytes(const EncodeSettings& settings, int ySlices, int xSlices) {
+    if (settings.constQ) return Array2D(extents[ySlices][xSlices]);
+    const int pictureBytes = (settings.interlaced ? settings.compressedBytes/2 : settings.compressedBytes);
+    return slice_bytes(ySlices, xSlices, pictureBytes, settings.sliceScalar);
+  }
+
+} // end unnamed namespace
+
+EncodeContext::EncodeContext(const EncodeSettings& settings):
+  key(settings.key()),
+  format(settings.height, settings.width, settings.chromaFormat),
+  ySlices(sliceCount((settings.interlaced ? settings.height/2 : settings.height),
+                     settings.ySize, settings.waveletDepth, "height")),
+  xSlices(sliceCount(settings.width, settings.xSize, settings.waveletDepth, "width")),
+  qMatrix(quantMatrix(settings.kernel, settings.waveletDepth)),
+  sliceBytes(cbrSliceBytes(settings, ySlices, xSlices)),
+  inFrame(format, settings.interlaced, settings.topFieldFirst) {
+}
+
+DecodeSettings::DecodeSettings(const SequenceHeader& s, const PicturePreamble& p, bool ld):
+  sequence(s), preamble(p), lowDelay(ld) {
+}
+
+// The picture number and slice size scalar do not affect the context
+const string DecodeSettings::key() const {
+  std::ostringstream text;
+  text << sequence.height << ' ' << sequence.width << ' ' << sequence.chromaFormat << ' '
+       << sequence.interlace << ' ' << sequence.topFieldFirst << ' ' << sequence.bitdepth << ' '
+       << preamble.wavelet_kernel << ' ' << preamble.depth << ' ' << preamble.depth_ho << ' '
+       << preamble.slices_x << ' ' << preamble.slices_y << ' ' << lowDelay;
+  for (unsigned int band=0; band<preamble.quant_matrix.size(); ++band) {
+    text << (band==0 ? " q" : ",") << preamble.quant_matrix[band];
+  }
+  if (lowDelay) {
+    text << ' ' << preamble.slice_bytes.numerator << '/' << preamble.slice_bytes.denominator;
+  }
+  return text.str();
+}
+
+namespace {
+  const PictureFormat transformFormat(const SequenceHeader& s, const PicturePreamble& p) {
+    const int pictureHeight = (s.interlace ? s.height/2 : s.height);
+    return PictureFormat(paddedSize(pictureHeight, p.depth),
+                         paddedSize(s.width, p.depth+p.depth_ho),
+                         s.chromaFormat);
+  }
+}
+
+namespace {
+
+  // Bytes for each slice of a picture, for low delay coding only
+  const Array2D ldSliceBytes(const DecodeSettings& settings) {
+    const PicturePreamble& preamble = settings.preamble;
+    if (!settings.lowDelay) return Array2D(extents[preamble.slices_y][preamble.slices_x]);
+    const int pictureBytes = (preamble.slice_bytes.numerator*preamble.slices_y*preamble.slices_x)/
+                             preamble.slice_bytes.denominator;
+    return slice_bytes(preamble.slices_y, preamble.slices_x, pictureBytes, 1);
+  }
+
+} // end unnamed namespace
+
+DecodeContext::DecodeContext(const DecodeSettings& settings):
+  key(settings.key()),
+  picFormat((settings.sequence.interlace ? settings.sequence.height/2 : settings.sequence.height),
+            settings.sequence.width,
+            settings.sequence.chromaFormat),
+  qMatrix(settings.preamble.quant_matrix.size()>0 ?
+          settings.preamble.quant_matrix :
+          quantMatrix(settings.preamble.wavelet_kernel, settings.preamble.depth, settings.preamble.depth_ho)),
+  sliceBytes(ldSliceBytes(settings)),
+  inSlices(transformFormat(settings.sequence, settings.preamble),
+           settings.preamble.depth,
+           settings.preamble.slices_y,
+           settings.preamble.slices_x,
+           settings.preamble.depth_ho),
+  outFrame(PictureFormat(settings.sequence.height, settings.sequence.width, settings.sequence.chromaFormat),
+           settings.sequence.interlace,
+           settings.sequence.topFieldFirst) {
+}
+
+bool isJob(const string& name) {
+  return (name==encodeHQCBR) || (name==encodeHQConstQ) || (name==decodeStream);
+}
+
+int runJob(const string& name,
+           const JobParams& params,
+           istream& inStream,
+           ostream& outStream,
+           Contexts& contexts,
+           const Progress& progress) {
+  if (!isJob(name)) throw invalid_argument("unknown job \"" + name + "\"");
+  if (name==decodeStream) {
+    const vector<string> unknown = params.unused();
+    if (!unknown.empty()) throw invalid_argument("unknown parameter \"" + unknown[0] + "\"");
+    return decode(inStream, outStream, contexts.decoders, progress);
+  }
+  const EncodeSettings settings(name, params);
+  const vector<string> unknown = params.unused();
+  if (!unknown.empty()) throw invalid_argument("unknown parameter \"" + unknown[0] + "\"");
+  return encode(settings, inStream, outStream, contexts.encoders, progress);
+}
@@ -0,0 +1,189 @@
+/*********************************************************************/
+/* Jobs.h                                                            */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares the encode and decode jobs run by the vc2d service.      */
+/* Jobs are named after the equivalent command line programs         */
+/* (EncodeHQ-CBR, EncodeHQ-ConstQ and DecodeStream) and take the     */
+/* same parameters, given as "key=value" using the long option       */
+/* names, e.g. "width=1920". Set up that depends only on the         */
+/* picture format (quantisation matrix, slice sizes, buffers) is     */
+/* kept in contexts which are reused by later jobs of that format.   */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef JOBS_18OCT26
+#define JOBS_18OCT26
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "Arrays.h"
+#include "Picture.h"
+#include "Frame.h"
+#include "Slices.h"
+#include "WaveletTransform.h"
+#include "DataUnit.h"
+
+// Parameters of a job, from its "key=value" (or just "key") tokens
+class JobParams {
+  public:
+    explicit JobParams(const std::vector<std::string>& tokens);
+    bool has(const std::string& key) const;
+    // Throws invalid_argument if the key is missing or its value is invalid
+    template <class T> const T value(const std::string& key) const;
+    template <class T> const T value(const std::string& key, const T& defaultValue) const;
+    // Keys which have not been read, for reporting unknown parameters
+    const std::vector<std::string> unused() const;
+  private:
+    std::map<std::string, std::string> values;
+    mutable std::map<std::string, bool> used;
+};
+
+template <class T>
+const T JobParams::value(const std::string& key) const {
+  std::map<std::string, std::string>::const_iterator p = values.find(key);
+  if (p==values.end()) throw std::invalid_argument("missing parameter \"" + key + "\"");
+  used[key] = true;
+  std::istringstream text(p->second);
+  T result;
+  text >> result;
+  if (!text || (text.peek()!=std::char_traits<char>::eof()))
+    throw std::invalid_argument("invalid value for parameter \"" + key + "\"");
+  return result;
+}
+
+template <class T>
+const T JobParams::value(const std::string& key, const T& defaultValue) const {
+  return has(key) ? value<T>(key) : defaultValue;
+}
+
+// Encoding parameters, as for the HQ encoder programs
+struct EncodeSettings {
+  explicit EncodeSettings(const std::string& job, const JobParams& params);
+  const std::string key() const;
+  bool constQ;
+  int height;
+  int width;
+  ColourFormat chromaFormat;
+  int bytes;
+  int lumaDepth;
+  int chromaDepth;
+  bool interlaced;
+  bool topFieldFirst;
+  WaveletKernel kernel;
+  int waveletDepth;
+  int ySize;
+  int xSize;
+  int qIndex;
+  int compressedBytes;
+  FrameRate frameRate;
+  int sliceScalar;
+};
+
+// Format dependent state for encoding
+struct EncodeContext {
+  explicit EncodeContext(const EncodeSettings& settings);
+  const std::string key;
+  const PictureFormat format;
+  const int ySlices;
+  const int xSlices;
+  const Array1D qMatrix;
+  const Array2D sliceBytes; // Bytes per slice for CBR coding
+  Frame inFrame;
+};
+
+// Decoding parameters, from the sequence header and picture preamble
+struct DecodeSettings {
+  DecodeSettings(const SequenceHeader&, const PicturePreamble&, bool lowDelay);
+  const std::string key() const;
+  SequenceHeader sequence;
+  PicturePreamble preamble;
+  bool lowDelay;
+};
+
+// Format dependent state for decoding
+struct DecodeContext {
+  explicit DecodeContext(const DecodeSettings& settings);
+  const std::string key;
+  const PictureFormat picFormat; // Field or frame format
+  const Array1D qMatrix;
+  const Array2D sliceBytes; // Bytes per slice for low delay coding
+  Slices inSlices;
+  Frame outFrame;
+};
+
+// A cache of idle contexts, keyed by the settings they were built from
+template <class Context>
+class ContextCache {
+  public:
+    typedef boost::shared_ptr<Context> Pointer;
+    explicit ContextCache(int capacity): maxIdle(capacity) {};
+    // Returns an idle context matching the settings, or else a new one
+    template <class Settings> Pointer acquire(const Settings& settings);
+    // Return a context to the cache once a job has finished with it
+    void release(const Pointer& context);
+  private:
+    typedef std::multimap<std::string, Pointer> Idle;
+    const int maxIdle;
+    Idle idle;
+    boost::mutex mutex;
+};
+
+template <class Context>
+template <class Settings>
+typename ContextCache<Context>::Pointer ContextCache<Context>::acquire(const Settings& settings) {
+  const std::string key = settings.key();
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    typename Idle::iterator p = idle.find(key);
+    if (p!=idle.end()) {
+      const Pointer context = p->second;
+      idle.erase(p);
+      return context;
+    }
+  }
+  // Construct outside the lock, building a context may be slow
+  return Pointer(new Context(settings));
+}
+
+template <class Context>
+void ContextCache<Context>::release(const Pointer& context) {
+  if (!context) return;
+  boost::mutex::scoped_lock lock(mutex);
+  // When full discard an arbitrary context, they are all equally cheap to rebuild
+  if (static_cast<int>(idle.size())>=maxIdle) idle.erase(idle.begin());
+  idle.insert(std::make_pair(context->key, context));
+}
+
+struct Contexts {
+  explicit Contexts(int capacity): encoders(capacity), decoders(capacity) {};
+  ContextCache<EncodeContext> encoders;
+  ContextCache<DecodeContext> decoders;
+};
+
+// Called with the number of frames completed so far
+typedef boost::function<void (int)> Progress;
+
+// Is name one of the jobs that runJob can perform?
+bool isJob(const std::string& name);
+
+// Run a job, returning the number of frames processed.
+// Errors are reported by throwing an exception.
+int runJob(const std::string& name,
+           const JobParams& params,
+           std::istream& inStream,
+           std::ostream& outStream,
+           Contexts& contexts,
+           const Progress& progress);
+
+#endif //JOBS_18OCT26
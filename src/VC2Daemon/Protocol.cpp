@@ -0,0 +1,253 @@
+/*********************************************************************/
+/* Protocol.cpp                                                      */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Defines the request/reply protocol used between vc2d and vc2c.    */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#include "Protocol.h"
+
+#include <stdexcept> // For runtime_error
+#include <cstring> // For strerror, memcpy
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+
+const char protocol::defaultSocket[] = "/tmp/vc2d.socket";
+
+namespace {
+
+  // Input and output file descriptors are the only ones ever passed
+  const int maxFds = 2;
+
+  const runtime_error systemError(const string& what) {
+    return runtime_error(what + ": " + std::strerror(errno));
+  }
+
+  const sockaddr_un socketAddress(const string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+      throw std::invalid_argument("socket path is too long: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return address;
+  }
+
+  void sendAll(int socket, const char* data, size_t length) {
+    while (length>0) {
+      const ssize_t sent = send(socket, data, length, MSG_NOSIGNAL);
+      if (sent<0) {
+        if (errno==EINTR) continue;
+        throw systemError("send failed");
+      }
+      data += sent;
+      length -= sent;
+    }
+  }
+
+} // end unnamed namespace
+
+int protocol::listenOn(const string& path) {
+  const sockaddr_un address = socketAddress(path);
+  const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock<0) throw systemError("failed to create socket");
+  unlink(path.c_str()); // Remove any socket left by a previous instance
+  if (bind(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address))<0) {
+    close(sock);
+    throw systemError("failed to bind socket \"" + path + "\"");
+  }
+  if (listen(sock, SOMAXCONN)<0) {
+    close(sock);
+    throw systemError("failed to listen on socket \"" + path + "\"");
+  }
+  return sock;
+}
+
+int protocol::connectTo(const string& path) {
+  const sockaddr_un address = socketAddress(path);
+  const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock<0) throw systemError("failed to create socket");
+  if (connect(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address))<0) {
+    close(sock);
+    throw systemError("failed to connect to \"" + path + "\"");
+  }
+  return sock;
+}
+
+void protocol::sendRequest(int socket,
+                           const vector<string>& tokens,
+                           const vector<int>& fds) {
+  if (fds.size()>static_cast<size_t>(maxFds))
+    throw std::invalid_argument("too many file descriptors for request");
+  string message;
+  for (vector<string>::const_iterator t=tokens.begin(); t!=tokens.end(); ++t) {
+    if (t->empty() || (t->find('\n')!=string::npos))
+      throw std::invalid_argument("request tokens must be non-empty single lines");
+    message += *t + '\n';
+  }
+  message += '\n';
+
+  // The file descriptors go with the first chunk of the message
+  iovec iov;
+  iov.iov_base = const_cast<char*>(message.data());
+  iov.iov_len = message.size();
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  char control[CMSG_SPACE(maxFds*sizeof(int))];
+  if (!fds.empty()) {
+    std::memset(control, 0, sizeof(control));
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(fds.size()*sizeof(int));
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(fds.size()*sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fds[0], fds.size()*sizeof(int));
+  }
+  ssize_t sent;
+  do {
+    sent = sendmsg(socket, &msg, MSG_NOSIGNAL);
+  } while ((sent<0) && (errno==EINTR));
+  if (sent<0) throw systemError("failed to send request");
+  // Send the remainder, if any, without the file descriptors
+  sendAll(socket, message.data()+sent, message.size()-sent);
+}
+
+bool protocol::receiveRequest(int socket,
+                              vector<string>& tokens,
+                              vector<int>& fds) {
+  // Requests are short, so limit their size to guard against rogue clients
+  const size_t maxRequest = 65536;
+  tokens.clear();
+  fds.clear();
+  string message;
+  while (message.size()<2 || message.compare(message.size()-2, 2, "\n\n")!=0) {
+    if (message.size()>maxRequest) throw runtime_error("request too long");
+    char data[4096];
+    iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = sizeof(data);
+    char control[CMSG_SPACE(maxFds*sizeof(int))];
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    const ssize_t received = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+    if (received<0) {
+      if (errno==EINTR) continue;
+      throw systemError("failed to receive request");
+    }
+    for (cmsghdr* cmsg=CMSG_FIRSTHDR(&msg); cmsg; cmsg=CMSG_NXTHDR(&msg, cmsg)) {
+      if ((cmsg->cmsg_level==SOL_SOCKET) && (cmsg->cmsg_type==SCM_RIGHTS)) {
+        const size_t count = (cmsg->cmsg_len-CMSG_LEN(0))/sizeof(int);
+        for (size_t i=0; i<count; ++i) {
+          int fd;
+          std::memcpy(&fd, CMSG_DATA(cmsg)+i*sizeof(int), sizeof(int));
+          fds.push_back(fd);
+        }
+      }
+    }
+    if (received==0) return false;
+    message.append(data, received);
+  }
+  // Split into tokens, dropping the terminating empty line
+  string::size_type begin = 0;
+  string::size_type end;
+  while ((end=message.find('\n', begin))!=begin) {
+    tokens.push_back(message.substr(begin, end-begin));
+    begin = end+1;
+  }
+  return true;
+}
+
+void protocol::sendLine(int socket, const string& line) {
+  const string message = line + '\n';
+  sendAll(socket, message.data(), message.size());
+}
+
+protocol::LineReader::LineReader(int socket): sock(socket) {}
+
+bool protocol::LineReader::getLine(string& line) {
+  string::size_type end;
+  while ((end=buffer.find('\n'))==string::npos) {
+    char data[4096];
+    const ssize_t received = recv(sock, data, sizeof(data), 0);
+    if (received<0) {
+      if (errno==EINTR) continue;
+      throw systemError("failed to receive reply");
+    }
+    if (received==0) return false;
+    buffer.append(data, received);
+  }
+  line = buffer.substr(0, end);
+  buffer.erase(0, end+1);
+  return true;
+}
+
+protocol::FileDescriptorBuffer::FileDescriptorBuffer(int fileDescriptor,
+                                                     std::ios_base::openmode mode):
+  fd(fileDescriptor), buffer(65536) {
+  if (mode & std::ios_base::out) {
+    setp(&buffer[0], &buffer[0]+buffer.size());
+  }
+  else {
+    setg(&buffer[0], &buffer[0], &buffer[0]); // Empty, so first read underflows
+  }
+}
+
+protocol::FileDescriptorBuffer::~FileDescriptorBuffer() {
+  flushBuffer();
+}
+
+protocol::FileDescriptorBuffer::int_type protocol::FileDescriptorBuffer::underflow() {
+  if (gptr()<egptr()) return traits_type::to_int_type(*gptr());
+  ssize_t count;
+  do {
+    count = read(fd, &buffer[0], buffer.size());
+  } while ((count<0) && (errno==EINTR));
+  if (count<=0) return traits_type::eof();
+  setg(&buffer[0], &buffer[0], &buffer[0]+count);
+  return traits_type::to_int_type(*gptr());
+}
+
+protocol::FileDescriptorBuffer::int_type protocol::FileDescriptorBuffer::overflow(int_type c) {
+  if (!flushBuffer()) return traits_type::eof();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+int protocol::FileDescriptorBuffer::sync() {
+  return flushBuffer() ? 0 : -1;
+}
+
+bool protocol::FileDescriptorBuffer::flushBuffer() {
+  if (!pbase()) return true; // Input buffer, nothing to write
+  const char* data = pbase();
+  while (data<pptr()) {
+    const ssize_t written = write(fd, data, pptr()-data);
+    if (written<0) {
+      if (errno==EINTR) continue;
+      return false;
+    }
+    data += written;
+  }
+  setp(&buffer[0], &buffer[0]+buffer.size());
+  return true;
+}
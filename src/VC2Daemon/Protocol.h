@@ -0,0 +1,80 @@
+/*********************************************************************/
+/* Protocol.h                                                        */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Declares the request/reply protocol used between vc2d and vc2c    */
+/* over a Unix domain (local) socket.                                */
+/* A request is a list of text tokens, the job name followed by      */
+/* "key=value" parameters, each terminated by a newline and the      */
+/* whole request terminated by an empty line. Input and output file  */
+/* descriptors may be passed with the request (SCM_RIGHTS).          */
+/* Replies are single lines: "progress <n>" after each frame,        */
+/* then either "done <n>" or "error <message>".                      */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+#ifndef PROTOCOL_18OCT26
+#define PROTOCOL_18OCT26
+
+#include <string>
+#include <vector>
+#include <streambuf>
+
+namespace protocol {
+
+  // Socket used if none is specified on the command line
+  extern const char defaultSocket[];
+
+  // Create a socket listening on path (any stale socket file is removed)
+  int listenOn(const std::string& path);
+
+  // Connect to a listening socket
+  int connectTo(const std::string& path);
+
+  // Send a request, with optional file descriptors, on a connected socket
+  void sendRequest(int socket,
+                   const std::vector<std::string>& tokens,
+                   const std::vector<int>& fds);
+
+  // Receive a request. Received file descriptors are owned by the caller.
+  // Returns false if the peer closed the connection before a whole request.
+  bool receiveRequest(int socket,
+                      std::vector<std::string>& tokens,
+                      std::vector<int>& fds);
+
+  // Send a single reply line (the newline is added)
+  void sendLine(int socket, const std::string& line);
+
+  // Reads reply lines from a connected socket
+  class LineReader {
+    public:
+      explicit LineReader(int socket);
+      // Returns false at end of connection
+      bool getLine(std::string& line);
+    private:
+      const int sock;
+      std::string buffer;
+  };
+
+  // Stream buffer reading from, or writing to, a file descriptor.
+  // The file descriptor is not closed by the buffer.
+  class FileDescriptorBuffer: public std::streambuf {
+    public:
+      FileDescriptorBuffer(int fd, std::ios_base::openmode mode);
+      ~FileDescriptorBuffer();
+    protected:
+      int_type underflow();
+      int_type overflow(int_type c);
+      int sync();
+    private:
+      FileDescriptorBuffer(const FileDescriptorBuffer&); // Not copyable
+      FileDescriptorBuffer& operator=(const FileDescriptorBuffer&);
+      bool flushBuffer();
+      const int fd;
+      std::vector<char> buffer;
+  };
+
+} // end namespace protocol
+
+#endif //PROTOCOL_18OCT26
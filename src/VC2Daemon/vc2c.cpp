@@ -0,0 +1,153 @@
+/*********************************************************************/
+/* vc2c.cpp                                                          */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* Command line client for the vc2d encode/decode service.           */
+/* Submits one job, passing open input and output files to the       */
+/* service, and reports progress until the job completes.            */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+const char version[] = __DATE__ " @ " __TIME__ ;
+const char summary[] = "Submits a VC-2 encode or decode job to the vc2d service";
+const char description[] = "\
+This program submits a job to a running vc2d service and waits for it to complete.\n\
+The job name is followed by the input and output file names and then the job\n\
+parameters, as key=value using the long option names of the corresponding\n\
+command line program. Jobs are:\n\
+  EncodeHQ-CBR    planar video to VC-2 HQ stream at a constant bit rate\n\
+  EncodeHQ-ConstQ planar video to VC-2 HQ stream with a constant quantiser\n\
+  DecodeStream    VC-2 (LD or HQ) stream to planar video\n\
+  shutdown        stop the service, once current jobs are complete (no files)\n\
+The files are opened by this program and passed to the service, so standard\n\
+input and output (\"-\") may be used. Alternatively the file names may be sent\n\
+for the service to open (--paths).\n\
+\n\
+Example: vc2c -v EncodeHQ-CBR inFileName outFileName width=1920 height=1080\n\
+         format=4:2:2 bitDepth=10 kernel=LeGall waveletDepth=3 vSlice=1 hSlice=2\n\
+         compressedBytes=1000000";
+const char* details[] = {version, summary, description};
+
+#include <cstdlib> //for EXIT_SUCCESS, EXIT_FAILURE
+#include <stdexcept> //For standard logic errors
+#include <iostream> //For cin, cout, cerr
+#include <string>
+#include <vector>
+#include <cstdio> // for perror
+#include <cstring> // for strerror
+#include <cerrno>
+#include <climits> // for PATH_MAX
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "ClientParams.h"
+#include "Protocol.h"
+
+using std::cerr;
+using std::clog;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+
+  // The service does not share the client's working directory
+  const string absolutePath(const string& fileName) {
+    if (!fileName.empty() && fileName[0]=='/') return fileName;
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) throw std::runtime_error("can't get current directory");
+    return string(cwd) + "/" + fileName;
+  }
+
+} // end unnamed namespace
+
+int main(int argc, char * argv[]) {
+
+try { //Giant try block around all code to get error messages
+
+  // get command line parameters
+  ProgramParams params = getCommandLineParams(argc, argv, details);
+  if (!params.error.empty()) {
+    cerr << "Command line error: " << params.error << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Create convenient aliases for program parameters
+  const string inFileName = params.inFileName;
+  const string outFileName = params.outFileName;
+  const bool verbose = params.verbose;
+
+  vector<string> tokens;
+  tokens.push_back(params.job);
+  vector<int> fds;
+  if (params.job!="shutdown") {
+    if (params.sendPaths) {
+      tokens.push_back("in=" + absolutePath(inFileName));
+      tokens.push_back("out=" + absolutePath(outFileName));
+    }
+    else {
+      const int inFd = (inFileName=="-") ? STDIN_FILENO : open(inFileName.c_str(), O_RDONLY);
+      if (inFd<0) {
+        perror((string("Failed to open input file \"")+inFileName+"\"").c_str());
+        return EXIT_FAILURE;
+      }
+      const int outFd = (outFileName=="-") ? STDOUT_FILENO :
+                        open(outFileName.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0666);
+      if (outFd<0) {
+        perror((string("Failed to open output file \"")+outFileName+"\"").c_str());
+        return EXIT_FAILURE;
+      }
+      fds.push_back(inFd);
+      fds.push_back(outFd);
+    }
+  }
+  tokens.insert(tokens.end(), params.jobParams.begin(), params.jobParams.end());
+
+  if (verbose) {
+    clog << "socket = " << params.socketPath << endl;
+    clog << "job = " << params.job << endl;
+    if (params.job!="shutdown") {
+      clog << "input file = " << inFileName << endl;
+      clog << "output file = " << outFileName << endl;
+    }
+  }
+
+  const int connection = protocol::connectTo(params.socketPath);
+  protocol::sendRequest(connection, tokens, fds);
+  // The service has its own copies of the file descriptors now
+  for (vector<int>::const_iterator fd=fds.begin(); fd!=fds.end(); ++fd) {
+    if (*fd!=STDIN_FILENO && *fd!=STDOUT_FILENO) close(*fd);
+  }
+
+  protocol::LineReader reader(connection);
+  string line;
+  while (reader.getLine(line)) {
+    if (line.compare(0, 9, "progress ")==0) {
+      if (verbose) clog << "\rFrames completed: " << line.substr(9) << std::flush;
+    }
+    else if (line.compare(0, 5, "done ")==0) {
+      if (verbose) clog << "\rCompleted after " << line.substr(5) << " frames" << endl;
+      close(connection);
+      return EXIT_SUCCESS;
+    }
+    else if (line.compare(0, 6, "error ")==0) {
+      if (verbose) clog << endl;
+      cerr << "Error: " << line.substr(6) << endl;
+      close(connection);
+      return EXIT_FAILURE;
+    }
+  }
+  close(connection);
+  cerr << "Error: connection to service lost" << endl;
+  return EXIT_FAILURE;
+} // end of try block
+
+// Report error messages from try block
+catch (const std::exception& ex) {
+    cerr << "Error: " << ex.what() << endl;
+    return EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,232 @@
+/*********************************************************************/
+/* vc2d.cpp                                                          */
+/* Author: BBC Research                                              */
+/* This version 18th October 2026                                    */
+/*                                                                   */
+/* A persistent VC-2 encode/decode service.                          */
+/* Listens on a Unix domain socket for jobs from vc2c and runs them  */
+/* on a shared pool of threads, reusing format dependent contexts    */
+/* between jobs. Progress is streamed back to the client.            */
+/* Copyright (c) BBC 2011-2026 -- For license see the LICENSE file   */
+/*********************************************************************/
+
+const char version[] = __DATE__ " @ " __TIME__ ;
+const char summary[] = "Runs VC-2 encode and decode jobs submitted over a Unix domain socket";
+const char description[] = "\
+This program is a long running service which encodes and decodes VC-2 streams\n\
+on behalf of local clients (see vc2c). This avoids process start up and buffer\n\
+set up for each clip, which can dominate processing time for short clips.\n\
+Jobs are named after, and take the same parameters as, the command line programs:\n\
+  EncodeHQ-CBR    planar video to VC-2 HQ stream at a constant bit rate\n\
+  EncodeHQ-ConstQ planar video to VC-2 HQ stream with a constant quantiser\n\
+  DecodeStream    VC-2 (LD or HQ) stream to planar video\n\
+Parameters are given as key=value using the long option names of the\n\
+corresponding program (e.g. width=1920 height=1080 format=4:2:2).\n\
+Input and output file descriptors are passed from the client, or the client may\n\
+send file names for the service to open.\n\
+Jobs run concurrently, up to the number of threads. Format dependent set up\n\
+(quantisation matrix, slice sizes and picture buffers) is kept and reused by\n\
+later jobs with the same format.\n\
+\n\
+Example: vc2d -v -j 4 -s /tmp/vc2d.socket";
+const char* details[] = {version, summary, description};
+
+#include <cstdlib> //for EXIT_SUCCESS, EXIT_FAILURE
+#include <stdexcept> //For standard logic errors
+#include <iostream> //For cin, cout, cerr
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio> // for perror
+#include <cerrno>
+#include <csignal>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <boost/bind/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "DaemonParams.h"
+#include "Protocol.h"
+#include "Jobs.h"
+#include "ThreadPool.h"
+
+using std::cerr;
+using std::clog;
+using std::endl;
+using std::string;
+using std::vector;
+using std::filebuf;
+using std::streambuf;
+using std::ios_base;
+using std::istream;
+using std::ostream;
+
+namespace {
+
+  struct Server {
+    Server(int contextCapacity, int socket, bool v):
+      contexts(contextCapacity), listenSocket(socket), verbose(v), jobCount(0) {};
+    Contexts contexts;
+    const int listenSocket;
+    const bool verbose;
+    boost::mutex logMutex;
+    int jobCount;
+  };
+
+  void log(Server& server, const string& message) {
+    boost::mutex::scoped_lock lock(server.logMutex);
+    clog << message << endl;
+  }
+
+  void reportProgress(int connection, int frames) {
+    std::ostringstream line;
+    line << "progress " << frames;
+    protocol::sendLine(connection, line.str());
+  }
+
+  // Run the job for one client connection
+  void serve(int connection, Server& server) {
+    vector<string> tokens;
+    vector<int> fds;
+    int jobNumber;
+    {
+      boost::mutex::scoped_lock lock(server.logMutex);
+      jobNumber = ++server.jobCount;
+    }
+    std::ostringstream prefix;
+    prefix << "Job " << jobNumber << ": ";
+    try {
+      if (!protocol::receiveRequest(connection, tokens, fds))
+        throw std::runtime_error("incomplete request");
+      if (tokens.empty()) throw std::invalid_argument("empty request");
+      const string job = tokens[0];
+      if (server.verbose) log(server, prefix.str() + job);
+
+      if (job=="shutdown") {
+        protocol::sendLine(connection, "done 0");
+        // Makes accept fail, so the main thread stops accepting jobs
+        shutdown(server.listenSocket, SHUT_RDWR);
+      }
+      else {
+        // Input and output file names, if no file descriptors were passed
+        string inFileName, outFileName;
+        vector<string> paramTokens;
+        for (vector<string>::const_iterator t=tokens.begin()+1; t!=tokens.end(); ++t) {
+          if (t->compare(0, 3, "in=")==0) inFileName = t->substr(3);
+          else if (t->compare(0, 4, "out=")==0) outFileName = t->substr(4);
+          else paramTokens.push_back(*t);
+        }
+        const JobParams params(paramTokens);
+        int frames;
+        if (fds.size()==2) {
+          protocol::FileDescriptorBuffer inBuffer(fds[0], ios_base::in);
+          protocol::FileDescriptorBuffer outBuffer(fds[1], ios_base::out);
+          istream inStream(&inBuffer);
+          ostream outStream(&outBuffer);
+          frames = runJob(job, params, inStream, outStream, server.contexts,
+                          boost::bind(reportProgress, connection, boost::placeholders::_1));
+        }
+        else if (fds.empty() && !inFileName.empty() && !outFileName.empty()) {
+          filebuf inFileBuffer, outFileBuffer;
+          if (!inFileBuffer.open(inFileName.c_str(), ios_base::in|ios_base::binary))
+            throw std::runtime_error("failed to open input file \"" + inFileName + "\"");
+          if (!outFileBuffer.open(outFileName.c_str(), ios_base::out|ios_base::binary))
+            throw std::runtime_error("failed to open output file \"" + outFileName + "\"");
+          istream inStream(&inFileBuffer);
+          ostream outStream(&outFileBuffer);
+          frames = runJob(job, params, inStream, outStream, server.contexts,
+                          boost::bind(reportProgress, connection, boost::placeholders::_1));
+          if (!outFileBuffer.close())
+            throw std::runtime_error("failed to write output file \"" + outFileName + "\"");
+        }
+        else {
+          throw std::invalid_argument("request needs input and output file descriptors or file names");
+        }
+        std::ostringstream done;
+        done << "done " << frames;
+        protocol::sendLine(connection, done.str());
+        if (server.verbose) log(server, prefix.str() + done.str());
+      }
+    }
+    catch (const std::exception& ex) {
+      if (server.verbose) log(server, prefix.str() + "error " + ex.what());
+      try {
+        protocol::sendLine(connection, string("error ") + ex.what());
+      }
+      catch (const std::exception&) {} // Client has gone away
+    }
+    for (vector<int>::const_iterator fd=fds.begin(); fd!=fds.end(); ++fd) close(*fd);
+    close(connection);
+  }
+
+  volatile std::sig_atomic_t interrupted = 0;
+
+  void onSignal(int) {
+    interrupted = 1;
+  }
+
+} // end unnamed namespace
+
+int main(int argc, char * argv[]) {
+
+try { //Giant try block around all code to get error messages
+
+  // get command line parameters
+  ProgramParams params = getCommandLineParams(argc, argv, details);
+  if (!params.error.empty()) {
+    cerr << "Command line error: " << params.error << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Create convenient aliases for program parameters
+  const string socketPath = params.socketPath;
+  const bool verbose = params.verbose;
+
+  // Clients going away must not kill the service
+  std::signal(SIGPIPE, SIG_IGN);
+  // Stop accepting jobs on interrupt (without restarting accept)
+  struct sigaction action;
+  action.sa_handler = onSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = 0;
+  sigaction(SIGINT, &action, 0);
+  sigaction(SIGTERM, &action, 0);
+
+  const int listenSocket = protocol::listenOn(socketPath);
+  Server server(params.contexts, listenSocket, verbose);
+  {
+    // Destroying the pool completes jobs already accepted
+    ThreadPool pool(params.threads);
+
+    if (verbose) {
+      clog << "Listening on \"" << socketPath << "\"" << endl;
+      clog << "threads = " << pool.size() << endl;
+      clog << "contexts = " << params.contexts << endl;
+    }
+
+    while (!interrupted) {
+      const int connection = accept(listenSocket, 0, 0);
+      if (connection<0) {
+        if (errno==EINTR) continue;
+        if (errno!=EINVAL) perror("accept failed");
+        break; // EINVAL means a shutdown job has shut the socket
+      }
+      pool.submit(boost::bind(serve, connection, boost::ref(server)));
+    }
+    if (verbose) log(server, "Shutting down");
+  }
+  close(listenSocket);
+  unlink(socketPath.c_str());
+} // end of try block
+
+// Report error messages from try block
+catch (const std::exception& ex) {
+    cerr << "Error: " << ex.what() << endl;
+    return EXIT_FAILURE;
+}
+
+  return EXIT_SUCCESS;
+}